@@ -1,6 +1,6 @@
 /*
 FLAC audio decoder. Choice of public domain or MIT-0. See license statements at the end of this file.
-dr_flac - v0.12.13 - 2020-05-16
+dr_flac - v0.12.14 - TBD
 
 David Reid - mackron@gmail.com
 
@@ -232,7 +232,7 @@ extern "C" {
 
 #define DRFLAC_VERSION_MAJOR     0
 #define DRFLAC_VERSION_MINOR     12
-#define DRFLAC_VERSION_REVISION  13
+#define DRFLAC_VERSION_REVISION  14
 #define DRFLAC_VERSION_STRING    DRFLAC_XSTRINGIFY(DRFLAC_VERSION_MAJOR) "." DRFLAC_XSTRINGIFY(DRFLAC_VERSION_MINOR) "." DRFLAC_XSTRINGIFY(DRFLAC_VERSION_REVISION)
 
 #include <stddef.h> /* For size_t. */
@@ -557,6 +557,36 @@ Use pMetadata->type to determine which metadata block is being handled and how t
 */
 typedef void (* drflac_meta_proc)(void* pUserData, drflac_metadata* pMetadata);
 
+/* The different ways a frame that fails to decode can be handled. See drflac_set_frame_error_policy(). */
+typedef enum
+{
+    drflac_frame_error_policy_skip    = 0,  /* The frame is skipped. Nothing is output for it. This is the default. */
+    drflac_frame_error_policy_silence = 1   /* The frame is replaced with silence of the same length. */
+} drflac_frame_error_policy;
+
+/*
+Callback for when a frame fails to decode.
+
+
+Parameters
+----------
+pUserData (in)
+    The user data that was passed to drflac_set_frame_error_policy().
+
+firstPCMFrame (in)
+    The index of the first PCM frame of the bad frame, as specified in it's header.
+
+pcmFrameCount (in)
+    The number of PCM frames in the bad frame, as specified in it's header.
+
+
+Remarks
+-------
+This is called from inside drflac_read_pcm_frames_*() and drflac_seek_to_pcm_frame(). A frame fails to decode when it's CRC does not match or when
+it's contents are invalid. The frame header has it's own CRC so the values passed in can be trusted.
+*/
+typedef void (* drflac_frame_error_proc)(void* pUserData, drflac_uint64 firstPCMFrame, drflac_uint32 pcmFrameCount);
+
 
 typedef struct
 {
@@ -690,6 +720,15 @@ typedef struct
     /* The user data posted to the metadata callback function. */
     void* pUserDataMD;
 
+    /* The function to call when a frame fails to decode. */
+    drflac_frame_error_proc onFrameError;
+
+    /* The user data posted to the frame error callback function. */
+    void* pUserDataFrameError;
+
+    /* How frames that fail to decode are handled. */
+    drflac_frame_error_policy frameErrorPolicy;
+
     /* Memory allocation callbacks. */
     drflac_allocation_callbacks allocationCallbacks;
 
@@ -747,11 +786,20 @@ typedef struct
     /* Internal use only. Only used with Ogg containers. Points to a drflac_oggbs object. This is an offset of pExtraData. */
     void* _oggbs;
 
+    /* Internal use only. The cache of recently decoded frames, or NULL if caching is disabled. See drflac_set_frame_cache_size(). */
+    void* _pFrameCache;
+
+    /* Internal use only. The decoding pipeline to use for this stream. This is selected once in drflac__init_from_info() based on the bits per sample. */
+    drflac_uint8 _decodePipeline;
+
     /* Internal use only. Used for profiling and testing different seeking modes. */
     drflac_bool32 _noSeekTableSeek    : 1;
     drflac_bool32 _noBinarySearchSeek : 1;
     drflac_bool32 _noBruteForceSeek   : 1;
 
+    /* Internal use only. Set when currentFLACFrame was loaded from the frame cache, in which case the bit streamer is not sitting on the next frame. */
+    drflac_bool32 _isFrameFromCache   : 1;
+
     /* The bit streamer. The raw FLAC data is fed through this object. */
     drflac_bs bs;
 
@@ -941,6 +989,58 @@ drflac_open_memory_with_metadata()
 DRFLAC_API void drflac_close(drflac* pFlac);
 
 
+/*
+Creates another decoder for the same stream as an existing decoder.
+
+
+Parameters
+----------
+pFlac (in)
+    The decoder to clone.
+
+onRead (in, optional)
+    The function to call when data needs to be read by the new decoder. See remarks.
+
+onSeek (in, optional)
+    The function to call when the read position of the new decoder needs to move. See remarks.
+
+pUserData (in, optional)
+    A pointer to application defined data that will be passed to onRead and onSeek.
+
+pAllocationCallbacks (in, optional)
+    A pointer to application defined callbacks for managing memory allocations. When NULL, the callbacks of `pFlac` are used.
+
+
+Return Value
+------------
+Returns a pointer to the new decoder, or NULL if an error occurs.
+
+
+Remarks
+-------
+The new decoder shares the STREAMINFO properties and seek table of `pFlac` and does not need to read any of the metadata blocks. Only the bit streamer
+and the buffer for decoded samples are allocated. This makes it cheap to create multiple read cursors over the same stream, such as one for each thread
+when reading different regions of a file in parallel. The new decoder is positioned at the first PCM frame.
+
+If `pFlac` was opened with `drflac_open_memory()` or `drflac_open_memory_with_metadata()`, `onRead` and `onSeek` can be NULL in which case the new decoder
+will read from the same block of memory. Otherwise, `onRead` and `onSeek` must be specified, and must read from an independent handle to the same data,
+such as a separate `FILE`. A decoder opened with `drflac_open_file()` does not retain the path so it can only be cloned by specifying callbacks.
+
+Because the seek table is shared, `pFlac` must not be closed until all of it's clones have been closed. Each decoder must only be used by one thread at
+a time. The frame cache (see `drflac_set_frame_cache_size()`) is not shared, and is disabled for the new decoder.
+
+Close the new decoder with `drflac_close()`.
+
+
+See Also
+--------
+drflac_open()
+drflac_open_memory()
+drflac_close()
+*/
+DRFLAC_API drflac* drflac_clone(const drflac* pFlac, drflac_read_proc onRead, drflac_seek_proc onSeek, void* pUserData, const drflac_allocation_callbacks* pAllocationCallbacks);
+
+
 /*
 Reads sample data from the given FLAC decoder, output as interleaved signed 32-bit PCM.
 
@@ -1046,6 +1146,70 @@ Return Value
 */
 DRFLAC_API drflac_bool32 drflac_seek_to_pcm_frame(drflac* pFlac, drflac_uint64 pcmFrameIndex);
 
+/*
+Sets the maximum size of the cache of recently decoded FLAC frames.
+
+
+Parameters
+----------
+pFlac (in)
+    The decoder.
+
+sizeInBytes (in)
+    The maximum number of bytes to use for the cache, including bookkeeping. Set this to 0 to disable the cache.
+
+
+Return Value
+------------
+`DRFLAC_TRUE` if successful; `DRFLAC_FALSE` otherwise. This will fail if `sizeInBytes` is too small to hold a single frame, or if the memory could not
+be allocated, in which case the cache will be disabled.
+
+
+Remarks
+-------
+The cache is disabled by default. When enabled, every frame that is decoded is stored in the cache, keyed by the index of it's first PCM frame. When
+the cache is full the least recently used frame is evicted. Seeking to a PCM frame inside a cached frame, and reading the frames that follow it, will
+be served from the cache without touching the underlying stream. This is useful for access patterns that repeatedly seek back to the same region of
+the stream, such as looping or scrubbing.
+
+Each frame takes `channels * maxBlockSizeInPCMFrames * sizeof(drflac_int32)` bytes, so a cache of a few megabytes will hold several seconds of audio
+for a typical stream.
+
+Changing the size of the cache will clear it.
+*/
+DRFLAC_API drflac_bool32 drflac_set_frame_cache_size(drflac* pFlac, size_t sizeInBytes);
+
+/*
+Sets how frames that fail to decode are handled.
+
+
+Parameters
+----------
+pFlac (in)
+    The decoder.
+
+policy (in)
+    The policy to apply to bad frames. See remarks.
+
+onFrameError (in, optional)
+    The function to call for each bad frame.
+
+pUserData (in, optional)
+    A pointer to application defined data that will be passed to onFrameError.
+
+
+Remarks
+-------
+A frame fails to decode when it's CRC does not match, or when it's contents are invalid. In both cases the decoder scans forward for the next frame
+header and continues from there.
+
+With `drflac_frame_error_policy_skip`, which is the default, nothing is output for the bad frame. This means the output will be shorter than the
+stream. With `drflac_frame_error_policy_silence` the bad frame is replaced with silence of the same length so the timing of the output is preserved.
+
+`onFrameError` is called for each bad frame regardless of the policy, which can be used for logging or for applying a custom concealment strategy.
+*/
+DRFLAC_API void drflac_set_frame_error_policy(drflac* pFlac, drflac_frame_error_policy policy, drflac_frame_error_proc onFrameError, void* pUserData);
+
 
 
 #ifndef DR_FLAC_NO_STDIO
@@ -1236,6 +1400,68 @@ DRFLAC_API drflac_int16* drflac_open_memory_and_read_pcm_frames_s16(const void*
 /* Same as drflac_open_memory_and_read_pcm_frames_s32(), except returns 32-bit floating-point samples. */
 DRFLAC_API float* drflac_open_memory_and_read_pcm_frames_f32(const void* data, size_t dataSize, unsigned int* channels, unsigned int* sampleRate, drflac_uint64* totalPCMFrameCount, const drflac_allocation_callbacks* pAllocationCallbacks);
 
+
+/* Structure describing a single stream for use with drflac_decode_batch(). */
+typedef struct
+{
+    /* The encoded data. When pData is NULL the stream is opened from pFilePath instead. */
+    const void* pData;
+    size_t dataSize;
+    const char* pFilePath;
+
+    /*
+    The buffer to receive the decoded samples as interleaved signed 32-bit PCM, and it's capacity in PCM frames. When pPCMFramesOut is NULL,
+    nothing is decoded and only the properties below are retrieved which can be used for sizing the buffer.
+    */
+    drflac_int32* pPCMFramesOut;
+    drflac_uint64 pcmFrameCapacity;
+
+    /* Output. Set by drflac_decode_batch(). */
+    drflac_uint32 channels;
+    drflac_uint32 sampleRate;
+    drflac_uint64 totalPCMFrameCount;
+    drflac_uint64 pcmFramesRead;
+    drflac_bool32 isSuccessful;
+} drflac_batch_item;
+
+/*
+Decodes a list of streams into caller provided buffers.
+
+
+Parameters
+----------
+pItems (in, out)
+    The streams to decode. The output members of each item are filled in.
+
+itemCount (in)
+    The number of items in pItems.
+
+pAllocationCallbacks (in, optional)
+    A pointer to application defined callbacks for managing memory allocations.
+
+
+Return Value
+------------
+The number of items that were successfully decoded.
+
+
+Remarks
+-------
+This is intended for loading a large number of small files, such as a sample library, where the cost of allocating and freeing a decoder for each
+file becomes significant. A single allocation is used for the decoder of every item, and is only grown when an item needs more memory than any of
+the previous ones.
+
+A stream whose length is not known up front is decoded until the end of the stream or until `pcmFrameCapacity` is reached, whichever comes first.
+Check `pcmFramesRead` for the number of PCM frames actually written. If the buffer is too small for a stream of known length, as many PCM frames
+as will fit are written and `isSuccessful` is set to false.
+
+Items are decoded sequentially on the calling thread. To decode across multiple threads, split the list and call this once per thread with it's own
+range of items.
+
+Opening from a file path is not available when DR_FLAC_NO_STDIO is defined.
+*/
+DRFLAC_API drflac_uint32 drflac_decode_batch(drflac_batch_item* pItems, drflac_uint32 itemCount, const drflac_allocation_callbacks* pAllocationCallbacks);
+
 /*
 Frees memory that was allocated internally by dr_flac.
 
@@ -1653,6 +1879,10 @@ typedef drflac_int32 drflac_result;
 #define DRFLAC_CHANNEL_ASSIGNMENT_RIGHT_SIDE            9
 #define DRFLAC_CHANNEL_ASSIGNMENT_MID_SIDE              10
 
+#define DRFLAC_DECODE_PIPELINE_GENERIC                  0   /* Chooses between 32- and 64-bit arithmetic for each subframe. */
+#define DRFLAC_DECODE_PIPELINE_32                       1   /* Always uses 32-bit arithmetic. Only used when the bits per sample is <= 16. */
+#define DRFLAC_MAX_SPECIALIZED_LPC_ORDER                12  /* Residual decoders are compiled for each predictor order up to and including this. */
+
 #define drflac_align(x, a)                              ((((x) + (a) - 1) / (a)) * (a))
 
 
@@ -2575,51 +2805,6 @@ static drflac_bool32 drflac__seek_bits(drflac_bs* bs, size_t bitsToSeek)
 }
 
 
-/* This function moves the bit streamer to the first bit after the sync code (bit 15 of the of the frame header). It will also update the CRC-16. */
-static drflac_bool32 drflac__find_and_seek_to_next_sync_code(drflac_bs* bs)
-{
-    DRFLAC_ASSERT(bs != NULL);
-
-    /*
-    The sync code is always aligned to 8 bits. This is convenient for us because it means we can do byte-aligned movements. The first
-    thing to do is align to the next byte.
-    */
-    if (!drflac__seek_bits(bs, DRFLAC_CACHE_L1_BITS_REMAINING(bs) & 7)) {
-        return DRFLAC_FALSE;
-    }
-
-    for (;;) {
-        drflac_uint8 hi;
-
-#ifndef DR_FLAC_NO_CRC
-        drflac__reset_crc16(bs);
-#endif
-
-        if (!drflac__read_uint8(bs, 8, &hi)) {
-            return DRFLAC_FALSE;
-        }
-
-        if (hi == 0xFF) {
-            drflac_uint8 lo;
-            if (!drflac__read_uint8(bs, 6, &lo)) {
-                return DRFLAC_FALSE;
-            }
-
-            if (lo == 0x3E) {
-                return DRFLAC_TRUE;
-            } else {
-                if (!drflac__seek_bits(bs, DRFLAC_CACHE_L1_BITS_REMAINING(bs) & 7)) {
-                    return DRFLAC_FALSE;
-                }
-            }
-        }
-    }
-
-    /* Should never get here. */
-    /*return DRFLAC_FALSE;*/
-}
-
-
 #if defined(DRFLAC_HAS_LZCNT_INTRINSIC)
 #define DRFLAC_IMPLEMENT_CLZ_LZCNT
 #endif
@@ -2796,6 +2981,110 @@ static DRFLAC_INLINE drflac_bool32 drflac__seek_past_next_set_bit(drflac_bs* bs,
 
 
 
+/*
+Returns a mask with the most significant bit of each byte set where the corresponding byte in the input is 0xFF. This is done on the whole cache
+line at once, without any carries between bytes, so the result is exact for every byte.
+*/
+static DRFLAC_INLINE drflac_cache_t drflac__find_0xFF_bytes(drflac_cache_t x)
+{
+    const drflac_cache_t lo7 = ((~(drflac_cache_t)0) / 0xFF) * 0x7F;    /* 0x7F7F... */
+    drflac_cache_t t = ~x;
+    return ~(((t & lo7) + lo7) | t | lo7);
+}
+
+/*
+Moves the bit streamer forward to the next 0xFF byte, which is the first byte of a sync code. The bit streamer must be aligned to a byte boundary.
+
+Rather than reading a byte at a time, this checks a whole cache line at a time. Lines in the L2 cache that do not contain any 0xFF bytes are skipped
+without being moved into the L1 cache, and the CRC is not calculated for any of the skipped bytes since they'll never be part of a frame we care about.
+*/
+static drflac_bool32 drflac__seek_to_next_0xFF_byte(drflac_bs* bs)
+{
+    DRFLAC_ASSERT(bs != NULL);
+    DRFLAC_ASSERT((DRFLAC_CACHE_L1_BITS_REMAINING(bs) & 7) == 0);
+
+    for (;;) {
+        if (bs->consumedBits < DRFLAC_CACHE_L1_SIZE_BITS(bs)) {
+            /* The consumed bits are always zero so they'll never be mistaken for a 0xFF byte. */
+            drflac_cache_t mask = drflac__find_0xFF_bytes(bs->cache);
+            if (mask != 0) {
+                drflac_uint32 bitsToSkip = drflac__clz(mask);  /* <-- Always a multiple of 8 because only the most significant bit of each byte is set. */
+                bs->consumedBits += bitsToSkip;
+                bs->cache <<= bitsToSkip;
+                return DRFLAC_TRUE;
+            }
+        }
+
+        /* Nothing in the L1 cache. The 0xFF check doesn't care about byte order so the L2 lines can be checked in place. */
+        while (bs->nextL2Line < DRFLAC_CACHE_L2_LINE_COUNT(bs) && drflac__find_0xFF_bytes(bs->cacheL2[bs->nextL2Line]) == 0) {
+            bs->nextL2Line += 1;
+        }
+
+        bs->consumedBits = DRFLAC_CACHE_L1_SIZE_BITS(bs);
+        bs->cache = 0;
+#ifndef DR_FLAC_NO_CRC
+        drflac__reset_crc16(bs);   /* <-- Prevents the reload from calculating the CRC of the bytes we just skipped. */
+#endif
+
+        if (!drflac__reload_cache(bs)) {
+            return DRFLAC_FALSE;
+        }
+    }
+}
+
+/*
+This function moves the bit streamer to the first bit after the sync code (bit 15 of the frame header). It will also update the CRC-16.
+
+Candidates are found with drflac__seek_to_next_0xFF_byte(), which uses drflac__find_0xFF_bytes() to test a whole cache line at a time, so only 0xFF
+bytes are ever looked at individually. The CRC-16 is reset at each candidate so that it only covers the frame header that follows.
+*/
+static drflac_bool32 drflac__find_and_seek_to_next_sync_code(drflac_bs* bs)
+{
+    DRFLAC_ASSERT(bs != NULL);
+
+    /*
+    The sync code is always aligned to 8 bits. This is convenient for us because it means we can do byte-aligned movements. The first
+    thing to do is align to the next byte.
+    */
+    if (!drflac__seek_bits(bs, DRFLAC_CACHE_L1_BITS_REMAINING(bs) & 7)) {
+        return DRFLAC_FALSE;
+    }
+
+    for (;;) {
+        drflac_uint8 hi;
+
+        if (!drflac__seek_to_next_0xFF_byte(bs)) {
+            return DRFLAC_FALSE;
+        }
+
+#ifndef DR_FLAC_NO_CRC
+        drflac__reset_crc16(bs);
+#endif
+
+        if (!drflac__read_uint8(bs, 8, &hi)) {
+            return DRFLAC_FALSE;
+        }
+
+        if (hi == 0xFF) {
+            drflac_uint8 lo;
+            if (!drflac__read_uint8(bs, 6, &lo)) {
+                return DRFLAC_FALSE;
+            }
+
+            if (lo == 0x3E) {
+                return DRFLAC_TRUE;
+            } else {
+                if (!drflac__seek_bits(bs, DRFLAC_CACHE_L1_BITS_REMAINING(bs) & 7)) {
+                    return DRFLAC_FALSE;
+                }
+            }
+        }
+    }
+
+    /* Should never get here. */
+    /*return DRFLAC_FALSE;*/
+}
+
 static drflac_bool32 drflac__seek_to_byte(drflac_bs* bs, drflac_uint64 offsetFromStart)
 {
     DRFLAC_ASSERT(bs != NULL);
@@ -4666,6 +4955,152 @@ static drflac_bool32 drflac__decode_samples_with_residual__rice(drflac_bs* bs, d
     }
 }
 
+/*
+Bit depth and predictor order specialized residual decoders.
+
+The generic path above needs to decide between 32- and 64-bit arithmetic and then does a jump into a switch for every single sample to
+calculate the prediction. Below we instantiate a version of the residual decoder for each combination of arithmetic width and predictor order
+so the prediction compiles down to straight line code. These are selected with drflac__get_decode_samples_with_residual__rice_proc() based on
+the decoding pipeline which is chosen once for the whole stream in drflac__init_from_info().
+
+The coefficients are copied to a local array so the compiler knows they can't alias the output buffer and doesn't need to reload them after
+every sample.
+*/
+typedef drflac_bool32 (* drflac__decode_samples_with_residual__rice_proc)(drflac_bs* bs, drflac_uint32 bitsPerSample, drflac_uint32 count, drflac_uint8 riceParam, drflac_uint32 order, drflac_int32 shift, const drflac_int32* coefficients, drflac_int32* pSamplesOut);
+
+#define DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(bits, lpcOrder) \
+static drflac_bool32 drflac__decode_samples_with_residual__rice__##bits##_order##lpcOrder(drflac_bs* bs, drflac_uint32 bitsPerSample, drflac_uint32 count, drflac_uint8 riceParam, drflac_uint32 order, drflac_int32 shift, const drflac_int32* coefficients, drflac_int32* pSamplesOut) \
+{                                                                                                                                                   \
+    drflac_uint32 t[2] = {0x00000000, 0xFFFFFFFF};                                                                                                  \
+    drflac_int32 localCoefficients[lpcOrder];                                                                                                       \
+    drflac_uint32 zeroCountPart;                                                                                                                    \
+    drflac_uint32 riceParamPart;                                                                                                                    \
+    drflac_uint32 riceParamMask;                                                                                                                    \
+    drflac_uint32 i;                                                                                                                                \
+                                                                                                                                                    \
+    DRFLAC_ASSERT(bs != NULL);                                                                                                                      \
+    DRFLAC_ASSERT(count > 0);                                                                                                                       \
+    DRFLAC_ASSERT(order == lpcOrder);                                                                                                               \
+    DRFLAC_ASSERT(pSamplesOut != NULL);                                                                                                             \
+                                                                                                                                                    \
+    (void)bitsPerSample;                                                                                                                            \
+    (void)order;                                                                                                                                    \
+                                                                                                                                                    \
+    for (i = 0; i < lpcOrder; i += 1) {                                                                                                             \
+        localCoefficients[i] = coefficients[i];                                                                                                     \
+    }                                                                                                                                               \
+                                                                                                                                                    \
+    riceParamMask = (drflac_uint32)~((~0UL) << riceParam);                                                                                          \
+                                                                                                                                                    \
+    for (i = 0; i < count; i += 1) {                                                                                                                \
+        if (!drflac__read_rice_parts_x1(bs, riceParam, &zeroCountPart, &riceParamPart)) {                                                           \
+            return DRFLAC_FALSE;                                                                                                                    \
+        }                                                                                                                                           \
+                                                                                                                                                    \
+        riceParamPart &= riceParamMask;                                                                                                             \
+        riceParamPart |= (zeroCountPart << riceParam);                                                                                              \
+        riceParamPart  = (riceParamPart >> 1) ^ t[riceParamPart & 0x01];                                                                            \
+                                                                                                                                                    \
+        pSamplesOut[i] = riceParamPart + drflac__calculate_prediction_##bits(lpcOrder, shift, localCoefficients, pSamplesOut + i);                  \
+    }                                                                                                                                               \
+                                                                                                                                                    \
+    return DRFLAC_TRUE;                                                                                                                             \
+}
+
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(32, 1)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(32, 2)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(32, 3)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(32, 4)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(32, 5)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(32, 6)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(32, 7)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(32, 8)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(32, 9)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(32, 10)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(32, 11)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(32, 12)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(64, 1)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(64, 2)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(64, 3)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(64, 4)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(64, 5)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(64, 6)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(64, 7)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(64, 8)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(64, 9)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(64, 10)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(64, 11)
+DRFLAC_DEFINE_DECODE_SAMPLES_WITH_RESIDUAL__RICE(64, 12)
+
+static drflac_bool32 drflac__decode_samples_with_residual__rice__order0(drflac_bs* bs, drflac_uint32 bitsPerSample, drflac_uint32 count, drflac_uint8 riceParam, drflac_uint32 order, drflac_int32 shift, const drflac_int32* coefficients, drflac_int32* pSamplesOut)
+{
+    return drflac__decode_samples_with_residual__rice__scalar_zeroorder(bs, bitsPerSample, count, riceParam, order, shift, coefficients, pSamplesOut);
+}
+
+static const drflac__decode_samples_with_residual__rice_proc drflac__gDecodeSamplesWithResidualRice32[DRFLAC_MAX_SPECIALIZED_LPC_ORDER+1] = {
+    drflac__decode_samples_with_residual__rice__order0,
+    drflac__decode_samples_with_residual__rice__32_order1,
+    drflac__decode_samples_with_residual__rice__32_order2,
+    drflac__decode_samples_with_residual__rice__32_order3,
+    drflac__decode_samples_with_residual__rice__32_order4,
+    drflac__decode_samples_with_residual__rice__32_order5,
+    drflac__decode_samples_with_residual__rice__32_order6,
+    drflac__decode_samples_with_residual__rice__32_order7,
+    drflac__decode_samples_with_residual__rice__32_order8,
+    drflac__decode_samples_with_residual__rice__32_order9,
+    drflac__decode_samples_with_residual__rice__32_order10,
+    drflac__decode_samples_with_residual__rice__32_order11,
+    drflac__decode_samples_with_residual__rice__32_order12
+};
+
+static const drflac__decode_samples_with_residual__rice_proc drflac__gDecodeSamplesWithResidualRice64[DRFLAC_MAX_SPECIALIZED_LPC_ORDER+1] = {
+    drflac__decode_samples_with_residual__rice__order0,
+    drflac__decode_samples_with_residual__rice__64_order1,
+    drflac__decode_samples_with_residual__rice__64_order2,
+    drflac__decode_samples_with_residual__rice__64_order3,
+    drflac__decode_samples_with_residual__rice__64_order4,
+    drflac__decode_samples_with_residual__rice__64_order5,
+    drflac__decode_samples_with_residual__rice__64_order6,
+    drflac__decode_samples_with_residual__rice__64_order7,
+    drflac__decode_samples_with_residual__rice__64_order8,
+    drflac__decode_samples_with_residual__rice__64_order9,
+    drflac__decode_samples_with_residual__rice__64_order10,
+    drflac__decode_samples_with_residual__rice__64_order11,
+    drflac__decode_samples_with_residual__rice__64_order12
+};
+
+static drflac__decode_samples_with_residual__rice_proc drflac__get_decode_samples_with_residual__rice_proc(drflac_uint8 decodePipeline, drflac_uint32 bitsPerSample, drflac_uint32 order, drflac_int32 shift)
+{
+    /*
+    The specialized decoders replace the scalar path only. The SSE4.1 and NEON paths decode four Rice codes at a time and are at least as fast,
+    so they're preferred whenever they're available.
+    */
+    if (order > DRFLAC_MAX_SPECIALIZED_LPC_ORDER) {
+        return drflac__decode_samples_with_residual__rice;
+    }
+
+#if defined(DRFLAC_SUPPORT_SSE41)
+    if (drflac__gIsSSE41Supported) {
+        return drflac__decode_samples_with_residual__rice;
+    }
+#elif defined(DRFLAC_SUPPORT_NEON)
+    if (drflac__gIsNEONSupported) {
+        return drflac__decode_samples_with_residual__rice;
+    }
+#endif
+
+    if (decodePipeline == DRFLAC_DECODE_PIPELINE_32) {
+        DRFLAC_ASSERT(bitsPerSample+shift <= 32);
+        return drflac__gDecodeSamplesWithResidualRice32[order];
+    }
+
+    if (bitsPerSample+shift > 32) {
+        return drflac__gDecodeSamplesWithResidualRice64[order];
+    } else {
+        return drflac__gDecodeSamplesWithResidualRice32[order];
+    }
+}
+
 /* Reads and seeks past a string of residual values as Rice codes. The decoder should be sitting on the first bit of the Rice codes. */
 static drflac_bool32 drflac__read_and_seek_residual__rice(drflac_bs* bs, drflac_uint32 count, drflac_uint8 riceParam)
 {
@@ -4717,12 +5152,13 @@ Reads and decodes the residual for the sub-frame the decoder is currently sittin
 when the decoder is sitting at the very start of the RESIDUAL block. The first <order> residuals will be ignored. The
 <blockSize> and <order> parameters are used to determine how many residual values need to be decoded.
 */
-static drflac_bool32 drflac__decode_samples_with_residual(drflac_bs* bs, drflac_uint32 bitsPerSample, drflac_uint32 blockSize, drflac_uint32 order, drflac_int32 shift, const drflac_int32* coefficients, drflac_int32* pDecodedSamples)
+static drflac_bool32 drflac__decode_samples_with_residual(drflac_bs* bs, drflac_uint8 decodePipeline, drflac_uint32 bitsPerSample, drflac_uint32 blockSize, drflac_uint32 order, drflac_int32 shift, const drflac_int32* coefficients, drflac_int32* pDecodedSamples)
 {
     drflac_uint8 residualMethod;
     drflac_uint8 partitionOrder;
     drflac_uint32 samplesInPartition;
     drflac_uint32 partitionsRemaining;
+    drflac__decode_samples_with_residual__rice_proc onDecodeRice;
 
     DRFLAC_ASSERT(bs != NULL);
     DRFLAC_ASSERT(blockSize != 0);
@@ -4756,6 +5192,9 @@ static drflac_bool32 drflac__decode_samples_with_residual(drflac_bs* bs, drflac_
         return DRFLAC_FALSE;
     }
 
+    /* The residual decoder is the same for every partition so it only needs to be selected once. */
+    onDecodeRice = drflac__get_decode_samples_with_residual__rice_proc(decodePipeline, bitsPerSample, order, shift);
+
     samplesInPartition = (blockSize / (1 << partitionOrder)) - order;
     partitionsRemaining = (1 << partitionOrder);
     for (;;) {
@@ -4777,7 +5216,7 @@ static drflac_bool32 drflac__decode_samples_with_residual(drflac_bs* bs, drflac_
         }
 
         if (riceParam != 0xFF) {
-            if (!drflac__decode_samples_with_residual__rice(bs, bitsPerSample, samplesInPartition, riceParam, order, shift, coefficients, pDecodedSamples)) {
+            if (!onDecodeRice(bs, bitsPerSample, samplesInPartition, riceParam, order, shift, coefficients, pDecodedSamples)) {
                 return DRFLAC_FALSE;
             }
         } else {
@@ -4933,7 +5372,7 @@ static drflac_bool32 drflac__decode_samples__verbatim(drflac_bs* bs, drflac_uint
     return DRFLAC_TRUE;
 }
 
-static drflac_bool32 drflac__decode_samples__fixed(drflac_bs* bs, drflac_uint32 blockSize, drflac_uint32 subframeBitsPerSample, drflac_uint8 lpcOrder, drflac_int32* pDecodedSamples)
+static drflac_bool32 drflac__decode_samples__fixed(drflac_bs* bs, drflac_uint8 decodePipeline, drflac_uint32 blockSize, drflac_uint32 subframeBitsPerSample, drflac_uint8 lpcOrder, drflac_int32* pDecodedSamples)
 {
     drflac_uint32 i;
 
@@ -4955,14 +5394,14 @@ static drflac_bool32 drflac__decode_samples__fixed(drflac_bs* bs, drflac_uint32
         pDecodedSamples[i] = sample;
     }
 
-    if (!drflac__decode_samples_with_residual(bs, subframeBitsPerSample, blockSize, lpcOrder, 0, lpcCoefficientsTable[lpcOrder], pDecodedSamples)) {
+    if (!drflac__decode_samples_with_residual(bs, decodePipeline, subframeBitsPerSample, blockSize, lpcOrder, 0, lpcCoefficientsTable[lpcOrder], pDecodedSamples)) {
         return DRFLAC_FALSE;
     }
 
     return DRFLAC_TRUE;
 }
 
-static drflac_bool32 drflac__decode_samples__lpc(drflac_bs* bs, drflac_uint32 blockSize, drflac_uint32 bitsPerSample, drflac_uint8 lpcOrder, drflac_int32* pDecodedSamples)
+static drflac_bool32 drflac__decode_samples__lpc(drflac_bs* bs, drflac_uint8 decodePipeline, drflac_uint32 blockSize, drflac_uint32 bitsPerSample, drflac_uint8 lpcOrder, drflac_int32* pDecodedSamples)
 {
     drflac_uint8 i;
     drflac_uint8 lpcPrecision;
@@ -4998,7 +5437,7 @@ static drflac_bool32 drflac__decode_samples__lpc(drflac_bs* bs, drflac_uint32 bl
         }
     }
 
-    if (!drflac__decode_samples_with_residual(bs, bitsPerSample, blockSize, lpcOrder, lpcShift, coefficients, pDecodedSamples)) {
+    if (!drflac__decode_samples_with_residual(bs, decodePipeline, bitsPerSample, blockSize, lpcOrder, lpcShift, coefficients, pDecodedSamples)) {
         return DRFLAC_FALSE;
     }
 
@@ -5228,7 +5667,7 @@ static drflac_bool32 drflac__read_subframe_header(drflac_bs* bs, drflac_subframe
     return DRFLAC_TRUE;
 }
 
-static drflac_bool32 drflac__decode_subframe(drflac_bs* bs, drflac_frame* frame, int subframeIndex, drflac_int32* pDecodedSamplesOut)
+static drflac_bool32 drflac__decode_subframe(drflac_bs* bs, drflac_uint8 decodePipeline, drflac_frame* frame, int subframeIndex, drflac_int32* pDecodedSamplesOut)
 {
     drflac_subframe* pSubframe;
     drflac_uint32 subframeBitsPerSample;
@@ -5271,12 +5710,12 @@ static drflac_bool32 drflac__decode_subframe(drflac_bs* bs, drflac_frame* frame,
 
         case DRFLAC_SUBFRAME_FIXED:
         {
-            drflac__decode_samples__fixed(bs, frame->header.blockSizeInPCMFrames, subframeBitsPerSample, pSubframe->lpcOrder, pSubframe->pSamplesS32);
+            drflac__decode_samples__fixed(bs, decodePipeline, frame->header.blockSizeInPCMFrames, subframeBitsPerSample, pSubframe->lpcOrder, pSubframe->pSamplesS32);
         } break;
 
         case DRFLAC_SUBFRAME_LPC:
         {
-            drflac__decode_samples__lpc(bs, frame->header.blockSizeInPCMFrames, subframeBitsPerSample, pSubframe->lpcOrder, pSubframe->pSamplesS32);
+            drflac__decode_samples__lpc(bs, decodePipeline, frame->header.blockSizeInPCMFrames, subframeBitsPerSample, pSubframe->lpcOrder, pSubframe->pSamplesS32);
         } break;
 
         default: return DRFLAC_FALSE;
@@ -5391,6 +5830,7 @@ static drflac_result drflac__decode_flac_frame(drflac* pFlac)
     int channelCount;
     int i;
     drflac_uint8 paddingSizeInBits;
+    drflac_uint8 decodePipeline;
     drflac_uint16 desiredCRC16;
 #ifndef DR_FLAC_NO_CRC
     drflac_uint16 actualCRC16;
@@ -5410,8 +5850,17 @@ static drflac_result drflac__decode_flac_frame(drflac* pFlac)
         return DRFLAC_ERROR;
     }
 
+    /*
+    The pipeline was selected based on the bits per sample in the STREAMINFO block, but technically a frame can specify it's own bits per sample. Fall
+    back to the generic pipeline if the frame needs more precision than the pipeline was selected for.
+    */
+    decodePipeline = pFlac->_decodePipeline;
+    if (decodePipeline == DRFLAC_DECODE_PIPELINE_32 && pFlac->currentFLACFrame.header.bitsPerSample > 16) {
+        decodePipeline = DRFLAC_DECODE_PIPELINE_GENERIC;
+    }
+
     for (i = 0; i < channelCount; ++i) {
-        if (!drflac__decode_subframe(&pFlac->bs, &pFlac->currentFLACFrame, i, pFlac->pDecodedSamples + (pFlac->currentFLACFrame.header.blockSizeInPCMFrames * i))) {
+        if (!drflac__decode_subframe(&pFlac->bs, decodePipeline, &pFlac->currentFLACFrame, i, pFlac->pDecodedSamples + (pFlac->currentFLACFrame.header.blockSizeInPCMFrames * i))) {
             return DRFLAC_ERROR;
         }
     }
@@ -5480,52 +5929,206 @@ static drflac_result drflac__seek_flac_frame(drflac* pFlac)
     return DRFLAC_SUCCESS;
 }
 
-static drflac_bool32 drflac__read_and_decode_next_flac_frame(drflac* pFlac)
+static void drflac__get_pcm_frame_range_of_current_flac_frame(drflac* pFlac, drflac_uint64* pFirstPCMFrame, drflac_uint64* pLastPCMFrame)
 {
+    drflac_uint64 firstPCMFrame;
+    drflac_uint64 lastPCMFrame;
+
     DRFLAC_ASSERT(pFlac != NULL);
 
-    for (;;) {
-        drflac_result result;
+    firstPCMFrame = pFlac->currentFLACFrame.header.pcmFrameNumber;
+    if (firstPCMFrame == 0) {
+        firstPCMFrame = ((drflac_uint64)pFlac->currentFLACFrame.header.flacFrameNumber) * pFlac->maxBlockSizeInPCMFrames;
+    }
 
-        if (!drflac__read_next_flac_frame_header(&pFlac->bs, pFlac->bitsPerSample, &pFlac->currentFLACFrame.header)) {
-            return DRFLAC_FALSE;
+    lastPCMFrame = firstPCMFrame + pFlac->currentFLACFrame.header.blockSizeInPCMFrames;
+    if (lastPCMFrame > 0) {
+        lastPCMFrame -= 1; /* Needs to be zero based. */
+    }
+
+    if (pFirstPCMFrame) {
+        *pFirstPCMFrame = firstPCMFrame;
+    }
+    if (pLastPCMFrame) {
+        *pLastPCMFrame = lastPCMFrame;
+    }
+}
+
+/*
+The frame cache. This is a single allocation made up of the drflac__frame_cache object, followed by an array of entries, followed by the sample data
+for each entry. Each entry has room for a whole frame of the maximum block size. The number of entries is expected to be small enough that a linear
+search is fine.
+*/
+typedef struct
+{
+    /* The frame, including the header and the wasted bits for each subframe. The sample pointers of each subframe point to pSamples. */
+    drflac_frame frame;
+
+    /* The index of the first PCM frame in the frame. This is the key. */
+    drflac_uint64 firstPCMFrame;
+
+    /* The value of the cache's counter at the time this entry was last used. The entry with the lowest value is evicted first. */
+    drflac_uint64 lastUsed;
+
+    /* A pointer to the sample data of this entry. This is an offset of the cache's allocation. */
+    drflac_int32* pSamples;
+
+    /* Whether or not this entry contains a frame. */
+    drflac_bool32 isInUse;
+} drflac__frame_cache_entry;
+
+typedef struct
+{
+    drflac_uint32 capacity;
+    drflac_uint64 counter;
+    drflac__frame_cache_entry* pEntries;
+} drflac__frame_cache;
+
+static void drflac__frame_cache_store(drflac* pFlac)
+{
+    drflac__frame_cache* pCache;
+    drflac__frame_cache_entry* pEntry;
+    drflac_uint64 firstPCMFrame;
+    drflac_uint32 blockSize;
+    drflac_uint32 channelCount;
+    drflac_uint32 iEntry;
+    drflac_uint32 iChannel;
+
+    DRFLAC_ASSERT(pFlac != NULL);
+
+    pCache = (drflac__frame_cache*)pFlac->_pFrameCache;
+    if (pCache == NULL) {
+        return;
+    }
+
+    drflac__get_pcm_frame_range_of_current_flac_frame(pFlac, &firstPCMFrame, NULL);
+
+    /* Use the entry for this frame if it's already cached. Otherwise use an unused entry, or failing that the least recently used one. */
+    pEntry = NULL;
+    for (iEntry = 0; iEntry < pCache->capacity; iEntry += 1) {
+        drflac__frame_cache_entry* pCandidate = &pCache->pEntries[iEntry];
+        if (pCandidate->isInUse && pCandidate->firstPCMFrame == firstPCMFrame) {
+            pCandidate->lastUsed = ++pCache->counter;
+            return;
         }
 
-        result = drflac__decode_flac_frame(pFlac);
-        if (result != DRFLAC_SUCCESS) {
-            if (result == DRFLAC_CRC_MISMATCH) {
-                continue;   /* CRC mismatch. Skip to the next frame. */
-            } else {
-                return DRFLAC_FALSE;
-            }
+        if (pEntry == NULL || (pEntry->isInUse && (!pCandidate->isInUse || pCandidate->lastUsed < pEntry->lastUsed))) {
+            pEntry = pCandidate;
         }
+    }
 
-        return DRFLAC_TRUE;
+    DRFLAC_ASSERT(pEntry != NULL);
+
+    blockSize    = pFlac->currentFLACFrame.header.blockSizeInPCMFrames;
+    channelCount = drflac__get_channel_count_from_channel_assignment(pFlac->currentFLACFrame.header.channelAssignment);
+    DRFLAC_ASSERT(blockSize <= pFlac->maxBlockSizeInPCMFrames);
+    DRFLAC_ASSERT(channelCount <= pFlac->channels);
+
+    pEntry->frame         = pFlac->currentFLACFrame;
+    pEntry->firstPCMFrame = firstPCMFrame;
+    pEntry->lastUsed      = ++pCache->counter;
+    pEntry->isInUse       = DRFLAC_TRUE;
+
+    for (iChannel = 0; iChannel < channelCount; iChannel += 1) {
+        pEntry->frame.subframes[iChannel].pSamplesS32 = pEntry->pSamples + (blockSize * iChannel);
+        DRFLAC_COPY_MEMORY(pEntry->frame.subframes[iChannel].pSamplesS32, pFlac->currentFLACFrame.subframes[iChannel].pSamplesS32, blockSize * sizeof(drflac_int32));
     }
 }
 
-static void drflac__get_pcm_frame_range_of_current_flac_frame(drflac* pFlac, drflac_uint64* pFirstPCMFrame, drflac_uint64* pLastPCMFrame)
+static drflac_bool32 drflac__frame_cache_load(drflac* pFlac, drflac_uint64 pcmFrameIndex)
 {
-    drflac_uint64 firstPCMFrame;
-    drflac_uint64 lastPCMFrame;
+    drflac__frame_cache* pCache;
+    drflac_uint32 iEntry;
 
     DRFLAC_ASSERT(pFlac != NULL);
 
-    firstPCMFrame = pFlac->currentFLACFrame.header.pcmFrameNumber;
-    if (firstPCMFrame == 0) {
-        firstPCMFrame = ((drflac_uint64)pFlac->currentFLACFrame.header.flacFrameNumber) * pFlac->maxBlockSizeInPCMFrames;
+    pCache = (drflac__frame_cache*)pFlac->_pFrameCache;
+    if (pCache == NULL) {
+        return DRFLAC_FALSE;
+    }
+
+    for (iEntry = 0; iEntry < pCache->capacity; iEntry += 1) {
+        drflac__frame_cache_entry* pEntry = &pCache->pEntries[iEntry];
+        if (pEntry->isInUse && pcmFrameIndex >= pEntry->firstPCMFrame && pcmFrameIndex < pEntry->firstPCMFrame + pEntry->frame.header.blockSizeInPCMFrames) {
+            /* The sample pointers of the subframes point straight into the cache so there's no need to copy anything. */
+            pFlac->currentFLACFrame = pEntry->frame;
+            pFlac->currentFLACFrame.pcmFramesRemaining = (drflac_uint32)(pEntry->firstPCMFrame + pEntry->frame.header.blockSizeInPCMFrames - pcmFrameIndex);
+            pFlac->_isFrameFromCache = DRFLAC_TRUE;
+
+            pEntry->lastUsed = ++pCache->counter;
+            return DRFLAC_TRUE;
+        }
+    }
+
+    return DRFLAC_FALSE;
+}
+
+/* Replaces the current frame with silence. Returns false if the frame header is not compatible with the stream. */
+static drflac_bool32 drflac__set_current_flac_frame_to_silence(drflac* pFlac)
+{
+    drflac_uint32 blockSize;
+    drflac_uint32 iChannel;
+
+    DRFLAC_ASSERT(pFlac != NULL);
+
+    blockSize = pFlac->currentFLACFrame.header.blockSizeInPCMFrames;
+    if (blockSize > pFlac->maxBlockSizeInPCMFrames) {
+        return DRFLAC_FALSE;
     }
 
-    lastPCMFrame = firstPCMFrame + pFlac->currentFLACFrame.header.blockSizeInPCMFrames;
-    if (lastPCMFrame > 0) {
-        lastPCMFrame -= 1; /* Needs to be zero based. */
-    }
+    /* The channel assignment might be the reason the frame failed. Silence is the same regardless of decorrelation so just use independent channels. */
+    pFlac->currentFLACFrame.header.channelAssignment = (drflac_uint8)(pFlac->channels - 1);
+
+    DRFLAC_ZERO_MEMORY(pFlac->currentFLACFrame.subframes, sizeof(pFlac->currentFLACFrame.subframes));
+    DRFLAC_ZERO_MEMORY(pFlac->pDecodedSamples, blockSize * pFlac->channels * sizeof(drflac_int32));
+    for (iChannel = 0; iChannel < pFlac->channels; iChannel += 1) {
+        pFlac->currentFLACFrame.subframes[iChannel].pSamplesS32 = pFlac->pDecodedSamples + (blockSize * iChannel);
+    }
+
+    pFlac->currentFLACFrame.pcmFramesRemaining = blockSize;
+
+    return DRFLAC_TRUE;
+}
+
+/*
+Reads and decodes the next frame. Bad frames are always skipped when applyErrorPolicy is false, which is what the seeking routines need since they
+use a successful decode as confirmation that they've landed on a real frame. When applyErrorPolicy is true, bad frames are handled as per the
+policy set with drflac_set_frame_error_policy().
+*/
+static drflac_bool32 drflac__read_and_decode_next_flac_frame(drflac* pFlac, drflac_bool32 applyErrorPolicy)
+{
+    DRFLAC_ASSERT(pFlac != NULL);
+
+    for (;;) {
+        drflac_result result;
+
+        if (!drflac__read_next_flac_frame_header(&pFlac->bs, pFlac->bitsPerSample, &pFlac->currentFLACFrame.header)) {
+            return DRFLAC_FALSE;
+        }
+
+        result = drflac__decode_flac_frame(pFlac);
+        if (result != DRFLAC_SUCCESS) {
+            if (result == DRFLAC_CRC_MISMATCH || (result == DRFLAC_ERROR && applyErrorPolicy)) {
+                if (applyErrorPolicy) {
+                    if (pFlac->onFrameError != NULL) {
+                        drflac_uint64 firstPCMFrame;
+                        drflac__get_pcm_frame_range_of_current_flac_frame(pFlac, &firstPCMFrame, NULL);
+                        pFlac->onFrameError(pFlac->pUserDataFrameError, firstPCMFrame, pFlac->currentFLACFrame.header.blockSizeInPCMFrames);
+                    }
+
+                    if (pFlac->frameErrorPolicy == drflac_frame_error_policy_silence && drflac__set_current_flac_frame_to_silence(pFlac)) {
+                        return DRFLAC_TRUE;     /* Silence is not cached since it's not the real content of the frame. */
+                    }
+                }
 
-    if (pFirstPCMFrame) {
-        *pFirstPCMFrame = firstPCMFrame;
-    }
-    if (pLastPCMFrame) {
-        *pLastPCMFrame = lastPCMFrame;
+                continue;   /* Skip to the next frame. */
+            } else {
+                return DRFLAC_FALSE;
+            }
+        }
+
+        drflac__frame_cache_store(pFlac);
+        return DRFLAC_TRUE;
     }
 }
 
@@ -5539,6 +6142,7 @@ static drflac_bool32 drflac__seek_to_first_frame(drflac* pFlac)
 
     DRFLAC_ZERO_MEMORY(&pFlac->currentFLACFrame, sizeof(pFlac->currentFLACFrame));
     pFlac->currentPCMFrame = 0;
+    pFlac->_isFrameFromCache = DRFLAC_FALSE;
 
     return result;
 }
@@ -5550,13 +6154,50 @@ static DRFLAC_INLINE drflac_result drflac__seek_to_next_flac_frame(drflac* pFlac
     return drflac__seek_flac_frame(pFlac);
 }
 
+static drflac_bool32 drflac__seek_to_pcm_frame__bitstream(drflac* pFlac, drflac_uint64 pcmFrameIndex);
+
+/*
+Moves to the next frame for the purpose of reading. This is the same as drflac__read_and_decode_next_flac_frame(), except that if the current frame
+was loaded from the frame cache the next frame is also pulled from the cache if possible. If it's not cached, the bit streamer is not sitting on the
+next frame so we need to do a proper seek to get it back in sync.
+*/
+static drflac_bool32 drflac__read_and_decode_next_flac_frame__cached(drflac* pFlac)
+{
+    drflac_uint64 nextPCMFrame;
+    drflac_uint64 currentPCMFrame;
+    drflac_bool32 result;
+
+    DRFLAC_ASSERT(pFlac != NULL);
+
+    if (!pFlac->_isFrameFromCache) {
+        return drflac__read_and_decode_next_flac_frame(pFlac, DRFLAC_TRUE);
+    }
+
+    drflac__get_pcm_frame_range_of_current_flac_frame(pFlac, NULL, &nextPCMFrame);
+    nextPCMFrame += 1;
+
+    if (pFlac->totalPCMFrameCount > 0 && nextPCMFrame >= pFlac->totalPCMFrameCount) {
+        return DRFLAC_FALSE;    /* At the end. */
+    }
+
+    if (drflac__frame_cache_load(pFlac, nextPCMFrame)) {
+        return DRFLAC_TRUE;
+    }
+
+    /* The seeking routines update the current PCM frame, but that is the responsibility of the caller in this case so it needs to be restored. */
+    currentPCMFrame = pFlac->currentPCMFrame;
+    result = drflac__seek_to_pcm_frame__bitstream(pFlac, nextPCMFrame);
+    pFlac->currentPCMFrame = currentPCMFrame;
+
+    return result;
+}
 
 static drflac_uint64 drflac__seek_forward_by_pcm_frames(drflac* pFlac, drflac_uint64 pcmFramesToSeek)
 {
     drflac_uint64 pcmFramesRead = 0;
     while (pcmFramesToSeek > 0) {
         if (pFlac->currentFLACFrame.pcmFramesRemaining == 0) {
-            if (!drflac__read_and_decode_next_flac_frame(pFlac)) {
+            if (!drflac__read_and_decode_next_flac_frame__cached(pFlac)) {
                 break;  /* Couldn't read the next frame, so just break from the loop and return. */
             }
         } else {
@@ -5729,7 +6370,7 @@ static drflac_bool32 drflac__seek_to_approximate_flac_frame_to_byte(drflac* pFla
             so it needs to stay this way for now.
             */
 #if 1
-            if (!drflac__read_and_decode_next_flac_frame(pFlac)) {
+            if (!drflac__read_and_decode_next_flac_frame(pFlac, DRFLAC_FALSE)) {
                 /* Halve the byte location and continue. */
                 targetByte = rangeLo + ((rangeHi - rangeLo)/2);
                 rangeHi = targetByte;
@@ -5763,7 +6404,7 @@ static drflac_bool32 drflac__decode_flac_frame_and_seek_forward_by_pcm_frames(dr
 #if 0
     if (drflac__decode_flac_frame(pFlac) != DRFLAC_SUCCESS) {
         /* We failed to decode this frame which may be due to it being corrupt. We'll just use the next valid FLAC frame. */
-        if (drflac__read_and_decode_next_flac_frame(pFlac) == DRFLAC_FALSE) {
+        if (drflac__read_and_decode_next_flac_frame(pFlac, DRFLAC_FALSE) == DRFLAC_FALSE) {
             return DRFLAC_FALSE;
         }
     }
@@ -7634,14 +8275,39 @@ static void drflac__init_from_info(drflac* pFlac, const drflac_init_info* pInit)
     pFlac->bitsPerSample           = (drflac_uint8)pInit->bitsPerSample;
     pFlac->totalPCMFrameCount      = pInit->totalPCMFrameCount;
     pFlac->container               = pInit->container;
+
+    /*
+    For streams of 16 bits per sample or less the prediction can never overflow 32 bits, even for side channels (17 bits) with the maximum LPC
+    shift of 15. We can therefore use the 32-bit pipeline for the whole stream which avoids the need to check for each subframe.
+    */
+    if (pFlac->bitsPerSample <= 16) {
+        pFlac->_decodePipeline = DRFLAC_DECODE_PIPELINE_32;
+    } else {
+        pFlac->_decodePipeline = DRFLAC_DECODE_PIPELINE_GENERIC;
+    }
 }
 
 
+/*
+The allocation size for decoded frames depends on the number of 32-bit integers that fit inside the largest SIMD vector we are supporting.
+*/
+static drflac_uint32 drflac__get_decoded_samples_allocation_size(drflac_uint32 maxBlockSizeInPCMFrames, drflac_uint32 channels)
+{
+    drflac_uint32 wholeSIMDVectorCountPerChannel;
+
+    if ((maxBlockSizeInPCMFrames % (DRFLAC_MAX_SIMD_VECTOR_SIZE / sizeof(drflac_int32))) == 0) {
+        wholeSIMDVectorCountPerChannel = (maxBlockSizeInPCMFrames / (DRFLAC_MAX_SIMD_VECTOR_SIZE / sizeof(drflac_int32)));
+    } else {
+        wholeSIMDVectorCountPerChannel = (maxBlockSizeInPCMFrames / (DRFLAC_MAX_SIMD_VECTOR_SIZE / sizeof(drflac_int32))) + 1;
+    }
+
+    return wholeSIMDVectorCountPerChannel * DRFLAC_MAX_SIMD_VECTOR_SIZE * channels;
+}
+
 static drflac* drflac_open_with_metadata_private(drflac_read_proc onRead, drflac_seek_proc onSeek, drflac_meta_proc onMeta, drflac_container container, void* pUserData, void* pUserDataMD, const drflac_allocation_callbacks* pAllocationCallbacks)
 {
     drflac_init_info init;
     drflac_uint32 allocationSize;
-    drflac_uint32 wholeSIMDVectorCountPerChannel;
     drflac_uint32 decodedSamplesAllocationSize;
 #ifndef DR_FLAC_NO_OGG
     drflac_oggbs oggbs;
@@ -7683,17 +8349,7 @@ static drflac* drflac_open_with_metadata_private(drflac_read_proc onRead, drflac
     */
     allocationSize = sizeof(drflac);
 
-    /*
-    The allocation size for decoded frames depends on the number of 32-bit integers that fit inside the largest SIMD vector
-    we are supporting.
-    */
-    if ((init.maxBlockSizeInPCMFrames % (DRFLAC_MAX_SIMD_VECTOR_SIZE / sizeof(drflac_int32))) == 0) {
-        wholeSIMDVectorCountPerChannel = (init.maxBlockSizeInPCMFrames / (DRFLAC_MAX_SIMD_VECTOR_SIZE / sizeof(drflac_int32)));
-    } else {
-        wholeSIMDVectorCountPerChannel = (init.maxBlockSizeInPCMFrames / (DRFLAC_MAX_SIMD_VECTOR_SIZE / sizeof(drflac_int32))) + 1;
-    }
-
-    decodedSamplesAllocationSize = wholeSIMDVectorCountPerChannel * DRFLAC_MAX_SIMD_VECTOR_SIZE * init.channels;
+    decodedSamplesAllocationSize = drflac__get_decoded_samples_allocation_size(init.maxBlockSizeInPCMFrames, init.channels);
 
     allocationSize += decodedSamplesAllocationSize;
     allocationSize += DRFLAC_MAX_SIMD_VECTOR_SIZE;  /* Allocate extra bytes to ensure we have enough for alignment. */
@@ -8642,9 +9298,115 @@ DRFLAC_API void drflac_close(drflac* pFlac)
 #endif
 #endif
 
+    drflac__free_from_callbacks(pFlac->_pFrameCache, &pFlac->allocationCallbacks);
     drflac__free_from_callbacks(pFlac, &pFlac->allocationCallbacks);
 }
 
+DRFLAC_API drflac* drflac_clone(const drflac* pFlac, drflac_read_proc onRead, drflac_seek_proc onSeek, void* pUserData, const drflac_allocation_callbacks* pAllocationCallbacks)
+{
+    drflac_allocation_callbacks allocationCallbacks;
+    drflac_uint32 allocationSize;
+    drflac_uint32 decodedSamplesAllocationSize;
+    drflac_bool32 isMemoryStream;
+    drflac_bool32 useMemoryStream = DRFLAC_FALSE;
+    drflac* pClone;
+
+    if (pFlac == NULL) {
+        return NULL;
+    }
+
+    if (pAllocationCallbacks != NULL) {
+        allocationCallbacks = *pAllocationCallbacks;
+        if (allocationCallbacks.onFree == NULL || (allocationCallbacks.onMalloc == NULL && allocationCallbacks.onRealloc == NULL)) {
+            return NULL;    /* Invalid allocation callbacks. */
+        }
+    } else {
+        allocationCallbacks = pFlac->allocationCallbacks;
+    }
+
+    /* We can only read from the same data as the original decoder if it's a block of memory. Otherwise the callbacks need to be specified. */
+#ifndef DR_FLAC_NO_OGG
+    if (pFlac->container == drflac_container_ogg) {
+        isMemoryStream = ((drflac_oggbs*)pFlac->_oggbs)->onRead == drflac__on_read_memory;
+    } else
+#endif
+    {
+        isMemoryStream = pFlac->bs.onRead == drflac__on_read_memory;
+    }
+
+    if (onRead == NULL || onSeek == NULL) {
+        if (!isMemoryStream) {
+            return NULL;
+        }
+
+        onRead = drflac__on_read_memory;
+        onSeek = drflac__on_seek_memory;
+        useMemoryStream = DRFLAC_TRUE;
+    }
+
+    /* The clone has the same layout as the original, minus the seek table which is shared. */
+    decodedSamplesAllocationSize = drflac__get_decoded_samples_allocation_size(pFlac->maxBlockSizeInPCMFrames, pFlac->channels);
+
+    allocationSize  = sizeof(drflac);
+    allocationSize += decodedSamplesAllocationSize;
+    allocationSize += DRFLAC_MAX_SIMD_VECTOR_SIZE;  /* Allocate extra bytes to ensure we have enough for alignment. */
+#ifndef DR_FLAC_NO_OGG
+    if (pFlac->container == drflac_container_ogg) {
+        allocationSize += sizeof(drflac_oggbs);
+    }
+#endif
+
+    pClone = (drflac*)drflac__malloc_from_callbacks(allocationSize, &allocationCallbacks);
+    if (pClone == NULL) {
+        return NULL;
+    }
+
+    /* Everything that was parsed from the metadata is copied as-is. The per-cursor state is reset. */
+    *pClone = *pFlac;
+    pClone->allocationCallbacks = allocationCallbacks;
+    pClone->pDecodedSamples     = (drflac_int32*)drflac_align((size_t)pClone->pExtraData, DRFLAC_MAX_SIMD_VECTOR_SIZE);
+    pClone->_pFrameCache        = NULL;
+    pClone->_isFrameFromCache   = DRFLAC_FALSE;
+    DRFLAC_ZERO_MEMORY(&pClone->currentFLACFrame, sizeof(pClone->currentFLACFrame));
+    pClone->currentPCMFrame     = 0;
+
+    /* The clone needs it's own read position when reading from the same block of memory. */
+    if (useMemoryStream) {
+        pClone->memoryStream.currentReadPos = 0;
+        pUserData = &pClone->memoryStream;
+    }
+
+    DRFLAC_ZERO_MEMORY(&pClone->bs, sizeof(pClone->bs));
+#ifndef DR_FLAC_NO_OGG
+    if (pFlac->container == drflac_container_ogg) {
+        drflac_oggbs* pInternalOggbs = (drflac_oggbs*)((drflac_uint8*)pClone->pDecodedSamples + decodedSamplesAllocationSize);
+        *pInternalOggbs = *(drflac_oggbs*)pFlac->_oggbs;
+        pInternalOggbs->onRead = onRead;
+        pInternalOggbs->onSeek = onSeek;
+        pInternalOggbs->pUserData = pUserData;
+        pInternalOggbs->bytesRemainingInPage = 0;
+
+        pClone->bs.onRead = drflac__on_read_ogg;
+        pClone->bs.onSeek = drflac__on_seek_ogg;
+        pClone->bs.pUserData = (void*)pInternalOggbs;
+        pClone->_oggbs = (void*)pInternalOggbs;
+    } else
+#endif
+    {
+        pClone->bs.onRead = onRead;
+        pClone->bs.onSeek = onSeek;
+        pClone->bs.pUserData = pUserData;
+    }
+    drflac__reset_cache(&pClone->bs);
+
+    if (!drflac__seek_to_first_frame(pClone)) {
+        drflac__free_from_callbacks(pClone, &allocationCallbacks);
+        return NULL;
+    }
+
+    return pClone;
+}
+
 
 #if 0
 static DRFLAC_INLINE void drflac_read_pcm_frames_s32__decode_left_side__reference(drflac* pFlac, drflac_uint64 frameCount, drflac_uint32 unusedBitsPerSample, const drflac_int32* pInputSamples0, const drflac_int32* pInputSamples1, drflac_int32* pOutputSamples)
@@ -9399,7 +10161,7 @@ DRFLAC_API drflac_uint64 drflac_read_pcm_frames_s32(drflac* pFlac, drflac_uint64
     while (framesToRead > 0) {
         /* If we've run out of samples in this frame, go to the next. */
         if (pFlac->currentFLACFrame.pcmFramesRemaining == 0) {
-            if (!drflac__read_and_decode_next_flac_frame(pFlac)) {
+            if (!drflac__read_and_decode_next_flac_frame__cached(pFlac)) {
                 break;  /* Couldn't read the next frame, so just break from the loop and return. */
             }
         } else {
@@ -10311,7 +11073,7 @@ DRFLAC_API drflac_uint64 drflac_read_pcm_frames_s16(drflac* pFlac, drflac_uint64
     while (framesToRead > 0) {
         /* If we've run out of samples in this frame, go to the next. */
         if (pFlac->currentFLACFrame.pcmFramesRemaining == 0) {
-            if (!drflac__read_and_decode_next_flac_frame(pFlac)) {
+            if (!drflac__read_and_decode_next_flac_frame__cached(pFlac)) {
                 break;  /* Couldn't read the next frame, so just break from the loop and return. */
             }
         } else {
@@ -11193,7 +11955,7 @@ DRFLAC_API drflac_uint64 drflac_read_pcm_frames_f32(drflac* pFlac, drflac_uint64
     while (framesToRead > 0) {
         /* If we've run out of samples in this frame, go to the next. */
         if (pFlac->currentFLACFrame.pcmFramesRemaining == 0) {
-            if (!drflac__read_and_decode_next_flac_frame(pFlac)) {
+            if (!drflac__read_and_decode_next_flac_frame__cached(pFlac)) {
                 break;  /* Couldn't read the next frame, so just break from the loop and return. */
             }
         } else {
@@ -11256,6 +12018,55 @@ DRFLAC_API drflac_uint64 drflac_read_pcm_frames_f32(drflac* pFlac, drflac_uint64
 }
 
 
+static drflac_bool32 drflac__seek_to_pcm_frame__bitstream(drflac* pFlac, drflac_uint64 pcmFrameIndex)
+{
+    drflac_bool32 wasSuccessful = DRFLAC_FALSE;
+
+    DRFLAC_ASSERT(pFlac != NULL);
+
+    /*
+    The seeking routines below assume the bit streamer is sitting on the frame after the current frame which won't be the case if the current
+    frame was loaded from the frame cache. In this case we need to start again from the first frame.
+    */
+    if (pFlac->_isFrameFromCache) {
+        if (!drflac__seek_to_first_frame(pFlac)) {
+            return DRFLAC_FALSE;
+        }
+    }
+
+    /*
+    Different techniques depending on encapsulation. Using the native FLAC seektable with Ogg encapsulation is a bit awkward so
+    we'll instead use Ogg's natural seeking facility.
+    */
+#ifndef DR_FLAC_NO_OGG
+    if (pFlac->container == drflac_container_ogg)
+    {
+        wasSuccessful = drflac_ogg__seek_to_pcm_frame(pFlac, pcmFrameIndex);
+    }
+    else
+#endif
+    {
+        /* First try seeking via the seek table. If this fails, fall back to a brute force seek which is much slower. */
+        if (/*!wasSuccessful && */!pFlac->_noSeekTableSeek) {
+            wasSuccessful = drflac__seek_to_pcm_frame__seek_table(pFlac, pcmFrameIndex);
+        }
+
+#if !defined(DR_FLAC_NO_CRC)
+        /* Fall back to binary search if seek table seeking fails. This requires the length of the stream to be known. */
+        if (!wasSuccessful && !pFlac->_noBinarySearchSeek && pFlac->totalPCMFrameCount > 0) {
+            wasSuccessful = drflac__seek_to_pcm_frame__binary_search(pFlac, pcmFrameIndex);
+        }
+#endif
+
+        /* Fall back to brute force if all else fails. */
+        if (!wasSuccessful && !pFlac->_noBruteForceSeek) {
+            wasSuccessful = drflac__seek_to_pcm_frame__brute_force(pFlac, pcmFrameIndex);
+        }
+    }
+
+    return wasSuccessful;
+}
+
 DRFLAC_API drflac_bool32 drflac_seek_to_pcm_frame(drflac* pFlac, drflac_uint64 pcmFrameIndex)
 {
     if (pFlac == NULL) {
@@ -11307,41 +12118,94 @@ DRFLAC_API drflac_bool32 drflac_seek_to_pcm_frame(drflac* pFlac, drflac_uint64 p
             }
         }
 
-        /*
-        Different techniques depending on encapsulation. Using the native FLAC seektable with Ogg encapsulation is a bit awkward so
-        we'll instead use Ogg's natural seeking facility.
-        */
-#ifndef DR_FLAC_NO_OGG
-        if (pFlac->container == drflac_container_ogg)
-        {
-            wasSuccessful = drflac_ogg__seek_to_pcm_frame(pFlac, pcmFrameIndex);
+        /* The frame cache is checked before going to the bit streamer. */
+        if (drflac__frame_cache_load(pFlac, pcmFrameIndex)) {
+            pFlac->currentPCMFrame = pcmFrameIndex;
+            return DRFLAC_TRUE;
         }
-        else
-#endif
-        {
-            /* First try seeking via the seek table. If this fails, fall back to a brute force seek which is much slower. */
-            if (/*!wasSuccessful && */!pFlac->_noSeekTableSeek) {
-                wasSuccessful = drflac__seek_to_pcm_frame__seek_table(pFlac, pcmFrameIndex);
-            }
-
-#if !defined(DR_FLAC_NO_CRC)
-            /* Fall back to binary search if seek table seeking fails. This requires the length of the stream to be known. */
-            if (!wasSuccessful && !pFlac->_noBinarySearchSeek && pFlac->totalPCMFrameCount > 0) {
-                wasSuccessful = drflac__seek_to_pcm_frame__binary_search(pFlac, pcmFrameIndex);
-            }
-#endif
 
-            /* Fall back to brute force if all else fails. */
-            if (!wasSuccessful && !pFlac->_noBruteForceSeek) {
-                wasSuccessful = drflac__seek_to_pcm_frame__brute_force(pFlac, pcmFrameIndex);
-            }
-        }
+        wasSuccessful = drflac__seek_to_pcm_frame__bitstream(pFlac, pcmFrameIndex);
 
         pFlac->currentPCMFrame = pcmFrameIndex;
         return wasSuccessful;
     }
 }
 
+DRFLAC_API drflac_bool32 drflac_set_frame_cache_size(drflac* pFlac, size_t sizeInBytes)
+{
+    drflac__frame_cache* pCache;
+    size_t entrySizeInBytes;
+    size_t samplesPerEntry;
+    size_t capacity;
+    size_t iEntry;
+
+    if (pFlac == NULL) {
+        return DRFLAC_FALSE;
+    }
+
+    /*
+    If the current frame was loaded from the cache its samples live inside the cache's allocation. They need to be moved to the decoder's own
+    buffer before the cache can be freed. The bit streamer is still out of sync, so _isFrameFromCache must stay set.
+    */
+    if (pFlac->_isFrameFromCache) {
+        drflac_uint32 blockSize = pFlac->currentFLACFrame.header.blockSizeInPCMFrames;
+        drflac_uint32 channelCount = drflac__get_channel_count_from_channel_assignment(pFlac->currentFLACFrame.header.channelAssignment);
+        drflac_uint32 iChannel;
+
+        for (iChannel = 0; iChannel < channelCount; iChannel += 1) {
+            DRFLAC_COPY_MEMORY(pFlac->pDecodedSamples + (blockSize * iChannel), pFlac->currentFLACFrame.subframes[iChannel].pSamplesS32, blockSize * sizeof(drflac_int32));
+            pFlac->currentFLACFrame.subframes[iChannel].pSamplesS32 = pFlac->pDecodedSamples + (blockSize * iChannel);
+        }
+    }
+
+    drflac__free_from_callbacks(pFlac->_pFrameCache, &pFlac->allocationCallbacks);
+    pFlac->_pFrameCache = NULL;
+
+    if (sizeInBytes == 0) {
+        return DRFLAC_TRUE;
+    }
+
+    samplesPerEntry  = (size_t)pFlac->maxBlockSizeInPCMFrames * pFlac->channels;
+    entrySizeInBytes = sizeof(drflac__frame_cache_entry) + (samplesPerEntry * sizeof(drflac_int32));
+    if (sizeInBytes < sizeof(drflac__frame_cache) + entrySizeInBytes) {
+        return DRFLAC_FALSE;    /* Too small to hold a single frame. */
+    }
+
+    capacity = (sizeInBytes - sizeof(drflac__frame_cache)) / entrySizeInBytes;
+    if ((drflac_uint64)capacity > 0xFFFFFFFF) {
+        capacity = 0xFFFFFFFF;
+    }
+
+    pCache = (drflac__frame_cache*)drflac__malloc_from_callbacks(sizeof(drflac__frame_cache) + (capacity * entrySizeInBytes), &pFlac->allocationCallbacks);
+    if (pCache == NULL) {
+        return DRFLAC_FALSE;    /* Out of memory. */
+    }
+
+    pCache->capacity = (drflac_uint32)capacity;
+    pCache->counter  = 0;
+    pCache->pEntries = (drflac__frame_cache_entry*)(pCache + 1);
+
+    for (iEntry = 0; iEntry < capacity; iEntry += 1) {
+        DRFLAC_ZERO_MEMORY(&pCache->pEntries[iEntry], sizeof(pCache->pEntries[iEntry]));
+        pCache->pEntries[iEntry].pSamples = (drflac_int32*)(pCache->pEntries + capacity) + (iEntry * samplesPerEntry);
+    }
+
+    pFlac->_pFrameCache = pCache;
+
+    return DRFLAC_TRUE;
+}
+
+DRFLAC_API void drflac_set_frame_error_policy(drflac* pFlac, drflac_frame_error_policy policy, drflac_frame_error_proc onFrameError, void* pUserData)
+{
+    if (pFlac == NULL) {
+        return;
+    }
+
+    pFlac->frameErrorPolicy    = policy;
+    pFlac->onFrameError        = onFrameError;
+    pFlac->pUserDataFrameError = pUserData;
+}
+
 
 
 /* High Level APIs */
@@ -11632,6 +12496,136 @@ DRFLAC_API float* drflac_open_memory_and_read_pcm_frames_f32(const void* data, s
 }
 
 
+/*
+Allocator used by drflac_decode_batch(). The decoder object is the only allocation that is alive at any one time so it can be handed the same
+block of memory for every item. Any other allocation is passed through to the real callbacks.
+*/
+typedef struct
+{
+    void* pBuffer;
+    size_t bufferSize;
+    drflac_bool32 isBufferInUse;
+    drflac_allocation_callbacks allocationCallbacks;
+} drflac__batch_allocator;
+
+static void* drflac__batch_allocator_malloc(size_t sz, void* pUserData)
+{
+    drflac__batch_allocator* pAllocator = (drflac__batch_allocator*)pUserData;
+    DRFLAC_ASSERT(pAllocator != NULL);
+
+    if (pAllocator->isBufferInUse) {
+        return drflac__malloc_from_callbacks(sz, &pAllocator->allocationCallbacks);
+    }
+
+    if (sz > pAllocator->bufferSize) {
+        drflac__free_from_callbacks(pAllocator->pBuffer, &pAllocator->allocationCallbacks);
+
+        pAllocator->pBuffer = drflac__malloc_from_callbacks(sz, &pAllocator->allocationCallbacks);
+        if (pAllocator->pBuffer == NULL) {
+            pAllocator->bufferSize = 0;
+            return NULL;
+        }
+
+        pAllocator->bufferSize = sz;
+    }
+
+    pAllocator->isBufferInUse = DRFLAC_TRUE;
+    return pAllocator->pBuffer;
+}
+
+static void drflac__batch_allocator_free(void* p, void* pUserData)
+{
+    drflac__batch_allocator* pAllocator = (drflac__batch_allocator*)pUserData;
+    DRFLAC_ASSERT(pAllocator != NULL);
+
+    if (p == pAllocator->pBuffer) {
+        pAllocator->isBufferInUse = DRFLAC_FALSE;
+    } else {
+        drflac__free_from_callbacks(p, &pAllocator->allocationCallbacks);
+    }
+}
+
+DRFLAC_API drflac_uint32 drflac_decode_batch(drflac_batch_item* pItems, drflac_uint32 itemCount, const drflac_allocation_callbacks* pAllocationCallbacks)
+{
+    drflac__batch_allocator allocator;
+    drflac_allocation_callbacks batchAllocationCallbacks;
+    drflac_uint32 successCount = 0;
+    drflac_uint32 iItem;
+
+    if (pItems == NULL) {
+        return 0;
+    }
+
+    DRFLAC_ZERO_MEMORY(&allocator, sizeof(allocator));
+    if (pAllocationCallbacks != NULL) {
+        allocator.allocationCallbacks = *pAllocationCallbacks;
+        if (allocator.allocationCallbacks.onFree == NULL || (allocator.allocationCallbacks.onMalloc == NULL && allocator.allocationCallbacks.onRealloc == NULL)) {
+            return 0;   /* Invalid allocation callbacks. */
+        }
+    } else {
+        allocator.allocationCallbacks.pUserData = NULL;
+        allocator.allocationCallbacks.onMalloc  = drflac__malloc_default;
+        allocator.allocationCallbacks.onRealloc = drflac__realloc_default;
+        allocator.allocationCallbacks.onFree    = drflac__free_default;
+    }
+
+    batchAllocationCallbacks.pUserData = &allocator;
+    batchAllocationCallbacks.onMalloc  = drflac__batch_allocator_malloc;
+    batchAllocationCallbacks.onRealloc = NULL;
+    batchAllocationCallbacks.onFree    = drflac__batch_allocator_free;
+
+    for (iItem = 0; iItem < itemCount; iItem += 1) {
+        drflac_batch_item* pItem = &pItems[iItem];
+        drflac* pFlac;
+
+        pItem->channels           = 0;
+        pItem->sampleRate         = 0;
+        pItem->totalPCMFrameCount = 0;
+        pItem->pcmFramesRead      = 0;
+        pItem->isSuccessful       = DRFLAC_FALSE;
+
+        if (pItem->pData != NULL) {
+            pFlac = drflac_open_memory(pItem->pData, pItem->dataSize, &batchAllocationCallbacks);
+        } else {
+#ifndef DR_FLAC_NO_STDIO
+            pFlac = drflac_open_file(pItem->pFilePath, &batchAllocationCallbacks);
+#else
+            pFlac = NULL;
+#endif
+        }
+
+        if (pFlac == NULL) {
+            continue;
+        }
+
+        pItem->channels           = pFlac->channels;
+        pItem->sampleRate         = pFlac->sampleRate;
+        pItem->totalPCMFrameCount = pFlac->totalPCMFrameCount;
+
+        if (pItem->pPCMFramesOut != NULL) {
+            pItem->pcmFramesRead = drflac_read_pcm_frames_s32(pFlac, pItem->pcmFrameCapacity, pItem->pPCMFramesOut);
+
+            /* It's an error if the buffer was too small or the stream ended early. */
+            if (pFlac->totalPCMFrameCount == 0 || pItem->pcmFramesRead == pFlac->totalPCMFrameCount) {
+                pItem->isSuccessful = DRFLAC_TRUE;
+            }
+        } else {
+            pItem->isSuccessful = DRFLAC_TRUE;
+        }
+
+        drflac_close(pFlac);
+
+        if (pItem->isSuccessful) {
+            successCount += 1;
+        }
+    }
+
+    drflac__free_from_callbacks(allocator.pBuffer, &allocator.allocationCallbacks);
+
+    return successCount;
+}
+
+
 DRFLAC_API void drflac_free(void* p, const drflac_allocation_callbacks* pAllocationCallbacks)
 {
     if (pAllocationCallbacks != NULL) {
@@ -11737,6 +12731,16 @@ DRFLAC_API drflac_bool32 drflac_next_cuesheet_track(drflac_cuesheet_track_iterat
 /*
 REVISION HISTORY
 ================
+v0.12.14 - TBD
+  - Add bit depth and predictor order specialized residual decoders for when SSE4.1 and NEON are unavailable. The decoding pipeline is
+    selected once when the stream is opened.
+  - Add drflac_set_frame_cache_size() for caching recently decoded frames.
+  - Add drflac_clone() for creating additional read cursors over the same stream without re-reading the metadata.
+  - Add drflac_decode_batch() for decoding many streams with a single decoder allocation.
+  - Add drflac_set_frame_error_policy() for controlling how frames that fail to decode are handled.
+  - Frames with invalid contents are now skipped rather than ending the stream.
+  - Improve the performance of searching for the next sync code.
+
 v0.12.13 - 2020-05-16
   - Add compile-time and run-time version querying.
     - DRFLAC_VERSION_MINOR
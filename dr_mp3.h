@@ -1,6 +1,6 @@
 /*
 MP3 audio decoder. Choice of public domain or MIT-0. See license statements at the end of this file.
-dr_mp3 - v0.6.10 - 2020-05-16
+dr_mp3 - v0.6.11 - TBD
 
 David Reid - mackron@gmail.com
 
@@ -63,7 +63,8 @@ The drmp3 object is transparent so you can get access to the channel count and s
     ```
 
 The example above initializes a decoder from a file, but you can also initialize it from a block of memory and read and seek callbacks with
-`drmp3_init_memory()` and `drmp3_init()` respectively.
+`drmp3_init_memory()` and `drmp3_init()` respectively. For network streams where data arrives in chunks, use `drmp3_init_push()` and pass each chunk to
+`drmp3_push_data()` as it arrives.
 
 You do not need to do any annoying memory management when reading PCM frames - this is all managed internally. You can request any number of PCM frames in each
 call to `drmp3_read_pcm_frames_f32()` and it will return as many PCM frames as it can, up to the requested amount.
@@ -79,8 +80,25 @@ Build Options
 #define DR_MP3_NO_STDIO
   Disable drmp3_init_file(), etc.
 
+#define DR_MP3_COMPACT
+  Reduce the memory used by each decoder, for programs that keep a large number of them open. The buffer for the current MP3 frame is
+  only allocated when the client's buffer is too small to decode into directly, and the default input buffer is 8KB instead of 16KB.
+  See also drmp3_suspend().
+
+#define DR_MP3_NO_MMAP
+  Disable memory mapping in drmp3_init_file_mmap() and drmp3_init_file_mmap_w(), which then behave the same as drmp3_init_file()
+  and drmp3_init_file_w().
+
 #define DR_MP3_NO_SIMD
   Disable SIMD optimizations.
+
+#define DR_MP3_NO_AVX
+  Disable AVX optimizations. AVX is detected at run time and SSE2 is used when it's not available.
+
+#define DR_MP3_FIXED_POINT
+  Decode with integer arithmetic only, for targets without a fast FPU. Output is s16 and this cannot be combined with
+  DR_MP3_FLOAT_OUTPUT. SIMD optimizations are not used in this mode. The output is within a couple of LSBs of the floating point
+  decoder.
 */
 
 #ifndef dr_mp3_h
@@ -95,7 +113,7 @@ extern "C" {
 
 #define DRMP3_VERSION_MAJOR     0
 #define DRMP3_VERSION_MINOR     6
-#define DRMP3_VERSION_REVISION  10
+#define DRMP3_VERSION_REVISION  11
 #define DRMP3_VERSION_STRING    DRMP3_XSTRINGIFY(DRMP3_VERSION_MAJOR) "." DRMP3_XSTRINGIFY(DRMP3_VERSION_MINOR) "." DRMP3_XSTRINGIFY(DRMP3_VERSION_REVISION)
 
 #include <stddef.h> /* For size_t. */
@@ -224,6 +242,8 @@ typedef drmp3_int32 drmp3_result;
 
 #define DRMP3_MAX_PCM_FRAMES_PER_MP3_FRAME  1152
 #define DRMP3_MAX_SAMPLES_PER_FRAME         (DRMP3_MAX_PCM_FRAMES_PER_MP3_FRAME*2)
+#define DRMP3_MIN_OUTPUT_SAMPLE_RATE        1000
+#define DRMP3_MAX_OUTPUT_SAMPLE_RATE        384000
 
 #ifdef _MSC_VER
     #define DRMP3_INLINE __forceinline
@@ -260,7 +280,11 @@ typedef struct
 
 typedef struct
 {
+#ifndef DR_MP3_FIXED_POINT
     float mdct_overlap[2][9*32], qmf_state[15*2*32];
+#else
+    drmp3_int32 mdct_overlap[2][9*32], qmf_state[15*2*32];
+#endif
     int reserv, free_format_bytes;
     drmp3_uint8 header[4], reserv_buf[511];
 } drmp3dec;
@@ -271,6 +295,27 @@ DRMP3_API void drmp3dec_init(drmp3dec *dec);
 /* Reads a frame from a low level decoder. */
 DRMP3_API int drmp3dec_decode_frame(drmp3dec *dec, const drmp3_uint8 *mp3, int mp3_bytes, void *pcm, drmp3dec_frame_info *info);
 
+/* A frame to be read by drmp3dec_decode_frame_batch(). The inputs are the parameters of drmp3dec_decode_frame(). */
+typedef struct
+{
+    drmp3dec *dec;
+    const drmp3_uint8 *mp3;
+    int mp3_bytes;
+    void *pcm;
+    drmp3dec_frame_info info;   /* Output. */
+    int samples;                /* Output. The return value of drmp3dec_decode_frame(). */
+} drmp3dec_batch_item;
+
+/*
+Reads a frame from each of a number of low level decoders, with the same results as calling drmp3dec_decode_frame() for each item in
+turn. Each decoder can only appear once in a batch.
+
+Headers and Huffman data are decoded one stream at a time, but mono Layer III frames are synthesized two at a time, one stream in the
+SIMD lanes that the left channel of a stereo frame would use and the other in the lanes of the right channel. This is for servers that
+decode a large number of streams at once. Stereo frames already fill the lanes so they gain nothing from being batched.
+*/
+DRMP3_API void drmp3dec_decode_frame_batch(drmp3dec_batch_item *items, int count);
+
 /* Helper for converting between f32 and s16. */
 DRMP3_API void drmp3dec_f32_to_s16(const float *in, drmp3_int16 *out, size_t num_samples);
 
@@ -287,6 +332,11 @@ Main API (Pull API)
 #define DRMP3_DEFAULT_SAMPLE_RATE   44100
 #endif
 
+/* The maximum number of MP3 frames a seek point will have decoded before it so the bit reservoir is full. Used by drmp3_calculate_seek_points() and drmp3_record_seek_points(). */
+#ifndef DRMP3_SEEK_MAX_PRIMING_MP3_FRAMES
+#define DRMP3_SEEK_MAX_PRIMING_MP3_FRAMES   32
+#endif
+
 
 typedef enum
 {
@@ -330,6 +380,17 @@ will be either drmp3_seek_origin_start or drmp3_seek_origin_current.
 */
 typedef drmp3_bool32 (* drmp3_seek_proc)(void* pUserData, int offset, drmp3_seek_origin origin);
 
+/*
+Callback for when a block of ICY metadata has been taken out of the data passed to drmp3_push_data().
+
+pUserData    [in] The user data that was passed to drmp3_set_icy_metadata_interval().
+pMetadata    [in] The metadata, such as "StreamTitle='...';". It's padded with null bytes and isn't necessarily null terminated.
+metadataSize [in] The size of the metadata in bytes, including the padding. This is a multiple of 16.
+
+Blocks that are empty, which is most of them, are not reported.
+*/
+typedef void (* drmp3_icy_metadata_proc)(void* pUserData, const char* pMetadata, size_t metadataSize);
+
 typedef struct
 {
     void* pUserData;
@@ -344,6 +405,19 @@ typedef struct
     drmp3_uint32 sampleRate;
 } drmp3_config;
 
+typedef enum
+{
+    drmp3_decode_quality_full = 0,      /* Every subband is decoded. The output is at the sample rate of the stream. */
+    drmp3_decode_quality_half_rate,     /* The lower 16 subbands are decoded and output at half the sample rate of the stream. */
+    drmp3_decode_quality_quarter_rate   /* The lower 8 subbands are decoded and output at a quarter of the sample rate of the stream. */
+} drmp3_decode_quality;
+
+typedef enum
+{
+    drmp3_seek_mode_exact = 0,          /* Seeking is sample exact. Without a seek table the stream is decoded from the start, or from the current position. */
+    drmp3_seek_mode_fast                /* The table of contents in the Xing/Info or VBRI frame, if any, is used to jump close to the target. */
+} drmp3_seek_mode;
+
 typedef struct
 {
     drmp3dec decoder;
@@ -358,22 +432,101 @@ typedef struct
     drmp3_uint32 mp3FrameSampleRate;    /* The sample rate of the currently loaded MP3 frame. Internal use only. */
     drmp3_uint32 pcmFramesConsumedInMP3Frame;
     drmp3_uint32 pcmFramesRemainingInMP3Frame;
+    drmp3_uint32 pcmFramesToTrimAtStart;    /* The number of PCM frames of encoder delay that still need to be skipped. Internal use only. */
+#if defined(DR_MP3_COMPACT)
+    drmp3_uint8* pcmFrames;             /* Allocated when first needed. Frames are decoded straight into the client's buffer when it has room for them. */
+#else
     drmp3_uint8 pcmFrames[sizeof(float)*DRMP3_MAX_SAMPLES_PER_FRAME];  /* <-- Multipled by sizeof(float) to ensure there's enough room for DR_MP3_FLOAT_OUTPUT. */
-    drmp3_uint64 currentPCMFrame;       /* The current PCM frame, globally, based on the output sample rate. Mainly used for seeking. */
+#endif
+    drmp3_uint64 currentPCMFrame;       /* The current PCM frame, globally, based on the sample rate of the stream. Mainly used for seeking. */
     drmp3_uint64 streamCursor;          /* The current byte the decoder is sitting on in the raw stream. */
     drmp3_seek_point* pSeekPoints;      /* NULL by default. Set with drmp3_bind_seek_table(). Memory is owned by the client. dr_mp3 will never attempt to free this pointer. */
     drmp3_uint32 seekPointCount;        /* The number of items in pSeekPoints. When set to 0 assumes to no seek table. Defaults to zero. */
-    size_t dataSize;
-    size_t dataCapacity;
-    size_t dataConsumed;
-    drmp3_uint8* pData;
+    drmp3_seek_mode seekMode;           /* Set with drmp3_set_seek_mode(). Defaults to drmp3_seek_mode_exact. */
+    size_t dataSize;                    /* The number of unread bytes in pData. */
+    size_t dataCapacity;                /* The size of the ring in pData. */
+    size_t dataConsumed;                /* The position in the ring of the first unread byte. */
+    size_t inputBufferSize;             /* The size set with drmp3_set_input_buffer_size(), or 0 for the default. */
+    drmp3_uint8* pData;                 /* A ring of dataCapacity bytes followed by a copy of its start. See drmp3__resize_data_buffer(). */
     drmp3_bool32 atEnd : 1;
+    drmp3_bool32 isSuspended : 1;       /* Set by drmp3_suspend(). pData holds exactly dataSize bytes, or is NULL, until drmp3_resume(). */
+    drmp3_bool32 isPreallocated : 1;    /* Set by drmp3_init_preallocated(). pData, and pcmFrames with DR_MP3_COMPACT, are owned by the client. */
+    drmp3_uint64 streamStartOffset;     /* The byte position of the first MP3 frame containing audio data. Seeking back to the start of the stream moves here. */
+    struct
+    {
+        drmp3_uint64 mp3FrameCount;         /* The number of MP3 frames containing audio data, not including the tag frame itself. Set to 0 if unknown. */
+        drmp3_uint64 byteCount;             /* The size of the MP3 data in bytes, including the tag frame. Set to 0 if unknown. */
+        drmp3_uint64 framePos;              /* The byte position of the tag frame. Offsets in the TOC are relative to this. */
+        drmp3_uint32 pcmFramesPerMP3Frame;
+        drmp3_uint32 delayInPCMFrames;      /* The number of PCM frames to trim from the start of the stream. Includes the decoder delay. */
+        drmp3_uint32 paddingInPCMFrames;    /* The number of PCM frames to trim from the end of the stream. */
+        drmp3_bool32 hasGaplessInfo;        /* Whether or not the tag frame has a LAME extension with the encoder delay and padding. */
+        drmp3_bool32 hasTOC;
+        drmp3_uint8 toc[100];               /* toc[i] is the byte position of i% of the stream, expressed as a fraction of byteCount in 1/256ths. */
+    } vbrTag;   /* Information from the Xing/Info or VBRI frame at the start of the stream, if any. Internal use only. */
     struct
     {
         const drmp3_uint8* pData;
         size_t dataSize;
         size_t currentReadPos;
+        drmp3_bool32 isMappedFile;          /* Set when pData is a mapping of a file made by drmp3_init_file_mmap(). It's unmapped by drmp3_uninit(). */
     } memory;   /* Only used for decoders that were opened against a block of memory. */
+    struct
+    {
+        drmp3_uint32 channelsIn;            /* The channel count of the stream. pMP3->channels is the output channel count. */
+        drmp3_uint32 sampleRateIn;          /* The sample rate of the stream. pMP3->sampleRate is the output sample rate. */
+        drmp3_uint32 upFactor;              /* The output sample rate divided by the greatest common factor of both rates. */
+        drmp3_uint32 downFactor;            /* The input sample rate divided by the greatest common factor of both rates. */
+        drmp3_uint32 tapCount;              /* The length of the filter. 0 when only the channel count is converted. */
+        drmp3_uint32 phase;                 /* The position of the next output frame between two input frames, in 1/upFactor units. */
+        drmp3_uint32 frameCapacity;         /* The number of frames each channel of pFrames can hold. */
+        drmp3_uint32 frameCount;            /* The number of frames in pFrames. */
+        drmp3_uint32 framePos;              /* The frame in pFrames at or just before the next output frame. */
+        drmp3_uint32 endPos;                /* The frame in pFrames where the stream ended. Only valid when atEnd is set. */
+        drmp3_bool32 isEnabled;
+        drmp3_bool32 isDownmixing;          /* Set when stereo is mixed down to mono by the decoder, before synthesis. The converter then only resamples. */
+        drmp3_bool32 atEnd;
+        float* pTaps;                       /* One row of tapCount coefficients for each phase. */
+        float* pFrames;                     /* Input frames at the output channel count, one channel after the other. */
+        drmp3_uint64 currentPCMFrame;       /* The current PCM frame at the output sample rate. */
+    } converter;    /* Sample rate and channel conversion, set up with drmp3_set_output_format(). Internal use only. */
+    struct
+    {
+        drmp3_uint32 capacity;              /* The number of items pSeekPoints can hold. 0 when not recording. */
+        drmp3_uint64 pcmFramesBetweenSeekPoints;
+        drmp3_uint64 nextTargetPCMFrame;    /* The PCM frame the next seek point will target. Counted the same way as runningPCMFrameCount. */
+        drmp3_uint64 runningPCMFrameCount;  /* The PCM frame at the start of the next MP3 frame, including the encoder delay. Only valid when isInSync is set. */
+        float runningPCMFrameCountFractionalPart;
+        drmp3_uint64 mp3FrameBytePos[DRMP3_SEEK_MAX_PRIMING_MP3_FRAMES+3];       /* A ring of the most recently decoded MP3 frames. */
+        drmp3_uint64 mp3FramePCMFrameIndex[DRMP3_SEEK_MAX_PRIMING_MP3_FRAMES+3];
+        drmp3_uint32 mp3FrameCount;         /* The number of items in the ring. */
+        drmp3_uint32 mp3FrameHead;          /* The index of the oldest item in the ring. */
+        drmp3_bool32 isInSync;              /* Set while MP3 frames are being decoded one after the other from a known position. */
+        drmp3_bool32 isAtStartOfStream;     /* Set when the first item in the ring is the first MP3 frame of the stream. */
+    } seekRecorder; /* Seek points recorded during playback, set up with drmp3_record_seek_points(). Internal use only. */
+    struct
+    {
+        drmp3_uint32 rateShift;             /* The sample rate of the stream, and every PCM frame count, is divided by 1 << rateShift. */
+        drmp3_uint32 sampleRate;            /* The values below are those of the stream at full quality. Only valid when rateShift is not 0. */
+        drmp3_uint32 pcmFramesPerMP3Frame;
+        drmp3_uint32 delayInPCMFrames;
+        drmp3_uint32 paddingInPCMFrames;
+    } decodeQuality;    /* Set with drmp3_set_decode_quality(). Internal use only. */
+    struct
+    {
+        drmp3_bool32 isEnabled;             /* Set by drmp3_init_push(). Data only comes from drmp3_push_data(). */
+        drmp3_bool32 isComplete;            /* Set by drmp3_push_end(). Running out of data is the end of the stream once this is set. */
+        const drmp3_uint8* pPendingData;    /* The data passed to drmp3_push_data() that hasn't been taken yet. Only set during the call. */
+        size_t pendingDataSize;
+        drmp3_uint64 bytesToSkip;           /* What's left of a tag that's being skipped over. It's dropped as it's pushed. */
+        drmp3_uint32 icyMetadataInterval;   /* The number of bytes of audio between ICY metadata blocks. 0 when there's no ICY metadata. */
+        drmp3_uint32 icyBytesToMetadata;    /* The number of bytes of audio before the next ICY metadata block. */
+        drmp3_uint32 icyMetadataSize;       /* The size of the ICY metadata block being taken out. 0 when it's the length byte that's next. */
+        drmp3_uint32 icyMetadataPos;        /* The number of bytes of the ICY metadata block that have been taken out so far. */
+        char* pIcyMetadata;                 /* Holds the ICY metadata block until it's complete. Only allocated when there's a callback. */
+        drmp3_icy_metadata_proc onIcyMetadata;
+        void* pIcyUserData;
+    } push;     /* Only used for decoders that were opened with drmp3_init_push(). */
 } drmp3;
 
 /*
@@ -385,12 +538,46 @@ pUserData [in, optional] A pointer to application defined data that will be pass
 
 Returns true if successful; false otherwise.
 
+ID3v2, ID3v1 and APEv2 tags are skipped over without being scanned. When onSeek is NULL the contents of large tags
+still need to be read and discarded.
+
 Close the loader with drmp3_uninit().
 
 See also: drmp3_init_file(), drmp3_init_memory(), drmp3_uninit()
 */
 DRMP3_API drmp3_bool32 drmp3_init(drmp3* pMP3, drmp3_read_proc onRead, drmp3_seek_proc onSeek, void* pUserData, const drmp3_allocation_callbacks* pAllocationCallbacks);
 
+/*
+Retrieves the size of the buffer that needs to be passed to drmp3_init_preallocated().
+
+inputBufferSize [in] The size of the buffer that data is read into from the onRead callback, the same as with
+                     drmp3_set_input_buffer_size(). Pass 0 for the default.
+
+Returns the size of the buffer in bytes, or 0 if inputBufferSize is out of range. The buffer is slightly larger than inputBufferSize.
+*/
+DRMP3_API size_t drmp3_get_preallocated_buffer_size(size_t inputBufferSize);
+
+/*
+Initializes an MP3 decoder that uses a buffer owned by the client instead of allocating one.
+
+pBuffer    [in] The buffer that data is read into from the onRead callback. This must be aligned for a float, such as memory returned by
+                malloc(), and must remain valid until drmp3_uninit() is called.
+bufferSize [in] The size of pBuffer in bytes. Use drmp3_get_preallocated_buffer_size() to find the size that's needed.
+
+Returns true if successful; false otherwise.
+
+Nothing is allocated by this function or by reading, seeking or uninitializing the decoder, which makes it suitable for starting
+playback on a real-time thread. The buffer is not freed by drmp3_uninit(). The exceptions are drmp3_set_output_format(), which
+allocates the sample rate converter and should be called beforehand, and the drmp3_open_*() functions. drmp3_suspend() does
+nothing and the input buffer size can't be changed with drmp3_set_input_buffer_size(). A stream with an MP3 frame that doesn't fit
+in the buffer will stop decoding at that frame instead of growing the buffer, but this doesn't happen with valid streams.
+
+pAllocationCallbacks is only used by drmp3_set_output_format().
+
+See also: drmp3_init()
+*/
+DRMP3_API drmp3_bool32 drmp3_init_preallocated(drmp3* pMP3, drmp3_read_proc onRead, drmp3_seek_proc onSeek, void* pUserData, void* pBuffer, size_t bufferSize, const drmp3_allocation_callbacks* pAllocationCallbacks);
+
 /*
 Initializes an MP3 decoder from a block of memory.
 
@@ -401,6 +588,59 @@ The buffer should contain the contents of the entire MP3 file.
 */
 DRMP3_API drmp3_bool32 drmp3_init_memory(drmp3* pMP3, const void* pData, size_t dataSize, const drmp3_allocation_callbacks* pAllocationCallbacks);
 
+/*
+Initializes an MP3 decoder that the client pushes data into, rather than one that reads it from a callback.
+
+Returns true if successful; false otherwise.
+
+This is intended for network streams where data arrives whenever it arrives, and a thread can't be blocked waiting on it. Data is
+passed in with drmp3_push_data() in chunks of any size, and drmp3_push_end() is called once there's no more. PCM frames are read
+as usual, but the read functions only return what can be decoded from the data that's been pushed so far, which can be nothing.
+That's not the end of the stream unless drmp3_push_end() has been called. A frame is decoded as soon as all of it has been pushed,
+except that up to 16KB of data is needed to find the first frame, or to find the next frame after junk in the stream.
+
+The format of the stream isn't known until enough data has been pushed to decode the first frame. Until then pMP3->channels and
+pMP3->sampleRate are 0, nothing can be read, and drmp3_set_output_format() fails. Push decoders can't be seeked.
+
+See also: drmp3_push_data(), drmp3_push_end(), drmp3_set_icy_metadata_interval()
+*/
+DRMP3_API drmp3_bool32 drmp3_init_push(drmp3* pMP3, const drmp3_allocation_callbacks* pAllocationCallbacks);
+
+/*
+Passes data to a decoder that was initialized with drmp3_init_push().
+
+pData    [in] The next chunk of the stream.
+dataSize [in] The size of pData in bytes.
+
+Returns the number of bytes that were taken. The data is copied so pData can be reused as soon as this returns.
+
+Fewer bytes than dataSize are taken when the input buffer is full. The rest needs to be pushed again after PCM frames have been read.
+The buffer holds 16KB by default, or 8KB with DR_MP3_COMPACT, and can be changed with drmp3_set_input_buffer_size().
+*/
+DRMP3_API size_t drmp3_push_data(drmp3* pMP3, const void* pData, size_t dataSize);
+
+/*
+Tells a decoder that was initialized with drmp3_init_push() that there's no more data.
+
+Whatever is left in the input buffer can be read, after which the stream has ended.
+*/
+DRMP3_API void drmp3_push_end(drmp3* pMP3);
+
+/*
+Strips ICY (SHOUTcast) metadata out of the data passed to drmp3_push_data().
+
+metadataInterval [in]           The value of the icy-metaint header of the HTTP response, or 0 if there isn't any metadata.
+onMetadata       [in, optional] The function to call with each block of metadata.
+pUserData        [in, optional] A pointer to application defined data that will be passed to onMetadata.
+
+Returns true if successful; false otherwise.
+
+Servers that are asked for metadata with the "Icy-MetaData: 1" request header insert a block of metadata after every
+metadataInterval bytes of audio. These need to be taken out before the audio can be decoded. The interval starts with the first
+byte of the body of the response, so this needs to be called before anything is pushed.
+*/
+DRMP3_API drmp3_bool32 drmp3_set_icy_metadata_interval(drmp3* pMP3, drmp3_uint32 metadataInterval, drmp3_icy_metadata_proc onMetadata, void* pUserData);
+
 #ifndef DR_MP3_NO_STDIO
 /*
 Initializes an MP3 decoder from a file.
@@ -411,6 +651,21 @@ any given time.
 */
 DRMP3_API drmp3_bool32 drmp3_init_file(drmp3* pMP3, const char* pFilePath, const drmp3_allocation_callbacks* pAllocationCallbacks);
 DRMP3_API drmp3_bool32 drmp3_init_file_w(drmp3* pMP3, const wchar_t* pFilePath, const drmp3_allocation_callbacks* pAllocationCallbacks);
+
+/*
+Initializes an MP3 decoder from a file by mapping it into memory.
+
+The mapped file is decoded in place, the same as with drmp3_init_memory(), so no data is copied out of the file before it's decoded.
+The operating system is told that the file will be read sequentially so it can read ahead. Files larger than 2GB are supported on
+64-bit platforms.
+
+If the file can't be mapped, such as on platforms without support for it or when DR_MP3_NO_MMAP is defined, this falls back to
+drmp3_init_file(), or drmp3_init_file_w() for the wide-character version.
+
+The file is unmapped by drmp3_uninit(). Results are undefined if the file is modified while it's mapped.
+*/
+DRMP3_API drmp3_bool32 drmp3_init_file_mmap(drmp3* pMP3, const char* pFilePath, const drmp3_allocation_callbacks* pAllocationCallbacks);
+DRMP3_API drmp3_bool32 drmp3_init_file_mmap_w(drmp3* pMP3, const wchar_t* pFilePath, const drmp3_allocation_callbacks* pAllocationCallbacks);
 #endif
 
 /*
@@ -418,6 +673,92 @@ Uninitializes an MP3 decoder.
 */
 DRMP3_API void drmp3_uninit(drmp3* pMP3);
 
+/*
+Converts the output of the decoder to a different channel count and/or sample rate.
+
+pConfig [in] The channel count and sample rate to output. A member that is set to 0 keeps the format of the stream. Passing NULL
+             turns conversion off.
+
+Returns true if successful; false otherwise. Mono and stereo are the only supported channel counts. The sample rate must be between
+DRMP3_MIN_OUTPUT_SAMPLE_RATE and DRMP3_MAX_OUTPUT_SAMPLE_RATE.
+
+Once this returns, pMP3->channels and pMP3->sampleRate hold the output format, and drmp3_read_pcm_frames_f32(),
+drmp3_read_pcm_frames_s16(), drmp3_seek_to_pcm_frame() and drmp3_get_pcm_frame_count() all work in output PCM frames. Seeking
+stays sample exact. The seek points from drmp3_calculate_seek_points() are always in the sample rate of the stream, so they remain
+valid.
+
+Mono is up-mixed by copying it to both channels. Stereo is down-mixed by the decoder, which averages the two channels just before the
+synthesis filter so that only one channel needs to be synthesized. This makes decoding a stereo stream to mono noticeably faster than
+decoding it to stereo. The sample rate is converted with a windowed sinc filter. Rates with a small common factor, such as 44100 and
+48000, use an exact polyphase filter. Other rates use the closest of DRMP3_RESAMPLER_MAX_PHASES phases. Apart from the down-mix, the
+conversion uses floating point math, even with DR_MP3_FIXED_POINT.
+
+This is best called right after initialization. When called after reading has started, the decoder seeks to the same point in time
+in the new sample rate, if the stream can be seeked.
+*/
+DRMP3_API drmp3_bool32 drmp3_set_output_format(drmp3* pMP3, const drmp3_config* pConfig);
+
+/*
+Trades the quality of the decoded audio for speed.
+
+quality [in] drmp3_decode_quality_full, drmp3_decode_quality_half_rate or drmp3_decode_quality_quarter_rate.
+
+Returns true if successful; false otherwise. The stream must be seekable.
+
+At half rate only the lower 16 of the 32 subbands of each MP3 frame are decoded, and they are synthesized straight to half the sample
+rate of the stream. Everything above a quarter of the original sample rate is lost. At quarter rate it's the lower 8 subbands and
+everything above an eighth of the original sample rate. The Huffman data, mid/side stereo and the IMDCT are only processed for the
+subbands that are kept, except in short blocks and intensity stereo, which are decoded in full. Depending on the bitrate, half rate
+takes 60% to 90% of the time of a full decode and quarter rate takes 40% to 60%. This is intended for things like waveform thumbnails
+and scrubbing previews, not for listening.
+
+Once this returns, pMP3->sampleRate is the reduced sample rate, rounded to the nearest whole number, and every PCM frame count and
+position is at that rate. The output format is reset to that of the stream, so call drmp3_set_output_format() after this rather than
+before. Any seek table that's been bound is unbound, and seek points stop being recorded, since their positions are at the old rate.
+
+The decoder seeks to the same point in time at the new rate.
+*/
+DRMP3_API drmp3_bool32 drmp3_set_decode_quality(drmp3* pMP3, drmp3_decode_quality quality);
+
+/*
+Sets the size of the buffer that data is read into from the onRead callback.
+
+bufferSizeInBytes [in] The size of the buffer. This must be at least 8192 bytes. Larger buffers mean fewer, larger reads.
+
+Returns true if successful; false otherwise. The default is DRMP3_DATA_CHUNK_SIZE, which is 16KB, or 8KB with DR_MP3_COMPACT. This
+has no effect on decoders initialized with drmp3_init_memory() since they decode straight out of the client's buffer.
+
+Data is never moved around inside the buffer while decoding. It's used as a ring, with the start of the ring mirrored past its end so
+that an MP3 frame that wraps around can still be handed to the decoder in one piece.
+
+Data that has already been read from the stream is kept. Making the buffer smaller than the amount of data that's currently buffered
+requires the stream to be seekable.
+*/
+DRMP3_API drmp3_bool32 drmp3_set_input_buffer_size(drmp3* pMP3, size_t bufferSizeInBytes);
+
+/*
+Frees the buffers of a decoder that won't be read from for a while.
+
+Returns true if successful; false otherwise.
+
+The input buffer is freed. If the stream can be seeked, data that has been read from it but not yet decoded is dropped and read again
+when decoding continues. Otherwise it's moved into an allocation that's just big enough to hold it. With DR_MP3_COMPACT, the buffer for
+the current MP3 frame is freed as well once all of its PCM frames have been read.
+
+The state of the decoder itself is kept so decoding carries on seamlessly. This is intended for programs that keep a large number of
+decoders open, most of which are idle at any given time.
+
+Reading from the decoder resumes it automatically. Use drmp3_resume() to do this ahead of time.
+*/
+DRMP3_API drmp3_bool32 drmp3_suspend(drmp3* pMP3);
+
+/*
+Reallocates the buffers freed by drmp3_suspend().
+
+Returns true if successful; false otherwise. Does nothing if the decoder isn't suspended.
+*/
+DRMP3_API drmp3_bool32 drmp3_resume(drmp3* pMP3);
+
 /*
 Reads PCM frames as interleaved 32-bit IEEE floating point PCM.
 
@@ -436,37 +777,89 @@ DRMP3_API drmp3_uint64 drmp3_read_pcm_frames_s16(drmp3* pMP3, drmp3_uint64 frame
 Seeks to a specific frame.
 
 Note that this is _not_ an MP3 frame, but rather a PCM frame.
+
+Seeking is sample exact by default. Without a seek table bound with drmp3_bind_seek_table() this decodes the stream up to the
+target frame, from the start of the stream or from the current position, which runs in linear time.
+
+When drmp3_seek_mode_fast is set with drmp3_set_seek_mode() and the stream starts with a Xing/Info or VBRI frame containing a
+table of contents, the table of contents is used instead of decoding. A bound seek table still takes priority.
 */
 DRMP3_API drmp3_bool32 drmp3_seek_to_pcm_frame(drmp3* pMP3, drmp3_uint64 frameIndex);
 
+/*
+Selects how drmp3_seek_to_pcm_frame() finds its target when no seek table is bound.
+
+seekMode [in] drmp3_seek_mode_exact or drmp3_seek_mode_fast.
+
+Returns true if successful; false otherwise. The default is drmp3_seek_mode_exact.
+
+With drmp3_seek_mode_fast, streams that start with a Xing/Info or VBRI frame containing a table of contents are seeked in
+constant time by jumping straight to the approximate location of the target frame. This includes CBR files written by LAME,
+which carry an Info frame. The position is only as accurate as the table of contents, which has a resolution of 1% of the
+stream, so the decoder does not know exactly which frame it landed on. The current frame is then assumed to be the target,
+which means positions reported afterwards, and the trimming of the encoder padding at the end of gapless streams, are only
+approximate until the decoder seeks back to the start or to a position found with a seek table. Streams without a table of
+contents are seeked exactly in either mode.
+
+Use drmp3_seek_mode_fast for things like scrubbing through long podcasts where speed matters more than precision. Use
+drmp3_seek_mode_exact, or a seek table, if you need sample exact seeking.
+*/
+DRMP3_API drmp3_bool32 drmp3_set_seek_mode(drmp3* pMP3, drmp3_seek_mode seekMode);
+
 /*
 Calculates the total number of PCM frames in the MP3 stream. Cannot be used for infinite streams such as internet
-radio. Runs in linear time. Returns 0 on error.
+radio. Returns 0 on error.
+
+If the stream starts with a Xing/Info or VBRI frame the count is taken from that and this runs in constant time. Otherwise
+the entire stream is scanned which runs in linear time. The scan only looks at frame headers and side info without decoding any
+audio so it's bound by the speed of I/O.
+
+For memory streams and files opened by dr_mp3 the tag is checked against the size of the stream when the decoder is initialized.
+A stream that's shorter than the tag says, such as a truncated download, is scanned instead. The tag is not checked for streams
+read with callbacks since their size isn't known. Use drmp3_verify_vbr_tag() if you do not trust the count in the tag.
+
+When the Xing/Info frame has a LAME extension the encoder delay and padding are trimmed from the start and end of the stream
+by drmp3_read_pcm_frames_f32() and drmp3_read_pcm_frames_s16() for gapless playback. They are excluded from the count.
 */
 DRMP3_API drmp3_uint64 drmp3_get_pcm_frame_count(drmp3* pMP3);
 
 /*
 Calculates the total number of MP3 frames in the MP3 stream. Cannot be used for infinite streams such as internet
-radio. Runs in linear time. Returns 0 on error.
+radio. Returns 0 on error.
+
+Like drmp3_get_pcm_frame_count(), this runs in constant time when the stream starts with a Xing/Info or VBRI frame.
 */
 DRMP3_API drmp3_uint64 drmp3_get_mp3_frame_count(drmp3* pMP3);
 
 /*
 Calculates the total number of MP3 and PCM frames in the MP3 stream. Cannot be used for infinite streams such as internet
-radio. Runs in linear time. Returns 0 on error.
+radio. Runs in constant time when the stream starts with a Xing/Info or VBRI frame, otherwise linear time. Returns 0 on error.
 
 This is equivalent to calling drmp3_get_mp3_frame_count() and drmp3_get_pcm_frame_count() except that it's more efficient.
 */
 DRMP3_API drmp3_bool32 drmp3_get_mp3_and_pcm_frame_count(drmp3* pMP3, drmp3_uint64* pMP3FrameCount, drmp3_uint64* pPCMFrameCount);
 
 /*
-Calculates the seekpoints based on PCM frames. This is slow.
+Scans the entire stream and compares the number of MP3 frames against the count reported by the Xing/Info or VBRI frame. This
+is useful for files that have been cut or concatenated without the tag being rewritten. Cannot be used for infinite streams.
+
+Returns DRMP3_TRUE if the tag is consistent with the stream or there is no tag. If the counts do not match, the scanned count
+replaces the one from the tag, the TOC is disabled, and DRMP3_FALSE is returned. DRMP3_FALSE is also returned if the stream
+could not be scanned. The read position is restored to where it was before calling this.
+*/
+DRMP3_API drmp3_bool32 drmp3_verify_vbr_tag(drmp3* pMP3);
+
+/*
+Calculates the seekpoints based on PCM frames. This requires a pass over the entire stream, but only the frame headers and side
+info are looked at so it's not much slower than reading the file.
 
 pSeekpoint count is a pointer to a uint32 containing the seekpoint count. On input it contains the desired count.
 On output it contains the actual count. The reason for this design is that the client may request too many
 seekpoints, in which case dr_mp3 will return a corrected count.
 
-Note that seektable seeking is not quite sample exact when the MP3 stream contains inconsistent sample rates.
+Seeking with a seek table is sample exact. Each seek point starts far enough before its target for the bit reservoir to be filled,
+so the leading frames decode exactly like they would when playing from the start of the stream. It is not quite sample exact when the
+MP3 stream contains inconsistent sample rates.
 */
 DRMP3_API drmp3_bool32 drmp3_calculate_seek_points(drmp3* pMP3, drmp3_uint32* pSeekPointCount, drmp3_seek_point* pSeekPoints);
 
@@ -480,6 +873,52 @@ Use drmp3_calculate_seek_points() to calculate the seek points.
 */
 DRMP3_API drmp3_bool32 drmp3_bind_seek_table(drmp3* pMP3, drmp3_uint32 seekPointCount, drmp3_seek_point* pSeekPoints);
 
+/*
+Records seek points as the stream is decoded.
+
+seekPointCount             [in] The number of seek points at the start of pSeekPoints that are already filled in, such as ones saved from an
+                                earlier recording of the same stream. Set this to 0 to start from scratch.
+seekPointCapacity          [in] The number of seek points pSeekPoints can hold.
+pSeekPoints                [in] The array that seek points are recorded into. This is owned by the client.
+pcmFramesBetweenSeekPoints [in] The number of PCM frames between each seek point, in the sample rate of the stream. Pass 0 for one second.
+
+Returns true if successful; false otherwise.
+
+pSeekPoints is bound as the seek table, the same as with drmp3_bind_seek_table(), and a seek point is added to the end of it every
+pcmFramesBetweenSeekPoints PCM frames as playback moves past the end of the recorded part of the stream. Seeking back into the part of
+the stream that has already been played then goes through the seek table instead of decoding everything from the start of the stream.
+Recorded seek points are sample exact, the same as those from drmp3_calculate_seek_points(). Recording stops once the table is full.
+
+Seek points can only be recorded while the position in the stream is known exactly. This is the case when playing from the start of
+the stream, or from a seek point in the table, but not after seeking with the table of contents of a Xing/Info or VBRI frame. It
+takes a few MP3 frames after seeking to a seek point for recording to pick up again.
+
+Use drmp3_get_seek_point_count() to find out how many seek points have been recorded. The table can be saved and bound to a decoder
+for the same stream later on. Binding a different table with drmp3_bind_seek_table() stops recording.
+*/
+DRMP3_API drmp3_bool32 drmp3_record_seek_points(drmp3* pMP3, drmp3_uint32 seekPointCount, drmp3_uint32 seekPointCapacity, drmp3_seek_point* pSeekPoints, drmp3_uint64 pcmFramesBetweenSeekPoints);
+
+/*
+Retrieves the number of seek points in the bound seek table, including ones that have been recorded with drmp3_record_seek_points().
+*/
+DRMP3_API drmp3_uint32 drmp3_get_seek_point_count(drmp3* pMP3);
+
+/*
+Decodes a range of PCM frames from an MP3 stream held in memory, using a seek table to get to the start of the range.
+
+This is intended for decoding a whole file across multiple threads. Calculate the seek points once with drmp3_calculate_seek_points(),
+then split the stream at the pcmFrameIndex of the seek points and decode each segment on a different thread. Every call creates its own
+decoder and only reads from pData and pSeekPoints so it's safe to run any number of these at the same time. Seeking with a seek table
+decodes enough MP3 frames before the segment to fill the bit reservoir and the IMDCT overlap, so the segments can be concatenated and
+will be identical to decoding the stream from start to end.
+
+pFramesOut must be large enough to hold pcmFrameCount frames. The channel count can be retrieved with drmp3_init_memory() beforehand.
+
+Returns the number of PCM frames decoded, which will be less than pcmFrameCount if the end of the stream is reached.
+*/
+DRMP3_API drmp3_uint64 drmp3_decode_memory_segment_f32(const void* pData, size_t dataSize, drmp3_uint32 seekPointCount, const drmp3_seek_point* pSeekPoints, drmp3_uint64 firstPCMFrame, drmp3_uint64 pcmFrameCount, float* pFramesOut, const drmp3_allocation_callbacks* pAllocationCallbacks);
+DRMP3_API drmp3_uint64 drmp3_decode_memory_segment_s16(const void* pData, size_t dataSize, drmp3_uint32 seekPointCount, const drmp3_seek_point* pSeekPoints, drmp3_uint64 firstPCMFrame, drmp3_uint64 pcmFrameCount, drmp3_int16* pFramesOut, const drmp3_allocation_callbacks* pAllocationCallbacks);
+
 
 /*
 Opens an decodes an entire MP3 stream as a single operation.
@@ -592,7 +1031,11 @@ DRMP3_API const char* drmp3_version_string()
 #define DRMP3_MIN(a, b)           ((a) > (b) ? (b) : (a))
 #define DRMP3_MAX(a, b)           ((a) < (b) ? (b) : (a))
 
-#if !defined(DR_MP3_NO_SIMD)
+#if defined(DR_MP3_FIXED_POINT) && defined(DR_MP3_FLOAT_OUTPUT)
+#error DR_MP3_FIXED_POINT only supports s16 output and cannot be used with DR_MP3_FLOAT_OUTPUT
+#endif
+
+#if !defined(DR_MP3_NO_SIMD) && !defined(DR_MP3_FIXED_POINT)
 
 #if !defined(DR_MP3_ONLY_SIMD) && (defined(_M_X64) || defined(_M_ARM64) || defined(__x86_64__) || defined(__aarch64__))
 /* x64 always have SSE2, arm64 always have neon, no need for generic code */
@@ -617,7 +1060,7 @@ DRMP3_API const char* drmp3_version_string()
 #define DRMP3_VMUL_S(x, s)  _mm_mul_ps(x, _mm_set1_ps(s))
 #define DRMP3_VREV(x) _mm_shuffle_ps(x, x, _MM_SHUFFLE(0, 1, 2, 3))
 typedef __m128 drmp3_f4;
-#if defined(_MSC_VER) || defined(DR_MP3_ONLY_SIMD)
+#if defined(_MSC_VER)
 #define drmp3_cpuid __cpuid
 #else
 static __inline__ __attribute__((always_inline)) void drmp3_cpuid(int CPUInfo[], const int InfoType)
@@ -670,6 +1113,55 @@ end:
     return g_have_simd - 1;
 #endif
 }
+
+/*
+AVX is optional on every x86 target so it's always detected at run time. Only plain AVX float instructions are used, and never
+FMA, so the 8-wide paths produce exactly the same output as the SSE paths. Define DR_MP3_NO_AVX to compile it out.
+*/
+#if !defined(DR_MP3_NO_AVX) && ((defined(_MSC_VER) && _MSC_VER >= 1700) || defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#include <immintrin.h>
+#define DRMP3_HAVE_AVX 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#define DRMP3_AVX_TARGET
+#else
+#define DRMP3_AVX_TARGET __attribute__((target("avx")))
+#endif
+#define DRMP3_VREV8(x) _mm256_shuffle_ps(_mm256_permute2f128_ps(x, x, 1), _mm256_permute2f128_ps(x, x, 1), _MM_SHUFFLE(0, 1, 2, 3))
+#if !defined(__AVX__)
+static unsigned int drmp3_xgetbv0(void)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    return (unsigned int)_xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ __volatile__(".byte 0x0f, 0x01, 0xd0" : "=a" (eax), "=d" (edx) : "c" (0)); /* xgetbv */
+    (void)edx;
+    return eax;
+#endif
+}
+#endif
+static int drmp3_have_avx(void)
+{
+#if defined(__AVX__)
+    return 1;
+#else
+    static int g_have_avx;
+    int CPUInfo[4];
+    if (g_have_avx)
+        return g_have_avx - 1;
+    g_have_avx = 1;
+    drmp3_cpuid(CPUInfo, 0);
+    if (CPUInfo[0] > 0)
+    {
+        drmp3_cpuid(CPUInfo, 1);
+        /* AVX supported by the CPU, and XMM/YMM state saved by the OS (OSXSAVE + XCR0 bits 1 and 2). */
+        if ((CPUInfo[2] & (1 << 27)) && (CPUInfo[2] & (1 << 28)) && (drmp3_xgetbv0() & 6) == 6)
+            g_have_avx = 2;
+    }
+    return g_have_avx - 1;
+#endif
+}
+#endif
 #elif defined(__ARM_NEON) || defined(__aarch64__)
 #include <arm_neon.h>
 #define DRMP3_HAVE_SSE 0
@@ -703,6 +1195,34 @@ static int drmp3_have_simd(void)
 
 #endif
 
+#ifndef DRMP3_HAVE_AVX
+#define DRMP3_HAVE_AVX 0
+#endif
+
+/*
+The decoder works on drmp3d_real_t which is a float unless DR_MP3_FIXED_POINT is defined. In fixed point mode samples are Q22 in
+32-bit integers and constants are Q27. Constants are written with DRMP3_REAL() and multiplied with DRMP3_MUL() so that the same code
+serves both modes. The synthesis window is integer valued so the polyphase filter accumulates into a drmp3d_acc_t, which is 64-bit
+in fixed point mode.
+
+A full scale sine dequantizes to about 0.5. Dequantized values are clamped to DRMP3_FIX_MAX and the input of the synthesis DCT,
+which can grow its input by up to 76 times, to DRMP3_DCT_MAX. This keeps out of range streams from overflowing.
+*/
+#ifndef DR_MP3_FIXED_POINT
+typedef float drmp3d_real_t;
+typedef float drmp3d_acc_t;
+#define DRMP3_REAL(x)       x
+#define DRMP3_MUL(x, y)     ((x)*(y))
+#else
+#define DRMP3_FRAC_BITS     22
+#define DRMP3_FIX_MAX       ((2 << DRMP3_FRAC_BITS) - 1)
+#define DRMP3_DCT_MAX       ((6 << DRMP3_FRAC_BITS) - 1)
+typedef drmp3_int32 drmp3d_real_t;
+typedef drmp3_int64 drmp3d_acc_t;
+#define DRMP3_REAL(x)       ((drmp3_int32)((x)*134217728.0 + ((x) < 0 ? -0.5 : 0.5)))
+#define DRMP3_MUL(x, y)     ((drmp3_int32)(((drmp3_int64)(x)*(y) + (1 << 26)) >> 27))
+#endif
+
 #if defined(__ARM_ARCH) && (__ARM_ARCH >= 6) && !defined(__aarch64__)
 #define DRMP3_HAVE_ARMV6 1
 static __inline__ __attribute__((always_inline)) drmp3_int32 drmp3_clip_int16_arm(int32_t a)
@@ -722,7 +1242,7 @@ typedef struct
 
 typedef struct
 {
-    float scf[3*64];
+    drmp3d_real_t scf[3*64];
     drmp3_uint8 total_bands, stereo_bands, bitalloc[64], scfcod[64];
 } drmp3_L12_scale_info;
 
@@ -745,7 +1265,7 @@ typedef struct
     drmp3_bs bs;
     drmp3_uint8 maindata[DRMP3_MAX_BITRESERVOIR_BYTES + DRMP3_MAX_L3_FRAME_PAYLOAD_BYTES];
     drmp3_L3_gr_info gr_info[4];
-    float grbuf[2][576], scf[40], syn[18 + 15][2*32];
+    drmp3d_real_t grbuf[2][576], scf[40], syn[18 + 15][2*32];
     drmp3_uint8 ist_pos[2][39];
 } drmp3dec_scratch;
 
@@ -870,16 +1390,21 @@ static const drmp3_L12_subband_alloc *drmp3_L12_subband_alloc_table(const drmp3_
     return alloc;
 }
 
-static void drmp3_L12_read_scalefactors(drmp3_bs *bs, drmp3_uint8 *pba, drmp3_uint8 *scfcod, int bands, float *scf)
+static void drmp3_L12_read_scalefactors(drmp3_bs *bs, drmp3_uint8 *pba, drmp3_uint8 *scfcod, int bands, drmp3d_real_t *scf)
 {
+#ifndef DR_MP3_FIXED_POINT
     static const float g_deq_L12[18*3] = {
 #define DRMP3_DQ(x) 9.53674316e-07f/x, 7.56931807e-07f/x, 6.00777173e-07f/x
         DRMP3_DQ(3),DRMP3_DQ(7),DRMP3_DQ(15),DRMP3_DQ(31),DRMP3_DQ(63),DRMP3_DQ(127),DRMP3_DQ(255),DRMP3_DQ(511),DRMP3_DQ(1023),DRMP3_DQ(2047),DRMP3_DQ(4095),DRMP3_DQ(8191),DRMP3_DQ(16383),DRMP3_DQ(32767),DRMP3_DQ(65535),DRMP3_DQ(3),DRMP3_DQ(5),DRMP3_DQ(9)
     };
+#else
+    /* The same factors without the division by the number of quantization steps, which drmp3_L12_apply_scf_384() does to keep precision. */
+    static const drmp3_int32 g_deq_L12[3] = { DRMP3_REAL(2.0), DRMP3_REAL(1.587401052), DRMP3_REAL(1.259921050) };
+#endif
     int i, m;
     for (i = 0; i < bands; i++)
     {
-        float s = 0;
+        drmp3d_real_t s = 0;
         int ba = *pba++;
         int mask = ba ? 4 + ((19 >> scfcod[i]) & 3) : 0;
         for (m = 4; m; m >>= 1)
@@ -887,7 +1412,11 @@ static void drmp3_L12_read_scalefactors(drmp3_bs *bs, drmp3_uint8 *pba, drmp3_ui
             if (mask & m)
             {
                 int b = drmp3_bs_get_bits(bs, 6);
+#ifndef DR_MP3_FIXED_POINT
                 s = g_deq_L12[ba*3 - 6 + b % 3]*(int)(1 << 21 >> b/3);
+#else
+                s = g_deq_L12[b % 3] >> b/3;
+#endif
             }
             *scf++ = s;
         }
@@ -942,12 +1471,12 @@ static void drmp3_L12_read_scale_info(const drmp3_uint8 *hdr, drmp3_bs *bs, drmp
     }
 }
 
-static int drmp3_L12_dequantize_granule(float *grbuf, drmp3_bs *bs, drmp3_L12_scale_info *sci, int group_size)
+static int drmp3_L12_dequantize_granule(drmp3d_real_t *grbuf, drmp3_bs *bs, drmp3_L12_scale_info *sci, int group_size)
 {
     int i, j, k, choff = 576;
     for (j = 0; j < 4; j++)
     {
-        float *dst = grbuf + group_size*j;
+        drmp3d_real_t *dst = grbuf + group_size*j;
         for (i = 0; i < 2*sci->total_bands; i++)
         {
             int ba = sci->bitalloc[i];
@@ -958,7 +1487,7 @@ static int drmp3_L12_dequantize_granule(float *grbuf, drmp3_bs *bs, drmp3_L12_sc
                     int half = (1 << (ba - 1)) - 1;
                     for (k = 0; k < group_size; k++)
                     {
-                        dst[k] = (float)((int)drmp3_bs_get_bits(bs, ba) - half);
+                        dst[k] = (drmp3d_real_t)((int)drmp3_bs_get_bits(bs, ba) - half);
                     }
                 } else
                 {
@@ -966,7 +1495,7 @@ static int drmp3_L12_dequantize_granule(float *grbuf, drmp3_bs *bs, drmp3_L12_sc
                     unsigned code = drmp3_bs_get_bits(bs, mod + 2 - (mod >> 3));  /* 5, 7, 10 */
                     for (k = 0; k < group_size; k++, code /= mod)
                     {
-                        dst[k] = (float)((int)(code % mod - mod/2));
+                        dst[k] = (drmp3d_real_t)((int)(code % mod - mod/2));
                     }
                 }
             }
@@ -977,10 +1506,41 @@ static int drmp3_L12_dequantize_granule(float *grbuf, drmp3_bs *bs, drmp3_L12_sc
     return group_size*4;
 }
 
+/*
+Reads the scale info of a Layer I or II frame and returns whether the samples that follow it fit in the frame. A frame where they don't
+is rejected by the decoder and outputs nothing, so this is used to count frames the same way without dequantizing anything.
+*/
+static int drmp3_L12_samples_fit(const drmp3_uint8 *hdr, drmp3_bs *bs_frame)
+{
+    drmp3_L12_scale_info sci[1];
+    int i, bits = 0, group_size = DRMP3_HDR_IS_LAYER_1(hdr) ? 1 : 3;
+
+    drmp3_L12_read_scale_info(hdr, bs_frame, sci);
+    for (i = 0; i < 2*sci->total_bands; i++)
+    {
+        int ba = sci->bitalloc[i];
+        if (ba != 0)
+        {
+            if (ba < 17)
+            {
+                bits += group_size*ba;
+            } else
+            {
+                unsigned mod = (2 << (ba - 17)) + 1;
+                bits += mod + 2 - (mod >> 3);
+            }
+        }
+    }
+
+    /* A frame is 3 calls to drmp3_L12_dequantize_granule(), each of which reads 4 groups per band. */
+    return bs_frame->pos + 3*4*bits <= bs_frame->limit;
+}
+
+#ifndef DR_MP3_FIXED_POINT
 static void drmp3_L12_apply_scf_384(drmp3_L12_scale_info *sci, const float *scf, float *dst)
 {
     int i, k;
-    memcpy(dst + 576 + sci->stereo_bands*18, dst + sci->stereo_bands*18, (sci->total_bands - sci->stereo_bands)*18*sizeof(float));
+    memcpy(dst + 576 + sci->stereo_bands*18, dst + sci->stereo_bands*18, (sci->total_bands - sci->stereo_bands)*18*sizeof(drmp3d_real_t));
     for (i = 0; i < sci->total_bands; i++, dst += 18, scf += 6)
     {
         for (k = 0; k < 12; k++)
@@ -990,6 +1550,34 @@ static void drmp3_L12_apply_scf_384(drmp3_L12_scale_info *sci, const float *scf,
         }
     }
 }
+#else
+/* Returns 2^32 divided by the number of quantization steps of an allocation, or 0 if nothing is allocated. */
+static drmp3_int64 drmp3_L12_step_recip(int ba)
+{
+    if (ba == 0)
+    {
+        return 0;
+    }
+    return 0xFFFFFFFFu / (ba < 17 ? (1u << ba) - 1 : (2u << (ba - 17)) + 1);
+}
+
+static void drmp3_L12_apply_scf_384(drmp3_L12_scale_info *sci, const drmp3_int32 *scf, drmp3_int32 *dst)
+{
+    int i, k;
+    memcpy(dst + 576 + sci->stereo_bands*18, dst + sci->stereo_bands*18, (sci->total_bands - sci->stereo_bands)*18*sizeof(drmp3_int32));
+    for (i = 0; i < sci->total_bands; i++, dst += 18, scf += 6)
+    {
+        /* Q44 factors. The right channel of bands above stereo_bands is a copy of the left one and has the same allocation. */
+        drmp3_int64 f0 = (scf[0]*drmp3_L12_step_recip(sci->bitalloc[2*i])) >> 15;
+        drmp3_int64 f1 = (scf[3]*drmp3_L12_step_recip(sci->bitalloc[2*i + (i < sci->stereo_bands)])) >> 15;
+        for (k = 0; k < 12; k++)
+        {
+            dst[k + 0]   = (drmp3_int32)((dst[k + 0]*f0)   >> (44 - DRMP3_FRAC_BITS));
+            dst[k + 576] = (drmp3_int32)((dst[k + 576]*f1) >> (44 - DRMP3_FRAC_BITS));
+        }
+    }
+}
+#endif
 #endif
 
 static int drmp3_L3_read_side_info(drmp3_bs *bs, drmp3_L3_gr_info *gr, const drmp3_uint8 *hdr)
@@ -1150,6 +1738,7 @@ static void drmp3_L3_read_scalefactors(drmp3_uint8 *scf, drmp3_uint8 *ist_pos, c
     scf[0] = scf[1] = scf[2] = 0;
 }
 
+#ifndef DR_MP3_FIXED_POINT
 static float drmp3_L3_ldexp_q2(float y, int exp_q2)
 {
     static const float g_expfrac[4] = { 9.31322575e-10f,7.83145814e-10f,6.58544508e-10f,5.53767716e-10f };
@@ -1161,8 +1750,16 @@ static float drmp3_L3_ldexp_q2(float y, int exp_q2)
     } while ((exp_q2 -= e) > 0);
     return y;
 }
+#else
+static const drmp3_int32 g_drmp3_expfrac[4] = { DRMP3_REAL(1), DRMP3_REAL(0.840896415), DRMP3_REAL(0.707106781), DRMP3_REAL(0.594603558) };
+
+static drmp3_int32 drmp3_L3_ldexp_q2(drmp3_int32 y, int exp_q2)
+{
+    return (exp_q2 >> 2) > 30 ? 0 : DRMP3_MUL(y, g_drmp3_expfrac[exp_q2 & 3]) >> (exp_q2 >> 2);
+}
+#endif
 
-static void drmp3_L3_decode_scalefactors(const drmp3_uint8 *hdr, drmp3_uint8 *ist_pos, drmp3_bs *bs, const drmp3_L3_gr_info *gr, float *scf, int ch)
+static void drmp3_L3_decode_scalefactors(const drmp3_uint8 *hdr, drmp3_uint8 *ist_pos, drmp3_bs *bs, const drmp3_L3_gr_info *gr, drmp3d_real_t *scf, int ch)
 {
     static const drmp3_uint8 g_scf_partitions[3][28] = {
         { 6,5,5, 5,6,5,5,5,6,5, 7,3,11,10,0,0, 7, 7, 7,0, 6, 6,6,3, 8, 8,5,0 },
@@ -1172,7 +1769,6 @@ static void drmp3_L3_decode_scalefactors(const drmp3_uint8 *hdr, drmp3_uint8 *is
     const drmp3_uint8 *scf_partition = g_scf_partitions[!!gr->n_short_sfb + !gr->n_long_sfb];
     drmp3_uint8 scf_size[4], iscf[40];
     int i, scf_shift = gr->scalefac_scale + 1, gain_exp, scfsi = gr->scfsi;
-    float gain;
 
     if (DRMP3_HDR_TEST_MPEG1(hdr))
     {
@@ -1217,13 +1813,24 @@ static void drmp3_L3_decode_scalefactors(const drmp3_uint8 *hdr, drmp3_uint8 *is
     }
 
     gain_exp = gr->global_gain + DRMP3_BITS_DEQUANTIZER_OUT*4 - 210 - (DRMP3_HDR_IS_MS_STEREO(hdr) ? 2 : 0);
-    gain = drmp3_L3_ldexp_q2(1 << (DRMP3_MAX_SCFI/4),  DRMP3_MAX_SCFI - gain_exp);
+#ifndef DR_MP3_FIXED_POINT
+    {
+        float gain = drmp3_L3_ldexp_q2(1 << (DRMP3_MAX_SCFI/4),  DRMP3_MAX_SCFI - gain_exp);
+        for (i = 0; i < (int)(gr->n_long_sfb + gr->n_short_sfb); i++)
+        {
+            scf[i] = drmp3_L3_ldexp_q2(gain, iscf[i] << scf_shift);
+        }
+    }
+#else
+    /* The scale factors are kept as exponents of 2^(1/4) and applied in drmp3_L3_huffman(). */
     for (i = 0; i < (int)(gr->n_long_sfb + gr->n_short_sfb); i++)
     {
-        scf[i] = drmp3_L3_ldexp_q2(gain, iscf[i] << scf_shift);
+        scf[i] = gain_exp - (iscf[i] << scf_shift);
     }
+#endif
 }
 
+#ifndef DR_MP3_FIXED_POINT
 static const float g_drmp3_pow43[129 + 16] = {
     0,-1,-2.519842f,-4.326749f,-6.349604f,-8.549880f,-10.902724f,-13.390518f,-16.000000f,-18.720754f,-21.544347f,-24.463781f,-27.473142f,-30.567351f,-33.741992f,-36.993181f,
     0,1,2.519842f,4.326749f,6.349604f,8.549880f,10.902724f,13.390518f,16.000000f,18.720754f,21.544347f,24.463781f,27.473142f,30.567351f,33.741992f,36.993181f,40.317474f,43.711787f,47.173345f,50.699631f,54.288352f,57.937408f,61.644865f,65.408941f,69.227979f,73.100443f,77.024898f,81.000000f,85.024491f,89.097188f,93.216975f,97.382800f,101.593667f,105.848633f,110.146801f,114.487321f,118.869381f,123.292209f,127.755065f,132.257246f,136.798076f,141.376907f,145.993119f,150.646117f,155.335327f,160.060199f,164.820202f,169.614826f,174.443577f,179.305980f,184.201575f,189.129918f,194.090580f,199.083145f,204.107210f,209.162385f,214.248292f,219.364564f,224.510845f,229.686789f,234.892058f,240.126328f,245.389280f,250.680604f,256.000000f,261.347174f,266.721841f,272.123723f,277.552547f,283.008049f,288.489971f,293.998060f,299.532071f,305.091761f,310.676898f,316.287249f,321.922592f,327.582707f,333.267377f,338.976394f,344.709550f,350.466646f,356.247482f,362.051866f,367.879608f,373.730522f,379.604427f,385.501143f,391.420496f,397.362314f,403.326427f,409.312672f,415.320884f,421.350905f,427.402579f,433.475750f,439.570269f,445.685987f,451.822757f,457.980436f,464.158883f,470.357960f,476.577530f,482.817459f,489.077615f,495.357868f,501.658090f,507.978156f,514.317941f,520.677324f,527.056184f,533.454404f,539.871867f,546.308458f,552.764065f,559.238575f,565.731879f,572.243870f,578.774440f,585.323483f,591.890898f,598.476581f,605.080431f,611.702349f,618.342238f,625.000000f,631.675540f,638.368763f,645.079578f
@@ -1249,48 +1856,162 @@ static float drmp3_L3_pow_43(int x)
     frac = (float)((x & 63) - sign) / ((x & ~63) + sign);
     return g_drmp3_pow43[16 + ((x + sign) >> 6)]*(1.f + frac*((4.f/3) + frac*(2.f/9)))*mult;
 }
+#else
+/* x^(4/3) in Q20. */
+static const drmp3_int32 g_drmp3_pow43[129 + 16] = {
+    0,-1048576,-2642246,-4536925,-6658043,-8965199,-11432334,-14040976,-16777216,-19630134,-22590885,-25652134,-28807677,-32052191,-35381043,-38790162,
+    0,1048576,2642246,4536925,6658043,8965199,11432334,14040976,16777216,19630134,22590885,25652134,28807677,32052191,35381043,38790162,
+    42275935,45835131,49464838,53162417,56925463,60751775,64639326,68586245,72590798,76651371,80766459,84934656,89154641,93425173,97745083,102113267,
+    106528681,110990336,115497292,120048657,124643580,129281251,133960896,138681774,143443179,148244431,153084881,157963902,162880896,167835283,172826508,177854036,
+    182917348,188015947,193149351,198317093,203518724,208753808,214021922,219322657,224655618,230020418,235416684,240844054,246302175,251790705,257309309,262857665,
+    268435456,274042375,279678122,285342405,291034939,296755448,302503660,308279310,314082140,319911899,325768339,331651219,337560304,343495364,349456173,355442511,
+    361454162,367490913,373552560,379638897,385749728,391884856,398044091,404227247,410434138,416664585,422918412,429195444,435495511,441818447,448164086,454532268,
+    460922835,467335629,473770499,480227294,486705865,493206069,499727760,506270800,512835049,519420372,526026633,532653703,539301449,545969745,552658465,559367485,
+    566096683,572845938,579615132,586404148,593212871,600041188,606888987,613756157,620642590,627548179,634472818,641416403,648378831,655360000,662359811,669378164,
+    676414963
+};
 
-static void drmp3_L3_huffman(float *dst, drmp3_bs *bs, const drmp3_L3_gr_info *gr_info, const float *scf, int layer3gr_limit)
+/* Returns x^(4/3) in Q20 using the same interpolation as the floating point version with a Q24 fraction. */
+static drmp3_int64 drmp3_L3_pow_43(int x)
 {
-    static const drmp3_int16 tabs[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        785,785,785,785,784,784,784,784,513,513,513,513,513,513,513,513,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,
-        -255,1313,1298,1282,785,785,785,785,784,784,784,784,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,290,288,
-        -255,1313,1298,1282,769,769,769,769,529,529,529,529,529,529,529,529,528,528,528,528,528,528,528,528,512,512,512,512,512,512,512,512,290,288,
-        -253,-318,-351,-367,785,785,785,785,784,784,784,784,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,819,818,547,547,275,275,275,275,561,560,515,546,289,274,288,258,
-        -254,-287,1329,1299,1314,1312,1057,1057,1042,1042,1026,1026,784,784,784,784,529,529,529,529,529,529,529,529,769,769,769,769,768,768,768,768,563,560,306,306,291,259,
-        -252,-413,-477,-542,1298,-575,1041,1041,784,784,784,784,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,-383,-399,1107,1092,1106,1061,849,849,789,789,1104,1091,773,773,1076,1075,341,340,325,309,834,804,577,577,532,532,516,516,832,818,803,816,561,561,531,531,515,546,289,289,288,258,
-        -252,-429,-493,-559,1057,1057,1042,1042,529,529,529,529,529,529,529,529,784,784,784,784,769,769,769,769,512,512,512,512,512,512,512,512,-382,1077,-415,1106,1061,1104,849,849,789,789,1091,1076,1029,1075,834,834,597,581,340,340,339,324,804,833,532,532,832,772,818,803,817,787,816,771,290,290,290,290,288,258,
-        -253,-349,-414,-447,-463,1329,1299,-479,1314,1312,1057,1057,1042,1042,1026,1026,785,785,785,785,784,784,784,784,769,769,769,769,768,768,768,768,-319,851,821,-335,836,850,805,849,341,340,325,336,533,533,579,579,564,564,773,832,578,548,563,516,321,276,306,291,304,259,
-        -251,-572,-733,-830,-863,-879,1041,1041,784,784,784,784,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,-511,-527,-543,1396,1351,1381,1366,1395,1335,1380,-559,1334,1138,1138,1063,1063,1350,1392,1031,1031,1062,1062,1364,1363,1120,1120,1333,1348,881,881,881,881,375,374,359,373,343,358,341,325,791,791,1123,1122,-703,1105,1045,-719,865,865,790,790,774,774,1104,1029,338,293,323,308,-799,-815,833,788,772,818,803,816,322,292,307,320,561,531,515,546,289,274,288,258,
-        -251,-525,-605,-685,-765,-831,-846,1298,1057,1057,1312,1282,785,785,785,785,784,784,784,784,769,769,769,769,512,512,512,512,512,512,512,512,1399,1398,1383,1367,1382,1396,1351,-511,1381,1366,1139,1139,1079,1079,1124,1124,1364,1349,1363,1333,882,882,882,882,807,807,807,807,1094,1094,1136,1136,373,341,535,535,881,775,867,822,774,-591,324,338,-671,849,550,550,866,864,609,609,293,336,534,534,789,835,773,-751,834,804,308,307,833,788,832,772,562,562,547,547,305,275,560,515,290,290,
-        -252,-397,-477,-557,-622,-653,-719,-735,-750,1329,1299,1314,1057,1057,1042,1042,1312,1282,1024,1024,785,785,785,785,784,784,784,784,769,769,769,769,-383,1127,1141,1111,1126,1140,1095,1110,869,869,883,883,1079,1109,882,882,375,374,807,868,838,881,791,-463,867,822,368,263,852,837,836,-543,610,610,550,550,352,336,534,534,865,774,851,821,850,805,593,533,579,564,773,832,578,578,548,548,577,577,307,276,306,291,516,560,259,259,
-        -250,-2107,-2507,-2764,-2909,-2974,-3007,-3023,1041,1041,1040,1040,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,-767,-1052,-1213,-1277,-1358,-1405,-1469,-1535,-1550,-1582,-1614,-1647,-1662,-1694,-1726,-1759,-1774,-1807,-1822,-1854,-1886,1565,-1919,-1935,-1951,-1967,1731,1730,1580,1717,-1983,1729,1564,-1999,1548,-2015,-2031,1715,1595,-2047,1714,-2063,1610,-2079,1609,-2095,1323,1323,1457,1457,1307,1307,1712,1547,1641,1700,1699,1594,1685,1625,1442,1442,1322,1322,-780,-973,-910,1279,1278,1277,1262,1276,1261,1275,1215,1260,1229,-959,974,974,989,989,-943,735,478,478,495,463,506,414,-1039,1003,958,1017,927,942,987,957,431,476,1272,1167,1228,-1183,1256,-1199,895,895,941,941,1242,1227,1212,1135,1014,1014,490,489,503,487,910,1013,985,925,863,894,970,955,1012,847,-1343,831,755,755,984,909,428,366,754,559,-1391,752,486,457,924,997,698,698,983,893,740,740,908,877,739,739,667,667,953,938,497,287,271,271,683,606,590,712,726,574,302,302,738,736,481,286,526,725,605,711,636,724,696,651,589,681,666,710,364,467,573,695,466,466,301,465,379,379,709,604,665,679,316,316,634,633,436,436,464,269,424,394,452,332,438,363,347,408,393,448,331,422,362,407,392,421,346,406,391,376,375,359,1441,1306,-2367,1290,-2383,1337,-2399,-2415,1426,1321,-2431,1411,1336,-2447,-2463,-2479,1169,1169,1049,1049,1424,1289,1412,1352,1319,-2495,1154,1154,1064,1064,1153,1153,416,390,360,404,403,389,344,374,373,343,358,372,327,357,342,311,356,326,1395,1394,1137,1137,1047,1047,1365,1392,1287,1379,1334,1364,1349,1378,1318,1363,792,792,792,792,1152,1152,1032,1032,1121,1121,1046,1046,1120,1120,1030,1030,-2895,1106,1061,1104,849,849,789,789,1091,1076,1029,1090,1060,1075,833,833,309,324,532,532,832,772,818,803,561,561,531,560,515,546,289,274,288,258,
-        -250,-1179,-1579,-1836,-1996,-2124,-2253,-2333,-2413,-2477,-2542,-2574,-2607,-2622,-2655,1314,1313,1298,1312,1282,785,785,785,785,1040,1040,1025,1025,768,768,768,768,-766,-798,-830,-862,-895,-911,-927,-943,-959,-975,-991,-1007,-1023,-1039,-1055,-1070,1724,1647,-1103,-1119,1631,1767,1662,1738,1708,1723,-1135,1780,1615,1779,1599,1677,1646,1778,1583,-1151,1777,1567,1737,1692,1765,1722,1707,1630,1751,1661,1764,1614,1736,1676,1763,1750,1645,1598,1721,1691,1762,1706,1582,1761,1566,-1167,1749,1629,767,766,751,765,494,494,735,764,719,749,734,763,447,447,748,718,477,506,431,491,446,476,461,505,415,430,475,445,504,399,460,489,414,503,383,474,429,459,502,502,746,752,488,398,501,473,413,472,486,271,480,270,-1439,-1455,1357,-1471,-1487,-1503,1341,1325,-1519,1489,1463,1403,1309,-1535,1372,1448,1418,1476,1356,1462,1387,-1551,1475,1340,1447,1402,1386,-1567,1068,1068,1474,1461,455,380,468,440,395,425,410,454,364,467,466,464,453,269,409,448,268,432,1371,1473,1432,1417,1308,1460,1355,1446,1459,1431,1083,1083,1401,1416,1458,1445,1067,1067,1370,1457,1051,1051,1291,1430,1385,1444,1354,1415,1400,1443,1082,1082,1173,1113,1186,1066,1185,1050,-1967,1158,1128,1172,1097,1171,1081,-1983,1157,1112,416,266,375,400,1170,1142,1127,1065,793,793,1169,1033,1156,1096,1141,1111,1155,1080,1126,1140,898,898,808,808,897,897,792,792,1095,1152,1032,1125,1110,1139,1079,1124,882,807,838,881,853,791,-2319,867,368,263,822,852,837,866,806,865,-2399,851,352,262,534,534,821,836,594,594,549,549,593,593,533,533,848,773,579,579,564,578,548,563,276,276,577,576,306,291,516,560,305,305,275,259,
-        -251,-892,-2058,-2620,-2828,-2957,-3023,-3039,1041,1041,1040,1040,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,-511,-527,-543,-559,1530,-575,-591,1528,1527,1407,1526,1391,1023,1023,1023,1023,1525,1375,1268,1268,1103,1103,1087,1087,1039,1039,1523,-604,815,815,815,815,510,495,509,479,508,463,507,447,431,505,415,399,-734,-782,1262,-815,1259,1244,-831,1258,1228,-847,-863,1196,-879,1253,987,987,748,-767,493,493,462,477,414,414,686,669,478,446,461,445,474,429,487,458,412,471,1266,1264,1009,1009,799,799,-1019,-1276,-1452,-1581,-1677,-1757,-1821,-1886,-1933,-1997,1257,1257,1483,1468,1512,1422,1497,1406,1467,1496,1421,1510,1134,1134,1225,1225,1466,1451,1374,1405,1252,1252,1358,1480,1164,1164,1251,1251,1238,1238,1389,1465,-1407,1054,1101,-1423,1207,-1439,830,830,1248,1038,1237,1117,1223,1148,1236,1208,411,426,395,410,379,269,1193,1222,1132,1235,1221,1116,976,976,1192,1162,1177,1220,1131,1191,963,963,-1647,961,780,-1663,558,558,994,993,437,408,393,407,829,978,813,797,947,-1743,721,721,377,392,844,950,828,890,706,706,812,859,796,960,948,843,934,874,571,571,-1919,690,555,689,421,346,539,539,944,779,918,873,932,842,903,888,570,570,931,917,674,674,-2575,1562,-2591,1609,-2607,1654,1322,1322,1441,1441,1696,1546,1683,1593,1669,1624,1426,1426,1321,1321,1639,1680,1425,1425,1305,1305,1545,1668,1608,1623,1667,1592,1638,1666,1320,1320,1652,1607,1409,1409,1304,1304,1288,1288,1664,1637,1395,1395,1335,1335,1622,1636,1394,1394,1319,1319,1606,1621,1392,1392,1137,1137,1137,1137,345,390,360,375,404,373,1047,-2751,-2767,-2783,1062,1121,1046,-2799,1077,-2815,1106,1061,789,789,1105,1104,263,355,310,340,325,354,352,262,339,324,1091,1076,1029,1090,1060,1075,833,833,788,788,1088,1028,818,818,803,803,561,561,531,531,816,771,546,546,289,274,288,258,
-        -253,-317,-381,-446,-478,-509,1279,1279,-811,-1179,-1451,-1756,-1900,-2028,-2189,-2253,-2333,-2414,-2445,-2511,-2526,1313,1298,-2559,1041,1041,1040,1040,1025,1025,1024,1024,1022,1007,1021,991,1020,975,1019,959,687,687,1018,1017,671,671,655,655,1016,1015,639,639,758,758,623,623,757,607,756,591,755,575,754,559,543,543,1009,783,-575,-621,-685,-749,496,-590,750,749,734,748,974,989,1003,958,988,973,1002,942,987,957,972,1001,926,986,941,971,956,1000,910,985,925,999,894,970,-1071,-1087,-1102,1390,-1135,1436,1509,1451,1374,-1151,1405,1358,1480,1420,-1167,1507,1494,1389,1342,1465,1435,1450,1326,1505,1310,1493,1373,1479,1404,1492,1464,1419,428,443,472,397,736,526,464,464,486,457,442,471,484,482,1357,1449,1434,1478,1388,1491,1341,1490,1325,1489,1463,1403,1309,1477,1372,1448,1418,1433,1476,1356,1462,1387,-1439,1475,1340,1447,1402,1474,1324,1461,1371,1473,269,448,1432,1417,1308,1460,-1711,1459,-1727,1441,1099,1099,1446,1386,1431,1401,-1743,1289,1083,1083,1160,1160,1458,1445,1067,1067,1370,1457,1307,1430,1129,1129,1098,1098,268,432,267,416,266,400,-1887,1144,1187,1082,1173,1113,1186,1066,1050,1158,1128,1143,1172,1097,1171,1081,420,391,1157,1112,1170,1142,1127,1065,1169,1049,1156,1096,1141,1111,1155,1080,1126,1154,1064,1153,1140,1095,1048,-2159,1125,1110,1137,-2175,823,823,1139,1138,807,807,384,264,368,263,868,838,853,791,867,822,852,837,866,806,865,790,-2319,851,821,836,352,262,850,805,849,-2399,533,533,835,820,336,261,578,548,563,577,532,532,832,772,562,562,547,547,305,275,560,515,290,290,288,258 };
-    static const drmp3_uint8 tab32[] = { 130,162,193,209,44,28,76,140,9,9,9,9,9,9,9,9,190,254,222,238,126,94,157,157,109,61,173,205};
+    drmp3_int32 frac;
+    int sign, mult = 8;
+
+    if (x < 129)
+    {
+        return g_drmp3_pow43[16 + x];
+    }
+
+    if (x < 1024)
+    {
+        mult = 4;
+        x <<= 3;
+    }
+
+    sign = 2*x & 64;
+    frac = ((x & 63) - sign)*(1 << 24) / ((x & ~63) + sign);
+    return ((drmp3_int64)g_drmp3_pow43[16 + ((x + sign) >> 6)]*((1 << 24) + ((frac*(22369621 + ((frac*(drmp3_int64)3728270) >> 24))) >> 24))) >> (24 - mult);
+}
+
+/* 2^(k/4) in Q22. */
+static const drmp3_int32 g_drmp3_pow2frac[4] = { 4194304,4987896,5931642,7053950 };
+
+/*
+Returns x*2^(q/4) in Q(DRMP3_FRAC_BITS) for a Q20 x. The scale factor is split into m = 2^((q & 3)/4) in Q22 and the shift
+sh = 42 - DRMP3_FRAC_BITS - (q >> 2), which is always positive because q is at most 41, and is clamped to 62.
+*/
+static DRMP3_INLINE drmp3_int32 drmp3_L3_deq_fix(drmp3_int64 x, drmp3_int32 m, int sh)
+{
+    drmp3_int64 r = (x*m + ((drmp3_int64)1 << (sh - 1))) >> sh;
+    if (r == 0)
+    {
+        r = (x > 0) - (x < 0);  /* Too small to represent, but the stereo processing needs to know which values are not zero. */
+    }
+    return (drmp3_int32)DRMP3_MIN(DRMP3_MAX(r, -DRMP3_FIX_MAX), DRMP3_FIX_MAX);
+}
+
+/* Clears the values that drmp3_L3_deq_fix() only kept non-zero for the benefit of drmp3_L3_stereo_top_band(). Only the right
+   channel of an intensity stereo frame needs them, and only until drmp3_L3_intensity_stereo() has run. */
+static void drmp3_L3_clear_ulp(drmp3d_real_t *x, int n)
+{
+    int i;
+    for (i = 0; i < n; i++)
+    {
+        if (x[i] >= -1 && x[i] <= 1)
+        {
+            x[i] = 0;
+        }
+    }
+}
+#endif
+
+static void drmp3_L3_huffman(drmp3d_real_t *dst, drmp3_bs *bs, const drmp3_L3_gr_info *gr_info, const drmp3d_real_t *scf, int layer3gr_limit, int max_lines)
+{
+    static const drmp3_int16 tabs[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        785,785,785,785,784,784,784,784,513,513,513,513,513,513,513,513,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,
+        -255,1313,1298,1282,785,785,785,785,784,784,784,784,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,290,288,
+        -255,1313,1298,1282,769,769,769,769,529,529,529,529,529,529,529,529,528,528,528,528,528,528,528,528,512,512,512,512,512,512,512,512,290,288,
+        -253,-318,-351,-367,785,785,785,785,784,784,784,784,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,819,818,547,547,275,275,275,275,561,560,515,546,289,274,288,258,
+        -254,-287,1329,1299,1314,1312,1057,1057,1042,1042,1026,1026,784,784,784,784,529,529,529,529,529,529,529,529,769,769,769,769,768,768,768,768,563,560,306,306,291,259,
+        -252,-413,-477,-542,1298,-575,1041,1041,784,784,784,784,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,-383,-399,1107,1092,1106,1061,849,849,789,789,1104,1091,773,773,1076,1075,341,340,325,309,834,804,577,577,532,532,516,516,832,818,803,816,561,561,531,531,515,546,289,289,288,258,
+        -252,-429,-493,-559,1057,1057,1042,1042,529,529,529,529,529,529,529,529,784,784,784,784,769,769,769,769,512,512,512,512,512,512,512,512,-382,1077,-415,1106,1061,1104,849,849,789,789,1091,1076,1029,1075,834,834,597,581,340,340,339,324,804,833,532,532,832,772,818,803,817,787,816,771,290,290,290,290,288,258,
+        -253,-349,-414,-447,-463,1329,1299,-479,1314,1312,1057,1057,1042,1042,1026,1026,785,785,785,785,784,784,784,784,769,769,769,769,768,768,768,768,-319,851,821,-335,836,850,805,849,341,340,325,336,533,533,579,579,564,564,773,832,578,548,563,516,321,276,306,291,304,259,
+        -251,-572,-733,-830,-863,-879,1041,1041,784,784,784,784,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,-511,-527,-543,1396,1351,1381,1366,1395,1335,1380,-559,1334,1138,1138,1063,1063,1350,1392,1031,1031,1062,1062,1364,1363,1120,1120,1333,1348,881,881,881,881,375,374,359,373,343,358,341,325,791,791,1123,1122,-703,1105,1045,-719,865,865,790,790,774,774,1104,1029,338,293,323,308,-799,-815,833,788,772,818,803,816,322,292,307,320,561,531,515,546,289,274,288,258,
+        -251,-525,-605,-685,-765,-831,-846,1298,1057,1057,1312,1282,785,785,785,785,784,784,784,784,769,769,769,769,512,512,512,512,512,512,512,512,1399,1398,1383,1367,1382,1396,1351,-511,1381,1366,1139,1139,1079,1079,1124,1124,1364,1349,1363,1333,882,882,882,882,807,807,807,807,1094,1094,1136,1136,373,341,535,535,881,775,867,822,774,-591,324,338,-671,849,550,550,866,864,609,609,293,336,534,534,789,835,773,-751,834,804,308,307,833,788,832,772,562,562,547,547,305,275,560,515,290,290,
+        -252,-397,-477,-557,-622,-653,-719,-735,-750,1329,1299,1314,1057,1057,1042,1042,1312,1282,1024,1024,785,785,785,785,784,784,784,784,769,769,769,769,-383,1127,1141,1111,1126,1140,1095,1110,869,869,883,883,1079,1109,882,882,375,374,807,868,838,881,791,-463,867,822,368,263,852,837,836,-543,610,610,550,550,352,336,534,534,865,774,851,821,850,805,593,533,579,564,773,832,578,578,548,548,577,577,307,276,306,291,516,560,259,259,
+        -250,-2107,-2507,-2764,-2909,-2974,-3007,-3023,1041,1041,1040,1040,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,-767,-1052,-1213,-1277,-1358,-1405,-1469,-1535,-1550,-1582,-1614,-1647,-1662,-1694,-1726,-1759,-1774,-1807,-1822,-1854,-1886,1565,-1919,-1935,-1951,-1967,1731,1730,1580,1717,-1983,1729,1564,-1999,1548,-2015,-2031,1715,1595,-2047,1714,-2063,1610,-2079,1609,-2095,1323,1323,1457,1457,1307,1307,1712,1547,1641,1700,1699,1594,1685,1625,1442,1442,1322,1322,-780,-973,-910,1279,1278,1277,1262,1276,1261,1275,1215,1260,1229,-959,974,974,989,989,-943,735,478,478,495,463,506,414,-1039,1003,958,1017,927,942,987,957,431,476,1272,1167,1228,-1183,1256,-1199,895,895,941,941,1242,1227,1212,1135,1014,1014,490,489,503,487,910,1013,985,925,863,894,970,955,1012,847,-1343,831,755,755,984,909,428,366,754,559,-1391,752,486,457,924,997,698,698,983,893,740,740,908,877,739,739,667,667,953,938,497,287,271,271,683,606,590,712,726,574,302,302,738,736,481,286,526,725,605,711,636,724,696,651,589,681,666,710,364,467,573,695,466,466,301,465,379,379,709,604,665,679,316,316,634,633,436,436,464,269,424,394,452,332,438,363,347,408,393,448,331,422,362,407,392,421,346,406,391,376,375,359,1441,1306,-2367,1290,-2383,1337,-2399,-2415,1426,1321,-2431,1411,1336,-2447,-2463,-2479,1169,1169,1049,1049,1424,1289,1412,1352,1319,-2495,1154,1154,1064,1064,1153,1153,416,390,360,404,403,389,344,374,373,343,358,372,327,357,342,311,356,326,1395,1394,1137,1137,1047,1047,1365,1392,1287,1379,1334,1364,1349,1378,1318,1363,792,792,792,792,1152,1152,1032,1032,1121,1121,1046,1046,1120,1120,1030,1030,-2895,1106,1061,1104,849,849,789,789,1091,1076,1029,1090,1060,1075,833,833,309,324,532,532,832,772,818,803,561,561,531,560,515,546,289,274,288,258,
+        -250,-1179,-1579,-1836,-1996,-2124,-2253,-2333,-2413,-2477,-2542,-2574,-2607,-2622,-2655,1314,1313,1298,1312,1282,785,785,785,785,1040,1040,1025,1025,768,768,768,768,-766,-798,-830,-862,-895,-911,-927,-943,-959,-975,-991,-1007,-1023,-1039,-1055,-1070,1724,1647,-1103,-1119,1631,1767,1662,1738,1708,1723,-1135,1780,1615,1779,1599,1677,1646,1778,1583,-1151,1777,1567,1737,1692,1765,1722,1707,1630,1751,1661,1764,1614,1736,1676,1763,1750,1645,1598,1721,1691,1762,1706,1582,1761,1566,-1167,1749,1629,767,766,751,765,494,494,735,764,719,749,734,763,447,447,748,718,477,506,431,491,446,476,461,505,415,430,475,445,504,399,460,489,414,503,383,474,429,459,502,502,746,752,488,398,501,473,413,472,486,271,480,270,-1439,-1455,1357,-1471,-1487,-1503,1341,1325,-1519,1489,1463,1403,1309,-1535,1372,1448,1418,1476,1356,1462,1387,-1551,1475,1340,1447,1402,1386,-1567,1068,1068,1474,1461,455,380,468,440,395,425,410,454,364,467,466,464,453,269,409,448,268,432,1371,1473,1432,1417,1308,1460,1355,1446,1459,1431,1083,1083,1401,1416,1458,1445,1067,1067,1370,1457,1051,1051,1291,1430,1385,1444,1354,1415,1400,1443,1082,1082,1173,1113,1186,1066,1185,1050,-1967,1158,1128,1172,1097,1171,1081,-1983,1157,1112,416,266,375,400,1170,1142,1127,1065,793,793,1169,1033,1156,1096,1141,1111,1155,1080,1126,1140,898,898,808,808,897,897,792,792,1095,1152,1032,1125,1110,1139,1079,1124,882,807,838,881,853,791,-2319,867,368,263,822,852,837,866,806,865,-2399,851,352,262,534,534,821,836,594,594,549,549,593,593,533,533,848,773,579,579,564,578,548,563,276,276,577,576,306,291,516,560,305,305,275,259,
+        -251,-892,-2058,-2620,-2828,-2957,-3023,-3039,1041,1041,1040,1040,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,-511,-527,-543,-559,1530,-575,-591,1528,1527,1407,1526,1391,1023,1023,1023,1023,1525,1375,1268,1268,1103,1103,1087,1087,1039,1039,1523,-604,815,815,815,815,510,495,509,479,508,463,507,447,431,505,415,399,-734,-782,1262,-815,1259,1244,-831,1258,1228,-847,-863,1196,-879,1253,987,987,748,-767,493,493,462,477,414,414,686,669,478,446,461,445,474,429,487,458,412,471,1266,1264,1009,1009,799,799,-1019,-1276,-1452,-1581,-1677,-1757,-1821,-1886,-1933,-1997,1257,1257,1483,1468,1512,1422,1497,1406,1467,1496,1421,1510,1134,1134,1225,1225,1466,1451,1374,1405,1252,1252,1358,1480,1164,1164,1251,1251,1238,1238,1389,1465,-1407,1054,1101,-1423,1207,-1439,830,830,1248,1038,1237,1117,1223,1148,1236,1208,411,426,395,410,379,269,1193,1222,1132,1235,1221,1116,976,976,1192,1162,1177,1220,1131,1191,963,963,-1647,961,780,-1663,558,558,994,993,437,408,393,407,829,978,813,797,947,-1743,721,721,377,392,844,950,828,890,706,706,812,859,796,960,948,843,934,874,571,571,-1919,690,555,689,421,346,539,539,944,779,918,873,932,842,903,888,570,570,931,917,674,674,-2575,1562,-2591,1609,-2607,1654,1322,1322,1441,1441,1696,1546,1683,1593,1669,1624,1426,1426,1321,1321,1639,1680,1425,1425,1305,1305,1545,1668,1608,1623,1667,1592,1638,1666,1320,1320,1652,1607,1409,1409,1304,1304,1288,1288,1664,1637,1395,1395,1335,1335,1622,1636,1394,1394,1319,1319,1606,1621,1392,1392,1137,1137,1137,1137,345,390,360,375,404,373,1047,-2751,-2767,-2783,1062,1121,1046,-2799,1077,-2815,1106,1061,789,789,1105,1104,263,355,310,340,325,354,352,262,339,324,1091,1076,1029,1090,1060,1075,833,833,788,788,1088,1028,818,818,803,803,561,561,531,531,816,771,546,546,289,274,288,258,
+        -253,-317,-381,-446,-478,-509,1279,1279,-811,-1179,-1451,-1756,-1900,-2028,-2189,-2253,-2333,-2414,-2445,-2511,-2526,1313,1298,-2559,1041,1041,1040,1040,1025,1025,1024,1024,1022,1007,1021,991,1020,975,1019,959,687,687,1018,1017,671,671,655,655,1016,1015,639,639,758,758,623,623,757,607,756,591,755,575,754,559,543,543,1009,783,-575,-621,-685,-749,496,-590,750,749,734,748,974,989,1003,958,988,973,1002,942,987,957,972,1001,926,986,941,971,956,1000,910,985,925,999,894,970,-1071,-1087,-1102,1390,-1135,1436,1509,1451,1374,-1151,1405,1358,1480,1420,-1167,1507,1494,1389,1342,1465,1435,1450,1326,1505,1310,1493,1373,1479,1404,1492,1464,1419,428,443,472,397,736,526,464,464,486,457,442,471,484,482,1357,1449,1434,1478,1388,1491,1341,1490,1325,1489,1463,1403,1309,1477,1372,1448,1418,1433,1476,1356,1462,1387,-1439,1475,1340,1447,1402,1474,1324,1461,1371,1473,269,448,1432,1417,1308,1460,-1711,1459,-1727,1441,1099,1099,1446,1386,1431,1401,-1743,1289,1083,1083,1160,1160,1458,1445,1067,1067,1370,1457,1307,1430,1129,1129,1098,1098,268,432,267,416,266,400,-1887,1144,1187,1082,1173,1113,1186,1066,1050,1158,1128,1143,1172,1097,1171,1081,420,391,1157,1112,1170,1142,1127,1065,1169,1049,1156,1096,1141,1111,1155,1080,1126,1154,1064,1153,1140,1095,1048,-2159,1125,1110,1137,-2175,823,823,1139,1138,807,807,384,264,368,263,868,838,853,791,867,822,852,837,866,806,865,790,-2319,851,821,836,352,262,850,805,849,-2399,533,533,835,820,336,261,578,548,563,577,532,532,832,772,562,562,547,547,305,275,560,515,290,290,288,258 };
+    static const drmp3_uint8 tab32[] = { 130,162,193,209,44,28,76,140,9,9,9,9,9,9,9,9,190,254,222,238,126,94,157,157,109,61,173,205};
     static const drmp3_uint8 tab33[] = { 252,236,220,204,188,172,156,140,124,108,92,76,60,44,28,12 };
     static const drmp3_int16 tabindex[2*16] = { 0,32,64,98,0,132,180,218,292,364,426,538,648,746,0,1126,1460,1460,1460,1460,1460,1460,1460,1460,1842,1842,1842,1842,1842,1842,1842,1842 };
     static const drmp3_uint8 g_linbits[] =  { 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,2,3,4,6,8,10,13,4,5,6,7,8,9,11,13 };
+    /*
+    Pair tables indexed by the next 8 bits of the stream, generated from the tables above. Each entry holds the g_drmp3_pow43 index of
+    both values with their signs already applied (5 bits each) and the total number of bits used by the code word and sign bits. Zero
+    means the code doesn't fit in 8 bits or has a linbits escape, and the tree above needs to be walked instead.
+    */
+    static const drmp3_uint16 tabpair[] = {
+        528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,528,
+        5681,5681,5681,5681,5681,5681,5681,5681,5169,5169,5169,5169,5169,5169,5169,5169,5665,5665,5665,5665,5665,5665,5665,5665,5153,5153,5153,5153,5153,5153,5153,5153,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3601,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,3585,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,
+        8786,8274,8770,8258,7760,7760,7248,7248,7761,7761,7249,7249,7745,7745,7233,7233,7730,7730,7218,7218,7714,7714,7202,7202,6674,6674,6674,6674,6658,6658,6658,6658,5681,5681,5681,5681,5681,5681,5681,5681,5169,5169,5169,5169,5169,5169,5169,5169,5665,5665,5665,5665,5665,5665,5665,5665,5153,5153,5153,5153,5153,5153,5153,5153,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,
+        8786,8274,8770,8258,7760,7760,7248,7248,7761,7761,7249,7249,7745,7745,7233,7233,7730,7730,7218,7218,7714,7714,7202,7202,6674,6674,6674,6674,6658,6658,6658,6658,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3632,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,3120,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,
+        0,0,0,0,8755,8243,8739,8227,0,0,8816,8304,8723,8707,0,0,8785,8273,8769,8257,8754,8242,8738,8226,7760,7760,7248,7248,7698,7698,7682,7682,5681,5681,5681,5681,5681,5681,5681,5681,5169,5169,5169,5169,5169,5169,5169,5169,5665,5665,5665,5665,5665,5665,5665,5665,5153,5153,5153,5153,5153,5153,5153,5153,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,
+        0,0,8816,8304,8818,8306,8802,8290,8787,8275,8771,8259,7699,7699,7683,7683,7793,7793,7281,7281,7777,7777,7265,7265,7731,7731,7219,7219,7715,7715,7203,7203,7762,7762,7250,7250,7746,7746,7234,7234,6736,6736,6736,6736,6224,6224,6224,6224,6737,6737,6737,6737,6225,6225,6225,6225,6721,6721,6721,6721,6209,6209,6209,6209,6706,6706,6706,6706,6194,6194,6194,6194,6690,6690,6690,6690,6178,6178,6178,6178,5650,5650,5650,5650,5650,5650,5650,5650,5634,5634,5634,5634,5634,5634,5634,5634,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,8724,8708,0,0,0,0,0,0,0,0,8723,8707,0,0,8785,8273,8769,8257,7730,7730,7218,7218,7714,7714,7202,7202,7760,7760,7248,7248,7698,7698,7682,7682,6705,6705,6705,6705,6193,6193,6193,6193,6689,6689,6689,6689,6177,6177,6177,6177,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,8786,8274,8770,8258,7760,7760,7248,7248,7698,7698,7682,7682,6737,6737,6737,6737,6225,6225,6225,6225,6721,6721,6721,6721,6209,6209,6209,6209,6706,6706,6706,6706,6194,6194,6194,6194,6690,6690,6690,6690,6178,6178,6178,6178,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4657,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4145,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4641,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,4129,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,8724,8708,8849,8337,8833,8321,8756,8244,8740,8228,8818,8306,8802,8290,8787,8275,8771,8259,7793,7793,7281,7281,7777,7777,7265,7265,7731,7731,7219,7219,7715,7715,7203,7203,7792,7792,7280,7280,7699,7699,7683,7683,7762,7762,7250,7250,7746,7746,7234,7234,6736,6736,6736,6736,6224,6224,6224,6224,6737,6737,6737,6737,6225,6225,6225,6225,6721,6721,6721,6721,6209,6209,6209,6209,6706,6706,6706,6706,6194,6194,6194,6194,6690,6690,6690,6690,6178,6178,6178,6178,5650,5650,5650,5650,5650,5650,5650,5650,5634,5634,5634,5634,5634,5634,5634,5634,5681,5681,5681,5681,5681,5681,5681,5681,5169,5169,5169,5169,5169,5169,5169,5169,5665,5665,5665,5665,5665,5665,5665,5665,5153,5153,5153,5153,5153,5153,5153,5153,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,8723,8707,0,0,8785,8273,8769,8257,8754,8242,8738,8226,7760,7760,7248,7248,7698,7698,7682,7682,6705,6705,6705,6705,6193,6193,6193,6193,6689,6689,6689,6689,6177,6177,6177,6177,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,8817,8305,8801,8289,8755,8243,8739,8227,8816,8304,8723,8707,8786,8274,8770,8258,7730,7730,7218,7218,7714,7714,7202,7202,6737,6737,6737,6737,6225,6225,6225,6225,6721,6721,6721,6721,6209,6209,6209,6209,6736,6736,6736,6736,6224,6224,6224,6224,6674,6674,6674,6674,6658,6658,6658,6658,5681,5681,5681,5681,5681,5681,5681,5681,5169,5169,5169,5169,5169,5169,5169,5169,5665,5665,5665,5665,5665,5665,5665,5665,5153,5153,5153,5153,5153,5153,5153,5153,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,2576,
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,8819,8307,8803,8291,8756,8244,8740,8228,8818,8306,8802,8290,8787,8275,8771,8259,8724,8708,8816,8304,7699,7699,7683,7683,7793,7793,7281,7281,7777,7777,7265,7265,7731,7731,7219,7219,7715,7715,7203,7203,7762,7762,7250,7250,7746,7746,7234,7234,6737,6737,6737,6737,6225,6225,6225,6225,6721,6721,6721,6721,6209,6209,6209,6209,6706,6706,6706,6706,6194,6194,6194,6194,6690,6690,6690,6690,6178,6178,6178,6178,6736,6736,6736,6736,6224,6224,6224,6224,6674,6674,6674,6674,6658,6658,6658,6658,4624,4624,4624,4624,4624,4624,4624,4624,4624,4624,4624,4624,4624,4624,4624,4624,5681,5681,5681,5681,5681,5681,5681,5681,5169,5169,5169,5169,5169,5169,5169,5169,5665,5665,5665,5665,5665,5665,5665,5665,5153,5153,5153,5153,5153,5153,5153,5153,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4656,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4144,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,8816,8304,8723,8707,0,0,8785,8273,8769,8257,8754,8242,8738,8226,7760,7760,7248,7248,7698,7698,7682,7682,6705,6705,6705,6705,6193,6193,6193,6193,6689,6689,6689,6689,6177,6177,6177,6177,5680,5680,5680,5680,5680,5680,5680,5680,5168,5168,5168,5168,5168,5168,5168,5168,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,8756,8244,8740,8228,0,0,8848,8336,8818,8306,8802,8290,8787,8275,8771,8259,8724,8708,8816,8304,8817,8305,8801,8289,8755,8243,8739,8227,7699,7699,7683,7683,7762,7762,7250,7250,7746,7746,7234,7234,7761,7761,7249,7249,7745,7745,7233,7233,7730,7730,7218,7218,7714,7714,7202,7202,6736,6736,6736,6736,6224,6224,6224,6224,6674,6674,6674,6674,6658,6658,6658,6658,5681,5681,5681,5681,5681,5681,5681,5681,5169,5169,5169,5169,5169,5169,5169,5169,5665,5665,5665,5665,5665,5665,5665,5665,5153,5153,5153,5153,5153,5153,5153,5153,5680,5680,5680,5680,5680,5680,5680,5680,5168,5168,5168,5168,5168,5168,5168,5168,5649,5649,5649,5649,5649,5649,5649,5649,5633,5633,5633,5633,5633,5633,5633,5633,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,3600,
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,8785,8273,8769,8257,8754,8242,8738,8226,7760,7760,7248,7248,7698,7698,7682,7682,6705,6705,6705,6705,6193,6193,6193,6193,6689,6689,6689,6689,6177,6177,6177,6177,5680,5680,5680,5680,5680,5680,5680,5680,5168,5168,5168,5168,5168,5168,5168,5168,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4625,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,4609,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,1552,
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,8817,8305,8801,8289,8755,8243,8739,8227,8816,8304,8723,8707,8786,8274,8770,8258,7761,7761,7249,7249,7745,7745,7233,7233,7730,7730,7218,7218,7714,7714,7202,7202,7760,7760,7248,7248,7698,7698,7682,7682,6705,6705,6705,6705,6193,6193,6193,6193,6689,6689,6689,6689,6177,6177,6177,6177,5680,5680,5680,5680,5680,5680,5680,5680,5168,5168,5168,5168,5168,5168,5168,5168,5649,5649,5649,5649,5649,5649,5649,5649,5633,5633,5633,5633,5633,5633,5633,5633,4624,4624,4624,4624,4624,4624,4624,4624,4624,4624,4624,4624,4624,4624,4624,4624 };
+    static const drmp3_int16 tabpairindex[2*16] = { 0,256,512,768,0,1024,1280,1536,1792,2048,2304,2560,2816,3072,0,3328,3584,3584,3584,3584,3584,3584,3584,3584,3840,3840,3840,3840,3840,3840,3840,3840 };
 
-#define DRMP3_PEEK_BITS(n)    (bs_cache >> (32 - n))
+    /*
+    The bit cache is 64 bits wide and is topped up to at least 57 bits after each pair. That's enough for the longest code word plus
+    linbits and sign bits of both values so there's never a need to refill in the middle of a pair.
+    */
+#define DRMP3_PEEK_BITS(n)    (int)(bs_cache >> (64 - (n)))
+#define DRMP3_SIGN_BIT        (int)(bs_cache >> 63)
 #define DRMP3_FLUSH_BITS(n)   { bs_cache <<= (n); bs_sh += (n); }
-#define DRMP3_CHECK_BITS      while (bs_sh >= 0) { bs_cache |= (drmp3_uint32)*bs_next_ptr++ << bs_sh; bs_sh -= 8; }
-#define DRMP3_BSPOS           ((bs_next_ptr - bs->buf)*8 - 24 + bs_sh)
+#define DRMP3_CHECK_BITS      while (bs_sh >= 0) { bs_cache |= (drmp3_uint64)*bs_next_ptr++ << bs_sh; bs_sh -= 8; }
+#define DRMP3_BSPOS           ((bs_next_ptr - bs->buf)*8 - 56 + bs_sh)
+#ifndef DR_MP3_FIXED_POINT
+#define DRMP3_NEXT_SCF        one = *scf++
+#define DRMP3_DEQ(x)          ((x)*one)
 
     float one = 0.0f;
-    int ireg = 0, big_val_cnt = gr_info->big_values;
+#else
+#define DRMP3_NEXT_SCF        { one_m = g_drmp3_pow2frac[*scf & 3]; one_sh = DRMP3_MIN(42 - DRMP3_FRAC_BITS - (*scf >> 2), 62); scf++; \
+                                one = drmp3_L3_deq_fix(1 << 20, one_m, one_sh); }
+#define DRMP3_DEQ(x)          drmp3_L3_deq_fix(x, one_m, one_sh)
+
+    drmp3_int32 one = 0, one_m = 0;
+    int one_sh = 1;
+#endif
+    int ireg = 0, big_val_cnt = DRMP3_MIN(gr_info->big_values, max_lines/2);
     const drmp3_uint8 *sfb = gr_info->sfbtab;
+    const drmp3d_real_t *dst_end = dst + max_lines;
     const drmp3_uint8 *bs_next_ptr = bs->buf + bs->pos/8;
-    drmp3_uint32 bs_cache = (((bs_next_ptr[0]*256u + bs_next_ptr[1])*256u + bs_next_ptr[2])*256u + bs_next_ptr[3]) << (bs->pos & 7);
+    drmp3_uint64 bs_cache = 0;
     int pairs_to_decode, np, bs_sh = (bs->pos & 7) - 8;
-    bs_next_ptr += 4;
+    for (np = 0; np < 8; np++)
+    {
+        bs_cache = (bs_cache << 8) | bs_next_ptr[np];
+    }
+    bs_cache <<= (bs->pos & 7);
+    bs_next_ptr += 8;
 
     while (big_val_cnt > 0)
     {
         int tab_num = gr_info->table_select[ireg];
         int sfb_cnt = gr_info->region_count[ireg++];
         const drmp3_int16 *codebook = tabs + tabindex[tab_num];
+        const drmp3_uint16 *pairbook = tabpair + tabpairindex[tab_num];
         int linbits = g_linbits[tab_num];
         if (linbits)
         {
@@ -1298,11 +2019,22 @@ static void drmp3_L3_huffman(float *dst, drmp3_bs *bs, const drmp3_L3_gr_info *g
             {
                 np = *sfb++ / 2;
                 pairs_to_decode = DRMP3_MIN(big_val_cnt, np);
-                one = *scf++;
+                DRMP3_NEXT_SCF;
                 do
                 {
                     int j, w = 5;
-                    int leaf = codebook[DRMP3_PEEK_BITS(w)];
+                    int leaf = pairbook[DRMP3_PEEK_BITS(8)];
+                    if (leaf)
+                    {
+                        dst[0] = DRMP3_DEQ(g_drmp3_pow43[leaf & 31]);
+                        dst[1] = DRMP3_DEQ(g_drmp3_pow43[(leaf >> 5) & 31]);
+                        DRMP3_FLUSH_BITS(leaf >> 10);
+                        dst += 2;
+                        DRMP3_CHECK_BITS;
+                        continue;
+                    }
+
+                    leaf = codebook[DRMP3_PEEK_BITS(w)];
                     while (leaf < 0)
                     {
                         DRMP3_FLUSH_BITS(w);
@@ -1318,11 +2050,10 @@ static void drmp3_L3_huffman(float *dst, drmp3_bs *bs, const drmp3_L3_gr_info *g
                         {
                             lsb += DRMP3_PEEK_BITS(linbits);
                             DRMP3_FLUSH_BITS(linbits);
-                            DRMP3_CHECK_BITS;
-                            *dst = one*drmp3_L3_pow_43(lsb)*((drmp3_int32)bs_cache < 0 ? -1: 1);
+                            *dst = DRMP3_DEQ(drmp3_L3_pow_43(lsb)*(DRMP3_SIGN_BIT ? -1: 1));
                         } else
                         {
-                            *dst = g_drmp3_pow43[16 + lsb - 16*(bs_cache >> 31)]*one;
+                            *dst = DRMP3_DEQ(g_drmp3_pow43[16 + lsb - 16*DRMP3_SIGN_BIT]);
                         }
                         DRMP3_FLUSH_BITS(lsb ? 1 : 0);
                     }
@@ -1335,11 +2066,22 @@ static void drmp3_L3_huffman(float *dst, drmp3_bs *bs, const drmp3_L3_gr_info *g
             {
                 np = *sfb++ / 2;
                 pairs_to_decode = DRMP3_MIN(big_val_cnt, np);
-                one = *scf++;
+                DRMP3_NEXT_SCF;
                 do
                 {
                     int j, w = 5;
-                    int leaf = codebook[DRMP3_PEEK_BITS(w)];
+                    int leaf = pairbook[DRMP3_PEEK_BITS(8)];
+                    if (leaf)
+                    {
+                        dst[0] = DRMP3_DEQ(g_drmp3_pow43[leaf & 31]);
+                        dst[1] = DRMP3_DEQ(g_drmp3_pow43[(leaf >> 5) & 31]);
+                        DRMP3_FLUSH_BITS(leaf >> 10);
+                        dst += 2;
+                        DRMP3_CHECK_BITS;
+                        continue;
+                    }
+
+                    leaf = codebook[DRMP3_PEEK_BITS(w)];
                     while (leaf < 0)
                     {
                         DRMP3_FLUSH_BITS(w);
@@ -1351,7 +2093,7 @@ static void drmp3_L3_huffman(float *dst, drmp3_bs *bs, const drmp3_L3_gr_info *g
                     for (j = 0; j < 2; j++, dst++, leaf >>= 4)
                     {
                         int lsb = leaf & 0x0F;
-                        *dst = g_drmp3_pow43[16 + lsb - 16*(bs_cache >> 31)]*one;
+                        *dst = DRMP3_DEQ(g_drmp3_pow43[16 + lsb - 16*DRMP3_SIGN_BIT]);
                         DRMP3_FLUSH_BITS(lsb ? 1 : 0);
                     }
                     DRMP3_CHECK_BITS;
@@ -1360,21 +2102,21 @@ static void drmp3_L3_huffman(float *dst, drmp3_bs *bs, const drmp3_L3_gr_info *g
         }
     }
 
-    for (np = 1 - big_val_cnt;; dst += 4)
+    for (np = 1 - big_val_cnt; dst < dst_end; dst += 4)
     {
         const drmp3_uint8 *codebook_count1 = (gr_info->count1_table) ? tab33 : tab32;
         int leaf = codebook_count1[DRMP3_PEEK_BITS(4)];
         if (!(leaf & 8))
         {
-            leaf = codebook_count1[(leaf >> 3) + (bs_cache << 4 >> (32 - (leaf & 3)))];
+            leaf = codebook_count1[(leaf >> 3) + (int)(bs_cache << 4 >> (64 - (leaf & 3)))];
         }
         DRMP3_FLUSH_BITS(leaf & 7);
         if (DRMP3_BSPOS > layer3gr_limit)
         {
             break;
         }
-#define DRMP3_RELOAD_SCALEFACTOR  if (!--np) { np = *sfb++/2; if (!np) break; one = *scf++; }
-#define DRMP3_DEQ_COUNT1(s) if (leaf & (128 >> s)) { dst[s] = ((drmp3_int32)bs_cache < 0) ? -one : one; DRMP3_FLUSH_BITS(1) }
+#define DRMP3_RELOAD_SCALEFACTOR  if (!--np) { np = *sfb++/2; if (!np) break; DRMP3_NEXT_SCF; }
+#define DRMP3_DEQ_COUNT1(s) if (leaf & (128 >> s)) { dst[s] = DRMP3_SIGN_BIT ? -one : one; DRMP3_FLUSH_BITS(1) }
         DRMP3_RELOAD_SCALEFACTOR;
         DRMP3_DEQ_COUNT1(0);
         DRMP3_DEQ_COUNT1(1);
@@ -1387,10 +2129,10 @@ static void drmp3_L3_huffman(float *dst, drmp3_bs *bs, const drmp3_L3_gr_info *g
     bs->pos = layer3gr_limit;
 }
 
-static void drmp3_L3_midside_stereo(float *left, int n)
+static void drmp3_L3_midside_stereo(drmp3d_real_t *left, int n)
 {
     int i = 0;
-    float *right = left + 576;
+    drmp3d_real_t *right = left + 576;
 #if DRMP3_HAVE_SIMD
     if (drmp3_have_simd()) for (; i < n - 3; i += 4)
     {
@@ -1402,24 +2144,24 @@ static void drmp3_L3_midside_stereo(float *left, int n)
 #endif
     for (; i < n; i++)
     {
-        float a = left[i];
-        float b = right[i];
+        drmp3d_real_t a = left[i];
+        drmp3d_real_t b = right[i];
         left[i] = a + b;
         right[i] = a - b;
     }
 }
 
-static void drmp3_L3_intensity_stereo_band(float *left, int n, float kl, float kr)
+static void drmp3_L3_intensity_stereo_band(drmp3d_real_t *left, int n, drmp3d_real_t kl, drmp3d_real_t kr)
 {
     int i;
     for (i = 0; i < n; i++)
     {
-        left[i + 576] = left[i]*kr;
-        left[i] = left[i]*kl;
+        left[i + 576] = DRMP3_MUL(left[i], kr);
+        left[i] = DRMP3_MUL(left[i], kl);
     }
 }
 
-static void drmp3_L3_stereo_top_band(const float *right, const drmp3_uint8 *sfb, int nbands, int max_band[3])
+static void drmp3_L3_stereo_top_band(const drmp3d_real_t *right, const drmp3_uint8 *sfb, int nbands, int max_band[3])
 {
     int i, k;
 
@@ -1439,9 +2181,9 @@ static void drmp3_L3_stereo_top_band(const float *right, const drmp3_uint8 *sfb,
     }
 }
 
-static void drmp3_L3_stereo_process(float *left, const drmp3_uint8 *ist_pos, const drmp3_uint8 *sfb, const drmp3_uint8 *hdr, int max_band[3], int mpeg2_sh)
+static void drmp3_L3_stereo_process(drmp3d_real_t *left, const drmp3_uint8 *ist_pos, const drmp3_uint8 *sfb, const drmp3_uint8 *hdr, int max_band[3], int mpeg2_sh)
 {
-    static const float g_pan[7*2] = { 0,1,0.21132487f,0.78867513f,0.36602540f,0.63397460f,0.5f,0.5f,0.63397460f,0.36602540f,0.78867513f,0.21132487f,1,0 };
+    static const drmp3d_real_t g_pan[7*2] = { DRMP3_REAL(0),DRMP3_REAL(1),DRMP3_REAL(0.21132487f),DRMP3_REAL(0.78867513f),DRMP3_REAL(0.36602540f),DRMP3_REAL(0.63397460f),DRMP3_REAL(0.5f),DRMP3_REAL(0.5f),DRMP3_REAL(0.63397460f),DRMP3_REAL(0.36602540f),DRMP3_REAL(0.78867513f),DRMP3_REAL(0.21132487f),DRMP3_REAL(1),DRMP3_REAL(0) };
     unsigned i, max_pos = DRMP3_HDR_TEST_MPEG1(hdr) ? 7 : 64;
 
     for (i = 0; sfb[i]; i++)
@@ -1449,22 +2191,22 @@ static void drmp3_L3_stereo_process(float *left, const drmp3_uint8 *ist_pos, con
         unsigned ipos = ist_pos[i];
         if ((int)i > max_band[i % 3] && ipos < max_pos)
         {
-            float kl, kr, s = DRMP3_HDR_TEST_MS_STEREO(hdr) ? 1.41421356f : 1;
+            drmp3d_real_t kl, kr, s = DRMP3_HDR_TEST_MS_STEREO(hdr) ? DRMP3_REAL(1.41421356f) : DRMP3_REAL(1);
             if (DRMP3_HDR_TEST_MPEG1(hdr))
             {
                 kl = g_pan[2*ipos];
                 kr = g_pan[2*ipos + 1];
             } else
             {
-                kl = 1;
-                kr = drmp3_L3_ldexp_q2(1, (ipos + 1) >> 1 << mpeg2_sh);
+                kl = DRMP3_REAL(1);
+                kr = drmp3_L3_ldexp_q2(DRMP3_REAL(1), (ipos + 1) >> 1 << mpeg2_sh);
                 if (ipos & 1)
                 {
                     kl = kr;
-                    kr = 1;
+                    kr = DRMP3_REAL(1);
                 }
             }
-            drmp3_L3_intensity_stereo_band(left, sfb[i], kl*s, kr*s);
+            drmp3_L3_intensity_stereo_band(left, sfb[i], DRMP3_MUL(kl, s), DRMP3_MUL(kr, s));
         } else if (DRMP3_HDR_TEST_MS_STEREO(hdr))
         {
             drmp3_L3_midside_stereo(left, sfb[i]);
@@ -1473,7 +2215,7 @@ static void drmp3_L3_stereo_process(float *left, const drmp3_uint8 *ist_pos, con
     }
 }
 
-static void drmp3_L3_intensity_stereo(float *left, drmp3_uint8 *ist_pos, const drmp3_L3_gr_info *gr, const drmp3_uint8 *hdr)
+static void drmp3_L3_intensity_stereo(drmp3d_real_t *left, drmp3_uint8 *ist_pos, const drmp3_L3_gr_info *gr, const drmp3_uint8 *hdr)
 {
     int max_band[3], n_sfb = gr->n_long_sfb + gr->n_short_sfb;
     int i, max_blocks = gr->n_short_sfb ? 3 : 1;
@@ -1493,10 +2235,10 @@ static void drmp3_L3_intensity_stereo(float *left, drmp3_uint8 *ist_pos, const d
     drmp3_L3_stereo_process(left, ist_pos, gr->sfbtab, hdr, max_band, gr[1].scalefac_compress & 1);
 }
 
-static void drmp3_L3_reorder(float *grbuf, float *scratch, const drmp3_uint8 *sfb)
+static void drmp3_L3_reorder(drmp3d_real_t *grbuf, drmp3d_real_t *scratch, const drmp3_uint8 *sfb)
 {
     int i, len;
-    float *src = grbuf, *dst = scratch;
+    drmp3d_real_t *src = grbuf, *dst = scratch;
 
     for (;0 != (len = *sfb); sfb += 3, src += 2*len)
     {
@@ -1507,19 +2249,40 @@ static void drmp3_L3_reorder(float *grbuf, float *scratch, const drmp3_uint8 *sf
             *dst++ = src[2*len];
         }
     }
-    memcpy(grbuf, scratch, (dst - scratch)*sizeof(float));
+    memcpy(grbuf, scratch, (dst - scratch)*sizeof(drmp3d_real_t));
+}
+
+#if DRMP3_HAVE_AVX
+static DRMP3_AVX_TARGET void drmp3_L3_antialias_avx(float *grbuf, const float *aa0, const float *aa1)
+{
+    __m256 vu = _mm256_loadu_ps(grbuf + 18);
+    __m256 vd = _mm256_loadu_ps(grbuf + 10);
+    __m256 vc0 = _mm256_loadu_ps(aa0);
+    __m256 vc1 = _mm256_loadu_ps(aa1);
+    vd = DRMP3_VREV8(vd);
+    _mm256_storeu_ps(grbuf + 18, _mm256_sub_ps(_mm256_mul_ps(vu, vc0), _mm256_mul_ps(vd, vc1)));
+    vd = _mm256_add_ps(_mm256_mul_ps(vu, vc1), _mm256_mul_ps(vd, vc0));
+    _mm256_storeu_ps(grbuf + 10, DRMP3_VREV8(vd));
 }
+#endif
 
-static void drmp3_L3_antialias(float *grbuf, int nbands)
+static void drmp3_L3_antialias(drmp3d_real_t *grbuf, int nbands)
 {
-    static const float g_aa[2][8] = {
-        {0.85749293f,0.88174200f,0.94962865f,0.98331459f,0.99551782f,0.99916056f,0.99989920f,0.99999316f},
-        {0.51449576f,0.47173197f,0.31337745f,0.18191320f,0.09457419f,0.04096558f,0.01419856f,0.00369997f}
+    static const drmp3d_real_t g_aa[2][8] = {
+        {DRMP3_REAL(0.85749293f),DRMP3_REAL(0.88174200f),DRMP3_REAL(0.94962865f),DRMP3_REAL(0.98331459f),DRMP3_REAL(0.99551782f),DRMP3_REAL(0.99916056f),DRMP3_REAL(0.99989920f),DRMP3_REAL(0.99999316f)},
+        {DRMP3_REAL(0.51449576f),DRMP3_REAL(0.47173197f),DRMP3_REAL(0.31337745f),DRMP3_REAL(0.18191320f),DRMP3_REAL(0.09457419f),DRMP3_REAL(0.04096558f),DRMP3_REAL(0.01419856f),DRMP3_REAL(0.00369997f)}
     };
 
     for (; nbands > 0; nbands--, grbuf += 18)
     {
         int i = 0;
+#if DRMP3_HAVE_AVX
+        if (drmp3_have_avx())
+        {
+            drmp3_L3_antialias_avx(grbuf, g_aa[0], g_aa[1]);
+            i = 8;
+        }
+#endif
 #if DRMP3_HAVE_SIMD
         if (drmp3_have_simd()) for (; i < 8; i += 4)
         {
@@ -1536,28 +2299,28 @@ static void drmp3_L3_antialias(float *grbuf, int nbands)
 #ifndef DR_MP3_ONLY_SIMD
         for(; i < 8; i++)
         {
-            float u = grbuf[18 + i];
-            float d = grbuf[17 - i];
-            grbuf[18 + i] = u*g_aa[0][i] - d*g_aa[1][i];
-            grbuf[17 - i] = u*g_aa[1][i] + d*g_aa[0][i];
+            drmp3d_real_t u = grbuf[18 + i];
+            drmp3d_real_t d = grbuf[17 - i];
+            grbuf[18 + i] = DRMP3_MUL(u, g_aa[0][i]) - DRMP3_MUL(d, g_aa[1][i]);
+            grbuf[17 - i] = DRMP3_MUL(u, g_aa[1][i]) + DRMP3_MUL(d, g_aa[0][i]);
         }
 #endif
     }
 }
 
-static void drmp3_L3_dct3_9(float *y)
+static void drmp3_L3_dct3_9(drmp3d_real_t *y)
 {
-    float s0, s1, s2, s3, s4, s5, s6, s7, s8, t0, t2, t4;
+    drmp3d_real_t s0, s1, s2, s3, s4, s5, s6, s7, s8, t0, t2, t4;
 
     s0 = y[0]; s2 = y[2]; s4 = y[4]; s6 = y[6]; s8 = y[8];
-    t0 = s0 + s6*0.5f;
+    t0 = s0 + DRMP3_MUL(s6, DRMP3_REAL(0.5f));
     s0 -= s6;
-    t4 = (s4 + s2)*0.93969262f;
-    t2 = (s8 + s2)*0.76604444f;
-    s6 = (s4 - s8)*0.17364818f;
+    t4 = DRMP3_MUL(s4 + s2, DRMP3_REAL(0.93969262f));
+    t2 = DRMP3_MUL(s8 + s2, DRMP3_REAL(0.76604444f));
+    s6 = DRMP3_MUL(s4 - s8, DRMP3_REAL(0.17364818f));
     s4 += s8 - s2;
 
-    s2 = s0 - s4*0.5f;
+    s2 = s0 - DRMP3_MUL(s4, DRMP3_REAL(0.5f));
     y[4] = s4 + s0;
     s8 = t0 - t2 + s6;
     s0 = t0 - t4 + t2;
@@ -1565,11 +2328,11 @@ static void drmp3_L3_dct3_9(float *y)
 
     s1 = y[1]; s3 = y[3]; s5 = y[5]; s7 = y[7];
 
-    s3 *= 0.86602540f;
-    t0 = (s5 + s1)*0.98480775f;
-    t4 = (s5 - s7)*0.34202014f;
-    t2 = (s1 + s7)*0.64278761f;
-    s1 = (s1 - s5 - s7)*0.86602540f;
+    s3 = DRMP3_MUL(s3, DRMP3_REAL(0.86602540f));
+    t0 = DRMP3_MUL(s5 + s1, DRMP3_REAL(0.98480775f));
+    t4 = DRMP3_MUL(s5 - s7, DRMP3_REAL(0.34202014f));
+    t2 = DRMP3_MUL(s1 + s7, DRMP3_REAL(0.64278761f));
+    s1 = DRMP3_MUL(s1 - s5 - s7, DRMP3_REAL(0.86602540f));
 
     s5 = t0 - s3 - t2;
     s7 = t4 - s3 - t0;
@@ -1585,16 +2348,34 @@ static void drmp3_L3_dct3_9(float *y)
     y[8] = s4 + s7;
 }
 
-static void drmp3_L3_imdct36(float *grbuf, float *overlap, const float *window, int nbands)
+#if DRMP3_HAVE_AVX
+static DRMP3_AVX_TARGET void drmp3_L3_imdct36_avx(float *grbuf, float *overlap, const float *window, const float *co, const float *si, const float *twid9)
+{
+    __m256 vovl = _mm256_loadu_ps(overlap);
+    __m256 vc = _mm256_loadu_ps(co);
+    __m256 vs = _mm256_loadu_ps(si);
+    __m256 vr0 = _mm256_loadu_ps(twid9);
+    __m256 vr1 = _mm256_loadu_ps(twid9 + 9);
+    __m256 vw0 = _mm256_loadu_ps(window);
+    __m256 vw1 = _mm256_loadu_ps(window + 9);
+    __m256 vsum = _mm256_add_ps(_mm256_mul_ps(vc, vr1), _mm256_mul_ps(vs, vr0));
+    _mm256_storeu_ps(overlap, _mm256_sub_ps(_mm256_mul_ps(vc, vr0), _mm256_mul_ps(vs, vr1)));
+    _mm256_storeu_ps(grbuf, _mm256_sub_ps(_mm256_mul_ps(vovl, vw0), _mm256_mul_ps(vsum, vw1)));
+    vsum = _mm256_add_ps(_mm256_mul_ps(vovl, vw1), _mm256_mul_ps(vsum, vw0));
+    _mm256_storeu_ps(grbuf + 10, DRMP3_VREV8(vsum));
+}
+#endif
+
+static void drmp3_L3_imdct36(drmp3d_real_t *grbuf, drmp3d_real_t *overlap, const drmp3d_real_t *window, int nbands)
 {
     int i, j;
-    static const float g_twid9[18] = {
-        0.73727734f,0.79335334f,0.84339145f,0.88701083f,0.92387953f,0.95371695f,0.97629601f,0.99144486f,0.99904822f,0.67559021f,0.60876143f,0.53729961f,0.46174861f,0.38268343f,0.30070580f,0.21643961f,0.13052619f,0.04361938f
+    static const drmp3d_real_t g_twid9[18] = {
+        DRMP3_REAL(0.73727734f),DRMP3_REAL(0.79335334f),DRMP3_REAL(0.84339145f),DRMP3_REAL(0.88701083f),DRMP3_REAL(0.92387953f),DRMP3_REAL(0.95371695f),DRMP3_REAL(0.97629601f),DRMP3_REAL(0.99144486f),DRMP3_REAL(0.99904822f),DRMP3_REAL(0.67559021f),DRMP3_REAL(0.60876143f),DRMP3_REAL(0.53729961f),DRMP3_REAL(0.46174861f),DRMP3_REAL(0.38268343f),DRMP3_REAL(0.30070580f),DRMP3_REAL(0.21643961f),DRMP3_REAL(0.13052619f),DRMP3_REAL(0.04361938f)
     };
 
     for (j = 0; j < nbands; j++, grbuf += 18, overlap += 9)
     {
-        float co[9], si[9];
+        drmp3d_real_t co[9], si[9];
         co[0] = -grbuf[0];
         si[0] = grbuf[17];
         for (i = 0; i < 4; i++)
@@ -1614,6 +2395,13 @@ static void drmp3_L3_imdct36(float *grbuf, float *overlap, const float *window,
 
         i = 0;
 
+#if DRMP3_HAVE_AVX
+        if (drmp3_have_avx())
+        {
+            drmp3_L3_imdct36_avx(grbuf, overlap, window, co, si, g_twid9);
+            i = 8;
+        }
+#endif
 #if DRMP3_HAVE_SIMD
         if (drmp3_have_simd()) for (; i < 8; i += 4)
         {
@@ -1633,28 +2421,28 @@ static void drmp3_L3_imdct36(float *grbuf, float *overlap, const float *window,
 #endif
         for (; i < 9; i++)
         {
-            float ovl  = overlap[i];
-            float sum  = co[i]*g_twid9[9 + i] + si[i]*g_twid9[0 + i];
-            overlap[i] = co[i]*g_twid9[0 + i] - si[i]*g_twid9[9 + i];
-            grbuf[i]      = ovl*window[0 + i] - sum*window[9 + i];
-            grbuf[17 - i] = ovl*window[9 + i] + sum*window[0 + i];
+            drmp3d_real_t ovl = overlap[i];
+            drmp3d_real_t sum = DRMP3_MUL(co[i], g_twid9[9 + i]) + DRMP3_MUL(si[i], g_twid9[0 + i]);
+            overlap[i] = DRMP3_MUL(co[i], g_twid9[0 + i]) - DRMP3_MUL(si[i], g_twid9[9 + i]);
+            grbuf[i]      = DRMP3_MUL(ovl, window[0 + i]) - DRMP3_MUL(sum, window[9 + i]);
+            grbuf[17 - i] = DRMP3_MUL(ovl, window[9 + i]) + DRMP3_MUL(sum, window[0 + i]);
         }
     }
 }
 
-static void drmp3_L3_idct3(float x0, float x1, float x2, float *dst)
+static void drmp3_L3_idct3(drmp3d_real_t x0, drmp3d_real_t x1, drmp3d_real_t x2, drmp3d_real_t *dst)
 {
-    float m1 = x1*0.86602540f;
-    float a1 = x0 - x2*0.5f;
+    drmp3d_real_t m1 = DRMP3_MUL(x1, DRMP3_REAL(0.86602540f));
+    drmp3d_real_t a1 = x0 - DRMP3_MUL(x2, DRMP3_REAL(0.5f));
     dst[1] = x0 + x2;
     dst[0] = a1 + m1;
     dst[2] = a1 - m1;
 }
 
-static void drmp3_L3_imdct12(float *x, float *dst, float *overlap)
+static void drmp3_L3_imdct12(drmp3d_real_t *x, drmp3d_real_t *dst, drmp3d_real_t *overlap)
 {
-    static const float g_twid3[6] = { 0.79335334f,0.92387953f,0.99144486f, 0.60876143f,0.38268343f,0.13052619f };
-    float co[3], si[3];
+    static const drmp3d_real_t g_twid3[6] = { DRMP3_REAL(0.79335334f),DRMP3_REAL(0.92387953f),DRMP3_REAL(0.99144486f), DRMP3_REAL(0.60876143f),DRMP3_REAL(0.38268343f),DRMP3_REAL(0.13052619f) };
+    drmp3d_real_t co[3], si[3];
     int i;
 
     drmp3_L3_idct3(-x[0], x[6] + x[3], x[12] + x[9], co);
@@ -1663,28 +2451,28 @@ static void drmp3_L3_imdct12(float *x, float *dst, float *overlap)
 
     for (i = 0; i < 3; i++)
     {
-        float ovl  = overlap[i];
-        float sum  = co[i]*g_twid3[3 + i] + si[i]*g_twid3[0 + i];
-        overlap[i] = co[i]*g_twid3[0 + i] - si[i]*g_twid3[3 + i];
-        dst[i]     = ovl*g_twid3[2 - i] - sum*g_twid3[5 - i];
-        dst[5 - i] = ovl*g_twid3[5 - i] + sum*g_twid3[2 - i];
+        drmp3d_real_t ovl = overlap[i];
+        drmp3d_real_t sum = DRMP3_MUL(co[i], g_twid3[3 + i]) + DRMP3_MUL(si[i], g_twid3[0 + i]);
+        overlap[i] = DRMP3_MUL(co[i], g_twid3[0 + i]) - DRMP3_MUL(si[i], g_twid3[3 + i]);
+        dst[i]     = DRMP3_MUL(ovl, g_twid3[2 - i]) - DRMP3_MUL(sum, g_twid3[5 - i]);
+        dst[5 - i] = DRMP3_MUL(ovl, g_twid3[5 - i]) + DRMP3_MUL(sum, g_twid3[2 - i]);
     }
 }
 
-static void drmp3_L3_imdct_short(float *grbuf, float *overlap, int nbands)
+static void drmp3_L3_imdct_short(drmp3d_real_t *grbuf, drmp3d_real_t *overlap, int nbands)
 {
     for (;nbands > 0; nbands--, overlap += 9, grbuf += 18)
     {
-        float tmp[18];
+        drmp3d_real_t tmp[18];
         memcpy(tmp, grbuf, sizeof(tmp));
-        memcpy(grbuf, overlap, 6*sizeof(float));
+        memcpy(grbuf, overlap, 6*sizeof(drmp3d_real_t));
         drmp3_L3_imdct12(tmp, grbuf + 6, overlap + 6);
         drmp3_L3_imdct12(tmp + 1, grbuf + 12, overlap + 6);
         drmp3_L3_imdct12(tmp + 2, overlap, overlap + 6);
     }
 }
 
-static void drmp3_L3_change_sign(float *grbuf)
+static void drmp3_L3_change_sign(drmp3d_real_t *grbuf)
 {
     int b, i;
     for (b = 0, grbuf += 18; b < 32; b += 2, grbuf += 36)
@@ -1692,11 +2480,11 @@ static void drmp3_L3_change_sign(float *grbuf)
             grbuf[i] = -grbuf[i];
 }
 
-static void drmp3_L3_imdct_gr(float *grbuf, float *overlap, unsigned block_type, unsigned n_long_bands)
+static void drmp3_L3_imdct_gr(drmp3d_real_t *grbuf, drmp3d_real_t *overlap, unsigned block_type, unsigned n_long_bands, unsigned n_bands)
 {
-    static const float g_mdct_window[2][18] = {
-        { 0.99904822f,0.99144486f,0.97629601f,0.95371695f,0.92387953f,0.88701083f,0.84339145f,0.79335334f,0.73727734f,0.04361938f,0.13052619f,0.21643961f,0.30070580f,0.38268343f,0.46174861f,0.53729961f,0.60876143f,0.67559021f },
-        { 1,1,1,1,1,1,0.99144486f,0.92387953f,0.79335334f,0,0,0,0,0,0,0.13052619f,0.38268343f,0.60876143f }
+    static const drmp3d_real_t g_mdct_window[2][18] = {
+        { DRMP3_REAL(0.99904822f),DRMP3_REAL(0.99144486f),DRMP3_REAL(0.97629601f),DRMP3_REAL(0.95371695f),DRMP3_REAL(0.92387953f),DRMP3_REAL(0.88701083f),DRMP3_REAL(0.84339145f),DRMP3_REAL(0.79335334f),DRMP3_REAL(0.73727734f),DRMP3_REAL(0.04361938f),DRMP3_REAL(0.13052619f),DRMP3_REAL(0.21643961f),DRMP3_REAL(0.30070580f),DRMP3_REAL(0.38268343f),DRMP3_REAL(0.46174861f),DRMP3_REAL(0.53729961f),DRMP3_REAL(0.60876143f),DRMP3_REAL(0.67559021f) },
+        { DRMP3_REAL(1),DRMP3_REAL(1),DRMP3_REAL(1),DRMP3_REAL(1),DRMP3_REAL(1),DRMP3_REAL(1),DRMP3_REAL(0.99144486f),DRMP3_REAL(0.92387953f),DRMP3_REAL(0.79335334f),DRMP3_REAL(0),DRMP3_REAL(0),DRMP3_REAL(0),DRMP3_REAL(0),DRMP3_REAL(0),DRMP3_REAL(0),DRMP3_REAL(0.13052619f),DRMP3_REAL(0.38268343f),DRMP3_REAL(0.60876143f) }
     };
     if (n_long_bands)
     {
@@ -1705,9 +2493,9 @@ static void drmp3_L3_imdct_gr(float *grbuf, float *overlap, unsigned block_type,
         overlap += 9*n_long_bands;
     }
     if (block_type == DRMP3_SHORT_BLOCK_TYPE)
-        drmp3_L3_imdct_short(grbuf, overlap, 32 - n_long_bands);
+        drmp3_L3_imdct_short(grbuf, overlap, n_bands - n_long_bands);
     else
-        drmp3_L3_imdct36(grbuf, overlap, g_mdct_window[block_type == DRMP3_STOP_BLOCK_TYPE], 32 - n_long_bands);
+        drmp3_L3_imdct36(grbuf, overlap, g_mdct_window[block_type == DRMP3_STOP_BLOCK_TYPE], n_bands - n_long_bands);
 }
 
 static void drmp3_L3_save_reservoir(drmp3dec *h, drmp3dec_scratch *s)
@@ -1732,11 +2520,23 @@ static int drmp3_L3_restore_reservoir(drmp3dec *h, drmp3_bs *bs, drmp3dec_scratc
     int bytes_have = DRMP3_MIN(h->reserv, main_data_begin);
     memcpy(s->maindata, h->reserv_buf + DRMP3_MAX(0, h->reserv - main_data_begin), DRMP3_MIN(h->reserv, main_data_begin));
     memcpy(s->maindata + bytes_have, bs->buf + bs->pos/8, frame_bytes);
+    /*
+    A corrupt frame can declare more Huffman bits in part_23_length than it actually has, in which case the Huffman decoder reads past
+    the end of the main data. Zero the remainder so that such frames decode the same way every time rather than depending on whatever
+    was left on the stack.
+    */
+    memset(s->maindata + bytes_have + frame_bytes, 0, sizeof(s->maindata) - (bytes_have + frame_bytes));
     drmp3_bs_init(&s->bs, s->maindata, bytes_have + frame_bytes);
     return h->reserv >= main_data_begin;
 }
 
-static void drmp3_L3_decode(drmp3dec *h, drmp3dec_scratch *s, drmp3_L3_gr_info *gr_info, int nch)
+/*
+Only the lower n_bands subbands are decoded. Huffman decoding stops once they're filled since the position of the next channel is
+known, and only they go through the stereo processing, antialiasing and IMDCT. Short blocks are decoded in full since they're still
+in scalefactor band order at that point, and so is the right channel with intensity stereo since where its data ends decides which
+bands are intensity coded.
+*/
+static void drmp3_L3_decode(drmp3dec *h, drmp3dec_scratch *s, drmp3_L3_gr_info *gr_info, int nch, int n_bands)
 {
     int ch;
 
@@ -1744,15 +2544,24 @@ static void drmp3_L3_decode(drmp3dec *h, drmp3dec_scratch *s, drmp3_L3_gr_info *
     {
         int layer3gr_limit = s->bs.pos + gr_info[ch].part_23_length;
         drmp3_L3_decode_scalefactors(h->header, s->ist_pos[ch], &s->bs, gr_info + ch, s->scf, ch);
-        drmp3_L3_huffman(s->grbuf[ch], &s->bs, gr_info + ch, s->scf, layer3gr_limit);
+        drmp3_L3_huffman(s->grbuf[ch], &s->bs, gr_info + ch, s->scf, layer3gr_limit, (gr_info[ch].n_short_sfb || (ch && DRMP3_HDR_TEST_I_STEREO(h->header))) ? 576 : 18*n_bands);
+#ifdef DR_MP3_FIXED_POINT
+        if (ch == 0 || !DRMP3_HDR_TEST_I_STEREO(h->header))
+        {
+            drmp3_L3_clear_ulp(s->grbuf[ch], 576);
+        }
+#endif
     }
 
     if (DRMP3_HDR_TEST_I_STEREO(h->header))
     {
         drmp3_L3_intensity_stereo(s->grbuf[0], s->ist_pos[1], gr_info, h->header);
+#ifdef DR_MP3_FIXED_POINT
+        drmp3_L3_clear_ulp(s->grbuf[1], 576);
+#endif
     } else if (DRMP3_HDR_IS_MS_STEREO(h->header))
     {
-        drmp3_L3_midside_stereo(s->grbuf[0], 576);
+        drmp3_L3_midside_stereo(s->grbuf[0], (gr_info[0].n_short_sfb || gr_info[1].n_short_sfb) ? 576 : 18*n_bands);
     }
 
     for (ch = 0; ch < nch; ch++, gr_info++)
@@ -1766,18 +2575,91 @@ static void drmp3_L3_decode(drmp3dec *h, drmp3dec_scratch *s, drmp3_L3_gr_info *
             drmp3_L3_reorder(s->grbuf[ch] + n_long_bands*18, s->syn[0], gr_info->sfbtab + gr_info->n_long_sfb);
         }
 
-        drmp3_L3_antialias(s->grbuf[ch], aa_bands);
-        drmp3_L3_imdct_gr(s->grbuf[ch], h->mdct_overlap[ch], gr_info->block_type, n_long_bands);
+        drmp3_L3_antialias(s->grbuf[ch], DRMP3_MIN(aa_bands, n_bands - 1));
+        drmp3_L3_imdct_gr(s->grbuf[ch], h->mdct_overlap[ch], gr_info->block_type, n_long_bands, n_bands);
         drmp3_L3_change_sign(s->grbuf[ch]);
     }
 }
 
-static void drmp3d_DCT_II(float *grbuf, int n)
+#if DRMP3_HAVE_AVX
+/* Transforms as many whole blocks of 8 columns as fit in n and returns the number of columns done. */
+static DRMP3_AVX_TARGET int drmp3d_DCT_II_avx(float *grbuf, int n, const float *g_sec)
+{
+    int i, k = 0;
+    for (; k + 8 <= n; k += 8)
+    {
+        __m256 t[4][8], *x;
+        float *y = grbuf + k;
+
+        for (x = t[0], i = 0; i < 8; i++, x++)
+        {
+            __m256 x0 = _mm256_loadu_ps(&y[i*18]);
+            __m256 x1 = _mm256_loadu_ps(&y[(15 - i)*18]);
+            __m256 x2 = _mm256_loadu_ps(&y[(16 + i)*18]);
+            __m256 x3 = _mm256_loadu_ps(&y[(31 - i)*18]);
+            __m256 t0 = _mm256_add_ps(x0, x3);
+            __m256 t1 = _mm256_add_ps(x1, x2);
+            __m256 t2 = _mm256_mul_ps(_mm256_sub_ps(x1, x2), _mm256_set1_ps(g_sec[3*i + 0]));
+            __m256 t3 = _mm256_mul_ps(_mm256_sub_ps(x0, x3), _mm256_set1_ps(g_sec[3*i + 1]));
+            x[0] = _mm256_add_ps(t0, t1);
+            x[8] = _mm256_mul_ps(_mm256_sub_ps(t0, t1), _mm256_set1_ps(g_sec[3*i + 2]));
+            x[16] = _mm256_add_ps(t3, t2);
+            x[24] = _mm256_mul_ps(_mm256_sub_ps(t3, t2), _mm256_set1_ps(g_sec[3*i + 2]));
+        }
+        for (x = t[0], i = 0; i < 4; i++, x += 8)
+        {
+            __m256 x0 = x[0], x1 = x[1], x2 = x[2], x3 = x[3], x4 = x[4], x5 = x[5], x6 = x[6], x7 = x[7], xt;
+            xt = _mm256_sub_ps(x0, x7); x0 = _mm256_add_ps(x0, x7);
+            x7 = _mm256_sub_ps(x1, x6); x1 = _mm256_add_ps(x1, x6);
+            x6 = _mm256_sub_ps(x2, x5); x2 = _mm256_add_ps(x2, x5);
+            x5 = _mm256_sub_ps(x3, x4); x3 = _mm256_add_ps(x3, x4);
+            x4 = _mm256_sub_ps(x0, x3); x0 = _mm256_add_ps(x0, x3);
+            x3 = _mm256_sub_ps(x1, x2); x1 = _mm256_add_ps(x1, x2);
+            x[0] = _mm256_add_ps(x0, x1);
+            x[4] = _mm256_mul_ps(_mm256_sub_ps(x0, x1), _mm256_set1_ps(0.70710677f));
+            x5 = _mm256_add_ps(x5, x6);
+            x6 = _mm256_mul_ps(_mm256_add_ps(x6, x7), _mm256_set1_ps(0.70710677f));
+            x7 = _mm256_add_ps(x7, xt);
+            x3 = _mm256_mul_ps(_mm256_add_ps(x3, x4), _mm256_set1_ps(0.70710677f));
+            x5 = _mm256_sub_ps(x5, _mm256_mul_ps(x7, _mm256_set1_ps(0.198912367f))); /* rotate by PI/8 */
+            x7 = _mm256_add_ps(x7, _mm256_mul_ps(x5, _mm256_set1_ps(0.382683432f)));
+            x5 = _mm256_sub_ps(x5, _mm256_mul_ps(x7, _mm256_set1_ps(0.198912367f)));
+            x0 = _mm256_sub_ps(xt, x6); xt = _mm256_add_ps(xt, x6);
+            x[1] = _mm256_mul_ps(_mm256_add_ps(xt, x7), _mm256_set1_ps(0.50979561f));
+            x[2] = _mm256_mul_ps(_mm256_add_ps(x4, x3), _mm256_set1_ps(0.54119611f));
+            x[3] = _mm256_mul_ps(_mm256_sub_ps(x0, x5), _mm256_set1_ps(0.60134488f));
+            x[5] = _mm256_mul_ps(_mm256_add_ps(x0, x5), _mm256_set1_ps(0.89997619f));
+            x[6] = _mm256_mul_ps(_mm256_sub_ps(x4, x3), _mm256_set1_ps(1.30656302f));
+            x[7] = _mm256_mul_ps(_mm256_sub_ps(xt, x7), _mm256_set1_ps(2.56291556f));
+        }
+
+        for (i = 0; i < 7; i++, y += 4*18)
+        {
+            __m256 s = _mm256_add_ps(t[3][i], t[3][i + 1]);
+            _mm256_storeu_ps(&y[0*18], t[0][i]);
+            _mm256_storeu_ps(&y[1*18], _mm256_add_ps(t[2][i], s));
+            _mm256_storeu_ps(&y[2*18], _mm256_add_ps(t[1][i], t[1][i + 1]));
+            _mm256_storeu_ps(&y[3*18], _mm256_add_ps(t[2][1 + i], s));
+        }
+        _mm256_storeu_ps(&y[0*18], t[0][7]);
+        _mm256_storeu_ps(&y[1*18], _mm256_add_ps(t[2][7], t[3][7]));
+        _mm256_storeu_ps(&y[2*18], t[1][7]);
+        _mm256_storeu_ps(&y[3*18], t[3][7]);
+    }
+    return k;
+}
+#endif
+
+static void drmp3d_DCT_II(drmp3d_real_t *grbuf, int n)
 {
-    static const float g_sec[24] = {
-        10.19000816f,0.50060302f,0.50241929f,3.40760851f,0.50547093f,0.52249861f,2.05778098f,0.51544732f,0.56694406f,1.48416460f,0.53104258f,0.64682180f,1.16943991f,0.55310392f,0.78815460f,0.97256821f,0.58293498f,1.06067765f,0.83934963f,0.62250412f,1.72244716f,0.74453628f,0.67480832f,5.10114861f
+    static const drmp3d_real_t g_sec[24] = {
+        DRMP3_REAL(10.19000816f),DRMP3_REAL(0.50060302f),DRMP3_REAL(0.50241929f),DRMP3_REAL(3.40760851f),DRMP3_REAL(0.50547093f),DRMP3_REAL(0.52249861f),DRMP3_REAL(2.05778098f),DRMP3_REAL(0.51544732f),DRMP3_REAL(0.56694406f),DRMP3_REAL(1.48416460f),DRMP3_REAL(0.53104258f),DRMP3_REAL(0.64682180f),DRMP3_REAL(1.16943991f),DRMP3_REAL(0.55310392f),DRMP3_REAL(0.78815460f),DRMP3_REAL(0.97256821f),DRMP3_REAL(0.58293498f),DRMP3_REAL(1.06067765f),DRMP3_REAL(0.83934963f),DRMP3_REAL(0.62250412f),DRMP3_REAL(1.72244716f),DRMP3_REAL(0.74453628f),DRMP3_REAL(0.67480832f),DRMP3_REAL(5.10114861f)
     };
     int i, k = 0;
+#if DRMP3_HAVE_AVX
+    if (drmp3_have_avx())
+        k = drmp3d_DCT_II_avx(grbuf, n, g_sec);
+#endif
 #if DRMP3_HAVE_SIMD
     if (drmp3_have_simd()) for (; k < n; k += 4)
     {
@@ -1868,26 +2750,26 @@ static void drmp3d_DCT_II(float *grbuf, int n)
 #else
     for (; k < n; k++)
     {
-        float t[4][8], *x, *y = grbuf + k;
+        drmp3d_real_t t[4][8], *x, *y = grbuf + k;
 
         for (x = t[0], i = 0; i < 8; i++, x++)
         {
-            float x0 = y[i*18];
-            float x1 = y[(15 - i)*18];
-            float x2 = y[(16 + i)*18];
-            float x3 = y[(31 - i)*18];
-            float t0 = x0 + x3;
-            float t1 = x1 + x2;
-            float t2 = (x1 - x2)*g_sec[3*i + 0];
-            float t3 = (x0 - x3)*g_sec[3*i + 1];
+            drmp3d_real_t x0 = y[i*18];
+            drmp3d_real_t x1 = y[(15 - i)*18];
+            drmp3d_real_t x2 = y[(16 + i)*18];
+            drmp3d_real_t x3 = y[(31 - i)*18];
+            drmp3d_real_t t0 = x0 + x3;
+            drmp3d_real_t t1 = x1 + x2;
+            drmp3d_real_t t2 = DRMP3_MUL(x1 - x2, g_sec[3*i + 0]);
+            drmp3d_real_t t3 = DRMP3_MUL(x0 - x3, g_sec[3*i + 1]);
             x[0] = t0 + t1;
-            x[8] = (t0 - t1)*g_sec[3*i + 2];
+            x[8] = DRMP3_MUL(t0 - t1, g_sec[3*i + 2]);
             x[16] = t3 + t2;
-            x[24] = (t3 - t2)*g_sec[3*i + 2];
+            x[24] = DRMP3_MUL(t3 - t2, g_sec[3*i + 2]);
         }
         for (x = t[0], i = 0; i < 4; i++, x += 8)
         {
-            float x0 = x[0], x1 = x[1], x2 = x[2], x3 = x[3], x4 = x[4], x5 = x[5], x6 = x[6], x7 = x[7], xt;
+            drmp3d_real_t x0 = x[0], x1 = x[1], x2 = x[2], x3 = x[3], x4 = x[4], x5 = x[5], x6 = x[6], x7 = x[7], xt;
             xt = x0 - x7; x0 += x7;
             x7 = x1 - x6; x1 += x6;
             x6 = x2 - x5; x2 += x5;
@@ -1895,21 +2777,21 @@ static void drmp3d_DCT_II(float *grbuf, int n)
             x4 = x0 - x3; x0 += x3;
             x3 = x1 - x2; x1 += x2;
             x[0] = x0 + x1;
-            x[4] = (x0 - x1)*0.70710677f;
+            x[4] = DRMP3_MUL(x0 - x1, DRMP3_REAL(0.70710677f));
             x5 =  x5 + x6;
-            x6 = (x6 + x7)*0.70710677f;
+            x6 = DRMP3_MUL(x6 + x7, DRMP3_REAL(0.70710677f));
             x7 =  x7 + xt;
-            x3 = (x3 + x4)*0.70710677f;
-            x5 -= x7*0.198912367f;  /* rotate by PI/8 */
-            x7 += x5*0.382683432f;
-            x5 -= x7*0.198912367f;
+            x3 = DRMP3_MUL(x3 + x4, DRMP3_REAL(0.70710677f));
+            x5 -= DRMP3_MUL(x7, DRMP3_REAL(0.198912367f));  /* rotate by PI/8 */
+            x7 += DRMP3_MUL(x5, DRMP3_REAL(0.382683432f));
+            x5 -= DRMP3_MUL(x7, DRMP3_REAL(0.198912367f));
             x0 = xt - x6; xt += x6;
-            x[1] = (xt + x7)*0.50979561f;
-            x[2] = (x4 + x3)*0.54119611f;
-            x[3] = (x0 - x5)*0.60134488f;
-            x[5] = (x0 + x5)*0.89997619f;
-            x[6] = (x4 - x3)*1.30656302f;
-            x[7] = (xt - x7)*2.56291556f;
+            x[1] = DRMP3_MUL(xt + x7, DRMP3_REAL(0.50979561f));
+            x[2] = DRMP3_MUL(x4 + x3, DRMP3_REAL(0.54119611f));
+            x[3] = DRMP3_MUL(x0 - x5, DRMP3_REAL(0.60134488f));
+            x[5] = DRMP3_MUL(x0 + x5, DRMP3_REAL(0.89997619f));
+            x[6] = DRMP3_MUL(x4 - x3, DRMP3_REAL(1.30656302f));
+            x[7] = DRMP3_MUL(xt - x7, DRMP3_REAL(2.56291556f));
 
         }
         for (i = 0; i < 7; i++, y += 4*18)
@@ -1927,7 +2809,18 @@ static void drmp3d_DCT_II(float *grbuf, int n)
 #endif
 }
 
-#ifndef DR_MP3_FLOAT_OUTPUT
+#if defined(DR_MP3_FIXED_POINT)
+typedef drmp3_int16 drmp3d_sample_t;
+
+/* Rounds exactly like the floating point version below. */
+static drmp3_int16 drmp3d_scale_pcm(drmp3_int64 sample)
+{
+    drmp3_int64 s = sample + (1 << (DRMP3_FRAC_BITS - 1));
+    s = (s < 0) ? -(-s >> DRMP3_FRAC_BITS) : (s >> DRMP3_FRAC_BITS);
+    s -= (s < 0);
+    return (drmp3_int16)DRMP3_MIN(DRMP3_MAX(s, -32768), 32767);
+}
+#elif !defined(DR_MP3_FLOAT_OUTPUT)
 typedef drmp3_int16 drmp3d_sample_t;
 
 static drmp3_int16 drmp3d_scale_pcm(float sample)
@@ -1954,38 +2847,141 @@ static float drmp3d_scale_pcm(float sample)
 }
 #endif
 
-static void drmp3d_synth_pair(drmp3d_sample_t *pcm, int nch, const float *z)
-{
-    float a;
-    a  = (z[14*64] - z[    0]) * 29;
-    a += (z[ 1*64] + z[13*64]) * 213;
-    a += (z[12*64] - z[ 2*64]) * 459;
-    a += (z[ 3*64] + z[11*64]) * 2037;
-    a += (z[10*64] - z[ 4*64]) * 5153;
-    a += (z[ 5*64] + z[ 9*64]) * 6574;
-    a += (z[ 8*64] - z[ 6*64]) * 37489;
-    a +=  z[ 7*64]             * 75038;
+/* In fixed point mode the first operand of each product is widened to 64 bits with DRMP3_ACC(). */
+#define DRMP3_ACC(x) ((drmp3d_acc_t)(x))
+
+static void drmp3d_synth_pair(drmp3d_sample_t *pcm, int nch, const drmp3d_real_t *z)
+{
+    drmp3d_acc_t a;
+    a  = (DRMP3_ACC(z[14*64]) - z[    0]) * 29;
+    a += (DRMP3_ACC(z[ 1*64]) + z[13*64]) * 213;
+    a += (DRMP3_ACC(z[12*64]) - z[ 2*64]) * 459;
+    a += (DRMP3_ACC(z[ 3*64]) + z[11*64]) * 2037;
+    a += (DRMP3_ACC(z[10*64]) - z[ 4*64]) * 5153;
+    a += (DRMP3_ACC(z[ 5*64]) + z[ 9*64]) * 6574;
+    a += (DRMP3_ACC(z[ 8*64]) - z[ 6*64]) * 37489;
+    a +=  DRMP3_ACC(z[ 7*64])             * 75038;
     pcm[0] = drmp3d_scale_pcm(a);
 
     z += 2;
-    a  = z[14*64] * 104;
-    a += z[12*64] * 1567;
-    a += z[10*64] * 9727;
-    a += z[ 8*64] * 64019;
-    a += z[ 6*64] * -9975;
-    a += z[ 4*64] * -45;
-    a += z[ 2*64] * 146;
-    a += z[ 0*64] * -5;
+    a  = DRMP3_ACC(z[14*64]) * 104;
+    a += DRMP3_ACC(z[12*64]) * 1567;
+    a += DRMP3_ACC(z[10*64]) * 9727;
+    a += DRMP3_ACC(z[ 8*64]) * 64019;
+    a += DRMP3_ACC(z[ 6*64]) * -9975;
+    a += DRMP3_ACC(z[ 4*64]) * -45;
+    a += DRMP3_ACC(z[ 2*64]) * 146;
+    a += DRMP3_ACC(z[ 0*64]) * -5;
     pcm[16*nch] = drmp3d_scale_pcm(a);
 }
 
-static void drmp3d_synth(float *xl, drmp3d_sample_t *dstl, int nch, float *lins)
+#if DRMP3_HAVE_SIMD
+/* Converts and scatters the 8 output samples of synthesis step i, shared by the SSE/NEON and AVX loops. */
+static DRMP3_INLINE void drmp3d_synth_store(drmp3d_sample_t *dstl, drmp3d_sample_t *dstr, int nch, int i, drmp3_f4 a, drmp3_f4 b)
+{
+#ifndef DR_MP3_FLOAT_OUTPUT
+#if DRMP3_HAVE_SSE
+        static const drmp3_f4 g_max = { 32767.0f, 32767.0f, 32767.0f, 32767.0f };
+        static const drmp3_f4 g_min = { -32768.0f, -32768.0f, -32768.0f, -32768.0f };
+        __m128i pcm8 = _mm_packs_epi32(_mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(a, g_max), g_min)),
+                                       _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(b, g_max), g_min)));
+        dstr[(15 - i)*nch] = (drmp3_int16)_mm_extract_epi16(pcm8, 1);
+        dstr[(17 + i)*nch] = (drmp3_int16)_mm_extract_epi16(pcm8, 5);
+        dstl[(15 - i)*nch] = (drmp3_int16)_mm_extract_epi16(pcm8, 0);
+        dstl[(17 + i)*nch] = (drmp3_int16)_mm_extract_epi16(pcm8, 4);
+        dstr[(47 - i)*nch] = (drmp3_int16)_mm_extract_epi16(pcm8, 3);
+        dstr[(49 + i)*nch] = (drmp3_int16)_mm_extract_epi16(pcm8, 7);
+        dstl[(47 - i)*nch] = (drmp3_int16)_mm_extract_epi16(pcm8, 2);
+        dstl[(49 + i)*nch] = (drmp3_int16)_mm_extract_epi16(pcm8, 6);
+#else
+        int16x4_t pcma, pcmb;
+        a = DRMP3_VADD(a, DRMP3_VSET(0.5f));
+        b = DRMP3_VADD(b, DRMP3_VSET(0.5f));
+        pcma = vqmovn_s32(vqaddq_s32(vcvtq_s32_f32(a), vreinterpretq_s32_u32(vcltq_f32(a, DRMP3_VSET(0)))));
+        pcmb = vqmovn_s32(vqaddq_s32(vcvtq_s32_f32(b), vreinterpretq_s32_u32(vcltq_f32(b, DRMP3_VSET(0)))));
+        vst1_lane_s16(dstr + (15 - i)*nch, pcma, 1);
+        vst1_lane_s16(dstr + (17 + i)*nch, pcmb, 1);
+        vst1_lane_s16(dstl + (15 - i)*nch, pcma, 0);
+        vst1_lane_s16(dstl + (17 + i)*nch, pcmb, 0);
+        vst1_lane_s16(dstr + (47 - i)*nch, pcma, 3);
+        vst1_lane_s16(dstr + (49 + i)*nch, pcmb, 3);
+        vst1_lane_s16(dstl + (47 - i)*nch, pcma, 2);
+        vst1_lane_s16(dstl + (49 + i)*nch, pcmb, 2);
+#endif
+#else
+        static const drmp3_f4 g_scale = { 1.0f/32768.0f, 1.0f/32768.0f, 1.0f/32768.0f, 1.0f/32768.0f };
+        a = DRMP3_VMUL(a, g_scale);
+        b = DRMP3_VMUL(b, g_scale);
+#if DRMP3_HAVE_SSE
+        _mm_store_ss(dstr + (15 - i)*nch, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)));
+        _mm_store_ss(dstr + (17 + i)*nch, _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1)));
+        _mm_store_ss(dstl + (15 - i)*nch, _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 0)));
+        _mm_store_ss(dstl + (17 + i)*nch, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)));
+        _mm_store_ss(dstr + (47 - i)*nch, _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)));
+        _mm_store_ss(dstr + (49 + i)*nch, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3)));
+        _mm_store_ss(dstl + (47 - i)*nch, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)));
+        _mm_store_ss(dstl + (49 + i)*nch, _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2)));
+#else
+        vst1q_lane_f32(dstr + (15 - i)*nch, a, 1);
+        vst1q_lane_f32(dstr + (17 + i)*nch, b, 1);
+        vst1q_lane_f32(dstl + (15 - i)*nch, a, 0);
+        vst1q_lane_f32(dstl + (17 + i)*nch, b, 0);
+        vst1q_lane_f32(dstr + (47 - i)*nch, a, 3);
+        vst1q_lane_f32(dstr + (49 + i)*nch, b, 3);
+        vst1q_lane_f32(dstl + (47 - i)*nch, a, 2);
+        vst1q_lane_f32(dstl + (49 + i)*nch, b, 2);
+#endif
+#endif /* DR_MP3_FLOAT_OUTPUT */
+}
+#endif
+
+#if DRMP3_HAVE_AVX
+/*
+Runs synthesis steps 14 down to 1 two at a time, with step i in the upper half of each register and step i - 1 in the lower
+half. The two steps never read what the other one writes to zlin so their inputs can all be filled in up front.
+*/
+static DRMP3_AVX_TARGET void drmp3d_synth_avx(float *xl, float *xr, drmp3d_sample_t *dstl, drmp3d_sample_t *dstr, int nch, float *zlin, const float *w)
+{
+    int i, j;
+    for (i = 14; i > 0; i -= 2, w += 32)
+    {
+        __m256 a, b;
+        for (j = i; j >= i - 1; j--)
+        {
+            zlin[4*j]     = xl[18*(31 - j)];
+            zlin[4*j + 1] = xr[18*(31 - j)];
+            zlin[4*j + 2] = xl[1 + 18*(31 - j)];
+            zlin[4*j + 3] = xr[1 + 18*(31 - j)];
+            zlin[4*j + 64] = xl[1 + 18*(1 + j)];
+            zlin[4*j + 64 + 1] = xr[1 + 18*(1 + j)];
+            zlin[4*j - 64 + 2] = xl[18*(1 + j)];
+            zlin[4*j - 64 + 3] = xr[18*(1 + j)];
+        }
+
+#define DRMP3_VLOAD8(k) __m256 w0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(w[16 + 2*k])), _mm_set1_ps(w[2*k]), 1); __m256 w1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(w[17 + 2*k])), _mm_set1_ps(w[1 + 2*k]), 1); __m256 vz = _mm256_loadu_ps(&zlin[4*(i - 1) - 64*k]); __m256 vy = _mm256_loadu_ps(&zlin[4*(i - 1) - 64*(15 - k)]);
+#define DRMP3_V80(k) { DRMP3_VLOAD8(k) b =                  _mm256_add_ps(_mm256_mul_ps(vz, w1), _mm256_mul_ps(vy, w0)) ; a =                  _mm256_sub_ps(_mm256_mul_ps(vz, w0), _mm256_mul_ps(vy, w1));  }
+#define DRMP3_V81(k) { DRMP3_VLOAD8(k) b = _mm256_add_ps(b, _mm256_add_ps(_mm256_mul_ps(vz, w1), _mm256_mul_ps(vy, w0))); a = _mm256_add_ps(a, _mm256_sub_ps(_mm256_mul_ps(vz, w0), _mm256_mul_ps(vy, w1))); }
+#define DRMP3_V82(k) { DRMP3_VLOAD8(k) b = _mm256_add_ps(b, _mm256_add_ps(_mm256_mul_ps(vz, w1), _mm256_mul_ps(vy, w0))); a = _mm256_add_ps(a, _mm256_sub_ps(_mm256_mul_ps(vy, w1), _mm256_mul_ps(vz, w0))); }
+        DRMP3_V80(0) DRMP3_V82(1) DRMP3_V81(2) DRMP3_V82(3) DRMP3_V81(4) DRMP3_V82(5) DRMP3_V81(6) DRMP3_V82(7)
+
+        drmp3d_synth_store(dstl, dstr, nch, i, _mm256_extractf128_ps(a, 1), _mm256_extractf128_ps(b, 1));
+        drmp3d_synth_store(dstl, dstr, nch, i - 1, _mm256_castps256_ps128(a), _mm256_castps256_ps128(b));
+    }
+}
+#endif
+
+static void drmp3d_synth_reduced(drmp3d_real_t *xl, drmp3d_real_t *xr, drmp3d_sample_t *dstl, drmp3d_sample_t *dstr, int nch, drmp3d_real_t *lins, const drmp3d_real_t *w, int rate_shift);
+
+/*
+The left and right channels go through the filter side by side, each in its own lanes. They don't need to belong to the same stream,
+which is how drmp3d_synth_granule_pair() synthesizes two mono streams at once. nch is the stride of the output. When dstl and dstr
+are the same the left channel is written last.
+*/
+static void drmp3d_synth(drmp3d_real_t *xl, drmp3d_real_t *xr, drmp3d_sample_t *dstl, drmp3d_sample_t *dstr, int nch, drmp3d_real_t *lins, int rate_shift)
 {
     int i;
-    float *xr = xl + 576*(nch - 1);
-    drmp3d_sample_t *dstr = dstl + (nch - 1);
 
-    static const float g_win[] = {
+    static const drmp3d_real_t g_win[] = {
         -1,26,-31,208,218,401,-519,2063,2000,4788,-5517,7134,5959,35640,-39336,74992,
         -1,24,-35,202,222,347,-581,2080,1952,4425,-5879,7640,5288,33791,-41176,74856,
         -1,21,-38,196,225,294,-645,2087,1893,4063,-6237,8092,4561,31947,-43006,74630,
@@ -2002,8 +2998,8 @@ static void drmp3d_synth(float *xl, drmp3d_sample_t *dstl, int nch, float *lins)
         -4,7,-91,117,177,-106,-1428,1698,402,545,-9416,9916,-7154,12980,-61289,66494,
         -5,6,-97,111,163,-127,-1498,1634,185,288,-9585,9838,-8540,11455,-62684,65290
     };
-    float *zlin = lins + 15*64;
-    const float *w = g_win;
+    drmp3d_real_t *zlin = lins + 15*64;
+    const drmp3d_real_t *w = g_win;
 
     zlin[4*15]     = xl[18*16];
     zlin[4*15 + 1] = xr[18*16];
@@ -2015,13 +3011,28 @@ static void drmp3d_synth(float *xl, drmp3d_sample_t *dstl, int nch, float *lins)
     zlin[4*31 + 2] = xl[1];
     zlin[4*31 + 3] = xr[1];
 
+    if (rate_shift)
+    {
+        drmp3d_synth_reduced(xl, xr, dstl, dstr, nch, lins, w, rate_shift);
+        return;
+    }
+
     drmp3d_synth_pair(dstr, nch, lins + 4*15 + 1);
     drmp3d_synth_pair(dstr + 32*nch, nch, lins + 4*15 + 64 + 1);
     drmp3d_synth_pair(dstl, nch, lins + 4*15);
     drmp3d_synth_pair(dstl + 32*nch, nch, lins + 4*15 + 64);
 
 #if DRMP3_HAVE_SIMD
-    if (drmp3_have_simd()) for (i = 14; i >= 0; i--)
+    i = 14;
+#if DRMP3_HAVE_AVX
+    if (drmp3_have_avx())
+    {
+        drmp3d_synth_avx(xl, xr, dstl, dstr, nch, zlin, w);
+        w += 14*16;
+        i = 0;
+    }
+#endif
+    if (drmp3_have_simd()) for (; i >= 0; i--)
     {
 #define DRMP3_VLOAD(k) drmp3_f4 w0 = DRMP3_VSET(*w++); drmp3_f4 w1 = DRMP3_VSET(*w++); drmp3_f4 vz = DRMP3_VLD(&zlin[4*i - 64*k]); drmp3_f4 vy = DRMP3_VLD(&zlin[4*i - 64*(15 - k)]);
 #define DRMP3_V0(k) { DRMP3_VLOAD(k) b =               DRMP3_VADD(DRMP3_VMUL(vz, w1), DRMP3_VMUL(vy, w0)) ; a =               DRMP3_VSUB(DRMP3_VMUL(vz, w0), DRMP3_VMUL(vy, w1));  }
@@ -2039,61 +3050,7 @@ static void drmp3d_synth(float *xl, drmp3d_sample_t *dstl, int nch, float *lins)
 
         DRMP3_V0(0) DRMP3_V2(1) DRMP3_V1(2) DRMP3_V2(3) DRMP3_V1(4) DRMP3_V2(5) DRMP3_V1(6) DRMP3_V2(7)
 
-        {
-#ifndef DR_MP3_FLOAT_OUTPUT
-#if DRMP3_HAVE_SSE
-            static const drmp3_f4 g_max = { 32767.0f, 32767.0f, 32767.0f, 32767.0f };
-            static const drmp3_f4 g_min = { -32768.0f, -32768.0f, -32768.0f, -32768.0f };
-            __m128i pcm8 = _mm_packs_epi32(_mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(a, g_max), g_min)),
-                                           _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(b, g_max), g_min)));
-            dstr[(15 - i)*nch] = (drmp3_int16)_mm_extract_epi16(pcm8, 1);
-            dstr[(17 + i)*nch] = (drmp3_int16)_mm_extract_epi16(pcm8, 5);
-            dstl[(15 - i)*nch] = (drmp3_int16)_mm_extract_epi16(pcm8, 0);
-            dstl[(17 + i)*nch] = (drmp3_int16)_mm_extract_epi16(pcm8, 4);
-            dstr[(47 - i)*nch] = (drmp3_int16)_mm_extract_epi16(pcm8, 3);
-            dstr[(49 + i)*nch] = (drmp3_int16)_mm_extract_epi16(pcm8, 7);
-            dstl[(47 - i)*nch] = (drmp3_int16)_mm_extract_epi16(pcm8, 2);
-            dstl[(49 + i)*nch] = (drmp3_int16)_mm_extract_epi16(pcm8, 6);
-#else
-            int16x4_t pcma, pcmb;
-            a = DRMP3_VADD(a, DRMP3_VSET(0.5f));
-            b = DRMP3_VADD(b, DRMP3_VSET(0.5f));
-            pcma = vqmovn_s32(vqaddq_s32(vcvtq_s32_f32(a), vreinterpretq_s32_u32(vcltq_f32(a, DRMP3_VSET(0)))));
-            pcmb = vqmovn_s32(vqaddq_s32(vcvtq_s32_f32(b), vreinterpretq_s32_u32(vcltq_f32(b, DRMP3_VSET(0)))));
-            vst1_lane_s16(dstr + (15 - i)*nch, pcma, 1);
-            vst1_lane_s16(dstr + (17 + i)*nch, pcmb, 1);
-            vst1_lane_s16(dstl + (15 - i)*nch, pcma, 0);
-            vst1_lane_s16(dstl + (17 + i)*nch, pcmb, 0);
-            vst1_lane_s16(dstr + (47 - i)*nch, pcma, 3);
-            vst1_lane_s16(dstr + (49 + i)*nch, pcmb, 3);
-            vst1_lane_s16(dstl + (47 - i)*nch, pcma, 2);
-            vst1_lane_s16(dstl + (49 + i)*nch, pcmb, 2);
-#endif
-#else
-            static const drmp3_f4 g_scale = { 1.0f/32768.0f, 1.0f/32768.0f, 1.0f/32768.0f, 1.0f/32768.0f };
-            a = DRMP3_VMUL(a, g_scale);
-            b = DRMP3_VMUL(b, g_scale);
-#if DRMP3_HAVE_SSE
-            _mm_store_ss(dstr + (15 - i)*nch, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)));
-            _mm_store_ss(dstr + (17 + i)*nch, _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1)));
-            _mm_store_ss(dstl + (15 - i)*nch, _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 0)));
-            _mm_store_ss(dstl + (17 + i)*nch, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)));
-            _mm_store_ss(dstr + (47 - i)*nch, _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)));
-            _mm_store_ss(dstr + (49 + i)*nch, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3)));
-            _mm_store_ss(dstl + (47 - i)*nch, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)));
-            _mm_store_ss(dstl + (49 + i)*nch, _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2)));
-#else
-            vst1q_lane_f32(dstr + (15 - i)*nch, a, 1);
-            vst1q_lane_f32(dstr + (17 + i)*nch, b, 1);
-            vst1q_lane_f32(dstl + (15 - i)*nch, a, 0);
-            vst1q_lane_f32(dstl + (17 + i)*nch, b, 0);
-            vst1q_lane_f32(dstr + (47 - i)*nch, a, 3);
-            vst1q_lane_f32(dstr + (49 + i)*nch, b, 3);
-            vst1q_lane_f32(dstl + (47 - i)*nch, a, 2);
-            vst1q_lane_f32(dstl + (49 + i)*nch, b, 2);
-#endif
-#endif /* DR_MP3_FLOAT_OUTPUT */
-        }
+        drmp3d_synth_store(dstl, dstr, nch, i, a, b);
     } else
 #endif
 #ifdef DR_MP3_ONLY_SIMD
@@ -2101,11 +3058,11 @@ static void drmp3d_synth(float *xl, drmp3d_sample_t *dstl, int nch, float *lins)
 #else
     for (i = 14; i >= 0; i--)
     {
-#define DRMP3_LOAD(k) float w0 = *w++; float w1 = *w++; float *vz = &zlin[4*i - k*64]; float *vy = &zlin[4*i - (15 - k)*64];
-#define DRMP3_S0(k) { int j; DRMP3_LOAD(k); for (j = 0; j < 4; j++) b[j]  = vz[j]*w1 + vy[j]*w0, a[j]  = vz[j]*w0 - vy[j]*w1; }
-#define DRMP3_S1(k) { int j; DRMP3_LOAD(k); for (j = 0; j < 4; j++) b[j] += vz[j]*w1 + vy[j]*w0, a[j] += vz[j]*w0 - vy[j]*w1; }
-#define DRMP3_S2(k) { int j; DRMP3_LOAD(k); for (j = 0; j < 4; j++) b[j] += vz[j]*w1 + vy[j]*w0, a[j] += vy[j]*w1 - vz[j]*w0; }
-        float a[4], b[4];
+#define DRMP3_LOAD(k) drmp3d_real_t w0 = *w++; drmp3d_real_t w1 = *w++; drmp3d_real_t *vz = &zlin[4*i - k*64]; drmp3d_real_t *vy = &zlin[4*i - (15 - k)*64];
+#define DRMP3_S0(k) { int j; DRMP3_LOAD(k); for (j = 0; j < 4; j++) b[j]  = DRMP3_ACC(vz[j])*w1 + DRMP3_ACC(vy[j])*w0, a[j]  = DRMP3_ACC(vz[j])*w0 - DRMP3_ACC(vy[j])*w1; }
+#define DRMP3_S1(k) { int j; DRMP3_LOAD(k); for (j = 0; j < 4; j++) b[j] += DRMP3_ACC(vz[j])*w1 + DRMP3_ACC(vy[j])*w0, a[j] += DRMP3_ACC(vz[j])*w0 - DRMP3_ACC(vy[j])*w1; }
+#define DRMP3_S2(k) { int j; DRMP3_LOAD(k); for (j = 0; j < 4; j++) b[j] += DRMP3_ACC(vz[j])*w1 + DRMP3_ACC(vy[j])*w0, a[j] += DRMP3_ACC(vy[j])*w1 - DRMP3_ACC(vz[j])*w0; }
+        drmp3d_acc_t a[4], b[4];
 
         zlin[4*i]     = xl[18*(31 - i)];
         zlin[4*i + 1] = xr[18*(31 - i)];
@@ -2130,19 +3087,129 @@ static void drmp3d_synth(float *xl, drmp3d_sample_t *dstl, int nch, float *lins)
 #endif
 }
 
-static void drmp3d_synth_granule(float *qmf_state, float *grbuf, int nbands, int nch, drmp3d_sample_t *pcm, float *lins)
+/*
+Synthesis at half or a quarter of the sample rate. The subbands above the new Nyquist frequency have been cleared so it's just a matter
+of decimating the output, and only the output samples that are kept are calculated. The history in zlin is still filled in completely.
+The samples are put together in stereo at the full rate first, which lets this share the conversion code with drmp3d_synth().
+*/
+static void drmp3d_synth_reduced(drmp3d_real_t *xl, drmp3d_real_t *xr, drmp3d_sample_t *dstl, drmp3d_sample_t *dstr, int nch, drmp3d_real_t *lins, const drmp3d_real_t *w, int rate_shift)
+{
+    int i, j, k;
+    drmp3d_real_t *zlin = lins + 15*64;
+    drmp3d_sample_t pcm[64*2];
+
+    drmp3d_synth_pair(pcm + 1, 2, lins + 4*15 + 1);
+    drmp3d_synth_pair(pcm + 1 + 64, 2, lins + 4*15 + 64 + 1);
+    drmp3d_synth_pair(pcm, 2, lins + 4*15);
+    drmp3d_synth_pair(pcm + 64, 2, lins + 4*15 + 64);
+
+    for (i = 14; i >= 0; i--)
+    {
+        zlin[4*i]     = xl[18*(31 - i)];
+        zlin[4*i + 1] = xr[18*(31 - i)];
+        zlin[4*i + 2] = xl[1 + 18*(31 - i)];
+        zlin[4*i + 3] = xr[1 + 18*(31 - i)];
+        zlin[4*(i + 16)]   = xl[1 + 18*(1 + i)];
+        zlin[4*(i + 16) + 1] = xr[1 + 18*(1 + i)];
+        zlin[4*(i - 16) + 2] = xl[18*(1 + i)];
+        zlin[4*(i - 16) + 3] = xr[18*(1 + i)];
+
+        if ((15 - i) & ((1 << rate_shift) - 1))
+        {
+            w += 16;
+            continue;
+        }
+
+#if DRMP3_HAVE_SIMD
+        if (drmp3_have_simd())
+        {
+            drmp3_f4 a, b;
+            DRMP3_V0(0) DRMP3_V2(1) DRMP3_V1(2) DRMP3_V2(3) DRMP3_V1(4) DRMP3_V2(5) DRMP3_V1(6) DRMP3_V2(7)
+            drmp3d_synth_store(pcm, pcm + 1, 2, i, a, b);
+        } else
+#endif
+        {
+            drmp3d_acc_t a[4], b[4];
+            for (j = 0; j < 4; j++)
+            {
+                a[j] = b[j] = 0;
+            }
+            for (k = 0; k < 8; k++, w += 2)
+            {
+                const drmp3d_real_t *vz = &zlin[4*i - k*64];
+                const drmp3d_real_t *vy = &zlin[4*i - (15 - k)*64];
+                for (j = 0; j < 4; j++)
+                {
+                    b[j] += DRMP3_ACC(vz[j])*w[1] + DRMP3_ACC(vy[j])*w[0];
+                    a[j] += (k & 1) ? DRMP3_ACC(vy[j])*w[1] - DRMP3_ACC(vz[j])*w[0] : DRMP3_ACC(vz[j])*w[0] - DRMP3_ACC(vy[j])*w[1];
+                }
+            }
+
+            pcm[(15 - i)*2 + 1] = drmp3d_scale_pcm(a[1]);
+            pcm[(17 + i)*2 + 1] = drmp3d_scale_pcm(b[1]);
+            pcm[(15 - i)*2]     = drmp3d_scale_pcm(a[0]);
+            pcm[(17 + i)*2]     = drmp3d_scale_pcm(b[0]);
+            pcm[(47 - i)*2 + 1] = drmp3d_scale_pcm(a[3]);
+            pcm[(49 + i)*2 + 1] = drmp3d_scale_pcm(b[3]);
+            pcm[(47 - i)*2]     = drmp3d_scale_pcm(a[2]);
+            pcm[(49 + i)*2]     = drmp3d_scale_pcm(b[2]);
+        }
+    }
+
+    for (i = 0; i < (64 >> rate_shift); i++)
+    {
+        dstr[i*nch] = pcm[(i << rate_shift)*2 + 1];
+        dstl[i*nch] = pcm[(i << rate_shift)*2];
+    }
+}
+
+/*
+Mixes the two channels of a granule down to mono. The synthesis filter is linear so this gives the same result as averaging the
+output of both channels, but only one channel has to be synthesized.
+*/
+static void drmp3d_downmix(drmp3d_real_t *left, int n)
+{
+    int i = 0;
+    drmp3d_real_t *right = left + 576;
+#if DRMP3_HAVE_SIMD
+    if (drmp3_have_simd()) for (; i < n - 3; i += 4)
+    {
+        DRMP3_VSTORE(left + i, DRMP3_VMUL_S(DRMP3_VADD(DRMP3_VLD(left + i), DRMP3_VLD(right + i)), 0.5f));
+    }
+#endif
+    for (; i < n; i++)
+    {
+        left[i] = DRMP3_MUL(left[i] + right[i], DRMP3_REAL(0.5f));
+    }
+}
+
+static void drmp3d_synth_granule(drmp3d_real_t *qmf_state, drmp3d_real_t *grbuf, int nbands, int nch, drmp3d_sample_t *pcm, drmp3d_real_t *lins, int rate_shift)
 {
     int i;
+    if (rate_shift)
+    {
+        for (i = 0; i < nch; i++)
+        {
+            memset(grbuf + 576*i + 18*(32 >> rate_shift), 0, sizeof(drmp3d_real_t)*(576 - 18*(32 >> rate_shift)));
+        }
+    }
+#ifdef DR_MP3_FIXED_POINT
+    for (i = 0; i < 576*nch; i++)
+    {
+        grbuf[i] = DRMP3_MIN(DRMP3_MAX(grbuf[i], -DRMP3_DCT_MAX), DRMP3_DCT_MAX);
+    }
+#endif
     for (i = 0; i < nch; i++)
     {
         drmp3d_DCT_II(grbuf + 576*i, nbands);
     }
 
-    memcpy(lins, qmf_state, sizeof(float)*15*64);
+    memcpy(lins, qmf_state, sizeof(drmp3d_real_t)*15*64);
 
     for (i = 0; i < nbands; i += 2)
     {
-        drmp3d_synth(grbuf + i, pcm + 32*nch*i, nch, lins + i*64);
+        drmp3d_sample_t *dst = pcm + (32 >> rate_shift)*nch*i;
+        drmp3d_synth(grbuf + i, grbuf + i + 576*(nch - 1), dst, dst + (nch - 1), nch, lins + i*64, rate_shift);
     }
 #ifndef DR_MP3_NONSTANDARD_BUT_LOGICAL
     if (nch == 1)
@@ -2154,28 +3221,111 @@ static void drmp3d_synth_granule(float *qmf_state, float *grbuf, int nbands, int
     } else
 #endif
     {
-        memcpy(qmf_state, lins + nbands*64, sizeof(float)*15*64);
+        memcpy(qmf_state, lins + nbands*64, sizeof(drmp3d_real_t)*15*64);
     }
 }
 
-static int drmp3d_match_frame(const drmp3_uint8 *hdr, int mp3_bytes, int frame_bytes)
+/*
+Synthesizes a granule of two mono streams at once. The first stream goes through the lanes of the left channel and the second through
+the lanes of the right, so the filter does the same amount of work as it does for one stream. A mono stream only keeps history in the
+even entries of qmf_state, which are interleaved into lins the same way as the two channels of a stereo stream.
+*/
+static void drmp3d_synth_granule_pair(drmp3d_real_t *qmf_state0, drmp3d_real_t *qmf_state1, drmp3d_real_t *grbuf0, drmp3d_real_t *grbuf1, int nbands, drmp3d_sample_t *pcm0, drmp3d_sample_t *pcm1, drmp3d_real_t *lins)
 {
-    int i, nmatch;
-    for (i = 0, nmatch = 0; nmatch < DRMP3_MAX_FRAME_SYNC_MATCHES; nmatch++)
+    int i;
+#ifdef DR_MP3_FIXED_POINT
+    for (i = 0; i < 576; i++)
     {
-        i += drmp3_hdr_frame_bytes(hdr + i, frame_bytes) + drmp3_hdr_padding(hdr + i);
-        if (i + DRMP3_HDR_SIZE > mp3_bytes)
-            return nmatch > 0;
-        if (!drmp3_hdr_compare(hdr, hdr + i))
-            return 0;
+        grbuf0[i] = DRMP3_MIN(DRMP3_MAX(grbuf0[i], -DRMP3_DCT_MAX), DRMP3_DCT_MAX);
+        grbuf1[i] = DRMP3_MIN(DRMP3_MAX(grbuf1[i], -DRMP3_DCT_MAX), DRMP3_DCT_MAX);
+    }
+#endif
+    drmp3d_DCT_II(grbuf0, nbands);
+    drmp3d_DCT_II(grbuf1, nbands);
+
+    for (i = 0; i < 15*64; i += 2)
+    {
+        lins[i]     = qmf_state0[i];
+        lins[i + 1] = qmf_state1[i];
+    }
+
+    for (i = 0; i < nbands; i += 2)
+    {
+        drmp3d_synth(grbuf0 + i, grbuf1 + i, pcm0 + 32*i, pcm1 + 32*i, 1, lins + i*64, 0);
+    }
+
+    for (i = 0; i < 15*64; i += 2)
+    {
+        qmf_state0[i] = lins[nbands*64 + i];
+        qmf_state1[i] = lins[nbands*64 + i + 1];
+#ifdef DR_MP3_NONSTANDARD_BUT_LOGICAL
+        qmf_state0[i + 1] = qmf_state0[i];
+        qmf_state1[i + 1] = qmf_state1[i];
+#endif
     }
-    return 1;
 }
 
-static int drmp3d_find_frame(const drmp3_uint8 *mp3, int mp3_bytes, int *free_format_bytes, int *ptr_frame_bytes)
+/*
+Returns the size in bytes of an ID3v2, ID3v1 or APEv2 tag starting at the given position, or 0 if there isn't one. The size of an
+ID3v2 or APEv2 tag comes from its header and can be larger than the number of bytes available, which is needed for skipping tags
+that don't fit in the input buffer. ID3v1 tags have a fixed size and are only recognized when all of it is available. This includes
+the 227 byte extended "TAG+" block, which always comes right before a regular ID3v1 tag. For APEv2 this only recognizes the header
+since a footer is only found at the start of a tag when there is no header, in which case the items come first and cannot be
+recognized anyway.
+*/
+static int drmp3d_tag_size_declared(const drmp3_uint8 *p, int bytes)
 {
-    int i, k;
-    for (i = 0; i < mp3_bytes - DRMP3_HDR_SIZE; i++, mp3++)
+    if (bytes >= 10 && p[0] == 'I' && p[1] == 'D' && p[2] == '3' && p[3] != 0xFF && p[4] != 0xFF &&
+        !((p[6] | p[7] | p[8] | p[9]) & 0x80))
+    {
+        int size = (p[6] << 21) | (p[7] << 14) | (p[8] << 7) | p[9];    /* Syncsafe. */
+        return 10 + size + ((p[5] & 0x10) ? 10 : 0);                    /* 10 byte header, plus a 10 byte footer if the flag is set. */
+    }
+    if (bytes >= 32 && !memcmp(p, "APETAGEX", 8))
+    {
+        drmp3_uint32 size  = (drmp3_uint32)p[12] | ((drmp3_uint32)p[13] << 8) | ((drmp3_uint32)p[14] << 16) | ((drmp3_uint32)p[15] << 24);
+        drmp3_uint32 flags = (drmp3_uint32)p[20] | ((drmp3_uint32)p[21] << 8) | ((drmp3_uint32)p[22] << 16) | ((drmp3_uint32)p[23] << 24);
+        if (!(flags & 0x20000000))
+            return 32;  /* A lone footer. */
+        if (size > 0x7FFFFFFF - 32)
+            return 0;
+        return 32 + (int)size;  /* The size includes the items and footer, but not the header. */
+    }
+    if (bytes >= 128 && p[0] == 'T' && p[1] == 'A' && p[2] == 'G')
+    {
+        /* The title of a regular ID3v1 tag can start with a '+' so the extended block is only trusted when the regular tag follows it. */
+        if (p[3] == '+' && bytes >= 227 + 128 && p[227] == 'T' && p[228] == 'A' && p[229] == 'G')
+            return 227;
+        return 128;
+    }
+    return 0;
+}
+
+/* Like drmp3d_tag_size_declared(), but never more than the number of bytes available. */
+static int drmp3d_tag_size(const drmp3_uint8 *p, int bytes)
+{
+    int size = drmp3d_tag_size_declared(p, bytes);
+    return (size > bytes) ? bytes : size;
+}
+
+static int drmp3d_match_frame(const drmp3_uint8 *hdr, int mp3_bytes, int frame_bytes)
+{
+    int i, nmatch;
+    for (i = 0, nmatch = 0; nmatch < DRMP3_MAX_FRAME_SYNC_MATCHES; nmatch++)
+    {
+        i += drmp3_hdr_frame_bytes(hdr + i, frame_bytes) + drmp3_hdr_padding(hdr + i);
+        if (i + DRMP3_HDR_SIZE > mp3_bytes)
+            return nmatch > 0;
+        if (!drmp3_hdr_compare(hdr, hdr + i))
+            return drmp3d_tag_size(hdr + i, mp3_bytes - i) != 0;   /* The last frame of a stream is followed by a tag rather than another frame. */
+    }
+    return 1;
+}
+
+static int drmp3d_find_frame(const drmp3_uint8 *mp3, int mp3_bytes, int *free_format_bytes, int *ptr_frame_bytes)
+{
+    int i, k;
+    for (i = 0; i < mp3_bytes - DRMP3_HDR_SIZE; i++, mp3++)
     {
         if (drmp3_hdr_valid(mp3))
         {
@@ -2215,17 +3365,19 @@ DRMP3_API void drmp3dec_init(drmp3dec *dec)
     dec->header[0] = 0;
 }
 
-DRMP3_API int drmp3dec_decode_frame(drmp3dec *dec, const drmp3_uint8 *mp3, int mp3_bytes, void *pcm, drmp3dec_frame_info *info)
+/*
+Finds the frame at the start of mp3, or the next one along if the decoder isn't in sync, and fills in the frame info. Returns the
+header of the frame with bs_frame set up to read what comes after it, or NULL if there isn't a whole frame in mp3.
+*/
+static const drmp3_uint8 *drmp3dec_sync_frame(drmp3dec *dec, const drmp3_uint8 *mp3, int mp3_bytes, drmp3dec_frame_info *info, drmp3_bs *bs_frame)
 {
-    int i = 0, igr, frame_size = 0, success = 1;
+    int i = 0, frame_size = 0;
     const drmp3_uint8 *hdr;
-    drmp3_bs bs_frame[1];
-    drmp3dec_scratch scratch;
 
     if (mp3_bytes > 4 && dec->header[0] == 0xff && drmp3_hdr_compare(dec->header, mp3))
     {
         frame_size = drmp3_hdr_frame_bytes(mp3, dec->free_format_bytes) + drmp3_hdr_padding(mp3);
-        if (frame_size != mp3_bytes && (frame_size + DRMP3_HDR_SIZE > mp3_bytes || !drmp3_hdr_compare(mp3, mp3 + frame_size)))
+        if (frame_size != mp3_bytes && (frame_size + DRMP3_HDR_SIZE > mp3_bytes || (!drmp3_hdr_compare(mp3, mp3 + frame_size) && !drmp3d_tag_size(mp3 + frame_size, mp3_bytes - frame_size))))
         {
             frame_size = 0;
         }
@@ -2237,7 +3389,7 @@ DRMP3_API int drmp3dec_decode_frame(drmp3dec *dec, const drmp3_uint8 *mp3, int m
         if (!frame_size || i + frame_size > mp3_bytes)
         {
             info->frame_bytes = i;
-            return 0;
+            return NULL;
         }
     }
 
@@ -2255,48 +3407,96 @@ DRMP3_API int drmp3dec_decode_frame(drmp3dec *dec, const drmp3_uint8 *mp3, int m
         drmp3_bs_get_bits(bs_frame, 16);
     }
 
+    return hdr;
+}
+
+/*
+Reads the side info of a Layer III frame and moves its main data into the bit reservoir. Returns 1 if the frame can be decoded, 0 if
+the main data it refers to hasn't been seen, and -1 if the frame is corrupt, in which case the decoder has been reset.
+*/
+static int drmp3dec_L3_begin_frame(drmp3dec *dec, drmp3_bs *bs_frame, drmp3dec_scratch *scratch, const drmp3_uint8 *hdr)
+{
+    int main_data_begin = drmp3_L3_read_side_info(bs_frame, scratch->gr_info, hdr);
+    if (main_data_begin < 0 || bs_frame->pos > bs_frame->limit)
+    {
+        drmp3dec_init(dec);
+        return -1;
+    }
+    /* Intensity stereo reads as many positions as the left channel has bands, which can be more than a corrupt right channel wrote. */
+    memset(scratch->ist_pos, 0, sizeof(scratch->ist_pos));
+    return drmp3_L3_restore_reservoir(dec, bs_frame, scratch, main_data_begin);
+}
+
+static void drmp3dec_L3_decode_granules(drmp3dec *dec, drmp3dec_scratch *scratch, void *pcm, int channels, int skip_synth, int rate_shift, int downmix)
+{
+    int igr, nch = downmix ? 1 : channels;
+    for (igr = 0; igr < (DRMP3_HDR_TEST_MPEG1(dec->header) ? 2 : 1); igr++, pcm = DRMP3_OFFSET_PTR(pcm, sizeof(drmp3d_sample_t)*(576 >> rate_shift)*nch))
+    {
+        memset(scratch->grbuf[0], 0, 576*2*sizeof(drmp3d_real_t));
+        drmp3_L3_decode(dec, scratch, scratch->gr_info + igr*channels, channels, 32 >> rate_shift);
+        if (!skip_synth)
+        {
+            if (nch != channels)
+            {
+                drmp3d_downmix(scratch->grbuf[0], 576);
+            }
+            drmp3d_synth_granule(dec->qmf_state, scratch->grbuf[0], 18, nch, (drmp3d_sample_t*)pcm, scratch->syn[0], rate_shift);
+        }
+    }
+}
+
+/*
+Decodes the frame found by drmp3dec_sync_frame(). See drmp3dec_decode_frame_ex() for the parameters. The scratch space is passed in so
+that drmp3dec_decode_frame_batch() can share its own.
+*/
+static int drmp3dec_decode_synced_frame(drmp3dec *dec, const drmp3_uint8 *hdr, drmp3_bs *bs_frame, drmp3dec_scratch *scratch, void *pcm, drmp3dec_frame_info *info, int skip_synth, int rate_shift, int downmix)
+{
+    int success = 1;
+
     if (info->layer == 3)
     {
-        int main_data_begin = drmp3_L3_read_side_info(bs_frame, scratch.gr_info, hdr);
-        if (main_data_begin < 0 || bs_frame->pos > bs_frame->limit)
+        success = drmp3dec_L3_begin_frame(dec, bs_frame, scratch, hdr);
+        if (success < 0)
         {
-            drmp3dec_init(dec);
             return 0;
         }
-        success = drmp3_L3_restore_reservoir(dec, bs_frame, &scratch, main_data_begin);
         if (success && pcm != NULL)
         {
-            for (igr = 0; igr < (DRMP3_HDR_TEST_MPEG1(hdr) ? 2 : 1); igr++, pcm = DRMP3_OFFSET_PTR(pcm, sizeof(drmp3d_sample_t)*576*info->channels))
-            {
-                memset(scratch.grbuf[0], 0, 576*2*sizeof(float));
-                drmp3_L3_decode(dec, &scratch, scratch.gr_info + igr*info->channels, info->channels);
-                drmp3d_synth_granule(dec->qmf_state, scratch.grbuf[0], 18, info->channels, (drmp3d_sample_t*)pcm, scratch.syn[0]);
-            }
+            drmp3dec_L3_decode_granules(dec, scratch, pcm, info->channels, skip_synth, rate_shift, downmix);
         }
-        drmp3_L3_save_reservoir(dec, &scratch);
+        drmp3_L3_save_reservoir(dec, scratch);
     } else
     {
 #ifdef DR_MP3_ONLY_MP3
         return 0;
 #else
         drmp3_L12_scale_info sci[1];
+        int i, igr, nch = downmix ? 1 : info->channels;
 
         if (pcm == NULL) {
-            return drmp3_hdr_frame_samples(hdr);
+            if (!drmp3_L12_samples_fit(hdr, bs_frame)) {
+                drmp3dec_init(dec);
+                return 0;
+            }
+            return drmp3_hdr_frame_samples(hdr) >> rate_shift;
         }
 
         drmp3_L12_read_scale_info(hdr, bs_frame, sci);
 
-        memset(scratch.grbuf[0], 0, 576*2*sizeof(float));
+        memset(scratch->grbuf[0], 0, 576*2*sizeof(drmp3d_real_t));
         for (i = 0, igr = 0; igr < 3; igr++)
         {
-            if (12 == (i += drmp3_L12_dequantize_granule(scratch.grbuf[0] + i, bs_frame, sci, info->layer | 1)))
+            if (12 == (i += drmp3_L12_dequantize_granule(scratch->grbuf[0] + i, bs_frame, sci, info->layer | 1)))
             {
                 i = 0;
-                drmp3_L12_apply_scf_384(sci, sci->scf + igr, scratch.grbuf[0]);
-                drmp3d_synth_granule(dec->qmf_state, scratch.grbuf[0], 12, info->channels, (drmp3d_sample_t*)pcm, scratch.syn[0]);
-                memset(scratch.grbuf[0], 0, 576*2*sizeof(float));
-                pcm = DRMP3_OFFSET_PTR(pcm, sizeof(drmp3d_sample_t)*384*info->channels);
+                drmp3_L12_apply_scf_384(sci, sci->scf + igr, scratch->grbuf[0]);
+                if (nch != info->channels)
+                {
+                    drmp3d_downmix(scratch->grbuf[0], 576);
+                }
+                drmp3d_synth_granule(dec->qmf_state, scratch->grbuf[0], 12, nch, (drmp3d_sample_t*)pcm, scratch->syn[0], rate_shift);
+                memset(scratch->grbuf[0], 0, 576*2*sizeof(drmp3d_real_t));
+                pcm = DRMP3_OFFSET_PTR(pcm, sizeof(drmp3d_sample_t)*(384 >> rate_shift)*nch);
             }
             if (bs_frame->pos > bs_frame->limit)
             {
@@ -2307,7 +3507,205 @@ DRMP3_API int drmp3dec_decode_frame(drmp3dec *dec, const drmp3_uint8 *mp3, int m
 #endif
     }
 
-    return success*drmp3_hdr_frame_samples(dec->header);
+    return success*(drmp3_hdr_frame_samples(dec->header) >> rate_shift);
+}
+
+/*
+When skip_synth is set, Layer III granules are only decoded as far as the IMDCT so that the overlap is carried into the next frame,
+and nothing is written to pcm. This is used for the frames leading up to a seek target. Layer I and II frames are always synthesized
+since a Layer I frame is too short to fill the synthesis filter on its own.
+
+A rate_shift of 1 or 2 only decodes the lower 16 or 8 subbands and outputs the frame at half or a quarter of its sample rate. The
+return value is the number of samples per channel that were output. The frame info is not affected.
+
+When downmix is set, stereo frames are mixed down to mono just before synthesis and are output as a single channel. The frame info
+still has the channel count of the frame. The synthesis filter keeps a single channel of history while this is set.
+*/
+static int drmp3dec_decode_frame_ex(drmp3dec *dec, const drmp3_uint8 *mp3, int mp3_bytes, void *pcm, drmp3dec_frame_info *info, int skip_synth, int rate_shift, int downmix)
+{
+    const drmp3_uint8 *hdr;
+    drmp3_bs bs_frame[1];
+    drmp3dec_scratch scratch;
+
+    hdr = drmp3dec_sync_frame(dec, mp3, mp3_bytes, info, bs_frame);
+    if (hdr == NULL)
+    {
+        return 0;
+    }
+
+    return drmp3dec_decode_synced_frame(dec, hdr, bs_frame, &scratch, pcm, info, skip_synth, rate_shift, downmix);
+}
+
+DRMP3_API int drmp3dec_decode_frame(drmp3dec *dec, const drmp3_uint8 *mp3, int mp3_bytes, void *pcm, drmp3dec_frame_info *info)
+{
+    return drmp3dec_decode_frame_ex(dec, mp3, mp3_bytes, pcm, info, 0, 0, 0);
+}
+
+/* Decodes two mono Layer III frames that have been through drmp3dec_sync_frame(), synthesizing them together when both can be decoded. */
+static void drmp3dec_L3_decode_pair(drmp3dec_batch_item *a, drmp3_bs *bs_a, const drmp3_uint8 *hdr_a, drmp3dec_batch_item *b, drmp3_bs *bs_b, const drmp3_uint8 *hdr_b, drmp3dec_scratch *scratch)
+{
+    int success_a = drmp3dec_L3_begin_frame(a->dec, bs_a, &scratch[0], hdr_a);
+    int success_b = drmp3dec_L3_begin_frame(b->dec, bs_b, &scratch[1], hdr_b);
+
+    if (success_a > 0 && success_b > 0)
+    {
+        int igr;
+        drmp3d_sample_t *pcm_a = (drmp3d_sample_t*)a->pcm, *pcm_b = (drmp3d_sample_t*)b->pcm;
+        for (igr = 0; igr < (DRMP3_HDR_TEST_MPEG1(hdr_a) ? 2 : 1); igr++, pcm_a += 576, pcm_b += 576)
+        {
+            memset(scratch[0].grbuf[0], 0, 576*2*sizeof(drmp3d_real_t));
+            memset(scratch[1].grbuf[0], 0, 576*2*sizeof(drmp3d_real_t));
+            drmp3_L3_decode(a->dec, &scratch[0], scratch[0].gr_info + igr, 1, 32);
+            drmp3_L3_decode(b->dec, &scratch[1], scratch[1].gr_info + igr, 1, 32);
+            drmp3d_synth_granule_pair(a->dec->qmf_state, b->dec->qmf_state, scratch[0].grbuf[0], scratch[1].grbuf[0], 18, pcm_a, pcm_b, scratch[0].syn[0]);
+        }
+    } else
+    {
+        if (success_a > 0)
+        {
+            drmp3dec_L3_decode_granules(a->dec, &scratch[0], a->pcm, 1, 0, 0, 0);
+        }
+        if (success_b > 0)
+        {
+            drmp3dec_L3_decode_granules(b->dec, &scratch[1], b->pcm, 1, 0, 0, 0);
+        }
+    }
+
+    if (success_a >= 0)
+    {
+        drmp3_L3_save_reservoir(a->dec, &scratch[0]);
+    }
+    if (success_b >= 0)
+    {
+        drmp3_L3_save_reservoir(b->dec, &scratch[1]);
+    }
+    a->samples = success_a > 0 ? (int)drmp3_hdr_frame_samples(hdr_a) : 0;
+    b->samples = success_b > 0 ? (int)drmp3_hdr_frame_samples(hdr_b) : 0;
+}
+
+DRMP3_API void drmp3dec_decode_frame_batch(drmp3dec_batch_item *items, int count)
+{
+    /* A mono Layer III frame is held back until there's another one with the same number of granules to pair it with. */
+    drmp3dec_scratch scratch[2];
+    drmp3dec_batch_item *pending = NULL;
+    const drmp3_uint8 *pending_hdr = NULL;
+    drmp3_bs pending_bs[1];
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        drmp3dec_batch_item *item = &items[i];
+        drmp3_bs bs_frame[1];
+        const drmp3_uint8 *hdr = drmp3dec_sync_frame(item->dec, item->mp3, item->mp3_bytes, &item->info, bs_frame);
+        if (hdr == NULL)
+        {
+            item->samples = 0;
+            continue;
+        }
+
+        if (item->info.layer != 3 || item->info.channels != 1 || item->pcm == NULL)
+        {
+            item->samples = drmp3dec_decode_synced_frame(item->dec, hdr, bs_frame, &scratch[0], item->pcm, &item->info, 0, 0, 0);
+            continue;
+        }
+
+        if (pending != NULL && DRMP3_HDR_TEST_MPEG1(pending_hdr) == DRMP3_HDR_TEST_MPEG1(hdr))
+        {
+            drmp3dec_L3_decode_pair(pending, pending_bs, pending_hdr, item, bs_frame, hdr, scratch);
+            pending = NULL;
+            continue;
+        }
+
+        if (pending != NULL)
+        {
+            pending->samples = drmp3dec_decode_synced_frame(pending->dec, pending_hdr, pending_bs, &scratch[0], pending->pcm, &pending->info, 0, 0, 0);
+        }
+
+        pending = item;
+        pending_hdr = hdr;
+        pending_bs[0] = bs_frame[0];
+    }
+
+    if (pending != NULL)
+    {
+        pending->samples = drmp3dec_decode_synced_frame(pending->dec, pending_hdr, pending_bs, &scratch[0], pending->pcm, &pending->info, 0, 0, 0);
+    }
+}
+
+/*
+This is the same as drmp3dec_decode_frame() with a NULL output buffer, except that for Layer III it only keeps track of how full the
+bit reservoir is rather than filling it. The return value and the frame info are identical, but it avoids all of the data movement of
+the reservoir. The decoder must be reinitialized before decoding any audio after scanning.
+*/
+static int drmp3dec_scan_frame(drmp3dec *dec, const drmp3_uint8 *mp3, int mp3_bytes, drmp3dec_frame_info *info)
+{
+    int i = 0, frame_size = 0;
+    const drmp3_uint8 *hdr;
+    drmp3_bs bs_frame[1];
+
+    if (mp3_bytes > 4 && dec->header[0] == 0xff && drmp3_hdr_compare(dec->header, mp3))
+    {
+        frame_size = drmp3_hdr_frame_bytes(mp3, dec->free_format_bytes) + drmp3_hdr_padding(mp3);
+        if (frame_size != mp3_bytes && (frame_size + DRMP3_HDR_SIZE > mp3_bytes || (!drmp3_hdr_compare(mp3, mp3 + frame_size) && !drmp3d_tag_size(mp3 + frame_size, mp3_bytes - frame_size))))
+        {
+            frame_size = 0;
+        }
+    }
+    if (!frame_size)
+    {
+        memset(dec, 0, sizeof(drmp3dec));
+        i = drmp3d_find_frame(mp3, mp3_bytes, &dec->free_format_bytes, &frame_size);
+        if (!frame_size || i + frame_size > mp3_bytes)
+        {
+            info->frame_bytes = i;
+            return 0;
+        }
+    }
+
+    hdr = mp3 + i;
+    memcpy(dec->header, hdr, DRMP3_HDR_SIZE);
+    info->frame_bytes = i + frame_size;
+    info->channels = DRMP3_HDR_IS_MONO(hdr) ? 1 : 2;
+    info->hz = drmp3_hdr_sample_rate_hz(hdr);
+    info->layer = 4 - DRMP3_HDR_GET_LAYER(hdr);
+    info->bitrate_kbps = drmp3_hdr_bitrate_kbps(hdr);
+
+    drmp3_bs_init(bs_frame, hdr + DRMP3_HDR_SIZE, frame_size - DRMP3_HDR_SIZE);
+    if (DRMP3_HDR_IS_CRC(hdr))
+    {
+        drmp3_bs_get_bits(bs_frame, 16);
+    }
+
+    if (info->layer == 3)
+    {
+        drmp3_L3_gr_info gr_info[4];
+        int main_data_begin, bytes_have, success;
+
+        main_data_begin = drmp3_L3_read_side_info(bs_frame, gr_info, hdr);
+        if (main_data_begin < 0 || bs_frame->pos > bs_frame->limit)
+        {
+            drmp3dec_init(dec);
+            return 0;
+        }
+
+        /* Mirrors drmp3_L3_restore_reservoir() followed by drmp3_L3_save_reservoir() when nothing is consumed. */
+        bytes_have  = DRMP3_MIN(dec->reserv, main_data_begin);
+        success     = dec->reserv >= main_data_begin;
+        dec->reserv = DRMP3_MIN(bytes_have + (bs_frame->limit - bs_frame->pos)/8, DRMP3_MAX_BITRESERVOIR_BYTES);
+
+        return success*drmp3_hdr_frame_samples(hdr);
+    }
+
+#ifdef DR_MP3_ONLY_MP3
+    return 0;
+#else
+    if (!drmp3_L12_samples_fit(hdr, bs_frame))
+    {
+        drmp3dec_init(dec);
+        return 0;
+    }
+    return drmp3_hdr_frame_samples(hdr);
+#endif
 }
 
 DRMP3_API void drmp3dec_f32_to_s16(const float *in, drmp3_int16 *out, size_t num_samples)
@@ -2390,11 +3788,40 @@ DRMP3_API void drmp3dec_f32_to_s16(const float *in, drmp3_int16 *out, size_t num
 #define DRMP3_SEEK_LEADING_MP3_FRAMES   2
 #endif
 
+/* The maximum number of filter phases for sample rate conversion. Used when the two rates don't have a large enough common factor. */
+#ifndef DRMP3_RESAMPLER_MAX_PHASES
+#define DRMP3_RESAMPLER_MAX_PHASES      1024
+#endif
+
+/* The number of zero crossings on each side of the sample rate conversion filter. Higher gives a sharper cutoff but is slower. */
+#ifndef DRMP3_RESAMPLER_ZERO_CROSSINGS
+#define DRMP3_RESAMPLER_ZERO_CROSSINGS  16
+#endif
+
+#define DRMP3_RESAMPLER_MAX_TAPS        512
+#define DRMP3_RESAMPLER_CUTOFF          0.92    /* The cutoff of the filter relative to the lower of the two Nyquist frequencies. */
+#define DRMP3_CONVERTER_CHUNK_FRAMES    1024    /* The number of input frames the converter reads at a time. */
+
+/* Flags for drmp3_decode_next_frame_ex__callbacks() and drmp3_decode_next_frame_ex__memory(). */
+#define DRMP3_FRAME_FLAG_SCAN_ONLY      0x00000001  /* Only parse headers and side info. No audio is decoded. */
+#define DRMP3_FRAME_FLAG_WARM_UP        0x00000002  /* Frames missing bit reservoir data are returned as silence rather than being skipped. */
+#define DRMP3_FRAME_FLAG_NO_SYNTH       0x00000004  /* Layer III frames are decoded up to the IMDCT but no PCM frames are output. See drmp3dec_decode_frame_ex(). */
+
 #define DRMP3_MIN_DATA_CHUNK_SIZE   16384
+#define DRMP3_MIN_INPUT_BUFFER_SIZE 8192    /* The smallest input buffer. Still comfortably larger than the biggest MP3 frame. */
+#define DRMP3_MAX_ICY_METADATA_SIZE (255*16)    /* The length byte of an ICY metadata block counts in 16 byte units. */
 
-/* The size in bytes of each chunk of data to read from the MP3 stream. minimp3 recommends at least 16K, but in an attempt to reduce data movement I'm making this slightly larger. */
+/*
+The default size in bytes of the buffer that data from the MP3 stream is read into. This is the 16K minimp3 recommends, which is enough now that
+buffered data is no longer moved down before each read. The ring mirrors up to DRMP3_MIN_DATA_CHUNK_SIZE bytes past its end so the allocation is
+twice this. Decoders that want fewer, larger reads can raise it with drmp3_set_input_buffer_size().
+*/
 #ifndef DRMP3_DATA_CHUNK_SIZE
-#define DRMP3_DATA_CHUNK_SIZE  DRMP3_MIN_DATA_CHUNK_SIZE*4
+#if defined(DR_MP3_COMPACT)
+#define DRMP3_DATA_CHUNK_SIZE  DRMP3_MIN_INPUT_BUFFER_SIZE
+#else
+#define DRMP3_DATA_CHUNK_SIZE  DRMP3_MIN_DATA_CHUNK_SIZE
+#endif
 #endif
 
 
@@ -2631,114 +4058,376 @@ static drmp3_bool32 drmp3__on_seek_64(drmp3* pMP3, drmp3_uint64 offset, drmp3_se
 }
 
 
-static drmp3_uint32 drmp3_decode_next_frame_ex__callbacks(drmp3* pMP3, drmp3d_sample_t* pPCMFrames)
+static drmp3_uint64 drmp3__get_next_frame_pos(drmp3* pMP3);
+
+static DRMP3_INLINE drmp3_uint32 drmp3__get_decoded_sample_rate(const drmp3* pMP3, drmp3_uint32 sampleRate)
 {
-    drmp3_uint32 pcmFramesRead = 0;
+    /* The sample rate of the output of the decoder, rounded to the nearest whole number. See drmp3_set_decode_quality(). */
+    return (sampleRate + ((1U << pMP3->decodeQuality.rateShift) >> 1)) >> pMP3->decodeQuality.rateShift;
+}
 
-    DRMP3_ASSERT(pMP3 != NULL);
-    DRMP3_ASSERT(pMP3->onRead != NULL);
+static DRMP3_INLINE drmp3_uint32 drmp3__get_decoded_channels(const drmp3* pMP3, drmp3_uint32 channels)
+{
+    /* The channel count of the output of the decoder. See drmp3_set_output_format(). */
+    return pMP3->converter.isDownmixing ? 1 : channels;
+}
 
-    if (pMP3->atEnd) {
+static drmp3_uint32 drmp3__get_starved_frame_sample_count(drmp3* pMP3, drmp3d_sample_t* pPCMFrames, const drmp3dec_frame_info* pInfo, drmp3_uint32 flags)
+{
+    /*
+    A Layer III frame that was found, but could not be decoded because the main data it refers to in the bit reservoir has not been
+    seen, will have its header stored in the decoder. Anything else, such as junk between frames, will have cleared it. When warming
+    up after a seek the frame still needs to be counted or else we'll lose track of where we are in the stream.
+    */
+    drmp3_uint32 pcmFrameCount;
+
+    if ((flags & DRMP3_FRAME_FLAG_WARM_UP) == 0 || pMP3->decoder.header[0] != 0xFF) {
         return 0;
     }
 
-    for (;;) {
-        drmp3dec_frame_info info;
+    pcmFrameCount = drmp3_hdr_frame_samples(pMP3->decoder.header) >> pMP3->decodeQuality.rateShift;
+    if (pPCMFrames != NULL) {
+        DRMP3_ZERO_MEMORY(pPCMFrames, pcmFrameCount * drmp3__get_decoded_channels(pMP3, pInfo->channels) * sizeof(drmp3d_sample_t));
+    }
 
-        /* minimp3 recommends doing data submission in chunks of at least 16K. If we don't have at least 16K bytes available, get more. */
-        if (pMP3->dataSize < DRMP3_MIN_DATA_CHUNK_SIZE) {
-            size_t bytesRead;
+    return pcmFrameCount;
+}
 
-            /* First we need to move the data down. */
-            memmove(pMP3->pData, pMP3->pData + pMP3->dataConsumed, pMP3->dataSize);
-            pMP3->dataConsumed = 0;
+static DRMP3_INLINE size_t drmp3__get_data_mirror_size(size_t dataCapacity)
+{
+    return DRMP3_MIN(dataCapacity, DRMP3_MIN_DATA_CHUNK_SIZE);
+}
 
-            if (pMP3->dataCapacity < DRMP3_DATA_CHUNK_SIZE) {
-                drmp3_uint8* pNewData;
-                size_t newDataCap;
+static void drmp3__mirror_data(drmp3* pMP3, size_t offset, size_t size)
+{
+    /* Bytes written to the start of the ring are copied past its end so frames that wrap around stay contiguous. */
+    size_t mirrorSize = drmp3__get_data_mirror_size(pMP3->dataCapacity);
 
-                newDataCap = DRMP3_DATA_CHUNK_SIZE;
+    if (offset < mirrorSize) {
+        if (size > mirrorSize - offset) {
+            size = mirrorSize - offset;
+        }
 
-                pNewData = (drmp3_uint8*)drmp3__realloc_from_callbacks(pMP3->pData, newDataCap, pMP3->dataCapacity, &pMP3->allocationCallbacks);
-                if (pNewData == NULL) {
-                    return 0; /* Out of memory. */
-                }
+        DRMP3_COPY_MEMORY(pMP3->pData + pMP3->dataCapacity + offset, pMP3->pData + offset, size);
+    }
+}
 
-                pMP3->pData = pNewData;
-                pMP3->dataCapacity = newDataCap;
-            }
+static void drmp3__copy_unread_data(const drmp3* pMP3, drmp3_uint8* pDst)
+{
+    /* Copies the unread data out of the ring in order. */
+    size_t firstPartSize;
 
-            bytesRead = drmp3__on_read(pMP3, pMP3->pData + pMP3->dataSize, (pMP3->dataCapacity - pMP3->dataSize));
-            if (bytesRead == 0) {
-                if (pMP3->dataSize == 0) {
-                    pMP3->atEnd = DRMP3_TRUE;
-                    return 0; /* No data. */
-                }
-            }
+    if (pMP3->dataSize == 0) {
+        return;
+    }
 
-            pMP3->dataSize += bytesRead;
-        }
+    firstPartSize = pMP3->dataCapacity - pMP3->dataConsumed;
+    if (firstPartSize > pMP3->dataSize) {
+        firstPartSize = pMP3->dataSize;
+    }
 
-        if (pMP3->dataSize > INT_MAX) {
-            pMP3->atEnd = DRMP3_TRUE;
-            return 0; /* File too big. */
-        }
+    DRMP3_COPY_MEMORY(pDst, pMP3->pData + pMP3->dataConsumed, firstPartSize);
+    DRMP3_COPY_MEMORY(pDst + firstPartSize, pMP3->pData, pMP3->dataSize - firstPartSize);
+}
 
-        pcmFramesRead = drmp3dec_decode_frame(&pMP3->decoder, pMP3->pData + pMP3->dataConsumed, (int)pMP3->dataSize, pPCMFrames, &info);    /* <-- Safe size_t -> int conversion thanks to the check above. */
+static void drmp3__reverse_bytes(drmp3_uint8* p, size_t size)
+{
+    size_t i;
 
-        /* Consume the data. */
-        if (info.frame_bytes > 0) {
-            pMP3->dataConsumed += (size_t)info.frame_bytes;
-            pMP3->dataSize     -= (size_t)info.frame_bytes;
-        }
+    for (i = 0; i < size/2; i += 1) {
+        drmp3_uint8 t = p[i];
+        p[i] = p[size - i - 1];
+        p[size - i - 1] = t;
+    }
+}
 
-        /* pcmFramesRead will be equal to 0 if decoding failed. If it is zero and info.frame_bytes > 0 then we have successfully decoded the frame. */
-        if (pcmFramesRead > 0) {
-            pcmFramesRead = drmp3_hdr_frame_samples(pMP3->decoder.header);
-            pMP3->pcmFramesConsumedInMP3Frame = 0;
-            pMP3->pcmFramesRemainingInMP3Frame = pcmFramesRead;
-            pMP3->mp3FrameChannels = info.channels;
-            pMP3->mp3FrameSampleRate = info.hz;
-            break;
-        } else if (info.frame_bytes == 0) {
-            /* Need more data. minimp3 recommends doing data submission in 16K chunks. */
-            size_t bytesRead;
+static drmp3_bool32 drmp3__resize_data_buffer(drmp3* pMP3, size_t newDataCap)
+{
+    /*
+    The buffer is a ring of dataCapacity bytes followed by a mirror of its first DRMP3_MIN_DATA_CHUNK_SIZE bytes, or all of it for smaller
+    rings. This is the only place where buffered data gets moved. It's unwrapped to the start of the new buffer.
+    */
+    drmp3_uint8* pNewData;
 
-            /* First we need to move the data down. */
-            memmove(pMP3->pData, pMP3->pData + pMP3->dataConsumed, pMP3->dataSize);
-            pMP3->dataConsumed = 0;
+    DRMP3_ASSERT(newDataCap >= DRMP3_MIN_INPUT_BUFFER_SIZE);
+    DRMP3_ASSERT(newDataCap >= pMP3->dataSize);
 
-            if (pMP3->dataCapacity == pMP3->dataSize) {
-                /* No room. Expand. */
-                drmp3_uint8* pNewData;
-                size_t newDataCap;
+    if (pMP3->isPreallocated) {
+        /* The client's buffer can't grow. It's unwrapped in place by rotating the ring so the first unread byte is at the start. */
+        if (newDataCap != pMP3->dataCapacity) {
+            return DRMP3_FALSE;
+        }
 
-                newDataCap = pMP3->dataCapacity + DRMP3_DATA_CHUNK_SIZE;
+        drmp3__reverse_bytes(pMP3->pData, pMP3->dataConsumed);
+        drmp3__reverse_bytes(pMP3->pData + pMP3->dataConsumed, pMP3->dataCapacity - pMP3->dataConsumed);
+        drmp3__reverse_bytes(pMP3->pData, pMP3->dataCapacity);
 
-                pNewData = (drmp3_uint8*)drmp3__realloc_from_callbacks(pMP3->pData, newDataCap, pMP3->dataCapacity, &pMP3->allocationCallbacks);
-                if (pNewData == NULL) {
-                    return 0; /* Out of memory. */
-                }
+        pMP3->dataConsumed = 0;
+        drmp3__mirror_data(pMP3, 0, pMP3->dataSize);
 
-                pMP3->pData = pNewData;
-                pMP3->dataCapacity = newDataCap;
-            }
+        return DRMP3_TRUE;
+    }
 
-            /* Fill in a chunk. */
-            bytesRead = drmp3__on_read(pMP3, pMP3->pData + pMP3->dataSize, (pMP3->dataCapacity - pMP3->dataSize));
-            if (bytesRead == 0) {
+    pNewData = (drmp3_uint8*)drmp3__malloc_from_callbacks(newDataCap + drmp3__get_data_mirror_size(newDataCap), &pMP3->allocationCallbacks);
+    if (pNewData == NULL) {
+        return DRMP3_FALSE;
+    }
+
+    drmp3__copy_unread_data(pMP3, pNewData);
+
+    drmp3__free_from_callbacks(pMP3->pData, &pMP3->allocationCallbacks);
+    pMP3->pData        = pNewData;
+    pMP3->dataCapacity = newDataCap;
+    pMP3->dataConsumed = 0;
+    drmp3__mirror_data(pMP3, 0, pMP3->dataSize);
+
+    return DRMP3_TRUE;
+}
+
+static size_t drmp3__fill_data_buffer(drmp3* pMP3)
+{
+    /* Reads into the free part of the ring. This takes two reads when the free part wraps around the end. */
+    size_t totalBytesRead = 0;
+
+    while (pMP3->dataSize < pMP3->dataCapacity) {
+        size_t writePos = pMP3->dataConsumed + pMP3->dataSize;
+        size_t bytesToRead;
+        size_t bytesRead;
+
+        if (writePos >= pMP3->dataCapacity) {
+            writePos -= pMP3->dataCapacity;
+        }
+
+        bytesToRead = pMP3->dataCapacity - pMP3->dataSize;
+        if (bytesToRead > pMP3->dataCapacity - writePos) {
+            bytesToRead = pMP3->dataCapacity - writePos;
+        }
+
+        bytesRead = drmp3__on_read(pMP3, pMP3->pData + writePos, bytesToRead);
+        drmp3__mirror_data(pMP3, writePos, bytesRead);
+
+        pMP3->dataSize += bytesRead;
+        totalBytesRead += bytesRead;
+
+        if (bytesRead < bytesToRead) {
+            break;
+        }
+    }
+
+    return totalBytesRead;
+}
+
+static void drmp3__consume_data(drmp3* pMP3, size_t byteCount)
+{
+    DRMP3_ASSERT(byteCount <= pMP3->dataSize);
+
+    pMP3->dataConsumed += byteCount;
+    pMP3->dataSize     -= byteCount;
+
+    if (pMP3->dataConsumed >= pMP3->dataCapacity) {
+        pMP3->dataConsumed -= pMP3->dataCapacity;
+    }
+}
+
+static drmp3_bool32 drmp3__skip_tag(drmp3* pMP3, size_t tagSize)
+{
+    /*
+    Skips past an ID3v2, ID3v1 or APEv2 tag sitting at the read position. Tags with embedded artwork can be megabytes in size so
+    rather than reading through them, anything that's not already buffered is seeked over.
+    */
+    drmp3_uint64 tagPos = drmp3__get_next_frame_pos(pMP3);
+    drmp3_uint64 tagEnd = tagPos + tagSize;
+
+    /* A tag sitting at the start of the stream is skipped directly when seeking back to the start. */
+    if (tagPos == pMP3->streamStartOffset) {
+        pMP3->streamStartOffset += tagSize;
+    }
+
+    if (pMP3->memory.pData != NULL && pMP3->memory.dataSize > 0) {
+        size_t bytesRemaining = pMP3->memory.dataSize - pMP3->memory.currentReadPos;
+        pMP3->memory.currentReadPos += (tagSize < bytesRemaining) ? tagSize : bytesRemaining;
+        return DRMP3_TRUE;
+    }
+
+    if (tagSize <= pMP3->dataSize) {
+        drmp3__consume_data(pMP3, tagSize);
+        return DRMP3_TRUE;
+    }
+
+    /* The tag extends past what's buffered. Drop the buffer and get past the rest of it straight from the stream. */
+    tagSize -= pMP3->dataSize;
+    pMP3->dataConsumed = 0;
+    pMP3->dataSize     = 0;
+
+    if (pMP3->push.isEnabled) {
+        pMP3->push.bytesToSkip = tagSize;
+        return DRMP3_TRUE;
+    }
+
+    if (pMP3->onSeek != NULL) {
+        return drmp3__on_seek_64(pMP3, tagEnd, drmp3_seek_origin_start);
+    }
+
+    /* Can't seek so we'll need to read and discard. */
+    while (tagSize > 0) {
+        size_t bytesToRead = (tagSize < pMP3->dataCapacity) ? tagSize : pMP3->dataCapacity;
+        size_t bytesRead   = drmp3__on_read(pMP3, pMP3->pData, bytesToRead);
+        if (bytesRead == 0) {
+            return DRMP3_FALSE;
+        }
+
+        tagSize -= bytesRead;
+    }
+
+    return DRMP3_TRUE;
+}
+
+static DRMP3_INLINE drmp3_bool32 drmp3__is_waiting_for_data(const drmp3* pMP3)
+{
+    /* A push decoder runs out of data whenever it has decoded everything that's been pushed so far. That's not the end of the stream. */
+    return pMP3->push.isEnabled && !pMP3->push.isComplete;
+}
+
+static drmp3_bool32 drmp3__is_next_frame_complete(const drmp3* pMP3, const drmp3_uint8* pFrameData, size_t frameDataSize)
+{
+    /*
+    Whether or not all of the next frame is in the buffer, along with a matching header for the frame after it. This is all the decoder
+    needs when it's in sync. Otherwise it needs more data to find its way into sync without mistaking a partial frame for junk.
+    */
+    size_t frameBytes;
+
+    if (frameDataSize < DRMP3_HDR_SIZE || pMP3->decoder.header[0] != 0xFF || !drmp3_hdr_compare(pMP3->decoder.header, pFrameData)) {
+        return DRMP3_FALSE;
+    }
+
+    frameBytes = (size_t)drmp3_hdr_frame_bytes(pFrameData, pMP3->decoder.free_format_bytes);
+    if (frameBytes == 0) {
+        return DRMP3_FALSE;
+    }
+
+    frameBytes += drmp3_hdr_padding(pFrameData);
+    return frameBytes + DRMP3_HDR_SIZE <= frameDataSize && drmp3_hdr_compare(pFrameData, pFrameData + frameBytes);
+}
+
+static drmp3_uint32 drmp3_decode_next_frame_ex__callbacks(drmp3* pMP3, drmp3d_sample_t* pPCMFrames, drmp3_uint32 flags)
+{
+    drmp3_uint32 pcmFramesRead = 0;
+
+    DRMP3_ASSERT(pMP3 != NULL);
+    DRMP3_ASSERT(pMP3->onRead != NULL);
+
+    if (pMP3->atEnd) {
+        return 0;
+    }
+
+    if (pMP3->pData == NULL || pMP3->isSuspended) {
+        if (!drmp3_resume(pMP3)) {
+            return 0; /* Out of memory. */
+        }
+    }
+
+    for (;;) {
+        drmp3dec_frame_info info;
+        const drmp3_uint8* pFrameData;
+        size_t frameDataSize;
+        int tagSize;
+
+        /*
+        minimp3 recommends doing data submission in chunks of at least 16K. If we don't have at least 16K bytes available, get more. Small
+        buffers are refilled when they're half empty so that reads don't get too small.
+        */
+        if (pMP3->dataSize < DRMP3_MIN(DRMP3_MIN_DATA_CHUNK_SIZE, pMP3->dataCapacity/2)) {
+            drmp3__fill_data_buffer(pMP3);
+            if (pMP3->dataSize == 0) {
+                pMP3->atEnd = !drmp3__is_waiting_for_data(pMP3);
+                return 0; /* No data. */
+            }
+        }
+
+        /* The mirrored region past the end of the ring means there's always more than a whole frame of contiguous bytes here. */
+        pFrameData    = pMP3->pData + pMP3->dataConsumed;
+        frameDataSize = pMP3->dataCapacity + drmp3__get_data_mirror_size(pMP3->dataCapacity) - pMP3->dataConsumed;
+        if (frameDataSize > pMP3->dataSize) {
+            frameDataSize = pMP3->dataSize;
+        }
+
+        /* A push decoder that's short on data holds on to it until more is pushed, unless there's a whole frame to decode. */
+        if (pMP3->dataSize < DRMP3_MIN(DRMP3_MIN_DATA_CHUNK_SIZE, pMP3->dataCapacity/2) && drmp3__is_waiting_for_data(pMP3) && !drmp3__is_next_frame_complete(pMP3, pFrameData, frameDataSize)) {
+            return 0;
+        }
+
+        if (frameDataSize > INT_MAX) {
+            pMP3->atEnd = DRMP3_TRUE;
+            return 0; /* Buffer too big. */
+        }
+
+        /* Tags are skipped over in one go rather than being scanned for a sync word byte by byte. */
+        tagSize = drmp3d_tag_size_declared(pFrameData, (int)frameDataSize);
+        if (tagSize > 0) {
+            if (!drmp3__skip_tag(pMP3, (size_t)tagSize)) {
                 pMP3->atEnd = DRMP3_TRUE;
-                return 0; /* Error reading more data. */
+                return 0;
+            }
+
+            continue;
+        }
+
+        /* Safe size_t -> int conversion thanks to the check above. */
+        if ((flags & DRMP3_FRAME_FLAG_SCAN_ONLY) != 0) {
+            pcmFramesRead = drmp3dec_scan_frame(&pMP3->decoder, pFrameData, (int)frameDataSize, &info);
+        } else {
+            pcmFramesRead = drmp3dec_decode_frame_ex(&pMP3->decoder, pFrameData, (int)frameDataSize, pPCMFrames, &info, (flags & DRMP3_FRAME_FLAG_NO_SYNTH) != 0, (int)pMP3->decodeQuality.rateShift, (int)pMP3->converter.isDownmixing);
+        }
+
+        if (pcmFramesRead == 0 && info.frame_bytes > 0) {
+            pcmFramesRead = drmp3__get_starved_frame_sample_count(pMP3, pPCMFrames, &info, flags);
+        }
+
+        /* Consume the data. */
+        if (info.frame_bytes > 0) {
+            drmp3__consume_data(pMP3, (size_t)info.frame_bytes);
+        }
+
+        /* pcmFramesRead will be equal to 0 if decoding failed. If it is zero and info.frame_bytes > 0 then we have successfully decoded the frame. */
+        if (pcmFramesRead > 0) {
+            pcmFramesRead = drmp3_hdr_frame_samples(pMP3->decoder.header) >> pMP3->decodeQuality.rateShift;
+            pMP3->pcmFramesConsumedInMP3Frame = 0;
+            pMP3->pcmFramesRemainingInMP3Frame = pcmFramesRead;
+            pMP3->mp3FrameChannels = drmp3__get_decoded_channels(pMP3, info.channels);
+            pMP3->mp3FrameSampleRate = drmp3__get_decoded_sample_rate(pMP3, (drmp3_uint32)info.hz);
+            break;
+        } else if (info.frame_bytes == 0) {
+            /* Need more data. */
+            if (frameDataSize < pMP3->dataSize) {
+                /*
+                The data runs past the mirrored region. Frames are much smaller than DRMP3_MIN_INPUT_BUFFER_SIZE so this should never
+                happen with a valid stream, but if it does the data is unwrapped so it can all be handed to the decoder.
+                */
+                if (!drmp3__resize_data_buffer(pMP3, pMP3->dataCapacity)) {
+                    return 0; /* Out of memory. */
+                }
+
+                continue;
+            }
+
+            if (pMP3->dataSize == pMP3->dataCapacity) {
+                /* No room. Expand. */
+                if (!drmp3__resize_data_buffer(pMP3, pMP3->dataCapacity + DRMP3_DATA_CHUNK_SIZE)) {
+                    return 0; /* Out of memory, or the buffer belongs to the client and can't be expanded. */
+                }
             }
 
-            pMP3->dataSize += bytesRead;
+            if (drmp3__fill_data_buffer(pMP3) == 0) {
+                pMP3->atEnd = !drmp3__is_waiting_for_data(pMP3);
+                return 0; /* Error reading more data. */
+            }
         }
     };
 
     return pcmFramesRead;
 }
 
-static drmp3_uint32 drmp3_decode_next_frame_ex__memory(drmp3* pMP3, drmp3d_sample_t* pPCMFrames)
+static drmp3_uint32 drmp3_decode_next_frame_ex__memory(drmp3* pMP3, drmp3d_sample_t* pPCMFrames, drmp3_uint32 flags)
 {
     drmp3_uint32 pcmFramesRead = 0;
     drmp3dec_frame_info info;
@@ -2750,32 +4439,130 @@ static drmp3_uint32 drmp3_decode_next_frame_ex__memory(drmp3* pMP3, drmp3d_sampl
         return 0;
     }
 
-    pcmFramesRead = drmp3dec_decode_frame(&pMP3->decoder, pMP3->memory.pData + pMP3->memory.currentReadPos, (int)(pMP3->memory.dataSize - pMP3->memory.currentReadPos), pPCMFrames, &info);
+    for (;;) {
+        const drmp3_uint8* pFrameData = pMP3->memory.pData + pMP3->memory.currentReadPos;
+        size_t bytesRemaining = pMP3->memory.dataSize - pMP3->memory.currentReadPos;
+        int frameDataSize;
+        int tagSize;
+
+        /* Data larger than 2GB, such as a mapped file, is handed to the decoder a window at a time. Frames are tiny in comparison. */
+        frameDataSize = (bytesRemaining > INT_MAX) ? INT_MAX : (int)bytesRemaining;
+
+        tagSize = drmp3d_tag_size(pFrameData, frameDataSize);
+        if (tagSize > 0) {
+            drmp3__skip_tag(pMP3, (size_t)tagSize);
+            continue;
+        }
+
+        if ((flags & DRMP3_FRAME_FLAG_SCAN_ONLY) != 0) {
+            pcmFramesRead = drmp3dec_scan_frame(&pMP3->decoder, pFrameData, frameDataSize, &info) >> pMP3->decodeQuality.rateShift;
+        } else {
+            pcmFramesRead = drmp3dec_decode_frame_ex(&pMP3->decoder, pFrameData, frameDataSize, pPCMFrames, &info, (flags & DRMP3_FRAME_FLAG_NO_SYNTH) != 0, (int)pMP3->decodeQuality.rateShift, (int)pMP3->converter.isDownmixing);
+        }
+
+        if (pcmFramesRead == 0 && info.frame_bytes > 0) {
+            pcmFramesRead = drmp3__get_starved_frame_sample_count(pMP3, pPCMFrames, &info, flags);
+        }
+
+        /* Consume the data. */
+        pMP3->memory.currentReadPos += (size_t)info.frame_bytes;
 
-    pMP3->pcmFramesConsumedInMP3Frame  = 0;
-    pMP3->pcmFramesRemainingInMP3Frame = pcmFramesRead;
-    pMP3->mp3FrameChannels             = info.channels;
-    pMP3->mp3FrameSampleRate           = info.hz;
+        if (pcmFramesRead > 0) {
+            pMP3->pcmFramesConsumedInMP3Frame  = 0;
+            pMP3->pcmFramesRemainingInMP3Frame = pcmFramesRead;
+            pMP3->mp3FrameChannels             = drmp3__get_decoded_channels(pMP3, info.channels);
+            pMP3->mp3FrameSampleRate           = drmp3__get_decoded_sample_rate(pMP3, (drmp3_uint32)info.hz);
+            break;
+        } else if (info.frame_bytes == 0) {
+            /* Nothing at all was read which means we're at the end of the data. */
+            pMP3->atEnd = DRMP3_TRUE;
+            break;
+        }
 
-    /* Consume the data. */
-    pMP3->memory.currentReadPos += (size_t)info.frame_bytes;
+        /*
+        Getting here means we skipped past a frame that could not be decoded. This happens after seeking into the middle of the
+        stream where the bit reservoir has not yet been filled. Just move on to the next one like we do with the callbacks path.
+        */
+    }
 
     return pcmFramesRead;
 }
 
+static void drmp3__record_mp3_frame(drmp3* pMP3, drmp3_uint64 bytePos, drmp3_uint32 pcmFrameCount);
+
 static drmp3_uint32 drmp3_decode_next_frame_ex(drmp3* pMP3, drmp3d_sample_t* pPCMFrames)
 {
+    drmp3_uint64 bytePos = 0;
+    drmp3_uint32 pcmFramesRead;
+
+    if (pMP3->seekRecorder.isInSync) {
+        bytePos = drmp3__get_next_frame_pos(pMP3);
+    }
+
+    if (pMP3->memory.pData != NULL && pMP3->memory.dataSize > 0) {
+        pcmFramesRead = drmp3_decode_next_frame_ex__memory(pMP3, pPCMFrames, 0);
+    } else {
+        pcmFramesRead = drmp3_decode_next_frame_ex__callbacks(pMP3, pPCMFrames, 0);
+    }
+
+    if (pMP3->seekRecorder.isInSync) {
+        drmp3__record_mp3_frame(pMP3, bytePos, pcmFramesRead);
+    }
+
+    return pcmFramesRead;
+}
+
+static drmp3_uint32 drmp3_warm_up_next_frame(drmp3* pMP3, drmp3d_sample_t* pPCMFrames, drmp3_uint32 flags)
+{
+    /* Like drmp3_decode_next_frame_ex(), but for frames that are discarded after a seek. Frames are never skipped, see DRMP3_FRAME_FLAG_WARM_UP. */
+    flags |= DRMP3_FRAME_FLAG_WARM_UP;
+
+    if (pMP3->memory.pData != NULL && pMP3->memory.dataSize > 0) {
+        return drmp3_decode_next_frame_ex__memory(pMP3, pPCMFrames, flags);
+    } else {
+        return drmp3_decode_next_frame_ex__callbacks(pMP3, pPCMFrames, flags);
+    }
+}
+
+static drmp3_uint32 drmp3_scan_next_frame(drmp3* pMP3)
+{
+    /*
+    Steps over the next frame by looking only at its header and side info. This returns the same PCM frame count as decoding with a
+    NULL output buffer would, but because the bit reservoir is only tracked and not filled, the decoder is not in a state where it
+    can decode audio afterwards. Callers must reset the decoder (drmp3_reset() or drmp3_seek_to_start_of_stream()) before reading.
+    */
+    pMP3->seekRecorder.isInSync = DRMP3_FALSE;
+
     if (pMP3->memory.pData != NULL && pMP3->memory.dataSize > 0) {
-        return drmp3_decode_next_frame_ex__memory(pMP3, pPCMFrames);
+        return drmp3_decode_next_frame_ex__memory(pMP3, NULL, DRMP3_FRAME_FLAG_SCAN_ONLY);
     } else {
-        return drmp3_decode_next_frame_ex__callbacks(pMP3, pPCMFrames);
+        return drmp3_decode_next_frame_ex__callbacks(pMP3, NULL, DRMP3_FRAME_FLAG_SCAN_ONLY);
+    }
+}
+
+static drmp3d_sample_t* drmp3__get_pcm_frames_buffer(drmp3* pMP3)
+{
+#if defined(DR_MP3_COMPACT)
+    if (pMP3->pcmFrames == NULL) {
+        pMP3->pcmFrames = (drmp3_uint8*)drmp3__malloc_from_callbacks(sizeof(drmp3d_sample_t)*DRMP3_MAX_SAMPLES_PER_FRAME, &pMP3->allocationCallbacks);
     }
+#endif
+
+    return (drmp3d_sample_t*)pMP3->pcmFrames;
 }
 
 static drmp3_uint32 drmp3_decode_next_frame(drmp3* pMP3)
 {
+    drmp3d_sample_t* pPCMFrames;
+
     DRMP3_ASSERT(pMP3 != NULL);
-    return drmp3_decode_next_frame_ex(pMP3, (drmp3d_sample_t*)pMP3->pcmFrames);
+
+    pPCMFrames = drmp3__get_pcm_frames_buffer(pMP3);
+    if (pPCMFrames == NULL) {
+        return 0;   /* Out of memory. */
+    }
+
+    return drmp3_decode_next_frame_ex(pMP3, pPCMFrames);
 }
 
 #if 0
@@ -2799,76 +4586,455 @@ static drmp3_uint32 drmp3_seek_next_frame(drmp3* pMP3)
 }
 #endif
 
-static drmp3_bool32 drmp3_init_internal(drmp3* pMP3, drmp3_read_proc onRead, drmp3_seek_proc onSeek, void* pUserData, const drmp3_allocation_callbacks* pAllocationCallbacks)
+static drmp3_uint64 drmp3__get_next_frame_pos(drmp3* pMP3)
 {
-    DRMP3_ASSERT(pMP3 != NULL);
-    DRMP3_ASSERT(onRead != NULL);
+    /* Returns the byte position in the stream of the data that'll be handed to the decoder next. */
+    if (pMP3->memory.pData != NULL && pMP3->memory.dataSize > 0) {
+        return pMP3->memory.currentReadPos;
+    } else {
+        DRMP3_ASSERT(pMP3->streamCursor >= pMP3->dataSize);
+        return pMP3->streamCursor - pMP3->dataSize;
+    }
+}
 
-    /* This function assumes the output object has already been reset to 0. Do not do that here, otherwise things will break. */
-    drmp3dec_init(&pMP3->decoder);
+static const drmp3_uint8* drmp3__get_last_frame_data(drmp3* pMP3, int* pFrameBytes)
+{
+    /*
+    Retrieves a pointer to the raw data of the MP3 frame that was just decoded. This will still be sitting in our buffer (or
+    the client's buffer for memory streams) since nothing gets moved until the next frame is decoded.
+    */
+    int frameBytes = drmp3_hdr_frame_bytes(pMP3->decoder.header, pMP3->decoder.free_format_bytes) + drmp3_hdr_padding(pMP3->decoder.header);
 
-    pMP3->onRead = onRead;
-    pMP3->onSeek = onSeek;
-    pMP3->pUserData = pUserData;
-    pMP3->allocationCallbacks = drmp3_copy_allocation_callbacks_or_defaults(pAllocationCallbacks);
+    if (pMP3->memory.pData != NULL && pMP3->memory.dataSize > 0) {
+        if ((size_t)frameBytes > pMP3->memory.currentReadPos) {
+            return NULL;
+        }
 
-    if (pMP3->allocationCallbacks.onFree == NULL || (pMP3->allocationCallbacks.onMalloc == NULL && pMP3->allocationCallbacks.onRealloc == NULL)) {
-        return DRMP3_FALSE;    /* Invalid allocation callbacks. */
-    }
+        *pFrameBytes = frameBytes;
+        return pMP3->memory.pData + pMP3->memory.currentReadPos - frameBytes;
+    } else {
+        /* The frame may have wrapped around the end of the ring, in which case it carries on into the mirrored region. */
+        size_t framePos;
 
-    /* Decode the first frame to confirm that it is indeed a valid MP3 stream. */
-    if (!drmp3_decode_next_frame(pMP3)) {
-        drmp3_uninit(pMP3);
-        return DRMP3_FALSE; /* Not a valid MP3 stream. */
-    }
+        if (pMP3->pData == NULL || (size_t)frameBytes > pMP3->dataCapacity - pMP3->dataSize) {
+            return NULL;
+        }
 
-    pMP3->channels   = pMP3->mp3FrameChannels;
-    pMP3->sampleRate = pMP3->mp3FrameSampleRate;
+        if ((size_t)frameBytes <= pMP3->dataConsumed) {
+            framePos = pMP3->dataConsumed - frameBytes;
+        } else {
+            framePos = pMP3->dataConsumed + pMP3->dataCapacity - frameBytes;
+        }
 
-    return DRMP3_TRUE;
+        *pFrameBytes = frameBytes;
+        return pMP3->pData + framePos;
+    }
 }
 
-DRMP3_API drmp3_bool32 drmp3_init(drmp3* pMP3, drmp3_read_proc onRead, drmp3_seek_proc onSeek, void* pUserData, const drmp3_allocation_callbacks* pAllocationCallbacks)
+static drmp3_uint32 drmp3__be32(const drmp3_uint8* p)
 {
-    if (pMP3 == NULL || onRead == NULL) {
-        return DRMP3_FALSE;
-    }
+    return ((drmp3_uint32)p[0] << 24) | ((drmp3_uint32)p[1] << 16) | ((drmp3_uint32)p[2] << 8) | (drmp3_uint32)p[3];
+}
 
-    DRMP3_ZERO_OBJECT(pMP3);
-    return drmp3_init_internal(pMP3, onRead, onSeek, pUserData, pAllocationCallbacks);
+static drmp3_uint32 drmp3__be16(const drmp3_uint8* p)
+{
+    return ((drmp3_uint32)p[0] << 8) | (drmp3_uint32)p[1];
 }
 
+#define DRMP3_XING_FLAG_FRAMES  0x01
+#define DRMP3_XING_FLAG_BYTES   0x02
+#define DRMP3_XING_FLAG_TOC     0x04
+#define DRMP3_XING_FLAG_QUALITY 0x08
 
-static size_t drmp3__on_read_memory(void* pUserData, void* pBufferOut, size_t bytesToRead)
+/* The number of PCM frames of delay introduced by the decoder. This is in addition to the encoder delay. */
+#define DRMP3_DECODER_DELAY     529
+
+static drmp3_bool32 drmp3__read_xing_tag(drmp3* pMP3, const drmp3_uint8* pFrame, int frameBytes)
 {
-    drmp3* pMP3 = (drmp3*)pUserData;
-    size_t bytesRemaining;
+    /*
+    The Xing/Info tag sits straight after the side info. Its size depends on the MPEG version and the channel count.
 
-    DRMP3_ASSERT(pMP3 != NULL);
-    DRMP3_ASSERT(pMP3->memory.dataSize >= pMP3->memory.currentReadPos);
+                    Mono  Stereo
+        MPEG1        17     32
+        MPEG2/2.5     9     17
+    */
+    const drmp3_uint8* pTag;
+    const drmp3_uint8* pEnd = pFrame + frameBytes;
+    drmp3_uint32 flags;
+    int sideInfoBytes;
 
-    bytesRemaining = pMP3->memory.dataSize - pMP3->memory.currentReadPos;
-    if (bytesToRead > bytesRemaining) {
-        bytesToRead = bytesRemaining;
+    if (DRMP3_HDR_TEST_MPEG1(pFrame)) {
+        sideInfoBytes = DRMP3_HDR_IS_MONO(pFrame) ? 17 : 32;
+    } else {
+        sideInfoBytes = DRMP3_HDR_IS_MONO(pFrame) ?  9 : 17;
     }
 
-    if (bytesToRead > 0) {
-        DRMP3_COPY_MEMORY(pBufferOut, pMP3->memory.pData + pMP3->memory.currentReadPos, bytesToRead);
-        pMP3->memory.currentReadPos += bytesToRead;
+    pTag = pFrame + DRMP3_HDR_SIZE + sideInfoBytes;
+    if (DRMP3_HDR_IS_CRC(pFrame)) {
+        pTag += 2;
     }
 
-    return bytesToRead;
-}
+    if (pTag + 8 > pEnd) {
+        return DRMP3_FALSE;
+    }
 
-static drmp3_bool32 drmp3__on_seek_memory(void* pUserData, int byteOffset, drmp3_seek_origin origin)
-{
-    drmp3* pMP3 = (drmp3*)pUserData;
+    if (memcmp(pTag, "Xing", 4) != 0 && memcmp(pTag, "Info", 4) != 0) {
+        return DRMP3_FALSE;
+    }
 
-    DRMP3_ASSERT(pMP3 != NULL);
+    flags = drmp3__be32(pTag + 4);
+    pTag += 8;
 
-    if (origin == drmp3_seek_origin_current) {
-        if (byteOffset > 0) {
-            if (pMP3->memory.currentReadPos + byteOffset > pMP3->memory.dataSize) {
+    if ((flags & DRMP3_XING_FLAG_FRAMES) != 0) {
+        if (pTag + 4 > pEnd) {
+            return DRMP3_TRUE;  /* It's a tag frame, but it's truncated. Don't trust any of it, but still skip it. */
+        }
+
+        pMP3->vbrTag.mp3FrameCount = drmp3__be32(pTag);
+        pTag += 4;
+    }
+
+    if ((flags & DRMP3_XING_FLAG_BYTES) != 0) {
+        if (pTag + 4 > pEnd) {
+            return DRMP3_TRUE;
+        }
+
+        pMP3->vbrTag.byteCount = drmp3__be32(pTag);
+        pTag += 4;
+    }
+
+    if ((flags & DRMP3_XING_FLAG_TOC) != 0) {
+        if (pTag + 100 > pEnd) {
+            return DRMP3_TRUE;
+        }
+
+        DRMP3_COPY_MEMORY(pMP3->vbrTag.toc, pTag, 100);
+        pMP3->vbrTag.hasTOC = DRMP3_TRUE;
+        pTag += 100;
+    }
+
+    if ((flags & DRMP3_XING_FLAG_QUALITY) != 0) {
+        pTag += 4;
+    }
+
+    /*
+    Encoders like LAME will follow the Xing data with an extension containing the encoder delay and padding which is needed
+    for gapless playback. The encoder version string comes first so if the first byte is zero there's no extension. The
+    delay and padding are two 12-bit values starting at byte 21.
+    */
+    if (pTag + 24 <= pEnd && pTag[0] != 0) {
+        drmp3_uint32 delay   = ((drmp3_uint32)pTag[21] << 4) | ((drmp3_uint32)pTag[22] >> 4);
+        drmp3_uint32 padding = (((drmp3_uint32)pTag[22] & 0x0F) << 8) | (drmp3_uint32)pTag[23];
+
+        /* The decoder introduces a delay of its own which needs to be shifted from the padding to the delay. */
+        pMP3->vbrTag.delayInPCMFrames   = delay + DRMP3_DECODER_DELAY;
+        pMP3->vbrTag.paddingInPCMFrames = (padding > DRMP3_DECODER_DELAY) ? (padding - DRMP3_DECODER_DELAY) : 0;
+        pMP3->vbrTag.hasGaplessInfo     = DRMP3_TRUE;
+    }
+
+    return DRMP3_TRUE;
+}
+
+static drmp3_bool32 drmp3__read_vbri_tag(drmp3* pMP3, const drmp3_uint8* pFrame, int frameBytes)
+{
+    /* The VBRI tag is always 32 bytes after the header, regardless of the MPEG version or channel count. */
+    const drmp3_uint8* pTag = pFrame + DRMP3_HDR_SIZE + 32;
+    drmp3_uint32 entryCount;
+    drmp3_uint32 entryScale;
+    drmp3_uint32 entrySize;
+    drmp3_uint32 mp3FramesPerEntry;
+    drmp3_uint64 byteCount;
+    drmp3_uint64 mp3FrameCount;
+
+    if (pTag + 26 > pFrame + frameBytes || memcmp(pTag, "VBRI", 4) != 0) {
+        return DRMP3_FALSE;
+    }
+
+    byteCount         = drmp3__be32(pTag + 10);
+    mp3FrameCount     = drmp3__be32(pTag + 14);
+    entryCount        = drmp3__be16(pTag + 18);
+    entryScale        = drmp3__be16(pTag + 20);
+    entrySize         = drmp3__be16(pTag + 22);
+    mp3FramesPerEntry = drmp3__be16(pTag + 24);
+    pTag += 26;
+
+    pMP3->vbrTag.mp3FrameCount = mp3FrameCount;
+    pMP3->vbrTag.byteCount     = byteCount;
+
+    /*
+    The VBRI table of contents is a list of byte sizes of consecutive runs of mp3FramesPerEntry frames, starting after the
+    tag frame. We convert this to the same format as the Xing TOC so we only need to deal with one format when seeking.
+    */
+    if (entryCount > 0 && entrySize >= 1 && entrySize <= 4 && mp3FramesPerEntry > 0 && byteCount > 0 && mp3FrameCount > 0 && pTag + (entryCount * entrySize) <= pFrame + frameBytes) {
+        drmp3_uint32 iPercent;
+        drmp3_uint32 iEntry = 0;
+        drmp3_uint64 entryStartPos = (drmp3_uint64)frameBytes;  /* Relative to the tag frame. */
+        drmp3_uint64 entryByteCount;
+
+        for (iPercent = 0; iPercent < 100; iPercent += 1) {
+            drmp3_uint64 targetMP3Frame = (mp3FrameCount * iPercent) / 100;
+            drmp3_uint64 pos;
+
+            /* Move forward to the entry containing the target frame, accumulating the byte position as we go. */
+            for (;;) {
+                drmp3_uint32 iByte;
+
+                entryByteCount = 0;
+                if (iEntry < entryCount) {
+                    for (iByte = 0; iByte < entrySize; iByte += 1) {
+                        entryByteCount = (entryByteCount << 8) | pTag[iEntry*entrySize + iByte];
+                    }
+                    entryByteCount *= entryScale;
+                }
+
+                if (iEntry >= entryCount || targetMP3Frame < (drmp3_uint64)(iEntry + 1) * mp3FramesPerEntry) {
+                    break;
+                }
+
+                entryStartPos += entryByteCount;
+                iEntry += 1;
+            }
+
+            pos = entryStartPos + (entryByteCount * (targetMP3Frame - (drmp3_uint64)iEntry * mp3FramesPerEntry)) / mp3FramesPerEntry;
+            pos = (pos * 256) / byteCount;
+            pMP3->vbrTag.toc[iPercent] = (drmp3_uint8)DRMP3_MIN(pos, 255);
+        }
+
+        pMP3->vbrTag.hasTOC = DRMP3_TRUE;
+    }
+
+    return DRMP3_TRUE;
+}
+
+static drmp3_uint64 drmp3__get_pcm_frame_count_from_vbr_tag(drmp3* pMP3)
+{
+    /* Only valid when the tag has a frame count. Gapless streams have their delay and padding excluded. */
+    drmp3_uint64 pcmFrameCount = pMP3->vbrTag.mp3FrameCount * pMP3->vbrTag.pcmFramesPerMP3Frame;
+    drmp3_uint64 pcmFramesToTrim = (drmp3_uint64)pMP3->vbrTag.delayInPCMFrames + pMP3->vbrTag.paddingInPCMFrames;
+
+    if (pcmFrameCount < pcmFramesToTrim) {
+        return 0;
+    }
+
+    return pcmFrameCount - pcmFramesToTrim;
+}
+
+static drmp3_bool32 drmp3__get_stream_size(drmp3* pMP3, drmp3_uint64* pStreamSize);
+
+static drmp3_bool32 drmp3__read_vbr_tag(drmp3* pMP3)
+{
+    /*
+    Encoders like LAME will write a Xing/Info (or the less common Fraunhofer VBRI) tag into the first MP3 frame of the stream.
+    This frame does not contain any audio data and must not be output. It contains the number of MP3 frames and the size of the
+    stream which means we can calculate the length of the stream without scanning the whole thing, and an optional table of
+    contents which can be used for fast seeking. Returns true if the frame that was just decoded is a tag frame.
+    */
+    const drmp3_uint8* pFrame;
+    int frameBytes;
+    drmp3_bool32 isTagFrame;
+    drmp3_uint64 streamSize;
+
+    pFrame = drmp3__get_last_frame_data(pMP3, &frameBytes);
+    if (pFrame == NULL || !drmp3_hdr_valid(pFrame) || DRMP3_HDR_GET_LAYER(pFrame) != 1) {
+        return DRMP3_FALSE; /* Only Layer III streams have a tag frame. */
+    }
+
+    isTagFrame = drmp3__read_xing_tag(pMP3, pFrame, frameBytes);
+    if (!isTagFrame) {
+        isTagFrame = drmp3__read_vbri_tag(pMP3, pFrame, frameBytes);
+    }
+
+    if (!isTagFrame) {
+        return DRMP3_FALSE;
+    }
+
+    pMP3->vbrTag.framePos             = drmp3__get_next_frame_pos(pMP3) - frameBytes;
+    pMP3->vbrTag.pcmFramesPerMP3Frame = drmp3_hdr_frame_samples(pFrame);
+
+    /*
+    A file that's been cut short still has the frame and byte counts of the whole stream in its tag, so the frame count would be
+    too high. When we know how big the stream is and it's more than an MP3 frame shorter than the tag says, neither the counts
+    nor the TOC are used. The frame count is then found by scanning the stream, and the padding isn't trimmed from the end since
+    it's been cut off. Data after the end of the stream, such as an ID3v1 or APE tag, is normal so a longer stream is accepted.
+    */
+    if (pMP3->vbrTag.byteCount > 0 && drmp3__get_stream_size(pMP3, &streamSize)) {
+        drmp3_uint64 averageFrameBytes = pMP3->vbrTag.byteCount / (pMP3->vbrTag.mp3FrameCount + 1);
+        if (pMP3->vbrTag.framePos + pMP3->vbrTag.byteCount > streamSize + DRMP3_MAX(averageFrameBytes, (drmp3_uint64)frameBytes)) {
+            pMP3->vbrTag.mp3FrameCount = 0;
+            pMP3->vbrTag.byteCount     = 0;
+        }
+    }
+
+    /* We can't do anything with the TOC if we don't know how big the stream is. */
+    if (pMP3->vbrTag.byteCount == 0 || pMP3->vbrTag.mp3FrameCount == 0) {
+        pMP3->vbrTag.hasTOC = DRMP3_FALSE;
+    }
+
+    return DRMP3_TRUE;
+}
+
+static drmp3_bool32 drmp3__read_first_frame(drmp3* pMP3)
+{
+    /* Decode the first frame to confirm that it is indeed a valid MP3 stream. */
+    if (!drmp3_decode_next_frame(pMP3)) {
+        return DRMP3_FALSE; /* Not a valid MP3 stream. */
+    }
+
+    /* If the first frame is a Xing/Info or VBRI frame we need to skip past it since it's not audio data. */
+    if (drmp3__read_vbr_tag(pMP3)) {
+        pMP3->streamStartOffset = drmp3__get_next_frame_pos(pMP3);
+
+        if (pMP3->push.isEnabled) {
+            /* The next frame may not have been pushed yet. It's decoded by the read path instead. */
+            pMP3->pcmFramesConsumedInMP3Frame  = 0;
+            pMP3->pcmFramesRemainingInMP3Frame = 0;
+        } else if (!drmp3_decode_next_frame(pMP3)) {
+            return DRMP3_FALSE; /* There's no audio data after the tag frame. */
+        }
+
+        /* The encoder delay is trimmed by the read path, just like after seeking back to the start. */
+        pMP3->pcmFramesToTrimAtStart = pMP3->vbrTag.delayInPCMFrames;
+    }
+
+    pMP3->channels   = pMP3->mp3FrameChannels;
+    pMP3->sampleRate = pMP3->mp3FrameSampleRate;
+    pMP3->converter.channelsIn   = pMP3->channels;
+    pMP3->converter.sampleRateIn = pMP3->sampleRate;
+
+    return DRMP3_TRUE;
+}
+
+static drmp3_bool32 drmp3__init_callbacks(drmp3* pMP3, drmp3_read_proc onRead, drmp3_seek_proc onSeek, void* pUserData, const drmp3_allocation_callbacks* pAllocationCallbacks)
+{
+    /* This function assumes the output object has already been reset to 0. Do not do that here, otherwise things will break. */
+    drmp3dec_init(&pMP3->decoder);
+
+    pMP3->onRead = onRead;
+    pMP3->onSeek = onSeek;
+    pMP3->pUserData = pUserData;
+    pMP3->allocationCallbacks = drmp3_copy_allocation_callbacks_or_defaults(pAllocationCallbacks);
+
+    if (pMP3->allocationCallbacks.onFree == NULL || (pMP3->allocationCallbacks.onMalloc == NULL && pMP3->allocationCallbacks.onRealloc == NULL)) {
+        return DRMP3_FALSE;    /* Invalid allocation callbacks. */
+    }
+
+    return DRMP3_TRUE;
+}
+
+static drmp3_bool32 drmp3_init_internal(drmp3* pMP3, drmp3_read_proc onRead, drmp3_seek_proc onSeek, void* pUserData, const drmp3_allocation_callbacks* pAllocationCallbacks)
+{
+    DRMP3_ASSERT(pMP3 != NULL);
+    DRMP3_ASSERT(onRead != NULL);
+
+    if (!drmp3__init_callbacks(pMP3, onRead, onSeek, pUserData, pAllocationCallbacks)) {
+        return DRMP3_FALSE;
+    }
+
+    if (!drmp3__read_first_frame(pMP3)) {
+        drmp3_uninit(pMP3);
+        return DRMP3_FALSE;
+    }
+
+    return DRMP3_TRUE;
+}
+
+DRMP3_API drmp3_bool32 drmp3_init(drmp3* pMP3, drmp3_read_proc onRead, drmp3_seek_proc onSeek, void* pUserData, const drmp3_allocation_callbacks* pAllocationCallbacks)
+{
+    if (pMP3 == NULL || onRead == NULL) {
+        return DRMP3_FALSE;
+    }
+
+    DRMP3_ZERO_OBJECT(pMP3);
+    return drmp3_init_internal(pMP3, onRead, onSeek, pUserData, pAllocationCallbacks);
+}
+
+static size_t drmp3__get_preallocated_pcm_frames_size(void)
+{
+    /* With DR_MP3_COMPACT the buffer for the current MP3 frame comes out of the client's buffer too. It's placed first to keep it aligned. */
+#if defined(DR_MP3_COMPACT)
+    return sizeof(drmp3d_sample_t)*DRMP3_MAX_SAMPLES_PER_FRAME;
+#else
+    return 0;
+#endif
+}
+
+DRMP3_API size_t drmp3_get_preallocated_buffer_size(size_t inputBufferSize)
+{
+    if (inputBufferSize == 0) {
+        inputBufferSize = DRMP3_MAX(DRMP3_DATA_CHUNK_SIZE, DRMP3_MIN_INPUT_BUFFER_SIZE);
+    }
+
+    if (inputBufferSize < DRMP3_MIN_INPUT_BUFFER_SIZE || inputBufferSize > INT_MAX - DRMP3_MIN_DATA_CHUNK_SIZE) {
+        return 0;
+    }
+
+    return drmp3__get_preallocated_pcm_frames_size() + inputBufferSize + drmp3__get_data_mirror_size(inputBufferSize);
+}
+
+DRMP3_API drmp3_bool32 drmp3_init_preallocated(drmp3* pMP3, drmp3_read_proc onRead, drmp3_seek_proc onSeek, void* pUserData, void* pBuffer, size_t bufferSize, const drmp3_allocation_callbacks* pAllocationCallbacks)
+{
+    size_t pcmFramesSize = drmp3__get_preallocated_pcm_frames_size();
+    size_t dataCapacity;
+
+    if (pMP3 == NULL || onRead == NULL || pBuffer == NULL || bufferSize < pcmFramesSize) {
+        return DRMP3_FALSE;
+    }
+
+    /* The ring takes whatever is left after its mirror. This is the inverse of drmp3_get_preallocated_buffer_size(). */
+    dataCapacity = bufferSize - pcmFramesSize;
+    if (dataCapacity >= DRMP3_MIN_DATA_CHUNK_SIZE*2) {
+        dataCapacity -= DRMP3_MIN_DATA_CHUNK_SIZE;
+    } else {
+        dataCapacity /= 2;
+    }
+
+    if (dataCapacity < DRMP3_MIN_INPUT_BUFFER_SIZE || dataCapacity > INT_MAX - DRMP3_MIN_DATA_CHUNK_SIZE) {
+        return DRMP3_FALSE;
+    }
+
+    DRMP3_ZERO_OBJECT(pMP3);
+    pMP3->pData           = (drmp3_uint8*)pBuffer + pcmFramesSize;
+    pMP3->dataCapacity    = dataCapacity;
+    pMP3->inputBufferSize = dataCapacity;
+    pMP3->isPreallocated  = DRMP3_TRUE;
+#if defined(DR_MP3_COMPACT)
+    pMP3->pcmFrames       = (drmp3_uint8*)pBuffer;
+#endif
+
+    return drmp3_init_internal(pMP3, onRead, onSeek, pUserData, pAllocationCallbacks);
+}
+
+
+static size_t drmp3__on_read_memory(void* pUserData, void* pBufferOut, size_t bytesToRead)
+{
+    drmp3* pMP3 = (drmp3*)pUserData;
+    size_t bytesRemaining;
+
+    DRMP3_ASSERT(pMP3 != NULL);
+    DRMP3_ASSERT(pMP3->memory.dataSize >= pMP3->memory.currentReadPos);
+
+    bytesRemaining = pMP3->memory.dataSize - pMP3->memory.currentReadPos;
+    if (bytesToRead > bytesRemaining) {
+        bytesToRead = bytesRemaining;
+    }
+
+    if (bytesToRead > 0) {
+        DRMP3_COPY_MEMORY(pBufferOut, pMP3->memory.pData + pMP3->memory.currentReadPos, bytesToRead);
+        pMP3->memory.currentReadPos += bytesToRead;
+    }
+
+    return bytesToRead;
+}
+
+static drmp3_bool32 drmp3__on_seek_memory(void* pUserData, int byteOffset, drmp3_seek_origin origin)
+{
+    drmp3* pMP3 = (drmp3*)pUserData;
+
+    DRMP3_ASSERT(pMP3 != NULL);
+
+    if (origin == drmp3_seek_origin_current) {
+        if (byteOffset > 0) {
+            if (pMP3->memory.currentReadPos + byteOffset > pMP3->memory.dataSize) {
                 byteOffset = (int)(pMP3->memory.dataSize - pMP3->memory.currentReadPos);  /* Trying to seek too far forward. */
             }
         } else {
@@ -2910,49 +5076,222 @@ DRMP3_API drmp3_bool32 drmp3_init_memory(drmp3* pMP3, const void* pData, size_t
 }
 
 
-#ifndef DR_MP3_NO_STDIO
-#include <stdio.h>
-#include <wchar.h>      /* For wcslen(), wcsrtombs() */
+static void drmp3__take_icy_metadata(drmp3* pMP3)
+{
+    /* Each block of ICY metadata is a length byte, counting in 16 byte units, followed by that many bytes of metadata. */
+    size_t bytesToTake;
 
-/* drmp3_result_from_errno() is only used inside DR_MP3_NO_STDIO for now. Move this out if it's ever used elsewhere. */
-#include <errno.h>
-static drmp3_result drmp3_result_from_errno(int e)
+    if (pMP3->push.icyMetadataSize == 0) {
+        pMP3->push.icyMetadataSize  = (drmp3_uint32)pMP3->push.pPendingData[0] * 16;
+        pMP3->push.icyMetadataPos   = 0;
+        pMP3->push.pPendingData    += 1;
+        pMP3->push.pendingDataSize -= 1;
+
+        if (pMP3->push.icyMetadataSize == 0) {
+            pMP3->push.icyBytesToMetadata = pMP3->push.icyMetadataInterval;
+            return;
+        }
+    }
+
+    bytesToTake = pMP3->push.icyMetadataSize - pMP3->push.icyMetadataPos;
+    if (bytesToTake > pMP3->push.pendingDataSize) {
+        bytesToTake = pMP3->push.pendingDataSize;
+    }
+
+    if (pMP3->push.pIcyMetadata != NULL) {
+        DRMP3_COPY_MEMORY(pMP3->push.pIcyMetadata + pMP3->push.icyMetadataPos, pMP3->push.pPendingData, bytesToTake);
+    }
+
+    pMP3->push.icyMetadataPos  += (drmp3_uint32)bytesToTake;
+    pMP3->push.pPendingData    += bytesToTake;
+    pMP3->push.pendingDataSize -= bytesToTake;
+
+    if (pMP3->push.icyMetadataPos == pMP3->push.icyMetadataSize) {
+        if (pMP3->push.onIcyMetadata != NULL && pMP3->push.pIcyMetadata != NULL) {
+            pMP3->push.onIcyMetadata(pMP3->push.pIcyUserData, pMP3->push.pIcyMetadata, pMP3->push.icyMetadataSize);
+        }
+
+        pMP3->push.icyMetadataSize    = 0;
+        pMP3->push.icyBytesToMetadata = pMP3->push.icyMetadataInterval;
+    }
+}
+
+static size_t drmp3__on_read_push(void* pUserData, void* pBufferOut, size_t bytesToRead)
 {
-    switch (e)
-    {
-        case 0: return DRMP3_SUCCESS;
-    #ifdef EPERM
-        case EPERM: return DRMP3_INVALID_OPERATION;
-    #endif
-    #ifdef ENOENT
-        case ENOENT: return DRMP3_DOES_NOT_EXIST;
-    #endif
-    #ifdef ESRCH
-        case ESRCH: return DRMP3_DOES_NOT_EXIST;
-    #endif
-    #ifdef EINTR
-        case EINTR: return DRMP3_INTERRUPT;
-    #endif
-    #ifdef EIO
-        case EIO: return DRMP3_IO_ERROR;
-    #endif
-    #ifdef ENXIO
-        case ENXIO: return DRMP3_DOES_NOT_EXIST;
-    #endif
-    #ifdef E2BIG
-        case E2BIG: return DRMP3_INVALID_ARGS;
-    #endif
-    #ifdef ENOEXEC
-        case ENOEXEC: return DRMP3_INVALID_FILE;
-    #endif
-    #ifdef EBADF
-        case EBADF: return DRMP3_INVALID_FILE;
-    #endif
-    #ifdef ECHILD
-        case ECHILD: return DRMP3_ERROR;
-    #endif
-    #ifdef EAGAIN
-        case EAGAIN: return DRMP3_UNAVAILABLE;
+    /* There's only data to read while drmp3_push_data() is running. The decoder sees it as a stream that's run dry otherwise. */
+    drmp3* pMP3 = (drmp3*)pUserData;
+    size_t bytesRead = 0;
+
+    DRMP3_ASSERT(pMP3 != NULL);
+
+    while (bytesRead < bytesToRead && pMP3->push.pendingDataSize > 0) {
+        size_t bytesAvailable;
+
+        if (pMP3->push.icyMetadataInterval > 0 && pMP3->push.icyBytesToMetadata == 0) {
+            drmp3__take_icy_metadata(pMP3);
+            continue;
+        }
+
+        bytesAvailable = pMP3->push.pendingDataSize;
+        if (pMP3->push.icyMetadataInterval > 0 && bytesAvailable > pMP3->push.icyBytesToMetadata) {
+            bytesAvailable = pMP3->push.icyBytesToMetadata;
+        }
+
+        if (pMP3->push.bytesToSkip > 0) {
+            /* The rest of a tag that didn't fit in the input buffer. It's still part of the stream so the cursor moves past it. */
+            if (bytesAvailable > pMP3->push.bytesToSkip) {
+                bytesAvailable = (size_t)pMP3->push.bytesToSkip;
+            }
+
+            pMP3->push.bytesToSkip -= bytesAvailable;
+            pMP3->streamCursor     += bytesAvailable;
+        } else {
+            if (bytesAvailable > bytesToRead - bytesRead) {
+                bytesAvailable = bytesToRead - bytesRead;
+            }
+
+            DRMP3_COPY_MEMORY((drmp3_uint8*)pBufferOut + bytesRead, pMP3->push.pPendingData, bytesAvailable);
+            bytesRead += bytesAvailable;
+        }
+
+        pMP3->push.pPendingData    += bytesAvailable;
+        pMP3->push.pendingDataSize -= bytesAvailable;
+
+        if (pMP3->push.icyMetadataInterval > 0) {
+            pMP3->push.icyBytesToMetadata -= (drmp3_uint32)bytesAvailable;
+        }
+    }
+
+    return bytesRead;
+}
+
+DRMP3_API drmp3_bool32 drmp3_init_push(drmp3* pMP3, const drmp3_allocation_callbacks* pAllocationCallbacks)
+{
+    if (pMP3 == NULL) {
+        return DRMP3_FALSE;
+    }
+
+    DRMP3_ZERO_OBJECT(pMP3);
+
+    /* The first frame is decoded once enough data has been pushed. */
+    pMP3->push.isEnabled = DRMP3_TRUE;
+
+    return drmp3__init_callbacks(pMP3, drmp3__on_read_push, NULL, pMP3, pAllocationCallbacks);
+}
+
+DRMP3_API size_t drmp3_push_data(drmp3* pMP3, const void* pData, size_t dataSize)
+{
+    size_t bytesTaken;
+
+    if (pMP3 == NULL || !pMP3->push.isEnabled || pMP3->push.isComplete || pData == NULL) {
+        return 0;
+    }
+
+    if (pMP3->pData == NULL || pMP3->isSuspended) {
+        if (!drmp3_resume(pMP3)) {
+            return 0; /* Out of memory. */
+        }
+    }
+
+    /* The data is only ever read from inside this call. Whatever doesn't fit in the input buffer is left for the client to push again. */
+    pMP3->push.pPendingData    = (const drmp3_uint8*)pData;
+    pMP3->push.pendingDataSize = dataSize;
+
+    drmp3__fill_data_buffer(pMP3);
+    bytesTaken = dataSize - pMP3->push.pendingDataSize;
+
+    pMP3->push.pPendingData    = NULL;
+    pMP3->push.pendingDataSize = 0;
+
+    if (pMP3->channels == 0) {
+        drmp3__read_first_frame(pMP3);
+    }
+
+    return bytesTaken;
+}
+
+DRMP3_API void drmp3_push_end(drmp3* pMP3)
+{
+    if (pMP3 == NULL || !pMP3->push.isEnabled) {
+        return;
+    }
+
+    pMP3->push.isComplete = DRMP3_TRUE;
+
+    /* A stream that's shorter than the amount of data needed to find the first frame hasn't been decoded yet. */
+    if (pMP3->channels == 0) {
+        drmp3__read_first_frame(pMP3);
+    }
+}
+
+DRMP3_API drmp3_bool32 drmp3_set_icy_metadata_interval(drmp3* pMP3, drmp3_uint32 metadataInterval, drmp3_icy_metadata_proc onMetadata, void* pUserData)
+{
+    if (pMP3 == NULL || !pMP3->push.isEnabled) {
+        return DRMP3_FALSE;
+    }
+
+    /* Blocks are only held on to when there's someone to give them to. They're dropped as they're pushed otherwise. */
+    if (onMetadata != NULL && metadataInterval > 0 && pMP3->push.pIcyMetadata == NULL) {
+        pMP3->push.pIcyMetadata = (char*)drmp3__malloc_from_callbacks(DRMP3_MAX_ICY_METADATA_SIZE, &pMP3->allocationCallbacks);
+        if (pMP3->push.pIcyMetadata == NULL) {
+            return DRMP3_FALSE;
+        }
+    }
+
+    pMP3->push.icyMetadataInterval = metadataInterval;
+    pMP3->push.icyBytesToMetadata  = metadataInterval;
+    pMP3->push.icyMetadataSize     = 0;
+    pMP3->push.icyMetadataPos      = 0;
+    pMP3->push.onIcyMetadata       = onMetadata;
+    pMP3->push.pIcyUserData        = pUserData;
+
+    return DRMP3_TRUE;
+}
+
+
+#ifndef DR_MP3_NO_STDIO
+#include <stdio.h>
+#include <wchar.h>      /* For wcslen(), wcsrtombs() */
+
+/* drmp3_result_from_errno() is only used inside DR_MP3_NO_STDIO for now. Move this out if it's ever used elsewhere. */
+#include <errno.h>
+static drmp3_result drmp3_result_from_errno(int e)
+{
+    switch (e)
+    {
+        case 0: return DRMP3_SUCCESS;
+    #ifdef EPERM
+        case EPERM: return DRMP3_INVALID_OPERATION;
+    #endif
+    #ifdef ENOENT
+        case ENOENT: return DRMP3_DOES_NOT_EXIST;
+    #endif
+    #ifdef ESRCH
+        case ESRCH: return DRMP3_DOES_NOT_EXIST;
+    #endif
+    #ifdef EINTR
+        case EINTR: return DRMP3_INTERRUPT;
+    #endif
+    #ifdef EIO
+        case EIO: return DRMP3_IO_ERROR;
+    #endif
+    #ifdef ENXIO
+        case ENXIO: return DRMP3_DOES_NOT_EXIST;
+    #endif
+    #ifdef E2BIG
+        case E2BIG: return DRMP3_INVALID_ARGS;
+    #endif
+    #ifdef ENOEXEC
+        case ENOEXEC: return DRMP3_INVALID_FILE;
+    #endif
+    #ifdef EBADF
+        case EBADF: return DRMP3_INVALID_FILE;
+    #endif
+    #ifdef ECHILD
+        case ECHILD: return DRMP3_ERROR;
+    #endif
+    #ifdef EAGAIN
+        case EAGAIN: return DRMP3_UNAVAILABLE;
     #endif
     #ifdef ENOMEM
         case ENOMEM: return DRMP3_OUT_OF_MEMORY;
@@ -3318,606 +5657,1914 @@ static drmp3_result drmp3_result_from_errno(int e)
     }
 }
 
-static drmp3_result drmp3_fopen(FILE** ppFile, const char* pFilePath, const char* pOpenMode)
+static drmp3_result drmp3_fopen(FILE** ppFile, const char* pFilePath, const char* pOpenMode)
+{
+#if _MSC_VER && _MSC_VER >= 1400
+    errno_t err;
+#endif
+
+    if (ppFile != NULL) {
+        *ppFile = NULL;  /* Safety. */
+    }
+
+    if (pFilePath == NULL || pOpenMode == NULL || ppFile == NULL) {
+        return DRMP3_INVALID_ARGS;
+    }
+
+#if _MSC_VER && _MSC_VER >= 1400
+    err = fopen_s(ppFile, pFilePath, pOpenMode);
+    if (err != 0) {
+        return drmp3_result_from_errno(err);
+    }
+#else
+#if defined(_WIN32) || defined(__APPLE__)
+    *ppFile = fopen(pFilePath, pOpenMode);
+#else
+    #if defined(_FILE_OFFSET_BITS) && _FILE_OFFSET_BITS == 64 && defined(_LARGEFILE64_SOURCE)
+        *ppFile = fopen64(pFilePath, pOpenMode);
+    #else
+        *ppFile = fopen(pFilePath, pOpenMode);
+    #endif
+#endif
+    if (*ppFile == NULL) {
+        drmp3_result result = drmp3_result_from_errno(errno);
+        if (result == DRMP3_SUCCESS) {
+            result = DRMP3_ERROR;   /* Just a safety check to make sure we never ever return success when pFile == NULL. */
+        }
+
+        return result;
+    }
+#endif
+
+    return DRMP3_SUCCESS;
+}
+
+/*
+_wfopen() isn't always available in all compilation environments.
+
+    * Windows only.
+    * MSVC seems to support it universally as far back as VC6 from what I can tell (haven't checked further back).
+    * MinGW-64 (both 32- and 64-bit) seems to support it.
+    * MinGW wraps it in !defined(__STRICT_ANSI__).
+
+This can be reviewed as compatibility issues arise. The preference is to use _wfopen_s() and _wfopen() as opposed to the wcsrtombs()
+fallback, so if you notice your compiler not detecting this properly I'm happy to look at adding support.
+*/
+#if defined(_WIN32)
+    #if defined(_MSC_VER) || defined(__MINGW64__) || !defined(__STRICT_ANSI__)
+        #define DRMP3_HAS_WFOPEN
+    #endif
+#endif
+
+#if !defined(DRMP3_HAS_WFOPEN)
+/*
+Converts a wide path to a multibyte one for the narrow file APIs. This is annoying because the conversion is locale specific. The only real way
+I can think of to do this is with wcsrtombs(). Note that wcstombs() is apparently not thread-safe because it uses a static global mbstate_t
+object for maintaining state. I've checked this with -std=c89 and it works, but if somebody get's a compiler error I'll look into improving
+compatibility. Free the returned string with drmp3__free_from_callbacks().
+*/
+static drmp3_result drmp3__wcstombs_alloc(char** ppPathMB, const wchar_t* pPath, const drmp3_allocation_callbacks* pAllocationCallbacks)
+{
+    mbstate_t mbs;
+    size_t lenMB;
+    const wchar_t* pPathTemp = pPath;
+    char* pPathMB;
+
+    *ppPathMB = NULL;
+
+    /* Get the length first. */
+    DRMP3_ZERO_OBJECT(&mbs);
+    lenMB = wcsrtombs(NULL, &pPathTemp, 0, &mbs);
+    if (lenMB == (size_t)-1) {
+        return drmp3_result_from_errno(errno);
+    }
+
+    pPathMB = (char*)drmp3__malloc_from_callbacks(lenMB + 1, pAllocationCallbacks);
+    if (pPathMB == NULL) {
+        return DRMP3_OUT_OF_MEMORY;
+    }
+
+    pPathTemp = pPath;
+    DRMP3_ZERO_OBJECT(&mbs);
+    wcsrtombs(pPathMB, &pPathTemp, lenMB + 1, &mbs);
+
+    *ppPathMB = pPathMB;
+    return DRMP3_SUCCESS;
+}
+#endif
+
+static drmp3_result drmp3_wfopen(FILE** ppFile, const wchar_t* pFilePath, const wchar_t* pOpenMode, const drmp3_allocation_callbacks* pAllocationCallbacks)
+{
+    if (ppFile != NULL) {
+        *ppFile = NULL;  /* Safety. */
+    }
+
+    if (pFilePath == NULL || pOpenMode == NULL || ppFile == NULL) {
+        return DRMP3_INVALID_ARGS;
+    }
+
+#if defined(DRMP3_HAS_WFOPEN)
+    {
+        /* Use _wfopen() on Windows. */
+    #if defined(_MSC_VER) && _MSC_VER >= 1400
+        errno_t err = _wfopen_s(ppFile, pFilePath, pOpenMode);
+        if (err != 0) {
+            return drmp3_result_from_errno(err);
+        }
+    #else
+        *ppFile = _wfopen(pFilePath, pOpenMode);
+        if (*ppFile == NULL) {
+            return drmp3_result_from_errno(errno);
+        }
+    #endif
+        (void)pAllocationCallbacks;
+    }
+#else
+    /* Use fopen() on anything other than Windows. Requires a conversion. */
+    {
+        drmp3_result result;
+        char* pFilePathMB = NULL;
+        char pOpenModeMB[32] = {0};
+        drmp3_allocation_callbacks allocationCallbacks = drmp3_copy_allocation_callbacks_or_defaults(pAllocationCallbacks);
+
+        result = drmp3__wcstombs_alloc(&pFilePathMB, pFilePath, &allocationCallbacks);
+        if (result != DRMP3_SUCCESS) {
+            return result;
+        }
+
+        /* The open mode should always consist of ASCII characters so we should be able to do a trivial conversion. */
+        {
+            size_t i = 0;
+            for (;;) {
+                if (pOpenMode[i] == 0) {
+                    pOpenModeMB[i] = '\0';
+                    break;
+                }
+
+                pOpenModeMB[i] = (char)pOpenMode[i];
+                i += 1;
+            }
+        }
+
+        *ppFile = fopen(pFilePathMB, pOpenModeMB);
+
+        drmp3__free_from_callbacks(pFilePathMB, &allocationCallbacks);
+    }
+
+    if (*ppFile == NULL) {
+        return DRMP3_ERROR;
+    }
+#endif
+
+    return DRMP3_SUCCESS;
+}
+
+
+
+static size_t drmp3__on_read_stdio(void* pUserData, void* pBufferOut, size_t bytesToRead)
+{
+    return fread(pBufferOut, 1, bytesToRead, (FILE*)pUserData);
+}
+
+static drmp3_bool32 drmp3__on_seek_stdio(void* pUserData, int offset, drmp3_seek_origin origin)
+{
+    return fseek((FILE*)pUserData, offset, (origin == drmp3_seek_origin_current) ? SEEK_CUR : SEEK_SET) == 0;
+}
+
+DRMP3_API drmp3_bool32 drmp3_init_file(drmp3* pMP3, const char* pFilePath, const drmp3_allocation_callbacks* pAllocationCallbacks)
+{
+    FILE* pFile;
+    if (drmp3_fopen(&pFile, pFilePath, "rb") != DRMP3_SUCCESS) {
+        return DRMP3_FALSE;
+    }
+
+    return drmp3_init(pMP3, drmp3__on_read_stdio, drmp3__on_seek_stdio, (void*)pFile, pAllocationCallbacks);
+}
+
+DRMP3_API drmp3_bool32 drmp3_init_file_w(drmp3* pMP3, const wchar_t* pFilePath, const drmp3_allocation_callbacks* pAllocationCallbacks)
+{
+    FILE* pFile;
+    if (drmp3_wfopen(&pFile, pFilePath, L"rb", pAllocationCallbacks) != DRMP3_SUCCESS) {
+        return DRMP3_FALSE;
+    }
+
+    return drmp3_init(pMP3, drmp3__on_read_stdio, drmp3__on_seek_stdio, (void*)pFile, pAllocationCallbacks);
+}
+
+#if !defined(DR_MP3_NO_MMAP)
+    #if defined(_WIN32)
+        #define DRMP3_HAS_MMAP
+    #elif defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__))
+        #define DRMP3_HAS_MMAP
+        #include <sys/types.h>
+        #include <sys/stat.h>
+        #include <sys/mman.h>
+        #include <fcntl.h>
+        #include <unistd.h>
+    #endif
+#endif
+
+#if defined(DRMP3_HAS_MMAP)
+#if defined(_WIN32)
+/*
+The few Win32 functions needed for mapping are declared here rather than including windows.h which would drag the whole of the
+Windows API, and macros like min and max, into the client's translation unit. The types are the ones windows.h resolves to so the
+declarations are compatible with it if it's included as well.
+*/
+#define DRMP3_WIN32_GENERIC_READ                0x80000000
+#define DRMP3_WIN32_FILE_SHARE_READ             0x00000001
+#define DRMP3_WIN32_OPEN_EXISTING               3
+#define DRMP3_WIN32_FILE_ATTRIBUTE_NORMAL       0x00000080
+#define DRMP3_WIN32_FILE_FLAG_SEQUENTIAL_SCAN   0x08000000
+#define DRMP3_WIN32_PAGE_READONLY               0x02
+#define DRMP3_WIN32_FILE_MAP_READ               0x0004
+#define DRMP3_WIN32_INVALID_FILE_SIZE           0xFFFFFFFF
+#define DRMP3_WIN32_INVALID_HANDLE_VALUE        ((void*)(size_t)-1)
+
+#if !defined(_WINDOWS_) && !defined(_INC_WINDOWS)
+#if defined(_WIN64)
+typedef drmp3_uint64  drmp3_win32_size_t;     /* SIZE_T */
+#else
+typedef unsigned long drmp3_win32_size_t;
+#endif
+
+struct _SECURITY_ATTRIBUTES;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+__declspec(dllimport) void*         __stdcall CreateFileA(const char* lpFileName, unsigned long dwDesiredAccess, unsigned long dwShareMode, struct _SECURITY_ATTRIBUTES* lpSecurityAttributes, unsigned long dwCreationDisposition, unsigned long dwFlagsAndAttributes, void* hTemplateFile);
+__declspec(dllimport) void*         __stdcall CreateFileW(const wchar_t* lpFileName, unsigned long dwDesiredAccess, unsigned long dwShareMode, struct _SECURITY_ATTRIBUTES* lpSecurityAttributes, unsigned long dwCreationDisposition, unsigned long dwFlagsAndAttributes, void* hTemplateFile);
+__declspec(dllimport) unsigned long __stdcall GetFileSize(void* hFile, unsigned long* lpFileSizeHigh);
+__declspec(dllimport) void*         __stdcall CreateFileMappingW(void* hFile, struct _SECURITY_ATTRIBUTES* lpFileMappingAttributes, unsigned long flProtect, unsigned long dwMaximumSizeHigh, unsigned long dwMaximumSizeLow, const wchar_t* lpName);
+__declspec(dllimport) void*         __stdcall MapViewOfFile(void* hFileMappingObject, unsigned long dwDesiredAccess, unsigned long dwFileOffsetHigh, unsigned long dwFileOffsetLow, drmp3_win32_size_t dwNumberOfBytesToMap);
+__declspec(dllimport) int           __stdcall UnmapViewOfFile(const void* lpBaseAddress);
+__declspec(dllimport) int           __stdcall CloseHandle(void* hObject);
+#ifdef __cplusplus
+}
+#endif
+#endif  /* windows.h */
+#endif  /* _WIN32 */
+
+/* A file opened for mapping. This is a HANDLE on Windows and a file descriptor everywhere else. */
+#if defined(_WIN32)
+typedef void* drmp3__mmap_file;
+#define DRMP3_MMAP_INVALID_FILE     DRMP3_WIN32_INVALID_HANDLE_VALUE
+#else
+typedef int drmp3__mmap_file;
+#define DRMP3_MMAP_INVALID_FILE     -1
+#endif
+
+static drmp3__mmap_file drmp3__open_file_for_mmap(const char* pFilePath)
+{
+#if defined(_WIN32)
+    return CreateFileA(pFilePath, DRMP3_WIN32_GENERIC_READ, DRMP3_WIN32_FILE_SHARE_READ, NULL, DRMP3_WIN32_OPEN_EXISTING, DRMP3_WIN32_FILE_ATTRIBUTE_NORMAL | DRMP3_WIN32_FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+#else
+    return open(pFilePath, O_RDONLY);
+#endif
+}
+
+static drmp3__mmap_file drmp3__open_file_for_mmap_w(const wchar_t* pFilePath, const drmp3_allocation_callbacks* pAllocationCallbacks)
+{
+#if defined(_WIN32)
+    (void)pAllocationCallbacks;
+    return CreateFileW(pFilePath, DRMP3_WIN32_GENERIC_READ, DRMP3_WIN32_FILE_SHARE_READ, NULL, DRMP3_WIN32_OPEN_EXISTING, DRMP3_WIN32_FILE_ATTRIBUTE_NORMAL | DRMP3_WIN32_FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+#else
+    /* There's no wide version of open() so the path needs converting, just like drmp3_wfopen() does for fopen(). */
+    drmp3__mmap_file fd;
+    char* pFilePathMB;
+    drmp3_allocation_callbacks allocationCallbacks = drmp3_copy_allocation_callbacks_or_defaults(pAllocationCallbacks);
+
+    if (drmp3__wcstombs_alloc(&pFilePathMB, pFilePath, &allocationCallbacks) != DRMP3_SUCCESS) {
+        return DRMP3_MMAP_INVALID_FILE;
+    }
+
+    fd = open(pFilePathMB, O_RDONLY);
+
+    drmp3__free_from_callbacks(pFilePathMB, &allocationCallbacks);
+    return fd;
+#endif
+}
+
+/* Maps the whole of a file opened with drmp3__open_file_for_mmap(). The file is always closed, whether or not it could be mapped. */
+static drmp3_result drmp3__map_file(drmp3__mmap_file hFile, void** ppData, size_t* pDataSize)
+{
+#if defined(_WIN32)
+    void* hMapping;
+    unsigned long fileSizeLo;
+    unsigned long fileSizeHi;
+    drmp3_uint64 fileSize;
+    void* pData;
+
+    /* INVALID_FILE_SIZE is a valid low half for files of 4GB or more so it's only an error if the high half is also set to it. */
+    fileSizeHi = DRMP3_WIN32_INVALID_FILE_SIZE;
+    fileSizeLo = GetFileSize(hFile, &fileSizeHi);
+    fileSize   = ((drmp3_uint64)fileSizeHi << 32) | fileSizeLo;
+    if (fileSizeLo == DRMP3_WIN32_INVALID_FILE_SIZE && fileSizeHi == DRMP3_WIN32_INVALID_FILE_SIZE) {
+        fileSize = 0;
+    }
+
+    if (fileSize == 0 || fileSize > (drmp3_uint64)((size_t)-1)) {
+        CloseHandle(hFile);
+        return DRMP3_ERROR;
+    }
+
+    hMapping = CreateFileMappingW(hFile, NULL, DRMP3_WIN32_PAGE_READONLY, 0, 0, NULL);
+    if (hMapping == NULL) {
+        CloseHandle(hFile);
+        return DRMP3_ERROR;
+    }
+
+    pData = MapViewOfFile(hMapping, DRMP3_WIN32_FILE_MAP_READ, 0, 0, 0);
+
+    /* The view keeps the file open. */
+    CloseHandle(hMapping);
+    CloseHandle(hFile);
+
+    if (pData == NULL) {
+        return DRMP3_ERROR;
+    }
+
+    *ppData    = pData;
+    *pDataSize = (size_t)fileSize;
+    return DRMP3_SUCCESS;
+#else
+    int fd = hFile;
+    struct stat info;
+    void* pData;
+
+    if (fstat(fd, &info) != 0 || info.st_size <= 0 || (drmp3_uint64)info.st_size > (drmp3_uint64)((size_t)-1)) {
+        close(fd);
+        return DRMP3_ERROR;
+    }
+
+    pData = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    /* The mapping keeps the file open. */
+    close(fd);
+
+    if (pData == MAP_FAILED) {
+        return drmp3_result_from_errno(errno);
+    }
+
+    /* Frames are read front to back so let the kernel read ahead aggressively. This is only a hint so failure doesn't matter. */
+#if defined(MADV_SEQUENTIAL)
+    madvise(pData, (size_t)info.st_size, MADV_SEQUENTIAL);
+#endif
+
+    *ppData    = pData;
+    *pDataSize = (size_t)info.st_size;
+    return DRMP3_SUCCESS;
+#endif
+}
+
+static void drmp3__unmap_file(const void* pData, size_t dataSize)
+{
+#if defined(_WIN32)
+    (void)dataSize;
+    UnmapViewOfFile(pData);
+#else
+    munmap((void*)pData, dataSize);
+#endif
+}
+
+/*
+Shared by drmp3_init_file_mmap() and drmp3_init_file_mmap_w(). The file is always closed. Returns DRMP3_ERROR if the file could not be
+mapped, in which case the caller falls back to reading it normally. DRMP3_INVALID_FILE is returned if the file was mapped but isn't an
+MP3 stream.
+*/
+static drmp3_result drmp3__init_mapped_file(drmp3* pMP3, drmp3__mmap_file hFile, const drmp3_allocation_callbacks* pAllocationCallbacks)
+{
+    void* pData = NULL;
+    size_t dataSize = 0;
+
+    if (hFile == DRMP3_MMAP_INVALID_FILE) {
+        return DRMP3_ERROR;
+    }
+
+    if (drmp3__map_file(hFile, &pData, &dataSize) != DRMP3_SUCCESS) {
+        return DRMP3_ERROR;
+    }
+
+    if (!drmp3_init_memory(pMP3, pData, dataSize, pAllocationCallbacks)) {
+        drmp3__unmap_file(pData, dataSize);
+        return DRMP3_INVALID_FILE;
+    }
+
+    pMP3->memory.isMappedFile = DRMP3_TRUE;
+    return DRMP3_SUCCESS;
+}
+#endif
+
+DRMP3_API drmp3_bool32 drmp3_init_file_mmap(drmp3* pMP3, const char* pFilePath, const drmp3_allocation_callbacks* pAllocationCallbacks)
+{
+#if defined(DRMP3_HAS_MMAP)
+    if (pMP3 != NULL && pFilePath != NULL) {
+        drmp3_result result = drmp3__init_mapped_file(pMP3, drmp3__open_file_for_mmap(pFilePath), pAllocationCallbacks);
+        if (result != DRMP3_ERROR) {
+            return result == DRMP3_SUCCESS;
+        }
+    }
+#endif
+
+    return drmp3_init_file(pMP3, pFilePath, pAllocationCallbacks);
+}
+
+DRMP3_API drmp3_bool32 drmp3_init_file_mmap_w(drmp3* pMP3, const wchar_t* pFilePath, const drmp3_allocation_callbacks* pAllocationCallbacks)
+{
+#if defined(DRMP3_HAS_MMAP)
+    if (pMP3 != NULL && pFilePath != NULL) {
+        drmp3_result result = drmp3__init_mapped_file(pMP3, drmp3__open_file_for_mmap_w(pFilePath, pAllocationCallbacks), pAllocationCallbacks);
+        if (result != DRMP3_ERROR) {
+            return result == DRMP3_SUCCESS;
+        }
+    }
+#endif
+
+    return drmp3_init_file_w(pMP3, pFilePath, pAllocationCallbacks);
+}
+#endif
+
+/* Retrieves the size of the stream in bytes. Returns false if it's not known, which is the case for streams read with callbacks. */
+static drmp3_bool32 drmp3__get_stream_size(drmp3* pMP3, drmp3_uint64* pStreamSize)
+{
+    if (pMP3->memory.pData != NULL) {
+        *pStreamSize = pMP3->memory.dataSize;
+        return DRMP3_TRUE;
+    }
+
+#ifndef DR_MP3_NO_STDIO
+    if (pMP3->onRead == drmp3__on_read_stdio) {
+        FILE* pFile = (FILE*)pMP3->pUserData;
+        long cursor;
+        long size;
+
+        cursor = ftell(pFile);
+        if (cursor < 0 || fseek(pFile, 0, SEEK_END) != 0) {
+            return DRMP3_FALSE;
+        }
+
+        size = ftell(pFile);
+        if (fseek(pFile, cursor, SEEK_SET) != 0 || size < 0) {
+            return DRMP3_FALSE;
+        }
+
+        *pStreamSize = (drmp3_uint64)size;
+        return DRMP3_TRUE;
+    }
+#endif
+
+    return DRMP3_FALSE;
+}
+
+DRMP3_API void drmp3_uninit(drmp3* pMP3)
+{
+    if (pMP3 == NULL) {
+        return;
+    }
+    
+#ifndef DR_MP3_NO_STDIO
+    if (pMP3->onRead == drmp3__on_read_stdio) {
+        fclose((FILE*)pMP3->pUserData);
+    }
+
+#if defined(DRMP3_HAS_MMAP)
+    if (pMP3->memory.isMappedFile) {
+        drmp3__unmap_file(pMP3->memory.pData, pMP3->memory.dataSize);
+    }
+#endif
+#endif
+
+    if (!pMP3->isPreallocated) {
+        drmp3__free_from_callbacks(pMP3->pData, &pMP3->allocationCallbacks);
+    #if defined(DR_MP3_COMPACT)
+        drmp3__free_from_callbacks(pMP3->pcmFrames, &pMP3->allocationCallbacks);
+    #endif
+    }
+
+    drmp3__free_from_callbacks(pMP3->converter.pTaps, &pMP3->allocationCallbacks);
+    drmp3__free_from_callbacks(pMP3->push.pIcyMetadata, &pMP3->allocationCallbacks);
+}
+
+#if defined(DR_MP3_FLOAT_OUTPUT)
+static void drmp3_f32_to_s16(drmp3_int16* dst, const float* src, drmp3_uint64 sampleCount)
+{
+    drmp3_uint64 i;
+    drmp3_uint64 i4;
+    drmp3_uint64 sampleCount4;
+
+    /* Unrolled. */
+    i = 0;
+    sampleCount4 = sampleCount >> 2;
+    for (i4 = 0; i4 < sampleCount4; i4 += 1) {
+        float x0 = src[i+0];
+        float x1 = src[i+1];
+        float x2 = src[i+2];
+        float x3 = src[i+3];
+
+        x0 = ((x0 < -1) ? -1 : ((x0 > 1) ? 1 : x0));
+        x1 = ((x1 < -1) ? -1 : ((x1 > 1) ? 1 : x1));
+        x2 = ((x2 < -1) ? -1 : ((x2 > 1) ? 1 : x2));
+        x3 = ((x3 < -1) ? -1 : ((x3 > 1) ? 1 : x3));
+
+        x0 = x0 * 32767.0f;
+        x1 = x1 * 32767.0f;
+        x2 = x2 * 32767.0f;
+        x3 = x3 * 32767.0f;
+
+        dst[i+0] = (drmp3_int16)x0;
+        dst[i+1] = (drmp3_int16)x1;
+        dst[i+2] = (drmp3_int16)x2;
+        dst[i+3] = (drmp3_int16)x3;
+
+        i += 4;
+    }
+
+    /* Leftover. */
+    for (; i < sampleCount; i += 1) {
+        float x = src[i];
+        x = ((x < -1) ? -1 : ((x > 1) ? 1 : x));    /* clip */
+        x = x * 32767.0f;                           /* -1..1 to -32767..32767 */
+
+        dst[i] = (drmp3_int16)x;
+    }
+}
+#endif
+
+#if !defined(DR_MP3_FLOAT_OUTPUT)
+static void drmp3_s16_to_f32(float* dst, const drmp3_int16* src, drmp3_uint64 sampleCount)
+{
+    drmp3_uint64 i;
+    for (i = 0; i < sampleCount; i += 1) {
+        float x = (float)src[i];
+        x = x * 0.000030517578125f;         /* -32768..32767 to -1..0.999969482421875 */
+        dst[i] = x;
+    }
+}
+#endif
+
+
+static drmp3_uint64 drmp3_read_pcm_frames_raw(drmp3* pMP3, drmp3_uint64 framesToRead, void* pBufferOut)
+{
+    drmp3_uint64 totalFramesRead = 0;
+    drmp3_bool32 isFrameInOutput = DRMP3_FALSE;   /* Set when the current MP3 frame was decoded straight into pBufferOut. */
+    drmp3_uint32 channels;
+
+    DRMP3_ASSERT(pMP3 != NULL);
+    DRMP3_ASSERT(pMP3->onRead != NULL);
+
+    channels = drmp3__get_decoded_channels(pMP3, pMP3->converter.channelsIn);
+
+    while (framesToRead > 0) {
+        drmp3_uint32 framesToConsume;
+
+        /*
+        For gapless streams we need to trim the encoder delay and padding. This only needs to be checked at MP3 frame boundaries
+        so it is done by just adjusting the range of PCM frames in the current MP3 frame that we're allowed to output.
+        */
+        if (pMP3->vbrTag.hasGaplessInfo) {
+            if (pMP3->pcmFramesToTrimAtStart > 0) {
+                drmp3_uint32 framesToTrim = DRMP3_MIN(pMP3->pcmFramesToTrimAtStart, pMP3->pcmFramesRemainingInMP3Frame);
+                pMP3->pcmFramesConsumedInMP3Frame  += framesToTrim;
+                pMP3->pcmFramesRemainingInMP3Frame -= framesToTrim;
+                pMP3->pcmFramesToTrimAtStart       -= framesToTrim;
+            }
+
+            if (pMP3->vbrTag.mp3FrameCount > 0) {
+                drmp3_uint64 totalPCMFrameCount = drmp3__get_pcm_frame_count_from_vbr_tag(pMP3);
+                if (pMP3->currentPCMFrame + pMP3->pcmFramesRemainingInMP3Frame > totalPCMFrameCount) {
+                    if (pMP3->currentPCMFrame >= totalPCMFrameCount) {
+                        break;  /* We've reached the end of the stream. Don't bother decoding the padding. */
+                    }
+
+                    pMP3->pcmFramesRemainingInMP3Frame = (drmp3_uint32)(totalPCMFrameCount - pMP3->currentPCMFrame);
+                }
+            }
+        }
+
+        framesToConsume = (drmp3_uint32)DRMP3_MIN(pMP3->pcmFramesRemainingInMP3Frame, framesToRead);
+        if (pBufferOut != NULL && !isFrameInOutput) {
+            /* These are always in the channel count of the decoder. Any conversion to the output format is done by the caller. */
+        #if defined(DR_MP3_FLOAT_OUTPUT)
+            /* f32 */
+            float* pFramesOutF32 = (float*)DRMP3_OFFSET_PTR(pBufferOut,          sizeof(float) * totalFramesRead                   * channels);
+            float* pFramesInF32  = (float*)DRMP3_OFFSET_PTR(&pMP3->pcmFrames[0], sizeof(float) * pMP3->pcmFramesConsumedInMP3Frame * pMP3->mp3FrameChannels);
+            DRMP3_COPY_MEMORY(pFramesOutF32, pFramesInF32, sizeof(float) * framesToConsume * channels);
+        #else
+            /* s16 */
+            drmp3_int16* pFramesOutS16 = (drmp3_int16*)DRMP3_OFFSET_PTR(pBufferOut,          sizeof(drmp3_int16) * totalFramesRead                   * channels);
+            drmp3_int16* pFramesInS16  = (drmp3_int16*)DRMP3_OFFSET_PTR(&pMP3->pcmFrames[0], sizeof(drmp3_int16) * pMP3->pcmFramesConsumedInMP3Frame * pMP3->mp3FrameChannels);
+            DRMP3_COPY_MEMORY(pFramesOutS16, pFramesInS16, sizeof(drmp3_int16) * framesToConsume * channels);
+        #endif
+        }
+
+        pMP3->currentPCMFrame              += framesToConsume;
+        pMP3->pcmFramesConsumedInMP3Frame  += framesToConsume;
+        pMP3->pcmFramesRemainingInMP3Frame -= framesToConsume;
+        totalFramesRead                    += framesToConsume;
+        framesToRead                       -= framesToConsume;
+
+        if (framesToRead == 0) {
+            break;
+        }
+
+        DRMP3_ASSERT(pMP3->pcmFramesRemainingInMP3Frame == 0);
+
+        /*
+        At this point we have exhausted our in-memory buffer so we need to re-fill. Note that the sample rate may have changed
+        at this point which means we'll also need to update our sample rate conversion pipeline.
+
+        When there's room for a whole MP3 frame in the output buffer it's decoded straight into it rather than going through
+        pcmFrames. The whole frame is then always consumed by the next iteration. This isn't done while the encoder delay is being
+        trimmed since the frame would need to be moved down.
+        */
+        if (pBufferOut != NULL && framesToRead * channels >= DRMP3_MAX_SAMPLES_PER_FRAME && pMP3->pcmFramesToTrimAtStart == 0) {
+            drmp3d_sample_t* pFramesOut = (drmp3d_sample_t*)DRMP3_OFFSET_PTR(pBufferOut, sizeof(drmp3d_sample_t) * totalFramesRead * channels);
+            if (drmp3_decode_next_frame_ex(pMP3, pFramesOut) == 0) {
+                break;
+            }
+
+            isFrameInOutput = DRMP3_TRUE;
+        } else {
+            if (drmp3_decode_next_frame(pMP3) == 0) {
+                break;
+            }
+
+            isFrameInOutput = DRMP3_FALSE;
+        }
+    }
+
+    return totalFramesRead;
+}
+
+
+/*
+Sample rate and channel conversion.
+
+Input frames are converted to f32 at the output channel count and kept in pFrames, one channel after the other, so that each output
+sample is a dot product of two contiguous arrays. The output frame at index k sits at input position k*downFactor/upFactor. Its
+integer part is framePos and its fractional part is phase/upFactor, which selects the row of filter taps. The filter is centered on
+the output position, so it needs (tapCount/2 - 1) frames of history before framePos and tapCount/2 frames of lookahead after it.
+Frames before the start of the stream are silence, and so are the frames after the end.
+
+Each output sample only depends on the input frames and its position, never on anything that was output before it. This is what
+makes seeking sample exact: it's just a matter of seeking the decoder to the first frame of history and setting the phase.
+*/
+static void drmp3__converter_make_taps(float* pTaps, drmp3_uint32 tapCount, drmp3_uint32 rowCount, drmp3_uint32 phaseDivisor, double cutoff)
+{
+    drmp3_uint32 iRow;
+    drmp3_uint32 iTap;
+    double halfLength = tapCount/2;
+
+    for (iRow = 0; iRow < rowCount; iRow += 1) {
+        float* pRow = pTaps + iRow*tapCount;
+        double sum = 0;
+
+        for (iTap = 0; iTap < tapCount; iTap += 1) {
+            /* The distance of the input frame from the output frame. Blackman windowed sinc. */
+            double x = (double)iTap - (halfLength - 1) - (double)iRow/phaseDivisor;
+            double h = (x == 0) ? cutoff : drmp3_sin(DRMP3_PI_D*cutoff*x) / (DRMP3_PI_D*x);
+            double w = 0.42 + 0.5*drmp3_cos(DRMP3_PI_D*x/halfLength) + 0.08*drmp3_cos(2*DRMP3_PI_D*x/halfLength);
+
+            pRow[iTap] = (float)(h*w);
+            sum += h*w;
+        }
+
+        /* Every phase is normalized so that a constant signal comes out unchanged. */
+        for (iTap = 0; iTap < tapCount; iTap += 1) {
+            pRow[iTap] = (float)(pRow[iTap] / sum);
+        }
+    }
+}
+
+static DRMP3_INLINE drmp3_uint32 drmp3__converter_history(const drmp3* pMP3)
+{
+    return (pMP3->converter.tapCount > 0) ? pMP3->converter.tapCount/2 - 1 : 0;
+}
+
+static DRMP3_INLINE drmp3_uint32 drmp3__converter_lookahead(const drmp3* pMP3)
+{
+    return pMP3->converter.tapCount/2;
+}
+
+static void drmp3__converter_reset(drmp3* pMP3, drmp3_uint32 silentFrameCount)
+{
+    drmp3_uint32 iChannel;
+
+    /* The first output frame is always at a whole input frame. */
+    pMP3->converter.phase      = 0;
+    pMP3->converter.framePos   = drmp3__converter_history(pMP3);
+    pMP3->converter.frameCount = silentFrameCount;
+    pMP3->converter.endPos     = 0;
+    pMP3->converter.atEnd      = DRMP3_FALSE;
+
+    for (iChannel = 0; iChannel < pMP3->channels; iChannel += 1) {
+        DRMP3_ZERO_MEMORY(pMP3->converter.pFrames + iChannel*pMP3->converter.frameCapacity, silentFrameCount * sizeof(float));
+    }
+}
+
+static DRMP3_INLINE float drmp3__sample_to_f32(drmp3d_sample_t x)
+{
+#if defined(DR_MP3_FLOAT_OUTPUT)
+    return x;
+#else
+    return x * 0.000030517578125f;
+#endif
+}
+
+/* Appends frames in the format of the decoder, converting them to the output channel count. */
+static void drmp3__converter_append(drmp3* pMP3, const drmp3d_sample_t* pFramesIn, drmp3_uint32 frameCount)
+{
+    drmp3_uint32 iFrame;
+    drmp3_uint32 channelsIn = drmp3__get_decoded_channels(pMP3, pMP3->converter.channelsIn);
+    float* pOut0 = pMP3->converter.pFrames + pMP3->converter.frameCount;
+    float* pOut1 = pOut0 + pMP3->converter.frameCapacity;
+
+    DRMP3_ASSERT(pMP3->converter.frameCount + frameCount <= pMP3->converter.frameCapacity);
+
+    if (pMP3->channels == 1) {
+        if (channelsIn == 1) {
+            for (iFrame = 0; iFrame < frameCount; iFrame += 1) {
+                pOut0[iFrame] = drmp3__sample_to_f32(pFramesIn[iFrame]);
+            }
+        } else {
+            for (iFrame = 0; iFrame < frameCount; iFrame += 1) {
+                pOut0[iFrame] = (drmp3__sample_to_f32(pFramesIn[iFrame*channelsIn + 0]) + drmp3__sample_to_f32(pFramesIn[iFrame*channelsIn + 1])) * 0.5f;
+            }
+        }
+    } else {
+        if (channelsIn == 1) {
+            for (iFrame = 0; iFrame < frameCount; iFrame += 1) {
+                pOut0[iFrame] = drmp3__sample_to_f32(pFramesIn[iFrame]);
+                pOut1[iFrame] = pOut0[iFrame];
+            }
+        } else {
+            for (iFrame = 0; iFrame < frameCount; iFrame += 1) {
+                pOut0[iFrame] = drmp3__sample_to_f32(pFramesIn[iFrame*channelsIn + 0]);
+                pOut1[iFrame] = drmp3__sample_to_f32(pFramesIn[iFrame*channelsIn + 1]);
+            }
+        }
+    }
+
+    pMP3->converter.frameCount += frameCount;
+}
+
+/*
+Drops the frames that are no longer needed and reads the next chunk of frames from the decoder. Returns false if there's nothing left
+to read. The end of the stream is padded with silence for the lookahead of the filter.
+*/
+static drmp3_bool32 drmp3__converter_fill(drmp3* pMP3)
+{
+    drmp3d_sample_t pFramesIn[DRMP3_CONVERTER_CHUNK_FRAMES*2];
+    drmp3_uint32 history   = drmp3__converter_history(pMP3);
+    drmp3_uint32 lookahead = drmp3__converter_lookahead(pMP3);
+    drmp3_uint32 discard;
+    drmp3_uint32 framesRead;
+    drmp3_uint32 iChannel;
+
+    if (pMP3->converter.atEnd) {
+        return DRMP3_FALSE;
+    }
+
+    discard = pMP3->converter.framePos - history;
+    if (discard > pMP3->converter.frameCount) {
+        /* Extreme down-sampling can step past frames we haven't read yet. */
+        drmp3_uint32 framesToSkip = discard - pMP3->converter.frameCount;
+        drmp3_uint32 framesSkipped;
+        discard = pMP3->converter.frameCount;
+        framesSkipped = (drmp3_uint32)drmp3_read_pcm_frames_raw(pMP3, framesToSkip, NULL);
+        if (framesSkipped < framesToSkip && drmp3__is_waiting_for_data(pMP3)) {
+            /* The rest are skipped once they've been pushed. */
+            pMP3->converter.framePos -= discard + framesSkipped;
+            pMP3->converter.frameCount = 0;
+            return DRMP3_FALSE;
+        }
+
+        if (framesSkipped < framesToSkip) {
+            pMP3->converter.framePos -= discard;
+            pMP3->converter.frameCount = 0;
+            pMP3->converter.endPos = 0;
+            pMP3->converter.atEnd = DRMP3_TRUE;
+            return DRMP3_FALSE;
+        }
+    }
+
+    if (discard > 0) {
+        for (iChannel = 0; iChannel < pMP3->channels; iChannel += 1) {
+            float* pChannel = pMP3->converter.pFrames + iChannel*pMP3->converter.frameCapacity;
+            memmove(pChannel, pChannel + discard, (pMP3->converter.frameCount - discard) * sizeof(float));
+        }
+
+        pMP3->converter.frameCount -= discard;
+        pMP3->converter.framePos   -= discard;
+    }
+
+    framesRead = (drmp3_uint32)drmp3_read_pcm_frames_raw(pMP3, DRMP3_MIN(DRMP3_CONVERTER_CHUNK_FRAMES, pMP3->converter.frameCapacity - pMP3->converter.frameCount - lookahead), pFramesIn);
+    if (framesRead > 0) {
+        drmp3__converter_append(pMP3, pFramesIn, framesRead);
+    } else if (drmp3__is_waiting_for_data(pMP3)) {
+        return DRMP3_FALSE; /* Nothing more has been pushed yet. */
+    } else {
+        pMP3->converter.endPos = pMP3->converter.frameCount;
+        pMP3->converter.atEnd  = DRMP3_TRUE;
+
+        for (iChannel = 0; iChannel < pMP3->channels; iChannel += 1) {
+            DRMP3_ZERO_MEMORY(pMP3->converter.pFrames + iChannel*pMP3->converter.frameCapacity + pMP3->converter.frameCount, lookahead * sizeof(float));
+        }
+        pMP3->converter.frameCount += lookahead;
+    }
+
+    return DRMP3_TRUE;
+}
+
+/*
+The dot product is accumulated in 4 lanes which are summed at the end, the same as a 4-wide SIMD register would be. All versions
+give the same result. The AVX version does both channels of a stereo frame at once, one in each half of the register.
+*/
+static float drmp3__dot_f32(const float* pTaps, const float* pFrames, drmp3_uint32 tapCount)
+{
+    drmp3_uint32 i;
+#if DRMP3_HAVE_SIMD
+    if (drmp3_have_simd()) {
+        float lanes[4];
+        drmp3_f4 acc = DRMP3_VMUL(DRMP3_VLD(pTaps), DRMP3_VLD(pFrames));
+        for (i = 4; i < tapCount; i += 4) {
+            acc = DRMP3_VMAC(acc, DRMP3_VLD(pTaps + i), DRMP3_VLD(pFrames + i));
+        }
+        DRMP3_VSTORE(lanes, acc);
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+#endif
+    {
+        float lanes[4];
+        lanes[0] = pTaps[0]*pFrames[0];
+        lanes[1] = pTaps[1]*pFrames[1];
+        lanes[2] = pTaps[2]*pFrames[2];
+        lanes[3] = pTaps[3]*pFrames[3];
+        for (i = 4; i < tapCount; i += 4) {
+            lanes[0] += pTaps[i + 0]*pFrames[i + 0];
+            lanes[1] += pTaps[i + 1]*pFrames[i + 1];
+            lanes[2] += pTaps[i + 2]*pFrames[i + 2];
+            lanes[3] += pTaps[i + 3]*pFrames[i + 3];
+        }
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+}
+
+#if DRMP3_HAVE_AVX
+static DRMP3_AVX_TARGET void drmp3__dot2_f32_avx(const float* pTaps, const float* pFrames0, const float* pFrames1, drmp3_uint32 tapCount, float* pOut)
+{
+    drmp3_uint32 i;
+    float lanes[8];
+    __m256 acc = _mm256_mul_ps(_mm256_broadcast_ps((const __m128*)pTaps), _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pFrames0)), _mm_loadu_ps(pFrames1), 1));
+    for (i = 4; i < tapCount; i += 4) {
+        __m256 x = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pFrames0 + i)), _mm_loadu_ps(pFrames1 + i), 1);
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_broadcast_ps((const __m128*)(pTaps + i)), x));
+    }
+    _mm256_storeu_ps(lanes, acc);
+    pOut[0] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    pOut[1] = (lanes[4] + lanes[5]) + (lanes[6] + lanes[7]);
+}
+#endif
+
+/* Outputs as many frames as possible from what's in pFrames. Returns the number of frames output. */
+static drmp3_uint32 drmp3__converter_process(drmp3* pMP3, drmp3_uint32 frameCount, float* pFramesOut)
+{
+    drmp3_uint32 channels    = pMP3->channels;
+    drmp3_uint32 tapCount    = pMP3->converter.tapCount;
+    drmp3_uint32 history     = drmp3__converter_history(pMP3);
+    drmp3_uint32 lookahead   = drmp3__converter_lookahead(pMP3);
+    drmp3_uint32 capacity    = pMP3->converter.frameCapacity;
+    drmp3_uint32 upFactor    = pMP3->converter.upFactor;
+    drmp3_uint32 stepInt     = pMP3->converter.downFactor / upFactor;
+    drmp3_uint32 stepFrac    = pMP3->converter.downFactor % upFactor;
+    drmp3_uint32 phaseCount  = DRMP3_MIN(upFactor, DRMP3_RESAMPLER_MAX_PHASES);
+    drmp3_uint32 framePos    = pMP3->converter.framePos;
+    drmp3_uint32 phase       = pMP3->converter.phase;
+    drmp3_uint32 endPos      = pMP3->converter.atEnd ? pMP3->converter.endPos : 0xFFFFFFFF;
+    const float* pFrames     = pMP3->converter.pFrames;
+    drmp3_uint32 framesOut;
+#if DRMP3_HAVE_AVX
+    int useAVX = (channels == 2 && drmp3_have_avx());
+#endif
+
+    for (framesOut = 0; framesOut < frameCount; framesOut += 1) {
+        float* pOut = pFramesOut + framesOut*channels;
+
+        if (framePos + lookahead >= pMP3->converter.frameCount || framePos >= endPos) {
+            break;
+        }
+
+        if (tapCount == 0) {
+            pOut[0] = pFrames[framePos];
+            if (channels == 2) {
+                pOut[1] = pFrames[framePos + capacity];
+            }
+        } else {
+            /* When there are too many phases to store, the closest one is used. The extra row is for the phase rounding up to 1. */
+            drmp3_uint32 iRow = (upFactor <= DRMP3_RESAMPLER_MAX_PHASES) ? phase : (drmp3_uint32)(((drmp3_uint64)phase*phaseCount + upFactor/2) / upFactor);
+            const float* pTaps  = pMP3->converter.pTaps + iRow*tapCount;
+            const float* pInput = pFrames + framePos - history;
+
+        #if DRMP3_HAVE_AVX
+            if (useAVX) {
+                drmp3__dot2_f32_avx(pTaps, pInput, pInput + capacity, tapCount, pOut);
+            } else
+        #endif
+            {
+                pOut[0] = drmp3__dot_f32(pTaps, pInput, tapCount);
+                if (channels == 2) {
+                    pOut[1] = drmp3__dot_f32(pTaps, pInput + capacity, tapCount);
+                }
+            }
+        }
+
+        framePos += stepInt;
+        phase    += stepFrac;
+        if (phase >= upFactor) {
+            phase    -= upFactor;
+            framePos += 1;
+        }
+    }
+
+    pMP3->converter.framePos = framePos;
+    pMP3->converter.phase    = phase;
+    pMP3->converter.currentPCMFrame += framesOut;
+
+    return framesOut;
+}
+
+static drmp3_uint64 drmp3__converter_read_pcm_frames_f32(drmp3* pMP3, drmp3_uint64 framesToRead, float* pBufferOut)
+{
+    drmp3_uint64 totalFramesRead = 0;
+    float pDiscard[256];
+
+    while (totalFramesRead < framesToRead) {
+        drmp3_uint32 framesToProcess;
+        drmp3_uint32 framesProcessed;
+        float* pFramesOut;
+
+        if (pBufferOut != NULL) {
+            framesToProcess = (drmp3_uint32)DRMP3_MIN(framesToRead - totalFramesRead, 0xFFFFFFFF);
+            pFramesOut = pBufferOut + totalFramesRead*pMP3->channels;
+        } else {
+            framesToProcess = (drmp3_uint32)DRMP3_MIN(framesToRead - totalFramesRead, DRMP3_COUNTOF(pDiscard) / pMP3->channels);
+            pFramesOut = pDiscard;
+        }
+
+        framesProcessed = drmp3__converter_process(pMP3, framesToProcess, pFramesOut);
+        totalFramesRead += framesProcessed;
+
+        if (framesProcessed < framesToProcess && !drmp3__converter_fill(pMP3)) {
+            break;
+        }
+    }
+
+    return totalFramesRead;
+}
+
+/* Unlike drmp3_f32_to_s16() this rounds, so that s16 frames which only had their channel count converted come back unchanged. */
+static void drmp3__converter_f32_to_s16(drmp3_int16* dst, const float* src, drmp3_uint64 sampleCount)
+{
+    drmp3_uint64 i;
+    for (i = 0; i < sampleCount; i += 1) {
+        float x = src[i] * 32768.0f;
+        x = ((x < -32768.0f) ? -32768.0f : ((x > 32767.0f) ? 32767.0f : x));
+        dst[i] = (drmp3_int16)((x < 0) ? (x - 0.5f) : (x + 0.5f));
+    }
+}
+
+
+DRMP3_API drmp3_uint64 drmp3_read_pcm_frames_f32(drmp3* pMP3, drmp3_uint64 framesToRead, float* pBufferOut)
+{
+    /* A push decoder doesn't know the format until it's decoded the first frame. */
+    if (pMP3 == NULL || pMP3->onRead == NULL || pMP3->channels == 0) {
+        return 0;
+    }
+
+    if (pMP3->converter.isEnabled) {
+        return drmp3__converter_read_pcm_frames_f32(pMP3, framesToRead, pBufferOut);
+    }
+
+#if defined(DR_MP3_FLOAT_OUTPUT)
+    /* Fast path. No conversion required. */
+    return drmp3_read_pcm_frames_raw(pMP3, framesToRead, pBufferOut);
+#else
+    /* Slow path. Convert from s16 to f32. */
+    {
+        drmp3_int16 pTempS16[8192];
+        drmp3_uint64 totalPCMFramesRead = 0;
+
+        while (totalPCMFramesRead < framesToRead) {
+            drmp3_uint64 framesJustRead;
+            drmp3_uint64 framesRemaining = framesToRead - totalPCMFramesRead;
+            drmp3_uint64 framesToReadNow = DRMP3_COUNTOF(pTempS16) / pMP3->channels;
+            if (framesToReadNow > framesRemaining) {
+                framesToReadNow = framesRemaining;
+            }
+
+            framesJustRead = drmp3_read_pcm_frames_raw(pMP3, framesToReadNow, pTempS16);
+            if (framesJustRead == 0) {
+                break;
+            }
+
+            drmp3_s16_to_f32((float*)DRMP3_OFFSET_PTR(pBufferOut, sizeof(float) * totalPCMFramesRead * pMP3->channels), pTempS16, framesJustRead * pMP3->channels);
+            totalPCMFramesRead += framesJustRead;
+        }
+
+        return totalPCMFramesRead;
+    }
+#endif
+}
+
+DRMP3_API drmp3_uint64 drmp3_read_pcm_frames_s16(drmp3* pMP3, drmp3_uint64 framesToRead, drmp3_int16* pBufferOut)
+{
+    /* A push decoder doesn't know the format until it's decoded the first frame. */
+    if (pMP3 == NULL || pMP3->onRead == NULL || pMP3->channels == 0) {
+        return 0;
+    }
+
+    if (pMP3->converter.isEnabled) {
+        float pTempF32[4096];
+        drmp3_uint64 totalPCMFramesRead = 0;
+
+        if (pBufferOut == NULL) {
+            return drmp3__converter_read_pcm_frames_f32(pMP3, framesToRead, NULL);
+        }
+
+        while (totalPCMFramesRead < framesToRead) {
+            drmp3_uint64 framesJustRead;
+            drmp3_uint64 framesToReadNow = DRMP3_MIN(framesToRead - totalPCMFramesRead, DRMP3_COUNTOF(pTempF32) / pMP3->channels);
+
+            framesJustRead = drmp3__converter_read_pcm_frames_f32(pMP3, framesToReadNow, pTempF32);
+            if (framesJustRead == 0) {
+                break;
+            }
+
+            drmp3__converter_f32_to_s16(pBufferOut + totalPCMFramesRead*pMP3->channels, pTempF32, framesJustRead * pMP3->channels);
+            totalPCMFramesRead += framesJustRead;
+        }
+
+        return totalPCMFramesRead;
+    }
+
+#if !defined(DR_MP3_FLOAT_OUTPUT)
+    /* Fast path. No conversion required. */
+    return drmp3_read_pcm_frames_raw(pMP3, framesToRead, pBufferOut);
+#else
+    /* Slow path. Convert from f32 to s16. */
+    {
+        float pTempF32[4096];
+        drmp3_uint64 totalPCMFramesRead = 0;
+
+        while (totalPCMFramesRead < framesToRead) {
+            drmp3_uint64 framesJustRead;
+            drmp3_uint64 framesRemaining = framesToRead - totalPCMFramesRead;
+            drmp3_uint64 framesToReadNow = DRMP3_COUNTOF(pTempF32) / pMP3->channels;
+            if (framesToReadNow > framesRemaining) {
+                framesToReadNow = framesRemaining;
+            }
+
+            framesJustRead = drmp3_read_pcm_frames_raw(pMP3, framesToReadNow, pTempF32);
+            if (framesJustRead == 0) {
+                break;
+            }
+
+            drmp3_f32_to_s16((drmp3_int16*)DRMP3_OFFSET_PTR(pBufferOut, sizeof(drmp3_int16) * totalPCMFramesRead * pMP3->channels), pTempF32, framesJustRead * pMP3->channels);
+            totalPCMFramesRead += framesJustRead;
+        }
+
+        return totalPCMFramesRead;
+    }
+#endif
+}
+
+static void drmp3_reset(drmp3* pMP3)
+{
+    DRMP3_ASSERT(pMP3 != NULL);
+
+    pMP3->pcmFramesConsumedInMP3Frame = 0;
+    pMP3->pcmFramesRemainingInMP3Frame = 0;
+    pMP3->pcmFramesToTrimAtStart = 0;
+    pMP3->currentPCMFrame = 0;
+    pMP3->dataSize = 0;
+    pMP3->dataConsumed = 0;
+    pMP3->atEnd = DRMP3_FALSE;
+    pMP3->seekRecorder.isInSync = DRMP3_FALSE;
+    drmp3dec_init(&pMP3->decoder);
+}
+
+static void drmp3__sync_seek_recorder(drmp3* pMP3, drmp3_uint64 runningPCMFrameCount, drmp3_bool32 isAtStartOfStream)
+{
+    /* Called when the decoder is sitting on an MP3 frame whose position in the stream is known exactly. */
+    drmp3_uint64 delayInPCMFrames = pMP3->vbrTag.delayInPCMFrames;
+    drmp3_uint64 pcmFramesBetweenSeekPoints = pMP3->seekRecorder.pcmFramesBetweenSeekPoints;
+
+    if (pMP3->seekRecorder.capacity == 0) {
+        return;
+    }
+
+    pMP3->seekRecorder.runningPCMFrameCount = runningPCMFrameCount;
+    pMP3->seekRecorder.runningPCMFrameCountFractionalPart = 0;
+    pMP3->seekRecorder.mp3FrameCount     = 0;
+    pMP3->seekRecorder.mp3FrameHead      = 0;
+    pMP3->seekRecorder.isAtStartOfStream = isAtStartOfStream;
+    pMP3->seekRecorder.isInSync          = DRMP3_TRUE;
+
+    /* Seek points are spaced evenly from the end of the encoder delay. The next one is the first that's not in an MP3 frame we've already passed. */
+    if (runningPCMFrameCount < delayInPCMFrames) {
+        pMP3->seekRecorder.nextTargetPCMFrame = delayInPCMFrames + pcmFramesBetweenSeekPoints;
+    } else {
+        pMP3->seekRecorder.nextTargetPCMFrame = delayInPCMFrames + ((runningPCMFrameCount - delayInPCMFrames) / pcmFramesBetweenSeekPoints + 1) * pcmFramesBetweenSeekPoints;
+    }
+}
+
+static drmp3_bool32 drmp3_seek_to_start_of_stream(drmp3* pMP3)
+{
+    DRMP3_ASSERT(pMP3 != NULL);
+    DRMP3_ASSERT(pMP3->onSeek != NULL);
+
+    /* Seek to the start of the stream to begin with. This will be past the Xing/Info or VBRI frame if there is one. */
+    if (!drmp3__on_seek_64(pMP3, pMP3->streamStartOffset, drmp3_seek_origin_start)) {
+        return DRMP3_FALSE;
+    }
+
+    /* Clear any cached data. */
+    drmp3_reset(pMP3);
+
+    /* The encoder delay will need to be trimmed again. */
+    pMP3->pcmFramesToTrimAtStart = pMP3->vbrTag.delayInPCMFrames;
+
+    drmp3__sync_seek_recorder(pMP3, 0, DRMP3_TRUE);
+
+    return DRMP3_TRUE;
+}
+
+
+static drmp3_bool32 drmp3_seek_forward_by_pcm_frames__brute_force(drmp3* pMP3, drmp3_uint64 frameOffset)
+{
+    drmp3_uint64 framesRead;
+
+    /*
+    Just using a dumb read-and-discard for now. What would be nice is to parse only the header of the MP3 frame, and then skip over leading
+    frames without spending the time doing a full decode. I cannot see an easy way to do this in minimp3, however, so it may involve some
+    kind of manual processing.
+    */
+    framesRead = drmp3_read_pcm_frames_raw(pMP3, frameOffset, NULL);
+    if (framesRead != frameOffset) {
+        return DRMP3_FALSE;
+    }
+
+    return DRMP3_TRUE;
+}
+
+static drmp3_bool32 drmp3_seek_to_pcm_frame__brute_force(drmp3* pMP3, drmp3_uint64 frameIndex)
 {
-#if _MSC_VER && _MSC_VER >= 1400
-    errno_t err;
-#endif
+    DRMP3_ASSERT(pMP3 != NULL);
 
-    if (ppFile != NULL) {
-        *ppFile = NULL;  /* Safety. */
+    if (frameIndex == pMP3->currentPCMFrame) {
+        return DRMP3_TRUE;
     }
 
-    if (pFilePath == NULL || pOpenMode == NULL || ppFile == NULL) {
-        return DRMP3_INVALID_ARGS;
+    /*
+    If we're moving foward we just read from where we're at. Otherwise we need to move back to the start of
+    the stream and read from the beginning.
+    */
+    if (frameIndex < pMP3->currentPCMFrame) {
+        /* Moving backward. Move to the start of the stream and then move forward. */
+        if (!drmp3_seek_to_start_of_stream(pMP3)) {
+            return DRMP3_FALSE;
+        }
     }
 
-#if _MSC_VER && _MSC_VER >= 1400
-    err = fopen_s(ppFile, pFilePath, pOpenMode);
-    if (err != 0) {
-        return drmp3_result_from_errno(err);
+    DRMP3_ASSERT(frameIndex >= pMP3->currentPCMFrame);
+    return drmp3_seek_forward_by_pcm_frames__brute_force(pMP3, (frameIndex - pMP3->currentPCMFrame));
+}
+
+static drmp3_bool32 drmp3_find_closest_seek_point(drmp3* pMP3, drmp3_uint64 frameIndex, drmp3_uint32* pSeekPointIndex)
+{
+    drmp3_uint32 iFirst;
+    drmp3_uint32 iLast;
+
+    DRMP3_ASSERT(pSeekPointIndex != NULL);
+
+    *pSeekPointIndex = 0;
+
+    if (frameIndex < pMP3->pSeekPoints[0].pcmFrameIndex) {
+        return DRMP3_FALSE;
     }
-#else
-#if defined(_WIN32) || defined(__APPLE__)
-    *ppFile = fopen(pFilePath, pOpenMode);
-#else
-    #if defined(_FILE_OFFSET_BITS) && _FILE_OFFSET_BITS == 64 && defined(_LARGEFILE64_SOURCE)
-        *ppFile = fopen64(pFilePath, pOpenMode);
-    #else
-        *ppFile = fopen(pFilePath, pOpenMode);
-    #endif
-#endif
-    if (*ppFile == NULL) {
-        drmp3_result result = drmp3_result_from_errno(errno);
-        if (result == DRMP3_SUCCESS) {
-            result = DRMP3_ERROR;   /* Just a safety check to make sure we never ever return success when pFile == NULL. */
-        }
 
-        return result;
+    /* Binary search for the last seek point at or before the target. Seek points are sorted by PCM frame. */
+    iFirst = 0;
+    iLast  = pMP3->seekPointCount - 1;
+    while (iFirst < iLast) {
+        drmp3_uint32 iMid = iFirst + (iLast - iFirst + 1)/2;
+        if (pMP3->pSeekPoints[iMid].pcmFrameIndex > frameIndex) {
+            iLast  = iMid - 1;
+        } else {
+            iFirst = iMid;
+        }
     }
-#endif
 
-    return DRMP3_SUCCESS;
+    *pSeekPointIndex = iFirst;
+    return DRMP3_TRUE;
 }
 
-/*
-_wfopen() isn't always available in all compilation environments.
+static drmp3_bool32 drmp3_seek_to_pcm_frame__seek_table(drmp3* pMP3, drmp3_uint64 frameIndex)
+{
+    drmp3_seek_point seekPoint;
+    drmp3_uint32 priorSeekPointIndex;
+    drmp3_uint16 iMP3Frame;
+    drmp3_uint64 leftoverFrames;
 
-    * Windows only.
-    * MSVC seems to support it universally as far back as VC6 from what I can tell (haven't checked further back).
-    * MinGW-64 (both 32- and 64-bit) seems to support it.
-    * MinGW wraps it in !defined(__STRICT_ANSI__).
+    DRMP3_ASSERT(pMP3 != NULL);
+    DRMP3_ASSERT(pMP3->pSeekPoints != NULL);
+    DRMP3_ASSERT(pMP3->seekPointCount > 0);
 
-This can be reviewed as compatibility issues arise. The preference is to use _wfopen_s() and _wfopen() as opposed to the wcsrtombs()
-fallback, so if you notice your compiler not detecting this properly I'm happy to look at adding support.
-*/
-#if defined(_WIN32)
-    #if defined(_MSC_VER) || defined(__MINGW64__) || !defined(__STRICT_ANSI__)
-        #define DRMP3_HAS_WFOPEN
-    #endif
-#endif
+    /*
+    If there is no prior seekpoint it means the target PCM frame comes before the first seek point. Just decode from the start of
+    the stream in this case. We do the same if the seek point is at the start of the stream or inside the encoder delay of a gapless
+    stream because the delay will need to be trimmed.
+    */
+    if (!drmp3_find_closest_seek_point(pMP3, frameIndex, &priorSeekPointIndex) ||
+        pMP3->pSeekPoints[priorSeekPointIndex].seekPosInBytes <= pMP3->streamStartOffset ||
+        pMP3->pSeekPoints[priorSeekPointIndex].pcmFrameIndex  <  pMP3->pSeekPoints[priorSeekPointIndex].pcmFramesToDiscard) {
+        if (!drmp3_seek_to_start_of_stream(pMP3)) {
+            return DRMP3_FALSE;
+        }
 
-static drmp3_result drmp3_wfopen(FILE** ppFile, const wchar_t* pFilePath, const wchar_t* pOpenMode, const drmp3_allocation_callbacks* pAllocationCallbacks)
-{
-    if (ppFile != NULL) {
-        *ppFile = NULL;  /* Safety. */
+        return drmp3_seek_forward_by_pcm_frames__brute_force(pMP3, frameIndex);
     }
 
-    if (pFilePath == NULL || pOpenMode == NULL || ppFile == NULL) {
-        return DRMP3_INVALID_ARGS;
+    seekPoint = pMP3->pSeekPoints[priorSeekPointIndex];
+
+    /* First thing to do is seek to the first byte of the relevant MP3 frame. */
+    if (!drmp3__on_seek_64(pMP3, seekPoint.seekPosInBytes, drmp3_seek_origin_start)) {
+        return DRMP3_FALSE; /* Failed to seek. */
     }
 
-#if defined(DRMP3_HAS_WFOPEN)
-    {
-        /* Use _wfopen() on Windows. */
-    #if defined(_MSC_VER) && _MSC_VER >= 1400
-        errno_t err = _wfopen_s(ppFile, pFilePath, pOpenMode);
-        if (err != 0) {
-            return drmp3_result_from_errno(err);
+    /* Clear any cached data. */
+    drmp3_reset(pMP3);
+
+    /*
+    Whole MP3 frames need to be discarded first. The leading ones only need to fill the bit reservoir so they don't need to be
+    decoded. The IMDCT overlap only depends on the last granule, and the synthesis filter only on the last 15 of the 18 subband
+    samples in a granule, so the second last frame is decoded up to the IMDCT and only the last one goes through synthesis. That
+    covers MPEG-2 frames, which only have one granule each.
+    */
+    for (iMP3Frame = 0; iMP3Frame < seekPoint.mp3FramesToDiscard; ++iMP3Frame) {
+        drmp3_uint32 pcmFramesRead;
+        drmp3d_sample_t* pPCMFrames;
+        drmp3_uint32 flags;
+
+        pPCMFrames = NULL;
+        flags = 0;
+        if (iMP3Frame + 2 >= seekPoint.mp3FramesToDiscard) {
+            pPCMFrames = drmp3__get_pcm_frames_buffer(pMP3);
+            if (pPCMFrames == NULL) {
+                return DRMP3_FALSE; /* Out of memory. */
+            }
+
+            if (iMP3Frame + 1 < seekPoint.mp3FramesToDiscard) {
+                flags = DRMP3_FRAME_FLAG_NO_SYNTH;
+            }
         }
-    #else
-        *ppFile = _wfopen(pFilePath, pOpenMode);
-        if (*ppFile == NULL) {
-            return drmp3_result_from_errno(errno);
+
+        /* Frames are never skipped here, even if they can't be decoded, so that the frame count stays in sync with the seek point. */
+        pcmFramesRead = drmp3_warm_up_next_frame(pMP3, pPCMFrames, flags);
+        if (pcmFramesRead == 0) {
+            return DRMP3_FALSE;
         }
-    #endif
-        (void)pAllocationCallbacks;
     }
-#else
+
+    /* We seeked to an MP3 frame in the raw stream so we need to make sure the current PCM frame is set correctly. */
+    pMP3->currentPCMFrame = seekPoint.pcmFrameIndex - seekPoint.pcmFramesToDiscard;
+
+    /* The next MP3 frame starts right after the one that was just decoded so seek points can be recorded from here on. */
+    drmp3__sync_seek_recorder(pMP3, pMP3->currentPCMFrame + pMP3->vbrTag.delayInPCMFrames + pMP3->pcmFramesRemainingInMP3Frame, DRMP3_FALSE);
+
     /*
-    Use fopen() on anything other than Windows. Requires a conversion. This is annoying because fopen() is locale specific. The only real way I can
-    think of to do this is with wcsrtombs(). Note that wcstombs() is apparently not thread-safe because it uses a static global mbstate_t object for
-    maintaining state. I've checked this with -std=c89 and it works, but if somebody get's a compiler error I'll look into improving compatibility.
+    Now at this point we can follow the same process as the brute force technique where we just skip over unnecessary MP3 frames and then
+    read-and-discard at least 2 whole MP3 frames.
     */
-    {
-        mbstate_t mbs;
-        size_t lenMB;
-        const wchar_t* pFilePathTemp = pFilePath;
-        char* pFilePathMB = NULL;
-        char pOpenModeMB[32] = {0};
+    leftoverFrames = frameIndex - pMP3->currentPCMFrame;
+    return drmp3_seek_forward_by_pcm_frames__brute_force(pMP3, leftoverFrames);
+}
 
-        /* Get the length first. */
-        DRMP3_ZERO_OBJECT(&mbs);
-        lenMB = wcsrtombs(NULL, &pFilePathTemp, 0, &mbs);
-        if (lenMB == (size_t)-1) {
-            return drmp3_result_from_errno(errno);
-        }
+static drmp3_bool32 drmp3_seek_to_pcm_frame__toc(drmp3* pMP3, drmp3_uint64 frameIndex)
+{
+    drmp3_uint64 totalPCMFrameCount;
+    drmp3_uint64 leadingPCMFrameCount;
+    drmp3_uint64 bytePos;
+    drmp3_uint32 iMP3Frame;
+    double percent;
+    double tocPos;
+    drmp3_uint32 iTOC;
 
-        pFilePathMB = (char*)drmp3__malloc_from_callbacks(lenMB + 1, pAllocationCallbacks);
-        if (pFilePathMB == NULL) {
-            return DRMP3_OUT_OF_MEMORY;
-        }
+    DRMP3_ASSERT(pMP3 != NULL);
+    DRMP3_ASSERT(pMP3->vbrTag.hasTOC);
 
-        pFilePathTemp = pFilePath;
-        DRMP3_ZERO_OBJECT(&mbs);
-        wcsrtombs(pFilePathMB, &pFilePathTemp, lenMB + 1, &mbs);
+    /* The TOC covers the whole stream, including the encoder delay and padding of gapless streams. */
+    totalPCMFrameCount   = pMP3->vbrTag.mp3FrameCount * pMP3->vbrTag.pcmFramesPerMP3Frame;
+    leadingPCMFrameCount = DRMP3_SEEK_LEADING_MP3_FRAMES * pMP3->vbrTag.pcmFramesPerMP3Frame;
 
-        /* The open mode should always consist of ASCII characters so we should be able to do a trivial conversion. */
-        {
-            size_t i = 0;
-            for (;;) {
-                if (pOpenMode[i] == 0) {
-                    pOpenModeMB[i] = '\0';
-                    break;
-                }
+    /*
+    When the target is close to the start of the stream or only a short way ahead of the current position it's both quicker
+    and more accurate to just decode our way there. "Close" is anything within a single TOC entry.
+    */
+    if (frameIndex <= leadingPCMFrameCount || (frameIndex >= pMP3->currentPCMFrame && (frameIndex - pMP3->currentPCMFrame) <= totalPCMFrameCount/100)) {
+        return drmp3_seek_to_pcm_frame__brute_force(pMP3, frameIndex);
+    }
 
-                pOpenModeMB[i] = (char)pOpenMode[i];
-                i += 1;
-            }
-        }
+    /*
+    We want to land a few MP3 frames before the target so that the bit reservoir and synthesis filter can be filled before we
+    get to it. The TOC maps a percentage of the duration to a percentage of the byte count. We interpolate between entries.
+    */
+    percent = ((double)(frameIndex + pMP3->vbrTag.delayInPCMFrames - leadingPCMFrameCount) * 100) / (double)totalPCMFrameCount;
+    if (percent > 99.999) {
+        percent = 99.999;
+    }
 
-        *ppFile = fopen(pFilePathMB, pOpenModeMB);
+    iTOC   = (drmp3_uint32)percent;
+    tocPos = pMP3->vbrTag.toc[iTOC];
+    if (iTOC < 99) {
+        tocPos += (pMP3->vbrTag.toc[iTOC+1] - tocPos) * (percent - iTOC);
+    } else {
+        tocPos += (256 - tocPos) * (percent - iTOC);
+    }
 
-        drmp3__free_from_callbacks(pFilePathMB, pAllocationCallbacks);
+    bytePos = pMP3->vbrTag.framePos + (drmp3_uint64)((tocPos / 256) * (double)pMP3->vbrTag.byteCount);
+    if (bytePos < pMP3->streamStartOffset) {
+        bytePos = pMP3->streamStartOffset;
     }
 
-    if (*ppFile == NULL) {
-        return DRMP3_ERROR;
+    /* We'll most likely land in the middle of a frame. The decoder will resynchronize itself on the next frame. */
+    if (!drmp3__on_seek_64(pMP3, bytePos, drmp3_seek_origin_start)) {
+        return DRMP3_FALSE;
     }
-#endif
 
-    return DRMP3_SUCCESS;
-}
+    drmp3_reset(pMP3);
 
+    /*
+    Decode the leading frames and discard them. These all need to be synthesized because MPEG-2 frames only have a single
+    granule, which means the overlap from the first frame is needed to get the synthesis filter into the right state.
+    */
+    for (iMP3Frame = 0; iMP3Frame < DRMP3_SEEK_LEADING_MP3_FRAMES; ++iMP3Frame) {
+        if (drmp3_decode_next_frame(pMP3) == 0) {
+            /*
+            The TOC put us too close to the end to fit the leading frames. This happens when seeking to the very end of the stream, in
+            which case it's fine to decode from the start.
+            */
+            if (!drmp3_seek_to_start_of_stream(pMP3)) {
+                return DRMP3_FALSE;
+            }
 
+            return drmp3_seek_forward_by_pcm_frames__brute_force(pMP3, frameIndex);
+        }
+    }
 
-static size_t drmp3__on_read_stdio(void* pUserData, void* pBufferOut, size_t bytesToRead)
-{
-    return fread(pBufferOut, 1, bytesToRead, (FILE*)pUserData);
+    pMP3->pcmFramesConsumedInMP3Frame += pMP3->pcmFramesRemainingInMP3Frame;
+    pMP3->pcmFramesRemainingInMP3Frame = 0;
+
+    /* We can't know exactly which frame we're sitting on so we just assume we landed where we intended. */
+    pMP3->currentPCMFrame = frameIndex;
+
+    return DRMP3_TRUE;
 }
 
-static drmp3_bool32 drmp3__on_seek_stdio(void* pUserData, int offset, drmp3_seek_origin origin)
+/* Seeks to a PCM frame in the sample rate of the stream, ignoring any conversion. */
+static drmp3_bool32 drmp3_seek_to_pcm_frame_raw(drmp3* pMP3, drmp3_uint64 frameIndex)
 {
-    return fseek((FILE*)pUserData, offset, (origin == drmp3_seek_origin_current) ? SEEK_CUR : SEEK_SET) == 0;
+    DRMP3_ASSERT(pMP3 != NULL);
+    DRMP3_ASSERT(pMP3->onSeek != NULL);
+
+    if (frameIndex == 0) {
+        return drmp3_seek_to_start_of_stream(pMP3);
+    }
+
+    /* Use the seek table if we have one. */
+    if (pMP3->pSeekPoints != NULL && pMP3->seekPointCount > 0) {
+        return drmp3_seek_to_pcm_frame__seek_table(pMP3, frameIndex);
+    } else if (pMP3->seekMode == drmp3_seek_mode_fast && pMP3->vbrTag.hasTOC) {
+        return drmp3_seek_to_pcm_frame__toc(pMP3, frameIndex);
+    } else {
+        return drmp3_seek_to_pcm_frame__brute_force(pMP3, frameIndex);
+    }
 }
 
-DRMP3_API drmp3_bool32 drmp3_init_file(drmp3* pMP3, const char* pFilePath, const drmp3_allocation_callbacks* pAllocationCallbacks)
+static drmp3_bool32 drmp3__converter_seek_to_pcm_frame(drmp3* pMP3, drmp3_uint64 frameIndex)
 {
-    FILE* pFile;
-    if (drmp3_fopen(&pFile, pFilePath, "rb") != DRMP3_SUCCESS) {
+    drmp3_uint64 inputPos   = frameIndex * pMP3->converter.downFactor;
+    drmp3_uint64 inputFrame = inputPos / pMP3->converter.upFactor;
+    drmp3_uint32 history    = drmp3__converter_history(pMP3);
+    drmp3_uint32 silentFrameCount = 0;
+
+    /* The decoder needs to start at the first frame of history. Anything before the start of the stream is silence. */
+    if (inputFrame < history) {
+        silentFrameCount = history - (drmp3_uint32)inputFrame;
+    }
+
+    if (!drmp3_seek_to_pcm_frame_raw(pMP3, inputFrame + silentFrameCount - history)) {
         return DRMP3_FALSE;
     }
 
-    return drmp3_init(pMP3, drmp3__on_read_stdio, drmp3__on_seek_stdio, (void*)pFile, pAllocationCallbacks);
+    drmp3__converter_reset(pMP3, silentFrameCount);
+    pMP3->converter.phase = (drmp3_uint32)(inputPos % pMP3->converter.upFactor);
+    pMP3->converter.currentPCMFrame = frameIndex;
+
+    return DRMP3_TRUE;
 }
 
-DRMP3_API drmp3_bool32 drmp3_init_file_w(drmp3* pMP3, const wchar_t* pFilePath, const drmp3_allocation_callbacks* pAllocationCallbacks)
+DRMP3_API drmp3_bool32 drmp3_seek_to_pcm_frame(drmp3* pMP3, drmp3_uint64 frameIndex)
 {
-    FILE* pFile;
-    if (drmp3_wfopen(&pFile, pFilePath, L"rb", pAllocationCallbacks) != DRMP3_SUCCESS) {
+    if (pMP3 == NULL || pMP3->onSeek == NULL) {
         return DRMP3_FALSE;
     }
 
-    return drmp3_init(pMP3, drmp3__on_read_stdio, drmp3__on_seek_stdio, (void*)pFile, pAllocationCallbacks);
+    if (pMP3->converter.isEnabled) {
+        return drmp3__converter_seek_to_pcm_frame(pMP3, frameIndex);
+    }
+
+    return drmp3_seek_to_pcm_frame_raw(pMP3, frameIndex);
 }
-#endif
 
-DRMP3_API void drmp3_uninit(drmp3* pMP3)
+DRMP3_API drmp3_bool32 drmp3_set_seek_mode(drmp3* pMP3, drmp3_seek_mode seekMode)
 {
-    if (pMP3 == NULL) {
-        return;
-    }
-    
-#ifndef DR_MP3_NO_STDIO
-    if (pMP3->onRead == drmp3__on_read_stdio) {
-        fclose((FILE*)pMP3->pUserData);
+    if (pMP3 == NULL || (seekMode != drmp3_seek_mode_exact && seekMode != drmp3_seek_mode_fast)) {
+        return DRMP3_FALSE;
     }
-#endif
 
-    drmp3__free_from_callbacks(pMP3->pData, &pMP3->allocationCallbacks);
+    pMP3->seekMode = seekMode;
+    return DRMP3_TRUE;
 }
 
-#if defined(DR_MP3_FLOAT_OUTPUT)
-static void drmp3_f32_to_s16(drmp3_int16* dst, const float* src, drmp3_uint64 sampleCount)
+static void drmp3__set_downmixing(drmp3* pMP3, drmp3_bool32 isDownmixing)
 {
-    drmp3_uint64 i;
-    drmp3_uint64 i4;
-    drmp3_uint64 sampleCount4;
+    /*
+    Turns mixing stereo down to mono in the decoder on or off. What's left of the current MP3 frame and the history of the synthesis
+    filter are converted to the new channel count so that decoding carries on seamlessly from where it is.
+    */
+    drmp3d_sample_t* pFrames = (drmp3d_sample_t*)pMP3->pcmFrames;
+    drmp3d_real_t* pHistory = pMP3->decoder.qmf_state;
+    drmp3_uint32 frameCount = pMP3->pcmFramesConsumedInMP3Frame + pMP3->pcmFramesRemainingInMP3Frame;
+    drmp3_uint32 i;
 
-    /* Unrolled. */
-    i = 0;
-    sampleCount4 = sampleCount >> 2;
-    for (i4 = 0; i4 < sampleCount4; i4 += 1) {
-        float x0 = src[i+0];
-        float x1 = src[i+1];
-        float x2 = src[i+2];
-        float x3 = src[i+3];
+    if (isDownmixing == pMP3->converter.isDownmixing) {
+        return;
+    }
 
-        x0 = ((x0 < -1) ? -1 : ((x0 > 1) ? 1 : x0));
-        x1 = ((x1 < -1) ? -1 : ((x1 > 1) ? 1 : x1));
-        x2 = ((x2 < -1) ? -1 : ((x2 > 1) ? 1 : x2));
-        x3 = ((x3 < -1) ? -1 : ((x3 > 1) ? 1 : x3));
+    pMP3->converter.isDownmixing = isDownmixing;
 
-        x0 = x0 * 32767.0f;
-        x1 = x1 * 32767.0f;
-        x2 = x2 * 32767.0f;
-        x3 = x3 * 32767.0f;
+    if (isDownmixing) {
+        if (pMP3->pcmFramesRemainingInMP3Frame > 0 && pMP3->mp3FrameChannels == 2) {
+            for (i = 0; i < frameCount; i += 1) {
+                pFrames[i] = (drmp3d_sample_t)((pFrames[i*2 + 0] + pFrames[i*2 + 1]) / 2);
+            }
+            pMP3->mp3FrameChannels = 1;
+        }
 
-        dst[i+0] = (drmp3_int16)x0;
-        dst[i+1] = (drmp3_int16)x1;
-        dst[i+2] = (drmp3_int16)x2;
-        dst[i+3] = (drmp3_int16)x3;
+        for (i = 0; i < 15*64; i += 2) {
+            pHistory[i] = DRMP3_MUL(pHistory[i] + pHistory[i + 1], DRMP3_REAL(0.5f));
+        }
+    } else {
+        if (pMP3->pcmFramesRemainingInMP3Frame > 0 && pMP3->mp3FrameChannels == 1 && pMP3->converter.channelsIn == 2) {
+            for (i = frameCount; i > 0; i -= 1) {
+                pFrames[i*2 - 1] = pFrames[i - 1];
+                pFrames[i*2 - 2] = pFrames[i - 1];
+            }
+            pMP3->mp3FrameChannels = 2;
+        }
 
-        i += 4;
+        for (i = 0; i < 15*64; i += 2) {
+            pHistory[i + 1] = pHistory[i];
+        }
     }
+}
 
-    /* Leftover. */
-    for (; i < sampleCount; i += 1) {
-        float x = src[i];
-        x = ((x < -1) ? -1 : ((x > 1) ? 1 : x));    /* clip */
-        x = x * 32767.0f;                           /* -1..1 to -32767..32767 */
+DRMP3_API drmp3_bool32 drmp3_set_output_format(drmp3* pMP3, const drmp3_config* pConfig)
+{
+    drmp3_uint32 channels;
+    drmp3_uint32 sampleRate;
+    drmp3_uint32 gcf;
+    drmp3_uint64 currentPCMFrame;
+    drmp3_uint32 previousSampleRate;
 
-        dst[i] = (drmp3_int16)x;
+    /* A push decoder doesn't know the format of the stream until it's decoded the first frame. */
+    if (pMP3 == NULL || pMP3->onRead == NULL || pMP3->converter.channelsIn == 0) {
+        return DRMP3_FALSE;
     }
-}
-#endif
 
-#if !defined(DR_MP3_FLOAT_OUTPUT)
-static void drmp3_s16_to_f32(float* dst, const drmp3_int16* src, drmp3_uint64 sampleCount)
-{
-    drmp3_uint64 i;
-    for (i = 0; i < sampleCount; i += 1) {
-        float x = (float)src[i];
-        x = x * 0.000030517578125f;         /* -32768..32767 to -1..0.999969482421875 */
-        dst[i] = x;
+    channels   = (pConfig != NULL && pConfig->channels   != 0) ? pConfig->channels   : pMP3->converter.channelsIn;
+    sampleRate = (pConfig != NULL && pConfig->sampleRate != 0) ? pConfig->sampleRate : pMP3->converter.sampleRateIn;
+    if (channels > 2 || sampleRate < DRMP3_MIN_OUTPUT_SAMPLE_RATE || sampleRate > DRMP3_MAX_OUTPUT_SAMPLE_RATE) {
+        return DRMP3_FALSE;
     }
-}
-#endif
 
+    /* Remember where we are so we can go back to the same point in time afterwards. */
+    currentPCMFrame    = pMP3->converter.isEnabled ? pMP3->converter.currentPCMFrame : pMP3->currentPCMFrame;
+    previousSampleRate = pMP3->sampleRate;
 
-static drmp3_uint64 drmp3_read_pcm_frames_raw(drmp3* pMP3, drmp3_uint64 framesToRead, void* pBufferOut)
-{
-    drmp3_uint64 totalFramesRead = 0;
+    drmp3__free_from_callbacks(pMP3->converter.pTaps, &pMP3->allocationCallbacks);
+    pMP3->converter.pTaps     = NULL;
+    pMP3->converter.pFrames   = NULL;
+    pMP3->converter.isEnabled = DRMP3_FALSE;
 
-    DRMP3_ASSERT(pMP3 != NULL);
-    DRMP3_ASSERT(pMP3->onRead != NULL);
+    /* Stereo is mixed down to mono by the decoder which saves synthesizing the second channel. */
+    drmp3__set_downmixing(pMP3, channels == 1 && pMP3->converter.channelsIn == 2);
+    pMP3->channels   = drmp3__get_decoded_channels(pMP3, pMP3->converter.channelsIn);
+    pMP3->sampleRate = pMP3->converter.sampleRateIn;
 
-    while (framesToRead > 0) {
-        drmp3_uint32 framesToConsume = (drmp3_uint32)DRMP3_MIN(pMP3->pcmFramesRemainingInMP3Frame, framesToRead);
-        if (pBufferOut != NULL) {
-        #if defined(DR_MP3_FLOAT_OUTPUT)
-            /* f32 */
-            float* pFramesOutF32 = (float*)DRMP3_OFFSET_PTR(pBufferOut,          sizeof(float) * totalFramesRead                   * pMP3->channels);
-            float* pFramesInF32  = (float*)DRMP3_OFFSET_PTR(&pMP3->pcmFrames[0], sizeof(float) * pMP3->pcmFramesConsumedInMP3Frame * pMP3->mp3FrameChannels);
-            DRMP3_COPY_MEMORY(pFramesOutF32, pFramesInF32, sizeof(float) * framesToConsume * pMP3->channels);
-        #else
-            /* s16 */
-            drmp3_int16* pFramesOutS16 = (drmp3_int16*)DRMP3_OFFSET_PTR(pBufferOut,          sizeof(drmp3_int16) * totalFramesRead                   * pMP3->channels);
-            drmp3_int16* pFramesInS16  = (drmp3_int16*)DRMP3_OFFSET_PTR(&pMP3->pcmFrames[0], sizeof(drmp3_int16) * pMP3->pcmFramesConsumedInMP3Frame * pMP3->mp3FrameChannels);
-            DRMP3_COPY_MEMORY(pFramesOutS16, pFramesInS16, sizeof(drmp3_int16) * framesToConsume * pMP3->channels);
-        #endif
+    if (channels != pMP3->channels || sampleRate != pMP3->converter.sampleRateIn) {
+        drmp3_uint32 phaseCount = 0;
+        drmp3_uint32 tapCount   = 0;
+        size_t allocationSize;
+
+        gcf = drmp3_gcf_u32(sampleRate, pMP3->converter.sampleRateIn);
+        pMP3->converter.upFactor   = sampleRate / gcf;
+        pMP3->converter.downFactor = pMP3->converter.sampleRateIn / gcf;
+
+        if (sampleRate != pMP3->converter.sampleRateIn) {
+            /* When down-sampling the cutoff is lower, so the filter needs to be longer to get the same number of zero crossings. */
+            double ratio = DRMP3_MIN(1.0, (double)sampleRate / pMP3->converter.sampleRateIn);
+            drmp3_uint32 halfLength = (drmp3_uint32)(DRMP3_RESAMPLER_ZERO_CROSSINGS / ratio + 1) & ~1;
+            tapCount = DRMP3_MIN(halfLength*2, DRMP3_RESAMPLER_MAX_TAPS);
+
+            /* With too many phases to store, phase i of DRMP3_RESAMPLER_MAX_PHASES is used, including the last one at a whole frame. */
+            phaseCount = (pMP3->converter.upFactor <= DRMP3_RESAMPLER_MAX_PHASES) ? pMP3->converter.upFactor : DRMP3_RESAMPLER_MAX_PHASES + 1;
         }
 
-        pMP3->currentPCMFrame              += framesToConsume;
-        pMP3->pcmFramesConsumedInMP3Frame  += framesToConsume;
-        pMP3->pcmFramesRemainingInMP3Frame -= framesToConsume;
-        totalFramesRead                    += framesToConsume;
-        framesToRead                       -= framesToConsume;
+        pMP3->converter.tapCount      = tapCount;
+        pMP3->converter.frameCapacity = tapCount + DRMP3_CONVERTER_CHUNK_FRAMES;
 
-        if (framesToRead == 0) {
-            break;
+        allocationSize = ((size_t)phaseCount*tapCount + (size_t)pMP3->converter.frameCapacity*channels) * sizeof(float);
+        pMP3->converter.pTaps = (float*)drmp3__malloc_from_callbacks(allocationSize, &pMP3->allocationCallbacks);
+        if (pMP3->converter.pTaps == NULL) {
+            return DRMP3_FALSE;
         }
 
-        DRMP3_ASSERT(pMP3->pcmFramesRemainingInMP3Frame == 0);
+        pMP3->converter.pFrames = pMP3->converter.pTaps + (size_t)phaseCount*tapCount;
 
-        /*
-        At this point we have exhausted our in-memory buffer so we need to re-fill. Note that the sample rate may have changed
-        at this point which means we'll also need to update our sample rate conversion pipeline.
-        */
-        if (drmp3_decode_next_frame(pMP3) == 0) {
-            break;
+        if (tapCount > 0) {
+            drmp3__converter_make_taps(pMP3->converter.pTaps, tapCount, phaseCount, DRMP3_MIN(pMP3->converter.upFactor, DRMP3_RESAMPLER_MAX_PHASES),
+                DRMP3_RESAMPLER_CUTOFF * DRMP3_MIN(1.0, (double)sampleRate / pMP3->converter.sampleRateIn));
         }
+
+        pMP3->channels   = channels;
+        pMP3->sampleRate = sampleRate;
+        pMP3->converter.isEnabled = DRMP3_TRUE;
+        pMP3->converter.currentPCMFrame = 0;
+        drmp3__converter_reset(pMP3, drmp3__converter_history(pMP3));
     }
 
-    return totalFramesRead;
-}
+    /* Nothing has been read yet in the common case, in which case we're already in the right place. */
+    if (currentPCMFrame > 0 || pMP3->currentPCMFrame > 0) {
+        currentPCMFrame = currentPCMFrame * pMP3->sampleRate / previousSampleRate;
+        if (pMP3->onSeek == NULL || !drmp3_seek_to_pcm_frame(pMP3, currentPCMFrame)) {
+            /* Not seekable. We carry on from wherever the decoder is sitting. */
+            pMP3->converter.currentPCMFrame = currentPCMFrame;
+        }
+    }
 
+    return DRMP3_TRUE;
+}
 
-DRMP3_API drmp3_uint64 drmp3_read_pcm_frames_f32(drmp3* pMP3, drmp3_uint64 framesToRead, float* pBufferOut)
+DRMP3_API drmp3_bool32 drmp3_set_decode_quality(drmp3* pMP3, drmp3_decode_quality quality)
 {
-    if (pMP3 == NULL || pMP3->onRead == NULL) {
-        return 0;
-    }
-
-#if defined(DR_MP3_FLOAT_OUTPUT)
-    /* Fast path. No conversion required. */
-    return drmp3_read_pcm_frames_raw(pMP3, framesToRead, pBufferOut);
-#else
-    /* Slow path. Convert from s16 to f32. */
-    {
-        drmp3_int16 pTempS16[8192];
-        drmp3_uint64 totalPCMFramesRead = 0;
+    drmp3_uint32 rateShift = (drmp3_uint32)quality;
+    drmp3_uint64 currentPCMFrame;
 
-        while (totalPCMFramesRead < framesToRead) {
-            drmp3_uint64 framesJustRead;
-            drmp3_uint64 framesRemaining = framesToRead - totalPCMFramesRead;
-            drmp3_uint64 framesToReadNow = DRMP3_COUNTOF(pTempS16) / pMP3->channels;
-            if (framesToReadNow > framesRemaining) {
-                framesToReadNow = framesRemaining;
-            }
+    if (pMP3 == NULL || pMP3->onRead == NULL || rateShift > (drmp3_uint32)drmp3_decode_quality_quarter_rate) {
+        return DRMP3_FALSE;
+    }
 
-            framesJustRead = drmp3_read_pcm_frames_raw(pMP3, framesToReadNow, pTempS16);
-            if (framesJustRead == 0) {
-                break;
-            }
+    if (rateShift == pMP3->decodeQuality.rateShift) {
+        return DRMP3_TRUE;
+    }
 
-            drmp3_s16_to_f32((float*)DRMP3_OFFSET_PTR(pBufferOut, sizeof(drmp3_int16) * totalPCMFramesRead * pMP3->channels), pTempS16, framesJustRead * pMP3->channels);
-            totalPCMFramesRead += framesJustRead;
-        }
+    /* The MP3 frame that's currently loaded was decoded at the old rate so it needs to be decoded again. */
+    if (pMP3->onSeek == NULL) {
+        return DRMP3_FALSE;
+    }
 
-        return totalPCMFramesRead;
+    /* Where we are in the stream, at the new rate. */
+    if (pMP3->converter.isEnabled) {
+        currentPCMFrame = pMP3->converter.currentPCMFrame * pMP3->converter.sampleRateIn / pMP3->sampleRate;
+    } else {
+        currentPCMFrame = pMP3->currentPCMFrame;
     }
-#endif
-}
+    currentPCMFrame = (currentPCMFrame << pMP3->decodeQuality.rateShift) >> rateShift;
 
-DRMP3_API drmp3_uint64 drmp3_read_pcm_frames_s16(drmp3* pMP3, drmp3_uint64 framesToRead, drmp3_int16* pBufferOut)
-{
-    if (pMP3 == NULL || pMP3->onRead == NULL) {
-        return 0;
+    if (pMP3->decodeQuality.rateShift == 0) {
+        pMP3->decodeQuality.sampleRate           = pMP3->converter.sampleRateIn;
+        pMP3->decodeQuality.pcmFramesPerMP3Frame = pMP3->vbrTag.pcmFramesPerMP3Frame;
+        pMP3->decodeQuality.delayInPCMFrames     = pMP3->vbrTag.delayInPCMFrames;
+        pMP3->decodeQuality.paddingInPCMFrames   = pMP3->vbrTag.paddingInPCMFrames;
     }
 
-#if !defined(DR_MP3_FLOAT_OUTPUT)
-    /* Fast path. No conversion required. */
-    return drmp3_read_pcm_frames_raw(pMP3, framesToRead, pBufferOut);
-#else
-    /* Slow path. Convert from f32 to s16. */
-    {
-        float pTempF32[4096];
-        drmp3_uint64 totalPCMFramesRead = 0;
+    pMP3->decodeQuality.rateShift = rateShift;
 
-        while (totalPCMFramesRead < framesToRead) {
-            drmp3_uint64 framesJustRead;
-            drmp3_uint64 framesRemaining = framesToRead - totalPCMFramesRead;
-            drmp3_uint64 framesToReadNow = DRMP3_COUNTOF(pTempF32) / pMP3->channels;
-            if (framesToReadNow > framesRemaining) {
-                framesToReadNow = framesRemaining;
-            }
+    pMP3->converter.sampleRateIn      = drmp3__get_decoded_sample_rate(pMP3, pMP3->decodeQuality.sampleRate);
+    pMP3->vbrTag.pcmFramesPerMP3Frame = pMP3->decodeQuality.pcmFramesPerMP3Frame >> rateShift;
+    pMP3->vbrTag.delayInPCMFrames     = pMP3->decodeQuality.delayInPCMFrames     >> rateShift;
+    pMP3->vbrTag.paddingInPCMFrames   = pMP3->decodeQuality.paddingInPCMFrames   >> rateShift;
 
-            framesJustRead = drmp3_read_pcm_frames_raw(pMP3, framesToReadNow, pTempF32);
-            if (framesJustRead == 0) {
-                break;
-            }
+    pMP3->pSeekPoints    = NULL;
+    pMP3->seekPointCount = 0;
+    pMP3->seekRecorder.capacity = 0;
 
-            drmp3_f32_to_s16((drmp3_int16*)DRMP3_OFFSET_PTR(pBufferOut, sizeof(drmp3_int16) * totalPCMFramesRead * pMP3->channels), pTempF32, framesJustRead * pMP3->channels);
-            totalPCMFramesRead += framesJustRead;
-        }
+    /*
+    Decoding needs to restart from the beginning since nothing that's been decoded so far is usable at the new rate. This also stops
+    drmp3_set_output_format() from seeking. That's done below, once the output format is reset.
+    */
+    pMP3->converter.currentPCMFrame = 0;
+    if (!drmp3_seek_to_start_of_stream(pMP3)) {
+        return DRMP3_FALSE;
+    }
 
-        return totalPCMFramesRead;
+    if (!drmp3_set_output_format(pMP3, NULL)) {
+        return DRMP3_FALSE;
     }
-#endif
+
+    return drmp3_seek_to_pcm_frame(pMP3, currentPCMFrame);
 }
 
-static void drmp3_reset(drmp3* pMP3)
+static drmp3_bool32 drmp3__unread_data(drmp3* pMP3)
 {
-    DRMP3_ASSERT(pMP3 != NULL);
+    /* Drops the buffered data by seeking the stream back to it. It'll be read again when it's needed. */
+    if (pMP3->onSeek == NULL || !drmp3__on_seek_64(pMP3, drmp3__get_next_frame_pos(pMP3), drmp3_seek_origin_start)) {
+        return DRMP3_FALSE;
+    }
 
-    pMP3->pcmFramesConsumedInMP3Frame = 0;
-    pMP3->pcmFramesRemainingInMP3Frame = 0;
-    pMP3->currentPCMFrame = 0;
-    pMP3->dataSize = 0;
-    pMP3->atEnd = DRMP3_FALSE;
-    drmp3dec_init(&pMP3->decoder);
+    pMP3->dataSize     = 0;
+    pMP3->dataConsumed = 0;
+
+    return DRMP3_TRUE;
 }
 
-static drmp3_bool32 drmp3_seek_to_start_of_stream(drmp3* pMP3)
+DRMP3_API drmp3_bool32 drmp3_set_input_buffer_size(drmp3* pMP3, size_t bufferSizeInBytes)
 {
-    DRMP3_ASSERT(pMP3 != NULL);
-    DRMP3_ASSERT(pMP3->onSeek != NULL);
+    if (pMP3 == NULL || bufferSizeInBytes < DRMP3_MIN_INPUT_BUFFER_SIZE || bufferSizeInBytes > INT_MAX - DRMP3_MIN_DATA_CHUNK_SIZE) {
+        return DRMP3_FALSE;
+    }
+
+    /* Memory streams are decoded in place. */
+    if (pMP3->memory.pData != NULL && pMP3->memory.dataSize > 0) {
+        return DRMP3_TRUE;
+    }
+
+    /* The client's buffer is used as-is. */
+    if (pMP3->isPreallocated) {
+        return bufferSizeInBytes == pMP3->dataCapacity;
+    }
 
-    /* Seek to the start of the stream to begin with. */
-    if (!drmp3__on_seek(pMP3, 0, drmp3_seek_origin_start)) {
+    /* The buffered data needs to be read again if it doesn't fit. */
+    if (bufferSizeInBytes < pMP3->dataSize && !drmp3__unread_data(pMP3)) {
         return DRMP3_FALSE;
     }
 
-    /* Clear any cached data. */
-    drmp3_reset(pMP3);
-    return DRMP3_TRUE;
-}
+    pMP3->inputBufferSize = bufferSizeInBytes;
 
+    /* A suspended decoder gets its new buffer when it's resumed. */
+    if (pMP3->pData == NULL || pMP3->isSuspended) {
+        return DRMP3_TRUE;
+    }
 
-static drmp3_bool32 drmp3_seek_forward_by_pcm_frames__brute_force(drmp3* pMP3, drmp3_uint64 frameOffset)
+    return drmp3__resize_data_buffer(pMP3, bufferSizeInBytes);
+}
+
+DRMP3_API drmp3_bool32 drmp3_suspend(drmp3* pMP3)
 {
-    drmp3_uint64 framesRead;
+    drmp3_uint8* pUnreadData = NULL;
 
-    /*
-    Just using a dumb read-and-discard for now. What would be nice is to parse only the header of the MP3 frame, and then skip over leading
-    frames without spending the time doing a full decode. I cannot see an easy way to do this in minimp3, however, so it may involve some
-    kind of manual processing.
-    */
-#if defined(DR_MP3_FLOAT_OUTPUT)
-    framesRead = drmp3_read_pcm_frames_f32(pMP3, frameOffset, NULL);
-#else
-    framesRead = drmp3_read_pcm_frames_s16(pMP3, frameOffset, NULL);
-#endif
-    if (framesRead != frameOffset) {
+    if (pMP3 == NULL) {
         return DRMP3_FALSE;
     }
 
+    /* There's nothing to free when the buffers belong to the client. */
+    if (pMP3->isPreallocated) {
+        return DRMP3_TRUE;
+    }
+
+#if defined(DR_MP3_COMPACT)
+    if (pMP3->pcmFramesRemainingInMP3Frame == 0) {
+        drmp3__free_from_callbacks(pMP3->pcmFrames, &pMP3->allocationCallbacks);
+        pMP3->pcmFrames = NULL;
+    }
+#endif
+
+    /* Memory streams don't have an input buffer. */
+    if (pMP3->pData == NULL || pMP3->isSuspended) {
+        return DRMP3_TRUE;
+    }
+
+    if (pMP3->dataSize > 0 && !drmp3__unread_data(pMP3)) {
+        /* The stream can't be seeked so the data needs to be kept. */
+        pUnreadData = (drmp3_uint8*)drmp3__malloc_from_callbacks(pMP3->dataSize, &pMP3->allocationCallbacks);
+        if (pUnreadData == NULL) {
+            return DRMP3_FALSE;
+        }
+
+        drmp3__copy_unread_data(pMP3, pUnreadData);
+    }
+
+    drmp3__free_from_callbacks(pMP3->pData, &pMP3->allocationCallbacks);
+    pMP3->pData        = pUnreadData;
+    pMP3->dataCapacity = pMP3->dataSize;
+    pMP3->dataConsumed = 0;
+    pMP3->isSuspended  = DRMP3_TRUE;
+
     return DRMP3_TRUE;
 }
 
-static drmp3_bool32 drmp3_seek_to_pcm_frame__brute_force(drmp3* pMP3, drmp3_uint64 frameIndex)
+DRMP3_API drmp3_bool32 drmp3_resume(drmp3* pMP3)
 {
-    DRMP3_ASSERT(pMP3 != NULL);
+    size_t bufferSize;
 
-    if (frameIndex == pMP3->currentPCMFrame) {
+    if (pMP3 == NULL) {
+        return DRMP3_FALSE;
+    }
+
+    /* Memory streams are decoded in place. */
+    if (pMP3->memory.pData != NULL && pMP3->memory.dataSize > 0) {
         return DRMP3_TRUE;
     }
 
-    /*
-    If we're moving foward we just read from where we're at. Otherwise we need to move back to the start of
-    the stream and read from the beginning.
-    */
-    if (frameIndex < pMP3->currentPCMFrame) {
-        /* Moving backward. Move to the start of the stream and then move forward. */
-        if (!drmp3_seek_to_start_of_stream(pMP3)) {
-            return DRMP3_FALSE;
-        }
+    if (pMP3->pData != NULL && !pMP3->isSuspended) {
+        return DRMP3_TRUE;
     }
 
-    DRMP3_ASSERT(frameIndex >= pMP3->currentPCMFrame);
-    return drmp3_seek_forward_by_pcm_frames__brute_force(pMP3, (frameIndex - pMP3->currentPCMFrame));
+    bufferSize = (pMP3->inputBufferSize != 0) ? pMP3->inputBufferSize : DRMP3_MAX(DRMP3_DATA_CHUNK_SIZE, DRMP3_MIN_INPUT_BUFFER_SIZE);
+    if (!drmp3__resize_data_buffer(pMP3, DRMP3_MAX(bufferSize, pMP3->dataSize))) {
+        return DRMP3_FALSE;
+    }
+
+    pMP3->isSuspended = DRMP3_FALSE;
+    return DRMP3_TRUE;
 }
 
-static drmp3_bool32 drmp3_find_closest_seek_point(drmp3* pMP3, drmp3_uint64 frameIndex, drmp3_uint32* pSeekPointIndex)
+static drmp3_bool32 drmp3__scan_mp3_and_pcm_frame_count(drmp3* pMP3, drmp3_uint64* pMP3FrameCount, drmp3_uint64* pPCMFrameCount)
 {
-    drmp3_uint32 iSeekPoint;
-
-    DRMP3_ASSERT(pSeekPointIndex != NULL);
-
-    *pSeekPointIndex = 0;
+    /*
+    Walks over every MP3 frame from the start of the stream without decoding any audio. This leaves the decoder in an undefined
+    position so the caller is responsible for seeking back to where it needs to be.
+    */
+    drmp3_uint64 totalPCMFrameCount = 0;
+    drmp3_uint64 totalMP3FrameCount = 0;
 
-    if (frameIndex < pMP3->pSeekPoints[0].pcmFrameIndex) {
+    if (!drmp3_seek_to_start_of_stream(pMP3)) {
         return DRMP3_FALSE;
     }
 
-    /* Linear search for simplicity to begin with while I'm getting this thing working. Once it's all working change this to a binary search. */
-    for (iSeekPoint = 0; iSeekPoint < pMP3->seekPointCount; ++iSeekPoint) {
-        if (pMP3->pSeekPoints[iSeekPoint].pcmFrameIndex > frameIndex) {
-            break;  /* Found it. */
+    for (;;) {
+        drmp3_uint32 pcmFramesInCurrentMP3Frame;
+
+        pcmFramesInCurrentMP3Frame = drmp3_scan_next_frame(pMP3);
+        if (pcmFramesInCurrentMP3Frame == 0) {
+            break;
         }
 
-        *pSeekPointIndex = iSeekPoint;
+        totalPCMFrameCount += pcmFramesInCurrentMP3Frame;
+        totalMP3FrameCount += 1;
     }
 
+    *pMP3FrameCount = totalMP3FrameCount;
+    *pPCMFrameCount = totalPCMFrameCount;
+
     return DRMP3_TRUE;
 }
 
-static drmp3_bool32 drmp3_seek_to_pcm_frame__seek_table(drmp3* pMP3, drmp3_uint64 frameIndex)
+/* Like drmp3_get_mp3_and_pcm_frame_count(), but the PCM frame count is in the sample rate of the stream. */
+static drmp3_bool32 drmp3__get_mp3_and_pcm_frame_count(drmp3* pMP3, drmp3_uint64* pMP3FrameCount, drmp3_uint64* pPCMFrameCount)
 {
-    drmp3_seek_point seekPoint;
-    drmp3_uint32 priorSeekPointIndex;
-    drmp3_uint16 iMP3Frame;
-    drmp3_uint64 leftoverFrames;
+    drmp3_uint64 currentPCMFrame;
+    drmp3_uint64 totalPCMFrameCount;
+    drmp3_uint64 totalMP3FrameCount;
 
     DRMP3_ASSERT(pMP3 != NULL);
-    DRMP3_ASSERT(pMP3->pSeekPoints != NULL);
-    DRMP3_ASSERT(pMP3->seekPointCount > 0);
 
-    /* If there is no prior seekpoint it means the target PCM frame comes before the first seek point. Just assume a seekpoint at the start of the file in this case. */
-    if (drmp3_find_closest_seek_point(pMP3, frameIndex, &priorSeekPointIndex)) {
-        seekPoint = pMP3->pSeekPoints[priorSeekPointIndex];
-    } else {
-        seekPoint.seekPosInBytes     = 0;
-        seekPoint.pcmFrameIndex      = 0;
-        seekPoint.mp3FramesToDiscard = 0;
-        seekPoint.pcmFramesToDiscard = 0;
-    }
+    /* If we have a Xing/Info or VBRI frame we can just use the frame count from that. */
+    if (pMP3->vbrTag.mp3FrameCount > 0) {
+        if (pMP3FrameCount != NULL) {
+            *pMP3FrameCount = pMP3->vbrTag.mp3FrameCount;
+        }
+        if (pPCMFrameCount != NULL) {
+            *pPCMFrameCount = drmp3__get_pcm_frame_count_from_vbr_tag(pMP3);
+        }
 
-    /* First thing to do is seek to the first byte of the relevant MP3 frame. */
-    if (!drmp3__on_seek_64(pMP3, seekPoint.seekPosInBytes, drmp3_seek_origin_start)) {
-        return DRMP3_FALSE; /* Failed to seek. */
+        return DRMP3_TRUE;
     }
 
-    /* Clear any cached data. */
-    drmp3_reset(pMP3);
+    /*
+    The way this works is we move back to the start of the stream, iterate over each MP3 frame and calculate the frame count, then
+    seek back to the PCM frame we were sitting on before calling this function. Only the frame headers and side info are looked at,
+    so this runs at about the speed of I/O. Any buffered frames of the sample rate converter stay valid since the decoder ends up
+    exactly where it was.
+    */
 
-    /* Whole MP3 frames need to be discarded first. */
-    for (iMP3Frame = 0; iMP3Frame < seekPoint.mp3FramesToDiscard; ++iMP3Frame) {
-        drmp3_uint32 pcmFramesRead;
-        drmp3d_sample_t* pPCMFrames;
+    /* The stream must support seeking for this to work. */
+    if (pMP3->onSeek == NULL) {
+        return DRMP3_FALSE;
+    }
 
-        /* Pass in non-null for the last frame because we want to ensure the sample rate converter is preloaded correctly. */
-        pPCMFrames = NULL;
-        if (iMP3Frame == seekPoint.mp3FramesToDiscard-1) {
-            pPCMFrames = (drmp3d_sample_t*)pMP3->pcmFrames;
-        }
+    /* We'll need to seek back to where we were, so grab the PCM frame we're currently sitting on so we can restore later. */
+    currentPCMFrame = pMP3->currentPCMFrame;
 
-        /* We first need to decode the next frame. */
-        pcmFramesRead = drmp3_decode_next_frame_ex(pMP3, pPCMFrames);
-        if (pcmFramesRead == 0) {
-            return DRMP3_FALSE;
-        }
+    if (!drmp3__scan_mp3_and_pcm_frame_count(pMP3, &totalMP3FrameCount, &totalPCMFrameCount)) {
+        return DRMP3_FALSE;
     }
 
-    /* We seeked to an MP3 frame in the raw stream so we need to make sure the current PCM frame is set correctly. */
-    pMP3->currentPCMFrame = seekPoint.pcmFrameIndex - seekPoint.pcmFramesToDiscard;
-
-    /*
-    Now at this point we can follow the same process as the brute force technique where we just skip over unnecessary MP3 frames and then
-    read-and-discard at least 2 whole MP3 frames.
-    */
-    leftoverFrames = frameIndex - pMP3->currentPCMFrame;
-    return drmp3_seek_forward_by_pcm_frames__brute_force(pMP3, leftoverFrames);
-}
+    /* A stream that's been cut short still has its encoder delay trimmed from the start. See drmp3__read_vbr_tag(). */
+    if (pMP3->vbrTag.hasGaplessInfo) {
+        totalPCMFrameCount -= DRMP3_MIN(totalPCMFrameCount, pMP3->vbrTag.delayInPCMFrames);
+    }
 
-DRMP3_API drmp3_bool32 drmp3_seek_to_pcm_frame(drmp3* pMP3, drmp3_uint64 frameIndex)
-{
-    if (pMP3 == NULL || pMP3->onSeek == NULL) {
+    /* Finally, we need to seek back to where we were. */
+    if (!drmp3_seek_to_start_of_stream(pMP3)) {
         return DRMP3_FALSE;
     }
 
-    if (frameIndex == 0) {
-        return drmp3_seek_to_start_of_stream(pMP3);
+    if (!drmp3_seek_to_pcm_frame_raw(pMP3, currentPCMFrame)) {
+        return DRMP3_FALSE;
     }
 
-    /* Use the seek table if we have one. */
-    if (pMP3->pSeekPoints != NULL && pMP3->seekPointCount > 0) {
-        return drmp3_seek_to_pcm_frame__seek_table(pMP3, frameIndex);
-    } else {
-        return drmp3_seek_to_pcm_frame__brute_force(pMP3, frameIndex);
+    if (pMP3FrameCount != NULL) {
+        *pMP3FrameCount = totalMP3FrameCount;
+    }
+    if (pPCMFrameCount != NULL) {
+        *pPCMFrameCount = totalPCMFrameCount;
     }
+
+    return DRMP3_TRUE;
 }
 
 DRMP3_API drmp3_bool32 drmp3_get_mp3_and_pcm_frame_count(drmp3* pMP3, drmp3_uint64* pMP3FrameCount, drmp3_uint64* pPCMFrameCount)
 {
-    drmp3_uint64 currentPCMFrame;
     drmp3_uint64 totalPCMFrameCount;
-    drmp3_uint64 totalMP3FrameCount;
 
     if (pMP3 == NULL) {
         return DRMP3_FALSE;
     }
 
-    /*
-    The way this works is we move back to the start of the stream, iterate over each MP3 frame and calculate the frame count based
-    on our output sample rate, the seek back to the PCM frame we were sitting on before calling this function.
-    */
-
-    /* The stream must support seeking for this to work. */
-    if (pMP3->onSeek == NULL) {
+    if (!drmp3__get_mp3_and_pcm_frame_count(pMP3, pMP3FrameCount, &totalPCMFrameCount)) {
         return DRMP3_FALSE;
     }
 
-    /* We'll need to seek back to where we were, so grab the PCM frame we're currently sitting on so we can restore later. */
-    currentPCMFrame = pMP3->currentPCMFrame;
-    
-    if (!drmp3_seek_to_start_of_stream(pMP3)) {
-        return DRMP3_FALSE;
+    /* Output frame k sits at input frame k*downFactor/upFactor so this is the number of output frames before the end of the input. */
+    if (pMP3->converter.isEnabled) {
+        totalPCMFrameCount = (totalPCMFrameCount*pMP3->converter.upFactor + pMP3->converter.downFactor - 1) / pMP3->converter.downFactor;
     }
 
-    totalPCMFrameCount = 0;
-    totalMP3FrameCount = 0;
+    if (pPCMFrameCount != NULL) {
+        *pPCMFrameCount = totalPCMFrameCount;
+    }
 
-    for (;;) {
-        drmp3_uint32 pcmFramesInCurrentMP3Frame;
+    return DRMP3_TRUE;
+}
 
-        pcmFramesInCurrentMP3Frame = drmp3_decode_next_frame_ex(pMP3, NULL);
-        if (pcmFramesInCurrentMP3Frame == 0) {
-            break;
-        }
+DRMP3_API drmp3_bool32 drmp3_verify_vbr_tag(drmp3* pMP3)
+{
+    drmp3_uint64 currentPCMFrame;
+    drmp3_uint64 totalPCMFrameCount;
+    drmp3_uint64 totalMP3FrameCount;
 
-        totalPCMFrameCount += pcmFramesInCurrentMP3Frame;
-        totalMP3FrameCount += 1;
+    if (pMP3 == NULL || pMP3->onSeek == NULL) {
+        return DRMP3_FALSE;
     }
 
-    /* Finally, we need to seek back to where we were. */
-    if (!drmp3_seek_to_start_of_stream(pMP3)) {
-        return DRMP3_FALSE;
+    /* Nothing to verify if there's no tag. */
+    if (pMP3->vbrTag.mp3FrameCount == 0) {
+        return DRMP3_TRUE;
     }
 
-    if (!drmp3_seek_to_pcm_frame(pMP3, currentPCMFrame)) {
+    currentPCMFrame = pMP3->currentPCMFrame;
+
+    if (!drmp3__scan_mp3_and_pcm_frame_count(pMP3, &totalMP3FrameCount, &totalPCMFrameCount)) {
         return DRMP3_FALSE;
     }
 
-    if (pMP3FrameCount != NULL) {
-        *pMP3FrameCount = totalMP3FrameCount;
+    if (totalMP3FrameCount == pMP3->vbrTag.mp3FrameCount) {
+        /* The tag is good. We can just go back to where we were. Since the count hasn't changed, neither has the current PCM frame. */
+        if (!drmp3_seek_to_start_of_stream(pMP3)) {
+            return DRMP3_FALSE;
+        }
+
+        return drmp3_seek_to_pcm_frame_raw(pMP3, currentPCMFrame);
     }
-    if (pPCMFrameCount != NULL) {
-        *pPCMFrameCount = totalPCMFrameCount;
+
+    /*
+    The tag is lying, which happens when a file has been cut or appended to without rewriting the tag. The scanned count replaces the
+    one from the tag so that the length and gapless trimming reflect what's actually in the stream. The TOC is no longer trustworthy
+    either since it was built against a different byte count.
+    */
+    pMP3->vbrTag.mp3FrameCount = totalMP3FrameCount;
+    pMP3->vbrTag.hasTOC        = DRMP3_FALSE;
+
+    if (!drmp3_seek_to_start_of_stream(pMP3)) {
+        return DRMP3_FALSE;
     }
+    drmp3_seek_to_pcm_frame_raw(pMP3, currentPCMFrame);
 
-    return DRMP3_TRUE;
+    return DRMP3_FALSE;
 }
 
 DRMP3_API drmp3_uint64 drmp3_get_pcm_frame_count(drmp3* pMP3)
@@ -3946,7 +7593,7 @@ static void drmp3__accumulate_running_pcm_frame_count(drmp3* pMP3, drmp3_uint32
     float pcmFrameCountOutF;
     drmp3_uint32 pcmFrameCountOut;
 
-    srcRatio = (float)pMP3->mp3FrameSampleRate / (float)pMP3->sampleRate;
+    srcRatio = (float)pMP3->mp3FrameSampleRate / (float)pMP3->converter.sampleRateIn;
     DRMP3_ASSERT(srcRatio > 0);
 
     pcmFrameCountOutF = *pRunningPCMFrameCountFractionalPart + (pcmFrameCountIn / srcRatio);
@@ -3961,6 +7608,41 @@ typedef struct
     drmp3_uint64 pcmFrameIndex; /* <-- After sample rate conversion. */
 } drmp3__seeking_mp3_frame_info;
 
+static void drmp3__make_seek_point(const drmp3__seeking_mp3_frame_info* pMP3FrameInfo, drmp3_uint32 mp3FrameInfoCount, drmp3_uint64 targetPCMFrame, drmp3_uint64 delayInPCMFrames, drmp3_seek_point* pSeekPoint)
+{
+    /*
+    The last MP3 frame is the one containing the target. The two before it are fully decoded when seeking so the IMDCT overlap and
+    synthesis filter are in the right state (see drmp3_seek_to_pcm_frame__seek_table()). Before them we need enough frames to fill
+    the bit reservoir of the first one so that it decodes exactly like it would when playing from the start. The payload of each frame
+    is estimated conservatively by assuming the largest possible header and side info.
+    */
+    drmp3_uint32 iTargetFrame = mp3FrameInfoCount-1;
+    drmp3_uint32 iFirstFrame;
+    drmp3_uint32 iLastLeadingFrame;
+    drmp3_uint64 reservoirBytes = 0;
+
+    DRMP3_ASSERT(mp3FrameInfoCount > 0);
+
+    iFirstFrame = (iTargetFrame >= 2) ? iTargetFrame-2 : 0;
+    while (iFirstFrame > 0 && reservoirBytes < DRMP3_MAX_BITRESERVOIR_BYTES) {
+        drmp3_uint64 frameBytes;
+
+        iFirstFrame -= 1;
+
+        frameBytes = pMP3FrameInfo[iFirstFrame+1].bytePos - pMP3FrameInfo[iFirstFrame].bytePos;
+        if (frameBytes > DRMP3_HDR_SIZE + 2 + 32) {
+            reservoirBytes += frameBytes - (DRMP3_HDR_SIZE + 2 + 32);   /* Header, CRC and side info. */
+        }
+    }
+
+    iLastLeadingFrame = (iTargetFrame > iFirstFrame) ? iTargetFrame-1 : iTargetFrame;
+
+    pSeekPoint->seekPosInBytes     = pMP3FrameInfo[iFirstFrame].bytePos;
+    pSeekPoint->pcmFrameIndex      = targetPCMFrame - delayInPCMFrames;
+    pSeekPoint->mp3FramesToDiscard = (drmp3_uint16)(iTargetFrame - iFirstFrame);
+    pSeekPoint->pcmFramesToDiscard = (drmp3_uint16)(targetPCMFrame - pMP3FrameInfo[iLastLeadingFrame].pcmFrameIndex);
+}
+
 DRMP3_API drmp3_bool32 drmp3_calculate_seek_points(drmp3* pMP3, drmp3_uint32* pSeekPointCount, drmp3_seek_point* pSeekPoints)
 {
     drmp3_uint32 seekPointCount;
@@ -3981,24 +7663,24 @@ DRMP3_API drmp3_bool32 drmp3_calculate_seek_points(drmp3* pMP3, drmp3_uint32* pS
     currentPCMFrame = pMP3->currentPCMFrame;
     
     /* We never do more than the total number of MP3 frames and we limit it to 32-bits. */
-    if (!drmp3_get_mp3_and_pcm_frame_count(pMP3, &totalMP3FrameCount, &totalPCMFrameCount)) {
+    if (!drmp3__get_mp3_and_pcm_frame_count(pMP3, &totalMP3FrameCount, &totalPCMFrameCount)) {
         return DRMP3_FALSE;
     }
 
     /* If there's less than DRMP3_SEEK_LEADING_MP3_FRAMES+1 frames we just report 1 seek point which will be the very start of the stream. */
     if (totalMP3FrameCount < DRMP3_SEEK_LEADING_MP3_FRAMES+1) {
         seekPointCount = 1;
-        pSeekPoints[0].seekPosInBytes     = 0;
+        pSeekPoints[0].seekPosInBytes     = pMP3->streamStartOffset;
         pSeekPoints[0].pcmFrameIndex      = 0;
         pSeekPoints[0].mp3FramesToDiscard = 0;
         pSeekPoints[0].pcmFramesToDiscard = 0;
     } else {
         drmp3_uint64 pcmFramesBetweenSeekPoints;
-        drmp3__seeking_mp3_frame_info mp3FrameInfo[DRMP3_SEEK_LEADING_MP3_FRAMES+1];
+        drmp3__seeking_mp3_frame_info mp3FrameInfo[DRMP3_SEEK_MAX_PRIMING_MP3_FRAMES+3];
+        drmp3_uint32 mp3FrameInfoCount = 0;
         drmp3_uint64 runningPCMFrameCount = 0;
         float runningPCMFrameCountFractionalPart = 0;
         drmp3_uint64 nextTargetPCMFrame;
-        drmp3_uint32 iMP3Frame;
         drmp3_uint32 iSeekPoint;
 
         if (seekPointCount > totalMP3FrameCount-1) {
@@ -4017,82 +7699,53 @@ DRMP3_API drmp3_bool32 drmp3_calculate_seek_points(drmp3* pMP3, drmp3_uint32* pS
 
         /*
         We need to cache the byte positions of the previous MP3 frames. As a new MP3 frame is iterated, we cycle the byte positions in this
-        array. The value in the first item in this array is the byte position that will be reported in the next seek point.
-        */
-
-        /* We need to initialize the array of MP3 byte positions for the leading MP3 frames. */
-        for (iMP3Frame = 0; iMP3Frame < DRMP3_SEEK_LEADING_MP3_FRAMES+1; ++iMP3Frame) {
-            drmp3_uint32 pcmFramesInCurrentMP3FrameIn;
-
-            /* The byte position of the next frame will be the stream's cursor position, minus whatever is sitting in the buffer. */
-            DRMP3_ASSERT(pMP3->streamCursor >= pMP3->dataSize);
-            mp3FrameInfo[iMP3Frame].bytePos       = pMP3->streamCursor - pMP3->dataSize;
-            mp3FrameInfo[iMP3Frame].pcmFrameIndex = runningPCMFrameCount;
-
-            /* We need to get information about this frame so we can know how many samples it contained. */
-            pcmFramesInCurrentMP3FrameIn = drmp3_decode_next_frame_ex(pMP3, NULL);
-            if (pcmFramesInCurrentMP3FrameIn == 0) {
-                return DRMP3_FALSE; /* This should never happen. */
-            }
-
-            drmp3__accumulate_running_pcm_frame_count(pMP3, pcmFramesInCurrentMP3FrameIn, &runningPCMFrameCount, &runningPCMFrameCountFractionalPart);
-        }
-
-        /*
-        At this point we will have extracted the byte positions of the leading MP3 frames. We can now start iterating over each seek point and
-        calculate them.
+        array. The last item is always the MP3 frame that was most recently stepped over. The running PCM frame count includes the encoder
+        delay of gapless streams, but the PCM frame index of each seek point must not since that's what the application will be seeking to.
         */
-        nextTargetPCMFrame = 0;
+        nextTargetPCMFrame = pMP3->vbrTag.delayInPCMFrames;
         for (iSeekPoint = 0; iSeekPoint < seekPointCount; ++iSeekPoint) {
             nextTargetPCMFrame += pcmFramesBetweenSeekPoints;
 
-            for (;;) {
-                if (nextTargetPCMFrame < runningPCMFrameCount) {
-                    /* The next seek point is in the current MP3 frame. */
-                    pSeekPoints[iSeekPoint].seekPosInBytes     = mp3FrameInfo[0].bytePos;
-                    pSeekPoints[iSeekPoint].pcmFrameIndex      = nextTargetPCMFrame;
-                    pSeekPoints[iSeekPoint].mp3FramesToDiscard = DRMP3_SEEK_LEADING_MP3_FRAMES;
-                    pSeekPoints[iSeekPoint].pcmFramesToDiscard = (drmp3_uint16)(nextTargetPCMFrame - mp3FrameInfo[DRMP3_SEEK_LEADING_MP3_FRAMES-1].pcmFrameIndex);
-                    break;
-                } else {
-                    size_t i;
-                    drmp3_uint32 pcmFramesInCurrentMP3FrameIn;
+            /* Keep going until we're sitting on the MP3 frame containing the next seek point. */
+            while (nextTargetPCMFrame >= runningPCMFrameCount) {
+                drmp3_uint32 pcmFramesInCurrentMP3FrameIn;
 
-                    /*
-                    The next seek point is not in the current MP3 frame, so continue on to the next one. The first thing to do is cycle the cached
-                    MP3 frame info.
-                    */
+                if (mp3FrameInfoCount == DRMP3_COUNTOF(mp3FrameInfo)) {
+                    size_t i;
                     for (i = 0; i < DRMP3_COUNTOF(mp3FrameInfo)-1; ++i) {
                         mp3FrameInfo[i] = mp3FrameInfo[i+1];
                     }
 
-                    /* Cache previous MP3 frame info. */
-                    mp3FrameInfo[DRMP3_COUNTOF(mp3FrameInfo)-1].bytePos       = pMP3->streamCursor - pMP3->dataSize;
-                    mp3FrameInfo[DRMP3_COUNTOF(mp3FrameInfo)-1].pcmFrameIndex = runningPCMFrameCount;
-
-                    /*
-                    Go to the next MP3 frame. This shouldn't ever fail, but just in case it does we just set the seek point and break. If it happens, it
-                    should only ever do it for the last seek point.
-                    */
-                    pcmFramesInCurrentMP3FrameIn = drmp3_decode_next_frame_ex(pMP3, NULL);
-                    if (pcmFramesInCurrentMP3FrameIn == 0) {
-                        pSeekPoints[iSeekPoint].seekPosInBytes     = mp3FrameInfo[0].bytePos;
-                        pSeekPoints[iSeekPoint].pcmFrameIndex      = nextTargetPCMFrame;
-                        pSeekPoints[iSeekPoint].mp3FramesToDiscard = DRMP3_SEEK_LEADING_MP3_FRAMES;
-                        pSeekPoints[iSeekPoint].pcmFramesToDiscard = (drmp3_uint16)(nextTargetPCMFrame - mp3FrameInfo[DRMP3_SEEK_LEADING_MP3_FRAMES-1].pcmFrameIndex);
-                        break;
-                    }
+                    mp3FrameInfoCount -= 1;
+                }
+
+                mp3FrameInfo[mp3FrameInfoCount].bytePos       = drmp3__get_next_frame_pos(pMP3);
+                mp3FrameInfo[mp3FrameInfoCount].pcmFrameIndex = runningPCMFrameCount;
 
-                    drmp3__accumulate_running_pcm_frame_count(pMP3, pcmFramesInCurrentMP3FrameIn, &runningPCMFrameCount, &runningPCMFrameCountFractionalPart);
+                pcmFramesInCurrentMP3FrameIn = drmp3_scan_next_frame(pMP3);
+                if (pcmFramesInCurrentMP3FrameIn == 0) {
+                    break;  /* Reached the end. */
                 }
+
+                mp3FrameInfoCount += 1;
+                drmp3__accumulate_running_pcm_frame_count(pMP3, pcmFramesInCurrentMP3FrameIn, &runningPCMFrameCount, &runningPCMFrameCountFractionalPart);
+            }
+
+            /* This shouldn't ever happen, but if the stream ends early we just report fewer seek points. */
+            if (nextTargetPCMFrame >= runningPCMFrameCount) {
+                break;
             }
+
+            drmp3__make_seek_point(mp3FrameInfo, mp3FrameInfoCount, nextTargetPCMFrame, pMP3->vbrTag.delayInPCMFrames, &pSeekPoints[iSeekPoint]);
         }
 
+        seekPointCount = iSeekPoint;
+
         /* Finally, we need to seek back to where we were. */
         if (!drmp3_seek_to_start_of_stream(pMP3)) {
             return DRMP3_FALSE;
         }
-        if (!drmp3_seek_to_pcm_frame(pMP3, currentPCMFrame)) {
+        if (!drmp3_seek_to_pcm_frame_raw(pMP3, currentPCMFrame)) {
             return DRMP3_FALSE;
         }
     }
@@ -4101,12 +7754,112 @@ DRMP3_API drmp3_bool32 drmp3_calculate_seek_points(drmp3* pMP3, drmp3_uint32* pS
     return DRMP3_TRUE;
 }
 
+static void drmp3__record_mp3_frame(drmp3* pMP3, drmp3_uint64 bytePos, drmp3_uint32 pcmFrameCount)
+{
+    /*
+    Called for each MP3 frame that's decoded while the seek recorder is in sync. The frame is added to the ring of recent frames and
+    a seek point is made in the same way as drmp3_calculate_seek_points() each time the running PCM frame count passes the next target.
+    Seek points need enough frames before them to fill the bit reservoir, so none are made until the ring is full, unless the ring
+    goes back to the start of the stream.
+    */
+    const drmp3_uint32 ringSize = DRMP3_COUNTOF(pMP3->seekRecorder.mp3FrameBytePos);
+    drmp3_uint32 iFrame;
+    drmp3_uint64 pcmFrameCountInStream = ~(drmp3_uint64)0;
+
+    if (pcmFrameCount == 0) {
+        pMP3->seekRecorder.isInSync = DRMP3_FALSE;  /* End of the stream or an error. */
+        return;
+    }
+
+    if (pMP3->seekRecorder.mp3FrameCount == ringSize) {
+        pMP3->seekRecorder.mp3FrameHead      = (pMP3->seekRecorder.mp3FrameHead + 1) % ringSize;
+        pMP3->seekRecorder.mp3FrameCount    -= 1;
+        pMP3->seekRecorder.isAtStartOfStream = DRMP3_FALSE;
+    }
+
+    iFrame = (pMP3->seekRecorder.mp3FrameHead + pMP3->seekRecorder.mp3FrameCount) % ringSize;
+    pMP3->seekRecorder.mp3FrameBytePos[iFrame]       = bytePos;
+    pMP3->seekRecorder.mp3FramePCMFrameIndex[iFrame] = pMP3->seekRecorder.runningPCMFrameCount;
+    pMP3->seekRecorder.mp3FrameCount += 1;
+
+    drmp3__accumulate_running_pcm_frame_count(pMP3, pcmFrameCount, &pMP3->seekRecorder.runningPCMFrameCount, &pMP3->seekRecorder.runningPCMFrameCountFractionalPart);
+
+    /* Seek points in the padding at the end of a gapless stream could never be used. */
+    if (pMP3->vbrTag.hasGaplessInfo && pMP3->vbrTag.mp3FrameCount > 0) {
+        pcmFrameCountInStream = pMP3->vbrTag.delayInPCMFrames + drmp3__get_pcm_frame_count_from_vbr_tag(pMP3);
+    }
+
+    while (pMP3->seekRecorder.nextTargetPCMFrame < pMP3->seekRecorder.runningPCMFrameCount && pMP3->seekRecorder.nextTargetPCMFrame < pcmFrameCountInStream) {
+        if (pMP3->seekPointCount < pMP3->seekRecorder.capacity && (pMP3->seekRecorder.mp3FrameCount == ringSize || pMP3->seekRecorder.isAtStartOfStream)) {
+            drmp3__seeking_mp3_frame_info mp3FrameInfo[DRMP3_SEEK_MAX_PRIMING_MP3_FRAMES+3];
+            drmp3_seek_point seekPoint;
+            drmp3_uint32 i;
+
+            for (i = 0; i < pMP3->seekRecorder.mp3FrameCount; ++i) {
+                iFrame = (pMP3->seekRecorder.mp3FrameHead + i) % ringSize;
+                mp3FrameInfo[i].bytePos       = pMP3->seekRecorder.mp3FrameBytePos[iFrame];
+                mp3FrameInfo[i].pcmFrameIndex = pMP3->seekRecorder.mp3FramePCMFrameIndex[iFrame];
+            }
+
+            drmp3__make_seek_point(mp3FrameInfo, pMP3->seekRecorder.mp3FrameCount, pMP3->seekRecorder.nextTargetPCMFrame, pMP3->vbrTag.delayInPCMFrames, &seekPoint);
+
+            /* Seek points that are already in the table, such as after seeking back into the part of the stream that's been played, are left alone. */
+            if (pMP3->seekPointCount == 0 || seekPoint.pcmFrameIndex > pMP3->pSeekPoints[pMP3->seekPointCount-1].pcmFrameIndex) {
+                pMP3->pSeekPoints[pMP3->seekPointCount] = seekPoint;
+                pMP3->seekPointCount += 1;
+            }
+        }
+
+        pMP3->seekRecorder.nextTargetPCMFrame += pMP3->seekRecorder.pcmFramesBetweenSeekPoints;
+    }
+}
+
+DRMP3_API drmp3_bool32 drmp3_record_seek_points(drmp3* pMP3, drmp3_uint32 seekPointCount, drmp3_uint32 seekPointCapacity, drmp3_seek_point* pSeekPoints, drmp3_uint64 pcmFramesBetweenSeekPoints)
+{
+    if (pMP3 == NULL || pSeekPoints == NULL || seekPointCapacity == 0 || seekPointCount > seekPointCapacity) {
+        return DRMP3_FALSE;
+    }
+
+    if (pcmFramesBetweenSeekPoints == 0) {
+        pcmFramesBetweenSeekPoints = pMP3->converter.sampleRateIn;
+    }
+
+    pMP3->pSeekPoints    = pSeekPoints;
+    pMP3->seekPointCount = seekPointCount;
+    pMP3->seekRecorder.capacity = seekPointCapacity;
+    pMP3->seekRecorder.pcmFramesBetweenSeekPoints = pcmFramesBetweenSeekPoints;
+    pMP3->seekRecorder.isInSync = DRMP3_FALSE;
+
+    /*
+    The first MP3 frame was decoded during initialization, before there was anything to record it to. If nothing has been read yet
+    we just go back to the start of the stream so it gets decoded again. Otherwise recording starts the next time the decoder seeks.
+    */
+    if (pMP3->currentPCMFrame == 0 && pMP3->pcmFramesConsumedInMP3Frame == 0 && pMP3->onSeek != NULL) {
+        return drmp3_seek_to_pcm_frame(pMP3, 0);
+    }
+
+    return DRMP3_TRUE;
+}
+
+DRMP3_API drmp3_uint32 drmp3_get_seek_point_count(drmp3* pMP3)
+{
+    if (pMP3 == NULL || pMP3->pSeekPoints == NULL) {
+        return 0;
+    }
+
+    return pMP3->seekPointCount;
+}
+
 DRMP3_API drmp3_bool32 drmp3_bind_seek_table(drmp3* pMP3, drmp3_uint32 seekPointCount, drmp3_seek_point* pSeekPoints)
 {
     if (pMP3 == NULL) {
         return DRMP3_FALSE;
     }
 
+    /* Stop recording, if drmp3_record_seek_points() was used. */
+    pMP3->seekRecorder.capacity = 0;
+    pMP3->seekRecorder.isInSync = DRMP3_FALSE;
+
     if (seekPointCount == 0 || pSeekPoints == NULL) {
         /* Unbinding. */
         pMP3->seekPointCount = 0;
@@ -4120,6 +7873,61 @@ DRMP3_API drmp3_bool32 drmp3_bind_seek_table(drmp3* pMP3, drmp3_uint32 seekPoint
     return DRMP3_TRUE;
 }
 
+static drmp3_bool32 drmp3__init_memory_segment(drmp3* pMP3, const void* pData, size_t dataSize, drmp3_uint32 seekPointCount, const drmp3_seek_point* pSeekPoints, drmp3_uint64 firstPCMFrame, const drmp3_allocation_callbacks* pAllocationCallbacks)
+{
+    if (!drmp3_init_memory(pMP3, pData, dataSize, pAllocationCallbacks)) {
+        return DRMP3_FALSE;
+    }
+
+    /* Seek points are only written while they're being recorded, which never happens here, so the table is only ever read from. */
+    drmp3_bind_seek_table(pMP3, seekPointCount, (drmp3_seek_point*)pSeekPoints);
+
+    if (!drmp3_seek_to_pcm_frame(pMP3, firstPCMFrame)) {
+        drmp3_uninit(pMP3);
+        return DRMP3_FALSE;
+    }
+
+    return DRMP3_TRUE;
+}
+
+DRMP3_API drmp3_uint64 drmp3_decode_memory_segment_f32(const void* pData, size_t dataSize, drmp3_uint32 seekPointCount, const drmp3_seek_point* pSeekPoints, drmp3_uint64 firstPCMFrame, drmp3_uint64 pcmFrameCount, float* pFramesOut, const drmp3_allocation_callbacks* pAllocationCallbacks)
+{
+    drmp3 mp3;
+    drmp3_uint64 framesRead;
+
+    if (pFramesOut == NULL) {
+        return 0;
+    }
+
+    if (!drmp3__init_memory_segment(&mp3, pData, dataSize, seekPointCount, pSeekPoints, firstPCMFrame, pAllocationCallbacks)) {
+        return 0;
+    }
+
+    framesRead = drmp3_read_pcm_frames_f32(&mp3, pcmFrameCount, pFramesOut);
+    drmp3_uninit(&mp3);
+
+    return framesRead;
+}
+
+DRMP3_API drmp3_uint64 drmp3_decode_memory_segment_s16(const void* pData, size_t dataSize, drmp3_uint32 seekPointCount, const drmp3_seek_point* pSeekPoints, drmp3_uint64 firstPCMFrame, drmp3_uint64 pcmFrameCount, drmp3_int16* pFramesOut, const drmp3_allocation_callbacks* pAllocationCallbacks)
+{
+    drmp3 mp3;
+    drmp3_uint64 framesRead;
+
+    if (pFramesOut == NULL) {
+        return 0;
+    }
+
+    if (!drmp3__init_memory_segment(&mp3, pData, dataSize, seekPointCount, pSeekPoints, firstPCMFrame, pAllocationCallbacks)) {
+        return 0;
+    }
+
+    framesRead = drmp3_read_pcm_frames_s16(&mp3, pcmFrameCount, pFramesOut);
+    drmp3_uninit(&mp3);
+
+    return framesRead;
+}
+
 
 static float* drmp3__full_read_and_close_f32(drmp3* pMP3, drmp3_config* pConfig, drmp3_uint64* pTotalFrameCount)
 {
@@ -4423,6 +8231,56 @@ counts rather than sample counts.
 /*
 REVISION HISTORY
 ================
+v0.6.11 - TBD
+  - Add support for Xing/Info and VBRI frames. The tag frame is no longer output as a frame of silence, the frame count is
+    taken from the tag instead of scanning the entire stream and the table of contents can be used for fast approximate seeking
+    with drmp3_set_seek_mode().
+  - Fix a bug where decoding from memory would stop at the first MP3 frame that could not be decoded.
+  - Fix a bug in drmp3_read_pcm_frames_f32() where output would be written to the wrong location when reading more than 8192 samples.
+  - Add support for gapless playback. The encoder delay and padding from the LAME tag are trimmed from the output.
+  - Counting frames and calculating seek points no longer decodes any audio. Only frame headers and side info are parsed.
+  - Add drmp3_verify_vbr_tag() for checking the frame count of a Xing/Info or VBRI frame against the stream.
+  - ID3v2, ID3v1 (including the extended "TAG+" block) and APEv2 tags are now skipped directly instead of being scanned for a sync
+    word. This makes opening files with large embedded artwork much faster and fixes a bug where the last MP3 frame would be dropped
+    when followed by a tag.
+  - Make seeking with a seek table sample exact. Seek points now start far enough back to fill the bit reservoir, and frames that can't
+    be decoded while warming up are no longer skipped. Seek tables also work correctly when decoding from memory now.
+  - Add drmp3_decode_memory_segment_f32() and drmp3_decode_memory_segment_s16() for decoding a stream in parallel.
+  - Add AVX versions of the polyphase synthesis, DCT, IMDCT and antialiasing stages, selected at run time. Output is identical to the
+    SSE path. Use DR_MP3_NO_AVX to disable.
+  - Speed up Huffman decoding. Most value pairs, including their sign bits, are now decoded with a single table lookup, and the bit
+    cache has been widened to 64 bits so it only needs to be refilled once per pair.
+  - Add DR_MP3_FIXED_POINT for decoding without any floating point math. Every stage works on 32-bit fixed point numbers and the
+    output is s16, within 2 LSB of the floating point decoder. This is intended for CPUs without an FPU or with a slow one.
+  - Add drmp3_set_output_format() for converting the output to a different channel count and sample rate. Sample rate conversion
+    uses a windowed sinc filter with SIMD and run-time selected AVX kernels. Seeking and frame counts work in the output rate.
+  - The buffer that data is read into from the onRead callback is now used as a ring so buffered data is no longer moved down before
+    every read. It now defaults to 16KB rather than 64KB and its size can be changed with drmp3_set_input_buffer_size().
+  - Add drmp3_init_file_mmap() and drmp3_init_file_mmap_w() for decoding a file in place by mapping it into memory. Use DR_MP3_NO_MMAP to disable mapping.
+  - Fix decoding from memory for data larger than 2GB.
+  - Add DR_MP3_COMPACT for reducing the size of the drmp3 structure and its input buffer, and drmp3_suspend()/drmp3_resume() for
+    releasing the buffers of decoders that are not currently being read from.
+  - Frames are now decoded straight into the output buffer of drmp3_read_pcm_frames_*() when it has room for a whole MP3 frame.
+  - Add drmp3_init_preallocated() and drmp3_get_preallocated_buffer_size() for decoding from callbacks with a buffer owned by the client.
+    Decoders initialized this way never allocate memory.
+  - Seeking with a seek table is faster. The closest seek point is found with a binary search, and only the last MP3 frame before the
+    target goes through the synthesis filter.
+  - Add drmp3_record_seek_points() for building a seek table while the stream is played, so seeking back into the part of the stream
+    that has already been played no longer decodes from the start. Use drmp3_get_seek_point_count() to save the table.
+  - Add drmp3_set_decode_quality() for decoding at half or a quarter of the sample rate. Only the lower subbands are decoded which is
+    faster. Intended for things like waveform thumbnails and scrubbing previews.
+  - Stereo streams are now mixed down to mono by the decoder, before synthesis, when the output format is set to mono. Only one
+    channel is synthesized which makes decoding to mono faster. Samples that would have clipped in one channel no longer do so.
+  - Add drmp3_init_push(), drmp3_push_data() and drmp3_push_end() for decoding network streams without a blocking read callback.
+    ICY (SHOUTcast) metadata can be stripped out of the stream with drmp3_set_icy_metadata_interval().
+  - Add drmp3dec_decode_frame_batch() for decoding a frame from each of many streams at once. Mono Layer III frames are
+    synthesized two at a time in the lanes normally used for the left and right channels of a stereo frame.
+  - Fix drmp3_init_file_w() failing on non-Windows platforms when no allocation callbacks are specified.
+  - Fix corrupt Layer III frames decoding differently from one run to the next. Main data that declares more Huffman bits than it
+    contains and intensity stereo frames whose channels use different block types read uninitialized stack memory.
+  - Fix frame counts and seek tables of Layer I and II streams containing frames that allocate more bits than the frame has. These
+    frames output nothing when decoded but were counted as a full frame, so seeking would land in the wrong place.
+
 v0.6.10 - 2020-05-16
   - Add compile-time and run-time version querying.
     - DRMP3_VERSION_MINOR
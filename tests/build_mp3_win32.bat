@@ -1 +1,3 @@
-gcc ./mp3/dr_mp3_test_0.c -o ./bin/dr_mp3_test_0.exe -std=c89 -ansi -pedantic -Wall
\ No newline at end of file
+gcc ./mp3/dr_mp3_test_0.c -o ./bin/dr_mp3_test_0.exe -std=c89 -ansi -pedantic -Wall
+gcc ./mp3/dr_mp3_decoding.c -o ./bin/dr_mp3_decoding.exe -std=c89 -ansi -pedantic -Wall -O3 -s -DNDEBUG
+g++ ./mp3/dr_mp3_decoding.cpp -o ./bin/dr_mp3_decoding_cpp.exe -pedantic -Wall -O3 -s -DNDEBUG
\ No newline at end of file
@@ -316,6 +316,297 @@ drflac_result decode_test_file_s16(libflac* pLibFlac, drflac* pFlac)
     return result;
 }
 
+drflac_result decode_test__compare_pcm_frames_with_libflac_s32(libflac* pLibFlac, drflac_uint64 firstPCMFrame, const drflac_int32* pPCMFrames, drflac_uint64 pcmFrameCount)
+{
+    drflac_uint64 iPCMFrame;
+
+    if (firstPCMFrame + pcmFrameCount > pLibFlac->pcmFrameCount) {
+        printf("  Too many PCM frames: firstPCMFrame=%d, pcmFrameCount=%d, libFLAC=%d", (int)firstPCMFrame, (int)pcmFrameCount, (int)pLibFlac->pcmFrameCount);
+        return DRFLAC_ERROR;
+    }
+
+    for (iPCMFrame = 0; iPCMFrame < pcmFrameCount; iPCMFrame += 1) {
+        const drflac_int32* pPCMFrame_libflac = pLibFlac->pPCMFrames + ((firstPCMFrame + iPCMFrame) * pLibFlac->channels);
+        const drflac_int32* pPCMFrame_drflac  = pPCMFrames           + (                iPCMFrame  * pLibFlac->channels);
+        drflac_uint32 iChannel;
+
+        for (iChannel = 0; iChannel < pLibFlac->channels; iChannel += 1) {
+            if (pPCMFrame_libflac[iChannel] != pPCMFrame_drflac[iChannel]) {
+                printf("  PCM Frame @ %d[%d] does not match", (int)(firstPCMFrame + iPCMFrame), iChannel);
+                return DRFLAC_ERROR;    /* Decoded frames do not match. */
+            }
+        }
+    }
+
+    return DRFLAC_SUCCESS;
+}
+
+static size_t decode_test__on_read_file(void* pUserData, void* pBufferOut, size_t bytesToRead)
+{
+    return fread(pBufferOut, 1, bytesToRead, (FILE*)pUserData);
+}
+
+static drflac_bool32 decode_test__on_seek_file(void* pUserData, int offset, drflac_seek_origin origin)
+{
+    return fseek((FILE*)pUserData, offset, (origin == drflac_seek_origin_current) ? SEEK_CUR : SEEK_SET) == 0;
+}
+
+drflac_result decode_test_file_clone(libflac* pLibFlac, const char* pFilePath)
+{
+    /*
+    This tests that clones have their own read cursor. The original decoder and two clones, one reading from the same block of memory and the
+    other from it's own file handle, are each started at a different position and then read in small interleaved chunks.
+    */
+    drflac_result result = DRFLAC_SUCCESS;
+    void* pFileData;
+    size_t fileSizeInBytes;
+    FILE* pFile;
+    drflac* pDecoders[3];
+    drflac_uint64 cursors[3];
+    drflac_int32* pPCMFrames;
+    drflac_uint64 pcmFrameChunkSize = 1000;   /* Deliberately not a multiple of the block size so reads straddle FLAC frames. */
+    drflac_uint32 iDecoder;
+    drflac_bool32 isAtEnd;
+
+    pFileData = dr_open_and_read_file(pFilePath, &fileSizeInBytes);
+    if (pFileData == NULL) {
+        printf("  Failed to load file");
+        return DRFLAC_ERROR;
+    }
+
+    if (dr_fopen(&pFile, pFilePath, "rb") != 0) {
+        free(pFileData);
+        printf("  Failed to open file");
+        return DRFLAC_ERROR;
+    }
+
+    pDecoders[0] = drflac_open_memory(pFileData, fileSizeInBytes, NULL);
+    pDecoders[1] = drflac_clone(pDecoders[0], NULL, NULL, NULL, NULL);
+    pDecoders[2] = drflac_clone(pDecoders[0], decode_test__on_read_file, decode_test__on_seek_file, pFile, NULL);
+    if (pDecoders[0] == NULL || pDecoders[1] == NULL || pDecoders[2] == NULL) {
+        printf("  Failed to clone decoder");
+        result = DRFLAC_ERROR;
+    }
+
+    pPCMFrames = (drflac_int32*)malloc((size_t)(pcmFrameChunkSize * pLibFlac->channels * sizeof(drflac_int32)));
+    if (pPCMFrames == NULL) {
+        printf("  Out of memory");
+        result = DRFLAC_ERROR;
+    }
+
+    for (iDecoder = 0; iDecoder < 3 && result == DRFLAC_SUCCESS; iDecoder += 1) {
+        cursors[iDecoder] = (pLibFlac->pcmFrameCount / 3) * iDecoder;
+        if (!drflac_seek_to_pcm_frame(pDecoders[iDecoder], cursors[iDecoder])) {
+            printf("  [dr_flac] Failed to seek to PCM frame @ %d", (int)cursors[iDecoder]);
+            result = DRFLAC_ERROR;
+        }
+    }
+
+    isAtEnd = DRFLAC_FALSE;
+    while (result == DRFLAC_SUCCESS && !isAtEnd) {
+        isAtEnd = DRFLAC_TRUE;
+
+        for (iDecoder = 0; iDecoder < 3 && result == DRFLAC_SUCCESS; iDecoder += 1) {
+            drflac_uint64 pcmFramesRead = drflac_read_pcm_frames_s32(pDecoders[iDecoder], pcmFrameChunkSize, pPCMFrames);
+            if (pcmFramesRead > 0) {
+                result = decode_test__compare_pcm_frames_with_libflac_s32(pLibFlac, cursors[iDecoder], pPCMFrames, pcmFramesRead);
+                cursors[iDecoder] += pcmFramesRead;
+                isAtEnd = DRFLAC_FALSE;
+            }
+        }
+    }
+
+    for (iDecoder = 0; iDecoder < 3 && result == DRFLAC_SUCCESS; iDecoder += 1) {
+        if (cursors[iDecoder] != pLibFlac->pcmFrameCount) {
+            printf("  Decoded frame counts differ: decoder=%d, libFLAC=%d, dr_flac=%d", (int)iDecoder, (int)pLibFlac->pcmFrameCount, (int)cursors[iDecoder]);
+            result = DRFLAC_ERROR;
+        }
+    }
+
+    /* The clones must be closed before the original decoder since they share it's seek table. */
+    free(pPCMFrames);
+    drflac_close(pDecoders[2]);
+    drflac_close(pDecoders[1]);
+    drflac_close(pDecoders[0]);
+    fclose(pFile);
+    free(pFileData);
+
+    return result;
+}
+
+#ifndef DR_FLAC_NO_CRC
+typedef struct
+{
+    drflac_uint32 callbackCount;
+    drflac_uint64 firstPCMFrame;
+    drflac_uint32 pcmFrameCount;
+} frame_error_test_state;
+
+static void decode_test__on_frame_error(void* pUserData, drflac_uint64 firstPCMFrame, drflac_uint32 pcmFrameCount)
+{
+    frame_error_test_state* pState = (frame_error_test_state*)pUserData;
+
+    pState->callbackCount += 1;
+    pState->firstPCMFrame  = firstPCMFrame;
+    pState->pcmFrameCount  = pcmFrameCount;
+}
+
+/*
+Finds the end of the FLAC frame starting at frameStart by running the CRC-16 over it. The CRC-16 of a frame including it's footer is 0, so the
+end is the first position where that is the case and it's followed by a sync code or the end of the data. Returns 0 if it can't be found.
+*/
+static size_t decode_test__find_end_of_flac_frame(const drflac_uint8* pData, size_t dataSize, size_t frameStart)
+{
+    drflac_uint16 crc16 = 0;
+    size_t i;
+
+    for (i = frameStart; i < dataSize; i += 1) {
+        crc16 = drflac_crc16_byte(crc16, pData[i]);
+        if (crc16 == 0 && (i - frameStart) > 4) {
+            if (i + 1 == dataSize || (i + 2 < dataSize && pData[i + 1] == 0xFF && (pData[i + 2] & 0xFE) == 0xF8)) {
+                return i + 1;
+            }
+        }
+    }
+
+    return 0;
+}
+#endif
+
+drflac_result decode_test_file_frame_error_policy(libflac* pLibFlac, const char* pFilePath)
+{
+#ifndef DR_FLAC_NO_CRC
+    /*
+    This tests how a frame that fails to decode is handled. The CRC-16 at the end of the second frame is corrupted, which should fire the callback
+    exactly once for that frame. With the skip policy the output is the reference minus the frame, and with the silence policy the frame is zeroed.
+    */
+    drflac_result result = DRFLAC_SUCCESS;
+    drflac_uint8* pFileData;
+    size_t fileSizeInBytes;
+    size_t frameEnd;
+    drflac* pFlac;
+    drflac_int32* pPCMFrames;
+    drflac_uint64 pcmFramesRead;
+    drflac_uint64 firstPCMFrameAfterBadFrame;
+    frame_error_test_state state;
+    int policy;
+
+    pFileData = (drflac_uint8*)dr_open_and_read_file(pFilePath, &fileSizeInBytes);
+    if (pFileData == NULL) {
+        printf("  Failed to load file");
+        return DRFLAC_ERROR;
+    }
+
+    pFlac = drflac_open_memory(pFileData, fileSizeInBytes, NULL);
+    if (pFlac == NULL) {
+        free(pFileData);
+        printf("  [dr_flac] Failed to open file from memory");
+        return DRFLAC_ERROR;
+    }
+
+    /* Finding frames by scanning only works for native streams. */
+    if (pFlac->container != drflac_container_native) {
+        drflac_close(pFlac);
+        free(pFileData);
+        return DRFLAC_SUCCESS;
+    }
+
+    /* Corrupt the second frame, or the first if there's only one so we can still test something. */
+    frameEnd = decode_test__find_end_of_flac_frame(pFileData, fileSizeInBytes, (size_t)pFlac->firstFLACFramePosInBytes);
+    if (frameEnd != 0 && frameEnd < fileSizeInBytes) {
+        size_t nextFrameEnd = decode_test__find_end_of_flac_frame(pFileData, fileSizeInBytes, frameEnd);
+        if (nextFrameEnd != 0) {
+            frameEnd = nextFrameEnd;
+        }
+    }
+
+    drflac_close(pFlac);
+
+    if (frameEnd == 0) {
+        free(pFileData);
+        printf("  Could not find the end of a FLAC frame");
+        return DRFLAC_ERROR;
+    }
+
+    pFileData[frameEnd - 1] ^= 0xFF;
+
+    pPCMFrames = (drflac_int32*)malloc((size_t)((pLibFlac->pcmFrameCount + 1) * pLibFlac->channels * sizeof(drflac_int32)));
+    if (pPCMFrames == NULL) {
+        free(pFileData);
+        printf("  Out of memory");
+        return DRFLAC_ERROR;
+    }
+
+    for (policy = drflac_frame_error_policy_skip; policy <= drflac_frame_error_policy_silence && result == DRFLAC_SUCCESS; policy += 1) {
+        pFlac = drflac_open_memory(pFileData, fileSizeInBytes, NULL);
+        if (pFlac == NULL) {
+            printf("  [dr_flac] Failed to open corrupted file");
+            result = DRFLAC_ERROR;
+            break;
+        }
+
+        DRFLAC_ZERO_MEMORY(&state, sizeof(state));
+        drflac_set_frame_error_policy(pFlac, (drflac_frame_error_policy)policy, decode_test__on_frame_error, &state);
+
+        pcmFramesRead = drflac_read_pcm_frames_s32(pFlac, pLibFlac->pcmFrameCount + 1, pPCMFrames);
+        drflac_close(pFlac);
+
+        if (state.callbackCount != 1 || state.firstPCMFrame + state.pcmFrameCount > pLibFlac->pcmFrameCount) {
+            printf("  Bad frame not reported correctly: policy=%d, callbackCount=%d, firstPCMFrame=%d, pcmFrameCount=%d", policy, (int)state.callbackCount, (int)state.firstPCMFrame, (int)state.pcmFrameCount);
+            result = DRFLAC_ERROR;
+            break;
+        }
+
+        /* Everything before the bad frame must be intact. */
+        result = decode_test__compare_pcm_frames_with_libflac_s32(pLibFlac, 0, pPCMFrames, state.firstPCMFrame);
+        if (result != DRFLAC_SUCCESS) {
+            break;
+        }
+
+        firstPCMFrameAfterBadFrame = state.firstPCMFrame + state.pcmFrameCount;
+
+        if (policy == drflac_frame_error_policy_skip) {
+            if (pcmFramesRead != pLibFlac->pcmFrameCount - state.pcmFrameCount) {
+                printf("  Decoded frame counts differ: policy=skip, expected=%d, dr_flac=%d", (int)(pLibFlac->pcmFrameCount - state.pcmFrameCount), (int)pcmFramesRead);
+                result = DRFLAC_ERROR;
+                break;
+            }
+
+            result = decode_test__compare_pcm_frames_with_libflac_s32(pLibFlac, firstPCMFrameAfterBadFrame, pPCMFrames + (state.firstPCMFrame * pLibFlac->channels), pLibFlac->pcmFrameCount - firstPCMFrameAfterBadFrame);
+        } else {
+            drflac_uint64 iSample;
+
+            if (pcmFramesRead != pLibFlac->pcmFrameCount) {
+                printf("  Decoded frame counts differ: policy=silence, expected=%d, dr_flac=%d", (int)pLibFlac->pcmFrameCount, (int)pcmFramesRead);
+                result = DRFLAC_ERROR;
+                break;
+            }
+
+            for (iSample = state.firstPCMFrame * pLibFlac->channels; iSample < firstPCMFrameAfterBadFrame * pLibFlac->channels; iSample += 1) {
+                if (pPCMFrames[iSample] != 0) {
+                    printf("  Bad frame was not replaced with silence @ %d", (int)(iSample / pLibFlac->channels));
+                    result = DRFLAC_ERROR;
+                    break;
+                }
+            }
+
+            if (result == DRFLAC_SUCCESS) {
+                result = decode_test__compare_pcm_frames_with_libflac_s32(pLibFlac, firstPCMFrameAfterBadFrame, pPCMFrames + (firstPCMFrameAfterBadFrame * pLibFlac->channels), pLibFlac->pcmFrameCount - firstPCMFrameAfterBadFrame);
+            }
+        }
+    }
+
+    free(pPCMFrames);
+    free(pFileData);
+
+    return result;
+#else
+    (void)pLibFlac;
+    (void)pFilePath;
+    return DRFLAC_SUCCESS;  /* Bad frames can't be detected without CRC checks. */
+#endif
+}
+
 drflac_result decode_test_file(const char* pFilePath)
 {
     /* To test seeking we just seek to our target PCM frame and then decode whatever is remaining and compare it against libFLAC. */
@@ -362,6 +653,20 @@ drflac_result decode_test_file(const char* pFilePath)
         return result;
     }
 
+    result = decode_test_file_clone(&libflac, pFilePath);
+    if (result != DRFLAC_SUCCESS) {
+        drflac_close(pFlac);
+        libflac_uninit(&libflac);
+        return result;
+    }
+
+    result = decode_test_file_frame_error_policy(&libflac, pFilePath);
+    if (result != DRFLAC_SUCCESS) {
+        drflac_close(pFlac);
+        libflac_uninit(&libflac);
+        return result;
+    }
+
 
     /* We're done with our decoders. */
     drflac_close(pFlac);
@@ -628,6 +933,182 @@ drflac_result open_and_read_test()
 
 
 
+typedef struct
+{
+    char filePath[256];
+    void* pFileData;
+    size_t fileSizeInBytes;
+    drflac_int32* pPCMFrames;   /* The output of drflac_open_file_and_read_pcm_frames_s32() which the output of the batch is compared against. */
+    drflac_uint64 pcmFrameCount;
+    drflac_uint32 channels;
+    drflac_uint64 queriedTotalPCMFrameCount;   /* The total PCM frame count retrieved by the batch when no output buffer was specified. */
+    drflac_uint32 queriedChannels;
+} batch_test_file;
+
+drflac_result batch_test_compare_item(const batch_test_file* pFile, const drflac_batch_item* pItem)
+{
+    if (pFile->pPCMFrames == NULL) {
+        /* The file could not be decoded individually so the batch should have failed on it as well. */
+        if (pItem->isSuccessful) {
+            printf("  Batch succeeded where drflac_open_file_and_read_pcm_frames_s32() failed.");
+            return DRFLAC_ERROR;
+        }
+
+        return DRFLAC_SUCCESS;
+    }
+
+    if (!pItem->isSuccessful) {
+        printf("  Batch failed.");
+        return DRFLAC_ERROR;
+    }
+
+    if (pFile->queriedChannels != pFile->channels || (pFile->queriedTotalPCMFrameCount != 0 && pFile->queriedTotalPCMFrameCount != pFile->pcmFrameCount)) {
+        printf("  Queried properties differ: channels=%d/%d, totalPCMFrameCount=%d/%d", (int)pFile->channels, (int)pFile->queriedChannels, (int)pFile->pcmFrameCount, (int)pFile->queriedTotalPCMFrameCount);
+        return DRFLAC_ERROR;
+    }
+
+    if (pItem->channels != pFile->channels || pItem->pcmFramesRead != pFile->pcmFrameCount) {
+        printf("  Properties differ: channels=%d/%d, pcmFrameCount=%d/%d", (int)pFile->channels, (int)pItem->channels, (int)pFile->pcmFrameCount, (int)pItem->pcmFramesRead);
+        return DRFLAC_ERROR;
+    }
+
+    if (memcmp(pFile->pPCMFrames, pItem->pPCMFramesOut, (size_t)(pFile->pcmFrameCount * pFile->channels * sizeof(drflac_int32))) != 0) {
+        printf("  Decoded PCM frames do not match.");
+        return DRFLAC_ERROR;
+    }
+
+    return DRFLAC_SUCCESS;
+}
+
+drflac_result batch_test_directory(const char* pDirectoryPath)
+{
+    dr_file_iterator iteratorState;
+    dr_file_iterator* pFile;
+    batch_test_file* pFiles;
+    drflac_batch_item* pItems;
+    drflac_uint32 fileCount;
+    drflac_uint32 iFile;
+    drflac_result result = DRFLAC_SUCCESS;
+
+    dr_printf_fixed(FILE_NAME_WIDTH, "%s", pDirectoryPath);
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "RESULT");
+    printf("\n");
+
+    /* The whole directory is decoded in a single batch so we need to know the file count up front. */
+    fileCount = 0;
+    pFile = dr_file_iterator_begin(pDirectoryPath, &iteratorState);
+    while (pFile != NULL) {
+        if (!pFile->isDirectory) {
+            fileCount += 1;
+        }
+
+        pFile = dr_file_iterator_next(pFile);
+    }
+
+    if (fileCount == 0) {
+        return DRFLAC_SUCCESS;
+    }
+
+    pFiles = (batch_test_file*)calloc(fileCount, sizeof(*pFiles));
+    pItems = (drflac_batch_item*)calloc(fileCount, sizeof(*pItems));
+    if (pFiles == NULL || pItems == NULL) {
+        free(pFiles);
+        free(pItems);
+        printf("  Out of memory");
+        return DRFLAC_ERROR;
+    }
+
+    /*
+    Every file is decoded individually first so we have something to compare against. Half of the items are opened from their path and the
+    other half from memory so that both paths are covered.
+    */
+    iFile = 0;
+    pFile = dr_file_iterator_begin(pDirectoryPath, &iteratorState);
+    while (pFile != NULL && iFile < fileCount) {
+        if (!pFile->isDirectory) {
+            unsigned int channels = 0;
+            unsigned int sampleRate = 0;
+
+            dr_strcpy_s(pFiles[iFile].filePath, sizeof(pFiles[iFile].filePath), pFile->absolutePath);
+            pFiles[iFile].pPCMFrames = drflac_open_file_and_read_pcm_frames_s32(pFiles[iFile].filePath, &channels, &sampleRate, &pFiles[iFile].pcmFrameCount, NULL);
+            pFiles[iFile].channels   = channels;
+
+            if ((iFile & 1) == 0) {
+                pItems[iFile].pFilePath = pFiles[iFile].filePath;
+            } else {
+                pFiles[iFile].pFileData = dr_open_and_read_file(pFiles[iFile].filePath, &pFiles[iFile].fileSizeInBytes);
+                pItems[iFile].pData     = pFiles[iFile].pFileData;
+                pItems[iFile].dataSize  = pFiles[iFile].fileSizeInBytes;
+            }
+
+            iFile += 1;
+        }
+
+        pFile = dr_file_iterator_next(pFile);
+    }
+
+    fileCount = iFile;
+
+    /* A batch without any output buffers only retrieves the properties of each stream. */
+    drflac_decode_batch(pItems, fileCount, NULL);
+
+    for (iFile = 0; iFile < fileCount; iFile += 1) {
+        pFiles[iFile].queriedTotalPCMFrameCount = pItems[iFile].totalPCMFrameCount;
+        pFiles[iFile].queriedChannels           = pItems[iFile].channels;
+
+        pItems[iFile].pcmFrameCapacity = pFiles[iFile].pcmFrameCount;
+        pItems[iFile].pPCMFramesOut    = (drflac_int32*)malloc((size_t)((pFiles[iFile].pcmFrameCount * pFiles[iFile].channels + 1) * sizeof(drflac_int32)));
+    }
+
+    /* Now decode for real. */
+    drflac_decode_batch(pItems, fileCount, NULL);
+
+    for (iFile = 0; iFile < fileCount; iFile += 1) {
+        drflac_result fileResult;
+
+        dr_printf_fixed_with_margin(FILE_NAME_WIDTH, TABLE_MARGIN, "%s", dr_path_file_name(pFiles[iFile].filePath));
+
+        if (pItems[iFile].pPCMFramesOut == NULL) {
+            printf("  Out of memory");
+            fileResult = DRFLAC_ERROR;
+        } else {
+            fileResult = batch_test_compare_item(&pFiles[iFile], &pItems[iFile]);
+        }
+
+        if (fileResult == DRFLAC_SUCCESS) {
+            printf("  Passed");
+        } else {
+            result = fileResult;
+        }
+
+        printf("\n");
+
+        free(pItems[iFile].pPCMFramesOut);
+        free(pFiles[iFile].pFileData);
+        drflac_free(pFiles[iFile].pPCMFrames, NULL);
+    }
+
+    free(pItems);
+    free(pFiles);
+
+    return result;
+}
+
+drflac_result batch_test()
+{
+    drflac_result result = DRFLAC_SUCCESS;
+
+    /* Directories. */
+    {
+        result = batch_test_directory(DEFAULT_SOURCE_DIR);
+        (void)result;
+    }
+
+    return result;
+}
+
+
+
 drflac_result decode_profiling_file(const char* pFilePath)
 {
     drflac_result result;
@@ -773,6 +1254,15 @@ int main(int argc, char** argv)
             return (int)result;    /* Don't continue if an error occurs during testing. */
         }
         printf("\n");
+
+        printf("=======================================================================\n");
+        printf("BATCH TESTING - drflac_decode_batch()\n");
+        printf("=======================================================================\n");
+        result = batch_test();
+        if (result != DRFLAC_SUCCESS) {
+            return (int)result;    /* Don't continue if an error occurs during testing. */
+        }
+        printf("\n");
     } else {
         printf("=======================================================================\n");
         printf("WARNING: Correctness Tests Disabled\n");
@@ -124,14 +124,67 @@ drflac_result seek_test_pcm_frame(libflac* pLibFlac, drflac* pFlac, drflac_uint6
     return DRFLAC_SUCCESS;
 }
 
+drflac_result seek_test_pcm_frames(libflac* pLibFlac, drflac* pFlac, drflac_uint32 iterationCount)
+{
+    drflac_result result = DRFLAC_SUCCESS;
+    drflac_uint32 iteration;
+
+    /* Start with the basics: Seek to the very end, and then the very start. */
+    if (result == DRFLAC_SUCCESS) {
+        result = seek_test_pcm_frame(pLibFlac, pFlac, pLibFlac->pcmFrameCount);
+    }
+    if (result == DRFLAC_SUCCESS) {
+        result = seek_test_pcm_frame(pLibFlac, pFlac, 0);
+    }
+
+    /* Now we'll try seeking to random locations. */
+    dr_seed(1234);
+
+    iteration = 0;
+    while (result == DRFLAC_SUCCESS && iteration < iterationCount) {
+        int targetPCMFrame = dr_rand_range_s32(0, (int)pLibFlac->pcmFrameCount);
+        if (targetPCMFrame > pLibFlac->pcmFrameCount) {
+            DRFLAC_ASSERT(DRFLAC_FALSE);    /* Should never hit this, but if we do it means our random number generation routine is wrong. */
+        }
+
+        result = seek_test_pcm_frame(pLibFlac, pFlac, (drflac_uint64)targetPCMFrame);
+        iteration += 1;
+    }
+
+    return result;
+}
+
+drflac_result seek_test_pcm_frames_with_frame_cache(libflac* pLibFlac, drflac* pFlac, size_t cacheSizeInBytes, drflac_uint32 iterationCount)
+{
+    drflac_result result;
+
+    if (!drflac_set_frame_cache_size(pFlac, cacheSizeInBytes)) {
+        printf("  Failed to set frame cache size to %d bytes", (int)cacheSizeInBytes);
+        return DRFLAC_ERROR;
+    }
+
+    /*
+    The same seeks are run twice. The first pass fills the cache and the second is mostly served from it. Every seek is compared against
+    libFLAC so cached frames need to be identical to freshly decoded ones.
+    */
+    result = seek_test_pcm_frames(pLibFlac, pFlac, iterationCount);
+    if (result == DRFLAC_SUCCESS) {
+        result = seek_test_pcm_frames(pLibFlac, pFlac, iterationCount);
+    }
+
+    drflac_set_frame_cache_size(pFlac, 0);
+
+    return result;
+}
+
 drflac_result seek_test_file(const char* pFilePath)
 {
     /* To test seeking we just seek to our target PCM frame and then decode whatever is remaining and compare it against libFLAC. */
     drflac_result result;
     libflac libflac;
     drflac* pFlac;
-    drflac_uint32 iteration;
     drflac_uint32 totalIterationCount = 10;
+    size_t frameSizeInBytes;
 
     dr_printf_fixed_with_margin(PROFILING_NAME_WIDTH, PROFILING_NUMBER_MARGIN, "%s", dr_path_file_name(pFilePath));
 
@@ -155,28 +208,22 @@ drflac_result seek_test_file(const char* pFilePath)
     pFlac->_noBinarySearchSeek = DRFLAC_FALSE;
     pFlac->_noBruteForceSeek   = DRFLAC_FALSE;
 
+    /* The size of a single decoded frame. This is used for sizing the frame cache. */
+    frameSizeInBytes = (size_t)pFlac->maxBlockSizeInPCMFrames * pFlac->channels * sizeof(drflac_int32);
+
     /* At this point we should have both libFLAC and dr_flac decoders open. We can now perform identical operations on each of them and compare. */
 
-    /* Start with the basics: Seek to the very end, and then the very start. */
+    result = seek_test_pcm_frames(&libflac, pFlac, totalIterationCount);
+
+    /*
+    Now do it again with the frame cache enabled. The small cache only holds a couple of frames so it's constantly evicting, whereas the large
+    one can hold the entire stream.
+    */
     if (result == DRFLAC_SUCCESS) {
-        result = seek_test_pcm_frame(&libflac, pFlac, libflac.pcmFrameCount);
+        result = seek_test_pcm_frames_with_frame_cache(&libflac, pFlac, frameSizeInBytes * 3, totalIterationCount);
     }
     if (result == DRFLAC_SUCCESS) {
-        result = seek_test_pcm_frame(&libflac, pFlac, 0);
-    }
-
-    /* Now we'll try seeking to random locations. */
-    dr_seed(1234);
-
-    iteration = 0;
-    while (result == DRFLAC_SUCCESS && iteration < totalIterationCount) {
-        int targetPCMFrame = dr_rand_range_s32(0, (int)libflac.pcmFrameCount);
-        if (targetPCMFrame > libflac.pcmFrameCount) {
-            DRFLAC_ASSERT(DRFLAC_FALSE);    /* Should never hit this, but if we do it means our random number generation routine is wrong. */
-        }
-
-        result = seek_test_pcm_frame(&libflac, pFlac, (drflac_uint64)targetPCMFrame);
-        iteration += 1;
+        result = seek_test_pcm_frames_with_frame_cache(&libflac, pFlac, (size_t)(frameSizeInBytes * ((libflac.pcmFrameCount / pFlac->maxBlockSizeInPCMFrames) + 2)), totalIterationCount);
     }
 
     /* We're done with our decoders. */
@@ -2,3 +2,27 @@
 #include "../../dr_mp3.h"
 
 #include "../common/dr_common.c"
+
+
+/* Helper for printing CPU caps from dr_mp3. */
+void print_cpu_caps()
+{
+    printf("%s\n", (sizeof(void*) == 8) ? "64 Bit" : "32 Bit");
+
+#if defined(DR_MP3_FIXED_POINT)
+    printf("Output:       Fixed point s16\n");
+#elif defined(DR_MP3_FLOAT_OUTPUT)
+    printf("Output:       f32\n");
+#else
+    printf("Output:       s16\n");
+#endif
+
+#if DRMP3_HAVE_SIMD
+    printf("Has SIMD:     %s\n", drmp3_have_simd() ? "YES" : "NO");
+#else
+    printf("Has SIMD:     NO\n");
+#endif
+#if DRMP3_HAVE_AVX
+    printf("Has AVX:      %s\n", drmp3_have_avx() ? "YES" : "NO");
+#endif
+}
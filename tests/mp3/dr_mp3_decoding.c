@@ -0,0 +1,865 @@
+/*#define DR_MP3_NO_SIMD*/
+/*#define DR_MP3_FLOAT_OUTPUT*/
+/*#define DR_MP3_FIXED_POINT*/
+#include "dr_mp3_common.c"
+
+#define FILE_NAME_WIDTH 40
+#define NUMBER_WIDTH    12
+#define TABLE_MARGIN    2
+
+#define DEFAULT_SOURCE_DIR  "testvectors/mp3/tests"
+
+#define SEEK_TEST_COUNT         100     /* The number of random seeks done on each file when testing and profiling seeking. */
+#define SEEK_TEST_READ_SIZE     1152    /* The number of PCM frames read and compared after each seek. */
+
+/*
+The largest difference allowed between a sample from dr_mp3 and the same sample from the lowlevel reference, which is 2 LSB at 16
+bits. Only the first read, which is a linear read from a freshly initialized decoder, is required to match exactly. Everything else
+comes after a seek, and seeking decodes the frames leading up to the target differently to a linear read. It may skip synthesis of
+those frames or start the bit reservoir from a seek point, so the output is only required to match what a client would hear.
+*/
+#define PCM_FRAME_TOLERANCE_F32 (2/32768.0f)
+
+
+/*
+The lowlevel object is the reference the high level API is compared against. It decodes the entire file into memory with
+drmp3dec_decode_frame() upon initialization, starting from the first frame found by drmp3_init() and trimming the encoder
+delay and padding the same way drmp3_read_pcm_frames_f32() does, so a linear read from both should be identical. The time spent
+in drmp3dec_decode_frame() is recorded which makes it the baseline for profiling.
+*/
+typedef struct
+{
+    float* pPCMFrames;              /* Interleaved. */
+    drmp3_uint64 pcmFrameCount;
+    drmp3_uint64 pcmFrameCap;       /* The capacity of the pPCMFrames buffer in PCM frames. */
+    drmp3_uint32 channels;
+    drmp3_uint32 sampleRate;
+    double decodeTimeInSeconds;     /* The total amount of time spent in drmp3dec_decode_frame(). This is used for profiling. */
+} lowlevel;
+
+drmp3_result lowlevel_init_memory(const void* pData, size_t dataSize, const drmp3* pMP3, lowlevel* pDecoder)
+{
+    drmp3dec dec;
+    drmp3dec_frame_info info;
+    drmp3d_sample_t pcm[DRMP3_MAX_SAMPLES_PER_FRAME];
+    size_t dataPos;
+    drmp3_uint64 pcmFramesToTrimAtStart = 0;
+    drmp3_uint64 pcmFrameCountFromTag = 0;
+    double decodeTimeBeg;
+    double decodeTimeEnd;
+
+    DRMP3_ZERO_OBJECT(pDecoder);
+
+    /* The tag frame is not audio so we start from the same place as drmp3. */
+    dataPos = (size_t)pMP3->streamStartOffset;
+
+    drmp3dec_init(&dec);
+    for (;;) {
+        int samples;
+        int iSample;
+
+        decodeTimeBeg = dr_timer_now();
+        samples = drmp3dec_decode_frame(&dec, (const drmp3_uint8*)pData + dataPos, (int)DRMP3_MIN(dataSize - dataPos, 0x7FFFFFFF), pcm, &info);
+        decodeTimeEnd = dr_timer_now();
+        pDecoder->decodeTimeInSeconds += decodeTimeEnd - decodeTimeBeg;
+
+        if (info.frame_bytes == 0) {
+            break;  /* End of the stream. */
+        }
+
+        dataPos += info.frame_bytes;
+
+        if (samples == 0) {
+            continue;   /* Skipped data or a frame that couldn't be decoded because the bit reservoir is empty. */
+        }
+
+        if (pDecoder->channels == 0) {
+            pDecoder->channels   = (drmp3_uint32)info.channels;
+            pDecoder->sampleRate = (drmp3_uint32)info.hz;
+        }
+
+        if ((drmp3_uint32)info.channels != pDecoder->channels) {
+            free(pDecoder->pPCMFrames);
+            printf("  [drmp3dec] Channel count changes mid-stream");
+            return DRMP3_ERROR;
+        }
+
+        /* Make sure there's room in the buffer. */
+        if ((pDecoder->pcmFrameCount + samples) > pDecoder->pcmFrameCap) {
+            float* pNewPCMFrames;
+
+            pDecoder->pcmFrameCap *= 2;
+            if (pDecoder->pcmFrameCap < (pDecoder->pcmFrameCount + samples)) {
+                pDecoder->pcmFrameCap = (pDecoder->pcmFrameCount + samples);
+            }
+
+            pNewPCMFrames = (float*)realloc(pDecoder->pPCMFrames, (size_t)(pDecoder->pcmFrameCap * pDecoder->channels * sizeof(float)));
+            if (pNewPCMFrames == NULL) {
+                free(pDecoder->pPCMFrames);
+                printf("  [drmp3dec] Out of memory");
+                return DRMP3_ERROR;
+            }
+
+            pDecoder->pPCMFrames = pNewPCMFrames;
+        }
+
+        /* Converted the same way as drmp3_read_pcm_frames_f32() so the results can be compared exactly. */
+        for (iSample = 0; iSample < samples * info.channels; iSample += 1) {
+        #if defined(DR_MP3_FLOAT_OUTPUT)
+            pDecoder->pPCMFrames[pDecoder->pcmFrameCount*pDecoder->channels + iSample] = pcm[iSample];
+        #else
+            pDecoder->pPCMFrames[pDecoder->pcmFrameCount*pDecoder->channels + iSample] = pcm[iSample] * 0.000030517578125f;
+        #endif
+        }
+
+        pDecoder->pcmFrameCount += samples;
+    }
+
+    /* Gapless streams have their encoder delay and padding trimmed. */
+    if (pMP3->vbrTag.hasGaplessInfo) {
+        pcmFramesToTrimAtStart = DRMP3_MIN(pMP3->vbrTag.delayInPCMFrames, pDecoder->pcmFrameCount);
+
+        if (pMP3->vbrTag.mp3FrameCount > 0) {
+            pcmFrameCountFromTag = pMP3->vbrTag.mp3FrameCount * pMP3->vbrTag.pcmFramesPerMP3Frame;
+            if (pcmFrameCountFromTag > (drmp3_uint64)pMP3->vbrTag.delayInPCMFrames + pMP3->vbrTag.paddingInPCMFrames) {
+                pcmFrameCountFromTag -= (drmp3_uint64)pMP3->vbrTag.delayInPCMFrames + pMP3->vbrTag.paddingInPCMFrames;
+            } else {
+                pcmFrameCountFromTag = 0;
+            }
+        }
+    }
+
+    if (pcmFramesToTrimAtStart > 0) {
+        pDecoder->pcmFrameCount -= pcmFramesToTrimAtStart;
+        memmove(pDecoder->pPCMFrames, pDecoder->pPCMFrames + pcmFramesToTrimAtStart*pDecoder->channels, (size_t)(pDecoder->pcmFrameCount * pDecoder->channels * sizeof(float)));
+    }
+
+    if (pMP3->vbrTag.hasGaplessInfo && pMP3->vbrTag.mp3FrameCount > 0 && pDecoder->pcmFrameCount > pcmFrameCountFromTag) {
+        pDecoder->pcmFrameCount = pcmFrameCountFromTag;
+    }
+
+    if (pDecoder->channels == 0) {
+        printf("  [drmp3dec] No frames decoded");
+        return DRMP3_ERROR;
+    }
+
+    return DRMP3_SUCCESS;
+}
+
+void lowlevel_uninit(lowlevel* pDecoder)
+{
+    free(pDecoder->pPCMFrames);
+}
+
+
+drmp3_result decode_test__compare_pcm_frames_f32(lowlevel* pLowLevel, drmp3_uint64 firstPCMFrame, drmp3_uint64 pcmFrameCount, const float* pPCMFrames_drmp3, float tolerance)
+{
+    drmp3_uint64 iPCMFrame;
+
+    for (iPCMFrame = 0; iPCMFrame < pcmFrameCount; iPCMFrame += 1) {
+        const float* pPCMFrame_lowlevel = pLowLevel->pPCMFrames + ((firstPCMFrame + iPCMFrame) * pLowLevel->channels);
+        const float* pPCMFrame_drmp3    = pPCMFrames_drmp3      + (                iPCMFrame  * pLowLevel->channels);
+        drmp3_uint32 iChannel;
+
+        for (iChannel = 0; iChannel < pLowLevel->channels; iChannel += 1) {
+            float difference = pPCMFrame_drmp3[iChannel] - pPCMFrame_lowlevel[iChannel];
+            if (difference > tolerance || difference < -tolerance) {
+                printf("  PCM Frame @ %d[%d] does not match (off by %g)", (int)(firstPCMFrame + iPCMFrame), iChannel, difference);
+                return DRMP3_ERROR;
+            }
+        }
+    }
+
+    return DRMP3_SUCCESS;
+}
+
+drmp3_result decode_test__read_and_compare_pcm_frame_chunks_f32(lowlevel* pLowLevel, drmp3* pMP3, drmp3_uint64 pcmFrameChunkSize, float tolerance)
+{
+    drmp3_result result = DRMP3_SUCCESS;
+    drmp3_uint64 totalPCMFrameCount = 0;
+    float* pPCMFrames;
+
+    pPCMFrames = (float*)malloc((size_t)(pcmFrameChunkSize * pLowLevel->channels * sizeof(float)));
+    if (pPCMFrames == NULL) {
+        printf("  [dr_mp3] Out of memory");
+        return DRMP3_ERROR;
+    }
+
+    for (;;) {
+        drmp3_uint64 pcmFrameCount = drmp3_read_pcm_frames_f32(pMP3, pcmFrameChunkSize, pPCMFrames);
+        if (pcmFrameCount == 0) {
+            break;
+        }
+
+        if (totalPCMFrameCount + pcmFrameCount > pLowLevel->pcmFrameCount) {
+            printf("  Decoded too many frames: chunkSize=%d, drmp3dec=%d, dr_mp3=%d+", (int)pcmFrameChunkSize, (int)pLowLevel->pcmFrameCount, (int)(totalPCMFrameCount + pcmFrameCount));
+            result = DRMP3_ERROR;
+            break;
+        }
+
+        result = decode_test__compare_pcm_frames_f32(pLowLevel, totalPCMFrameCount, pcmFrameCount, pPCMFrames, tolerance);
+        if (result != DRMP3_SUCCESS) {
+            break;
+        }
+
+        totalPCMFrameCount += pcmFrameCount;
+    }
+
+    if (result == DRMP3_SUCCESS && totalPCMFrameCount != pLowLevel->pcmFrameCount) {
+        printf("  Decoded frame counts differ: chunkSize=%d, drmp3dec=%d, dr_mp3=%d", (int)pcmFrameChunkSize, (int)pLowLevel->pcmFrameCount, (int)totalPCMFrameCount);
+        result = DRMP3_ERROR;
+    }
+
+    free(pPCMFrames);
+    return result;
+}
+
+drmp3_result decode_test__seek_to_start_f32(drmp3* pMP3)
+{
+    if (!drmp3_seek_to_pcm_frame(pMP3, 0)) {
+        printf("  Failed to seek to the start");
+        return DRMP3_ERROR;
+    }
+
+    return DRMP3_SUCCESS;
+}
+
+drmp3_result decode_test__seek_and_compare_f32(lowlevel* pLowLevel, drmp3* pMP3)
+{
+    drmp3_result result = DRMP3_SUCCESS;
+    float pPCMFrames[SEEK_TEST_READ_SIZE * 2];
+    int iSeek;
+
+    if (pLowLevel->pcmFrameCount == 0) {
+        return DRMP3_SUCCESS;   /* Nothing to seek to. */
+    }
+
+    dr_seed(4321);
+
+    for (iSeek = 0; iSeek < SEEK_TEST_COUNT; iSeek += 1) {
+        drmp3_uint64 targetPCMFrame = (drmp3_uint64)dr_rand_range_s32(0, (int)pLowLevel->pcmFrameCount - 1);
+        drmp3_uint64 pcmFrameCount;
+
+        if (!drmp3_seek_to_pcm_frame(pMP3, targetPCMFrame)) {
+            printf("  Failed to seek to PCM frame %d", (int)targetPCMFrame);
+            return DRMP3_ERROR;
+        }
+
+        pcmFrameCount = drmp3_read_pcm_frames_f32(pMP3, SEEK_TEST_READ_SIZE, pPCMFrames);
+        if (pcmFrameCount != DRMP3_MIN(SEEK_TEST_READ_SIZE, pLowLevel->pcmFrameCount - targetPCMFrame)) {
+            printf("  Wrong frame count after seeking to PCM frame %d: %d", (int)targetPCMFrame, (int)pcmFrameCount);
+            return DRMP3_ERROR;
+        }
+
+        result = decode_test__compare_pcm_frames_f32(pLowLevel, targetPCMFrame, pcmFrameCount, pPCMFrames, PCM_FRAME_TOLERANCE_F32);
+        if (result != DRMP3_SUCCESS) {
+            printf(" after seeking to PCM frame %d", (int)targetPCMFrame);
+            return result;
+        }
+    }
+
+    return result;
+}
+
+drmp3_result decode_test_file_f32(lowlevel* pLowLevel, drmp3* pMP3)
+{
+    drmp3_result result = DRMP3_SUCCESS;
+
+    /* Start with reading the entire file in one go. The decoder hasn't been used yet so this must match exactly. */
+    if (result == DRMP3_SUCCESS) {
+        result = decode_test__read_and_compare_pcm_frame_chunks_f32(pLowLevel, pMP3, pLowLevel->pcmFrameCount, 0);
+    }
+
+    /* Now try with reading one PCM frame at a time. This and the next test start with a seek back to the start. */
+    if (result == DRMP3_SUCCESS) {
+        result = decode_test__seek_to_start_f32(pMP3);
+    }
+    if (result == DRMP3_SUCCESS) {
+        result = decode_test__read_and_compare_pcm_frame_chunks_f32(pLowLevel, pMP3, 1, PCM_FRAME_TOLERANCE_F32);
+    }
+
+    /* Now test MP3 frame boundaries. */
+    if (result == DRMP3_SUCCESS) {
+        result = decode_test__seek_to_start_f32(pMP3);
+    }
+    if (result == DRMP3_SUCCESS) {
+        result = decode_test__read_and_compare_pcm_frame_chunks_f32(pLowLevel, pMP3, DRMP3_MAX_PCM_FRAMES_PER_MP3_FRAME, PCM_FRAME_TOLERANCE_F32);
+    }
+
+    return result;
+}
+
+drmp3_result decode_test_file(const char* pFilePath)
+{
+    drmp3_result result;
+    lowlevel lowlevel;
+    drmp3 mp3;
+    void* pFileData;
+    size_t fileSizeInBytes;
+    drmp3_uint32 seekPointCount;
+    drmp3_seek_point* pSeekPoints;
+
+    dr_printf_fixed_with_margin(FILE_NAME_WIDTH, TABLE_MARGIN, "%s", dr_path_file_name(pFilePath));
+
+    pFileData = dr_open_and_read_file(pFilePath, &fileSizeInBytes);
+    if (pFileData == NULL) {
+        printf("  Failed to load file");
+        return DRMP3_ERROR;
+    }
+
+    if (!drmp3_init_memory(&mp3, pFileData, fileSizeInBytes, NULL)) {
+        free(pFileData);
+        printf("  Failed to open via dr_mp3.");
+        return DRMP3_ERROR;
+    }
+
+    result = lowlevel_init_memory(pFileData, fileSizeInBytes, &mp3, &lowlevel);
+    if (result != DRMP3_SUCCESS) {
+        drmp3_uninit(&mp3);
+        free(pFileData);
+        return result;
+    }
+
+    /* At this point we should have both decoders ready. We can now read from dr_mp3 in different ways and compare. */
+    result = decode_test_file_f32(&lowlevel, &mp3);
+
+    /* Seeking without a seek table. The table of contents isn't used since drmp3_set_seek_mode() is never called. */
+    if (result == DRMP3_SUCCESS) {
+        result = decode_test__seek_and_compare_f32(&lowlevel, &mp3);
+    }
+
+    /* Seeking with a seek table. */
+    if (result == DRMP3_SUCCESS) {
+        seekPointCount = (drmp3_uint32)(lowlevel.pcmFrameCount / lowlevel.sampleRate) + 1;
+        pSeekPoints = (drmp3_seek_point*)malloc(seekPointCount * sizeof(*pSeekPoints));
+        if (pSeekPoints == NULL) {
+            printf("  Out of memory");
+            result = DRMP3_ERROR;
+        } else {
+            if (!drmp3_calculate_seek_points(&mp3, &seekPointCount, pSeekPoints) || !drmp3_bind_seek_table(&mp3, seekPointCount, pSeekPoints)) {
+                printf("  Failed to calculate seek points");
+                result = DRMP3_ERROR;
+            } else {
+                result = decode_test__seek_and_compare_f32(&lowlevel, &mp3);
+            }
+
+            drmp3_bind_seek_table(&mp3, 0, NULL);
+            free(pSeekPoints);
+        }
+    }
+
+    /* We're done with our decoders. */
+    lowlevel_uninit(&lowlevel);
+    drmp3_uninit(&mp3);
+    free(pFileData);
+
+    if (result == DRMP3_SUCCESS) {
+        printf("  Passed");
+    }
+
+    return result;
+}
+
+drmp3_result decode_test_directory(const char* pDirectoryPath)
+{
+    dr_file_iterator iteratorState;
+    dr_file_iterator* pFile;
+    drmp3_bool32 foundError = DRMP3_FALSE;
+
+    dr_printf_fixed(FILE_NAME_WIDTH, "%s", pDirectoryPath);
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "RESULT");
+    printf("\n");
+
+    pFile = dr_file_iterator_begin(pDirectoryPath, &iteratorState);
+    while (pFile != NULL) {
+        drmp3_result result;
+
+        /* Skip directories for now, but we may want to look at doing recursive file iteration. */
+        if (!pFile->isDirectory) {
+            result = decode_test_file(pFile->absolutePath);
+            if (result != DRMP3_SUCCESS) {
+                foundError = DRMP3_TRUE;
+            }
+
+            printf("\n");
+        }
+
+        pFile = dr_file_iterator_next(pFile);
+    }
+
+    return (foundError) ? DRMP3_ERROR : DRMP3_SUCCESS;
+}
+
+drmp3_result decode_test()
+{
+    drmp3_result result = DRMP3_SUCCESS;
+
+    /* Directories. */
+    {
+        result = decode_test_directory(DEFAULT_SOURCE_DIR);
+    }
+
+    return result;
+}
+
+
+
+/* Totals across every file in the directory, for a summary line at the end of the decode profiling table. */
+typedef struct
+{
+    double fileSizeInMB;
+    double durationInSeconds;
+    double lowlevelDecodeTimeInSeconds;
+    double drmp3DecodeTimeInSeconds;
+} decode_profiling_totals;
+
+void decode_profiling__print_row(double lowlevelDecodeTimeInSeconds, double drmp3DecodeTimeInSeconds, double fileSizeInMB, double durationInSeconds)
+{
+    /* drmp3dec and dr_mp3 decode times. */
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "%.2fms", lowlevelDecodeTimeInSeconds*1000);
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "%.2fms", drmp3DecodeTimeInSeconds*1000);
+
+    /* Difference. */
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "%d%%", (int)(drmp3DecodeTimeInSeconds/lowlevelDecodeTimeInSeconds * 100));
+
+    /* Throughput of dr_mp3, in megabytes of MP3 data per second and as a multiple of the playback speed. */
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "%.2f", fileSizeInMB/drmp3DecodeTimeInSeconds);
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "%.0fx", durationInSeconds/drmp3DecodeTimeInSeconds);
+}
+
+drmp3_result decode_profiling_file(const char* pFilePath, decode_profiling_totals* pTotals)
+{
+    drmp3_result result;
+    lowlevel lowlevel;
+    drmp3 mp3;
+    float* pTempBuffer;
+    double decodeTimeBeg;
+    double decodeTimeEnd;
+    double drmp3DecodeTimeInSeconds;
+    double fileSizeInMB;
+    double durationInSeconds;
+    void* pFileData;
+    size_t fileSizeInBytes;
+
+    dr_printf_fixed_with_margin(FILE_NAME_WIDTH, TABLE_MARGIN, "%s", dr_path_file_name(pFilePath));
+
+    pFileData = dr_open_and_read_file(pFilePath, &fileSizeInBytes);
+    if (pFileData == NULL) {
+        printf("  Failed to load file");
+        return DRMP3_ERROR;    /* Failed to open the file. */
+    }
+
+    if (!drmp3_init_memory(&mp3, pFileData, fileSizeInBytes, NULL)) {
+        free(pFileData);
+        printf("  [dr_mp3] Failed to load file.");
+        return DRMP3_ERROR;
+    }
+
+    /* drmp3dec */
+    result = lowlevel_init_memory(pFileData, fileSizeInBytes, &mp3, &lowlevel);
+    if (result != DRMP3_SUCCESS) {
+        drmp3_uninit(&mp3);
+        free(pFileData);
+        return result;
+    }
+
+    /* dr_mp3 decode time. */
+    pTempBuffer = (float*)malloc((size_t)(lowlevel.pcmFrameCount * lowlevel.channels * sizeof(float)));
+    if (pTempBuffer == NULL) {
+        lowlevel_uninit(&lowlevel);
+        drmp3_uninit(&mp3);
+        free(pFileData);
+        printf("  Out of memory.");
+        return DRMP3_ERROR;    /* Out of memory. */
+    }
+
+    DRMP3_ZERO_MEMORY(pTempBuffer, (size_t)(lowlevel.pcmFrameCount * lowlevel.channels * sizeof(float)));
+
+    decodeTimeBeg = dr_timer_now();
+    drmp3_read_pcm_frames_f32(&mp3, lowlevel.pcmFrameCount, pTempBuffer);
+    decodeTimeEnd = dr_timer_now();
+
+    free(pTempBuffer);
+
+    drmp3DecodeTimeInSeconds = decodeTimeEnd - decodeTimeBeg;
+    fileSizeInMB = fileSizeInBytes / (1024.0*1024.0);
+    durationInSeconds = lowlevel.pcmFrameCount / (double)lowlevel.sampleRate;
+
+    decode_profiling__print_row(lowlevel.decodeTimeInSeconds, drmp3DecodeTimeInSeconds, fileSizeInMB, durationInSeconds);
+
+    pTotals->fileSizeInMB                += fileSizeInMB;
+    pTotals->durationInSeconds           += durationInSeconds;
+    pTotals->lowlevelDecodeTimeInSeconds += lowlevel.decodeTimeInSeconds;
+    pTotals->drmp3DecodeTimeInSeconds    += drmp3DecodeTimeInSeconds;
+
+    lowlevel_uninit(&lowlevel);
+    drmp3_uninit(&mp3);
+    free(pFileData);
+
+    return DRMP3_SUCCESS;
+}
+
+drmp3_result decode_profiling_directory(const char* pDirectoryPath)
+{
+    dr_file_iterator iteratorState;
+    dr_file_iterator* pFile;
+    drmp3_bool32 foundError = DRMP3_FALSE;
+    decode_profiling_totals totals;
+
+    DRMP3_ZERO_OBJECT(&totals);
+
+    dr_printf_fixed(FILE_NAME_WIDTH, "%s", pDirectoryPath);
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "drmp3dec");
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "dr_mp3");
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "");
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "MB/s");
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "Realtime");
+    printf("\n");
+
+    pFile = dr_file_iterator_begin(pDirectoryPath, &iteratorState);
+    while (pFile != NULL) {
+        drmp3_result result;
+
+        /* Skip directories for now, but we may want to look at doing recursive file iteration. */
+        if (!pFile->isDirectory) {
+            result = decode_profiling_file(pFile->absolutePath, &totals);
+            if (result != DRMP3_SUCCESS) {
+                foundError = DRMP3_TRUE;
+            }
+
+            printf("\n");
+        }
+
+        pFile = dr_file_iterator_next(pFile);
+    }
+
+    if (totals.drmp3DecodeTimeInSeconds > 0) {
+        dr_printf_fixed_with_margin(FILE_NAME_WIDTH, TABLE_MARGIN, "TOTAL");
+        decode_profiling__print_row(totals.lowlevelDecodeTimeInSeconds, totals.drmp3DecodeTimeInSeconds, totals.fileSizeInMB, totals.durationInSeconds);
+        printf("\n");
+    }
+
+    return (foundError) ? DRMP3_ERROR : DRMP3_SUCCESS;
+}
+
+drmp3_result decode_profiling()
+{
+    drmp3_result result = DRMP3_SUCCESS;
+
+    /* Directories. */
+    {
+        result = decode_profiling_directory(DEFAULT_SOURCE_DIR);
+    }
+
+    return result;
+}
+
+
+
+/*
+Stage profiling breaks down the time it takes to get through a file with the high level API. Each stage is timed separately on
+a fresh decoder so the times can be compared between versions.
+*/
+drmp3_result stage_profiling_file(const char* pFilePath)
+{
+    drmp3 mp3;
+    void* pFileData;
+    size_t fileSizeInBytes;
+    drmp3_uint64 pcmFrameCount;
+    drmp3_uint32 seekPointCount;
+    drmp3_seek_point* pSeekPoints;
+    float pPCMFrames[4096];
+    double timeBeg;
+    double initTimeInSeconds;
+    double countTimeInSeconds;
+    double seekTableTimeInSeconds;
+    double decodeTimeInSeconds;
+
+    dr_printf_fixed_with_margin(FILE_NAME_WIDTH, TABLE_MARGIN, "%s", dr_path_file_name(pFilePath));
+
+    pFileData = dr_open_and_read_file(pFilePath, &fileSizeInBytes);
+    if (pFileData == NULL) {
+        printf("  Failed to load file");
+        return DRMP3_ERROR;
+    }
+
+    /* Initialization, which includes reading the tags and decoding the first frame. */
+    timeBeg = dr_timer_now();
+    if (!drmp3_init_memory(&mp3, pFileData, fileSizeInBytes, NULL)) {
+        free(pFileData);
+        printf("  [dr_mp3] Failed to load file.");
+        return DRMP3_ERROR;
+    }
+    initTimeInSeconds = dr_timer_now() - timeBeg;
+
+    /* Length. This is a scan of the frame headers unless there's a tag frame with the count. */
+    timeBeg = dr_timer_now();
+    pcmFrameCount = drmp3_get_pcm_frame_count(&mp3);
+    countTimeInSeconds = dr_timer_now() - timeBeg;
+
+    /* Seek table. One seek point per second. */
+    seekPointCount = (drmp3_uint32)(pcmFrameCount / mp3.sampleRate) + 1;
+    pSeekPoints = (drmp3_seek_point*)malloc(seekPointCount * sizeof(*pSeekPoints));
+    if (pSeekPoints == NULL) {
+        drmp3_uninit(&mp3);
+        free(pFileData);
+        printf("  Out of memory.");
+        return DRMP3_ERROR;
+    }
+
+    timeBeg = dr_timer_now();
+    drmp3_calculate_seek_points(&mp3, &seekPointCount, pSeekPoints);
+    seekTableTimeInSeconds = dr_timer_now() - timeBeg;
+
+    free(pSeekPoints);
+
+    /* Decoding, in chunks like a typical streaming client. */
+    drmp3_seek_to_pcm_frame(&mp3, 0);
+    timeBeg = dr_timer_now();
+    while (drmp3_read_pcm_frames_f32(&mp3, DRMP3_COUNTOF(pPCMFrames) / mp3.channels, pPCMFrames) > 0) {
+    }
+    decodeTimeInSeconds = dr_timer_now() - timeBeg;
+
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "%.3fms", initTimeInSeconds*1000);
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "%.3fms", countTimeInSeconds*1000);
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "%.3fms", seekTableTimeInSeconds*1000);
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "%.2fms", decodeTimeInSeconds*1000);
+
+    drmp3_uninit(&mp3);
+    free(pFileData);
+
+    return DRMP3_SUCCESS;
+}
+
+drmp3_result stage_profiling_directory(const char* pDirectoryPath)
+{
+    dr_file_iterator iteratorState;
+    dr_file_iterator* pFile;
+    drmp3_bool32 foundError = DRMP3_FALSE;
+
+    dr_printf_fixed(FILE_NAME_WIDTH, "%s", pDirectoryPath);
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "Init");
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "Length");
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "SeekTable");
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "Decode");
+    printf("\n");
+
+    pFile = dr_file_iterator_begin(pDirectoryPath, &iteratorState);
+    while (pFile != NULL) {
+        drmp3_result result;
+
+        /* Skip directories for now, but we may want to look at doing recursive file iteration. */
+        if (!pFile->isDirectory) {
+            result = stage_profiling_file(pFile->absolutePath);
+            if (result != DRMP3_SUCCESS) {
+                foundError = DRMP3_TRUE;
+            }
+
+            printf("\n");
+        }
+
+        pFile = dr_file_iterator_next(pFile);
+    }
+
+    return (foundError) ? DRMP3_ERROR : DRMP3_SUCCESS;
+}
+
+drmp3_result stage_profiling()
+{
+    drmp3_result result = DRMP3_SUCCESS;
+
+    /* Directories. */
+    {
+        result = stage_profiling_directory(DEFAULT_SOURCE_DIR);
+    }
+
+    return result;
+}
+
+
+
+/*
+Seek profiling measures the average time of a seek to a random position, without and then with a seek table bound. The same
+positions are used for both.
+*/
+double seek_profiling__time_random_seeks(drmp3* pMP3, drmp3_uint64 pcmFrameCount)
+{
+    double timeBeg;
+    double totalTimeInSeconds = 0;
+    int iSeek;
+
+    dr_seed(1234);
+
+    for (iSeek = 0; iSeek < SEEK_TEST_COUNT; iSeek += 1) {
+        drmp3_uint64 targetPCMFrame = (drmp3_uint64)dr_rand_range_s32(0, (int)pcmFrameCount - 1);
+
+        timeBeg = dr_timer_now();
+        drmp3_seek_to_pcm_frame(pMP3, targetPCMFrame);
+        totalTimeInSeconds += dr_timer_now() - timeBeg;
+    }
+
+    return totalTimeInSeconds / SEEK_TEST_COUNT;
+}
+
+drmp3_result seek_profiling_file(const char* pFilePath)
+{
+    drmp3 mp3;
+    void* pFileData;
+    size_t fileSizeInBytes;
+    drmp3_uint64 pcmFrameCount;
+    drmp3_uint32 seekPointCount;
+    drmp3_seek_point* pSeekPoints;
+    double seekTimeInSeconds;
+    double seekTimeWithTableInSeconds;
+
+    dr_printf_fixed_with_margin(FILE_NAME_WIDTH, TABLE_MARGIN, "%s", dr_path_file_name(pFilePath));
+
+    pFileData = dr_open_and_read_file(pFilePath, &fileSizeInBytes);
+    if (pFileData == NULL) {
+        printf("  Failed to load file");
+        return DRMP3_ERROR;
+    }
+
+    if (!drmp3_init_memory(&mp3, pFileData, fileSizeInBytes, NULL)) {
+        free(pFileData);
+        printf("  [dr_mp3] Failed to load file.");
+        return DRMP3_ERROR;
+    }
+
+    pcmFrameCount = drmp3_get_pcm_frame_count(&mp3);
+    if (pcmFrameCount == 0) {
+        drmp3_uninit(&mp3);
+        free(pFileData);
+        printf("  Empty stream.");
+        return DRMP3_ERROR;
+    }
+
+    seekPointCount = (drmp3_uint32)(pcmFrameCount / mp3.sampleRate) + 1;
+    pSeekPoints = (drmp3_seek_point*)malloc(seekPointCount * sizeof(*pSeekPoints));
+    if (pSeekPoints == NULL) {
+        drmp3_uninit(&mp3);
+        free(pFileData);
+        printf("  Out of memory.");
+        return DRMP3_ERROR;
+    }
+
+    /* Without a seek table. */
+    seekTimeInSeconds = seek_profiling__time_random_seeks(&mp3, pcmFrameCount);
+
+    /* With a seek table. */
+    if (!drmp3_calculate_seek_points(&mp3, &seekPointCount, pSeekPoints) || !drmp3_bind_seek_table(&mp3, seekPointCount, pSeekPoints)) {
+        free(pSeekPoints);
+        drmp3_uninit(&mp3);
+        free(pFileData);
+        printf("  Failed to calculate seek points.");
+        return DRMP3_ERROR;
+    }
+
+    seekTimeWithTableInSeconds = seek_profiling__time_random_seeks(&mp3, pcmFrameCount);
+
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "%.3fms", seekTimeInSeconds*1000);
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "%.3fms", seekTimeWithTableInSeconds*1000);
+
+    drmp3_uninit(&mp3);
+    free(pSeekPoints);
+    free(pFileData);
+
+    return DRMP3_SUCCESS;
+}
+
+drmp3_result seek_profiling_directory(const char* pDirectoryPath)
+{
+    dr_file_iterator iteratorState;
+    dr_file_iterator* pFile;
+    drmp3_bool32 foundError = DRMP3_FALSE;
+
+    dr_printf_fixed(FILE_NAME_WIDTH, "%s", pDirectoryPath);
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "No Table");
+    dr_printf_fixed_with_margin(NUMBER_WIDTH, TABLE_MARGIN, "Table");
+    printf("\n");
+
+    pFile = dr_file_iterator_begin(pDirectoryPath, &iteratorState);
+    while (pFile != NULL) {
+        drmp3_result result;
+
+        /* Skip directories for now, but we may want to look at doing recursive file iteration. */
+        if (!pFile->isDirectory) {
+            result = seek_profiling_file(pFile->absolutePath);
+            if (result != DRMP3_SUCCESS) {
+                foundError = DRMP3_TRUE;
+            }
+
+            printf("\n");
+        }
+
+        pFile = dr_file_iterator_next(pFile);
+    }
+
+    return (foundError) ? DRMP3_ERROR : DRMP3_SUCCESS;
+}
+
+drmp3_result seek_profiling()
+{
+    drmp3_result result = DRMP3_SUCCESS;
+
+    /* Directories. */
+    {
+        result = seek_profiling_directory(DEFAULT_SOURCE_DIR);
+    }
+
+    return result;
+}
+
+
+int main(int argc, char** argv)
+{
+    drmp3_result result = DRMP3_SUCCESS;
+    drmp3_bool32 doTesting = DRMP3_TRUE;
+    drmp3_bool32 doProfiling = DRMP3_TRUE;
+
+    /* This program has two main parts. The first is just a normal functionality test. The second is a profiling of the decoder and seeking. */
+    if (dr_argv_is_set(argc, argv, "--onlyprofile")) {
+        doTesting = DRMP3_FALSE;
+    }
+
+    print_cpu_caps();
+
+    if (doTesting) {
+        printf("=======================================================================\n");
+        printf("DECODE TESTING - drmp3_read_pcm_frames_f32() vs drmp3dec_decode_frame()\n");
+        printf("=======================================================================\n");
+        result = decode_test();
+        if (result != DRMP3_SUCCESS) {
+            return (int)result;    /* Don't continue if an error occurs during testing. */
+        }
+        printf("\n");
+    } else {
+        printf("=======================================================================\n");
+        printf("WARNING: Correctness Tests Disabled\n");
+        printf("=======================================================================\n");
+    }
+
+    /* Profiling. */
+    if (doProfiling) {
+        printf("=======================================================================\n");
+        printf("DECODE PROFILING (LOWER IS BETTER)\n");
+        printf("=======================================================================\n");
+        result = decode_profiling();
+        printf("\n");
+
+        printf("=======================================================================\n");
+        printf("STAGE PROFILING (LOWER IS BETTER)\n");
+        printf("=======================================================================\n");
+        result = stage_profiling();
+        printf("\n");
+
+        printf("=======================================================================\n");
+        printf("SEEK PROFILING - AVERAGE PER SEEK (LOWER IS BETTER)\n");
+        printf("=======================================================================\n");
+        result = seek_profiling();
+        printf("\n");
+    }
+
+    /*getchar();*/
+    return (int)result;
+}
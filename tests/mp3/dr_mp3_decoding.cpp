@@ -0,0 +1 @@
+#include "dr_mp3_decoding.c"
\ No newline at end of file